@@ -48,6 +48,9 @@
 /** Maximum active async calls per phone */
 #define IPC_MAX_ASYNC_CALLS  64
 
+/** Maximum number of calls sent or received by one batched syscall */
+#define IPC_BATCH_MAX  64
+
 /* Flags for calls */
 
 /** This is answer to a call */
@@ -71,6 +74,13 @@
  */
 #define DATA_XFER_LIMIT  (64 * 1024)
 
+/**
+ * Maximum buffer size allowed for IPC_M_DATA_WRITE and
+ * IPC_M_DATA_READ requests with the IPC_XF_BULK flag. Buffers which
+ * cannot be transferred directly are limited to DATA_XFER_LIMIT.
+ */
+#define DATA_XFER_BULK_LIMIT  (16 * 1024 * 1024)
+
 /* Macros for manipulating calling data */
 #define IPC_SET_RETVAL(data, retval)  ((data).args[0] = (sysarg_t) (retval))
 #define IPC_SET_IMETHOD(data, val)    ((data).args[0] = (val))
@@ -107,6 +117,12 @@
 /** Restrict the transfer size if necessary. */
 #define IPC_XF_RESTRICT  (1 << 0)
 
+/**
+ * Transfer the data directly between the sender's buffer and the
+ * recipient's buffer without an intermediate kernel buffer.
+ */
+#define IPC_XF_BULK  (1 << 1)
+
 /** User-defined IPC methods */
 #define IPC_FIRST_USER_METHOD  1024
 
@@ -127,6 +143,16 @@ typedef struct {
 	cap_call_handle_t cap_handle;
 } ipc_data_t;
 
+/** Asynchronous call submitted with SYS_IPC_CALL_ASYNC_BATCH */
+typedef struct {
+	/** Phone capability for the call */
+	cap_phone_handle_t phone;
+	/** User-defined label */
+	sysarg_t label;
+	/** Call payload */
+	sysarg_t args[IPC_CALL_LEN];
+} ipc_batch_call_t;
+
 #endif
 
 /** @}
@@ -161,7 +161,7 @@ enum {
 	 * Sender:
 	 *  - uspace: arg1 .. sender's destination buffer address
 	 *            arg2 .. sender's destination buffer size
-	 *            arg3 .. flags (IPC_XF_RESTRICT)
+	 *            arg3 .. flags (IPC_XF_RESTRICT, IPC_XF_BULK)
 	 *            arg4 .. <unused>
 	 *            arg5 .. <unused>
 	 *
@@ -180,7 +180,7 @@ enum {
 	 * Sender:
 	 *  - uspace: arg1 .. sender's source buffer address
 	 *            arg2 .. sender's source buffer size
-	 *            arg3 .. flags (IPC_XF_RESTRICT)
+	 *            arg3 .. flags (IPC_XF_RESTRICT, IPC_XF_BULK)
 	 *            arg4 .. <unused>
 	 *            arg5 .. <unused>
 	 *
@@ -63,11 +63,13 @@ typedef enum {
  *
  */
 typedef struct {
-	unsigned int id;         /**< CPU ID as stored by kernel */
-	bool active;             /**< CPU is activate */
-	uint16_t frequency_mhz;  /**< Frequency in MHz */
-	uint64_t idle_cycles;    /**< Number of idle cycles */
-	uint64_t busy_cycles;    /**< Number of busy cycles */
+	unsigned int id;             /**< CPU ID as stored by kernel */
+	bool active;                 /**< CPU is activate */
+	uint16_t frequency_mhz;      /**< Frequency in MHz */
+	uint64_t idle_cycles;        /**< Number of idle cycles */
+	uint64_t busy_cycles;        /**< Number of busy cycles */
+	uint64_t migrations;         /**< Threads migrated to the CPU */
+	uint64_t migrations_remote;  /**< Of those, threads leaving their LLC */
 } stats_cpu_t;
 
 /** Physical memory statistics
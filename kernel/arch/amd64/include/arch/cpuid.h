@@ -41,9 +41,14 @@
 
 #define INTEL_CPUID_LEVEL     0x00000000
 #define INTEL_CPUID_STANDARD  0x00000001
+#define INTEL_CPUID_CACHE     0x00000004
+#define INTEL_CPUID_TOPOLOGY  0x0000000b
 #define INTEL_CPUID_EXTENDED  0x80000000
 #define INTEL_SSE2            26
 #define INTEL_FXSAVE          24
+#define INTEL_HTT             28
+
+#define AMD_CPUID_CACHE  0x8000001d
 
 #ifndef __ASSEMBLER__
 
@@ -59,6 +64,7 @@ typedef struct {
 extern int has_cpuid(void);
 
 extern void cpuid(uint32_t cmd, cpu_info_t *info);
+extern void cpuid_subleaf(uint32_t cmd, uint32_t subleaf, cpu_info_t *info);
 
 #endif /* !def __ASSEMBLER__ */
 #endif
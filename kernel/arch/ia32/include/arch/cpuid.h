@@ -37,8 +37,14 @@
 
 #define INTEL_CPUID_LEVEL     0x00000000
 #define INTEL_CPUID_STANDARD  0x00000001
+#define INTEL_CPUID_CACHE     0x00000004
+#define INTEL_CPUID_TOPOLOGY  0x0000000b
+#define INTEL_CPUID_EXTENDED  0x80000000
 #define INTEL_PSE             3
 #define INTEL_SEP             11
+#define INTEL_HTT             28
+
+#define AMD_CPUID_CACHE  0x8000001d
 
 #ifndef __ASSEMBLER__
 
@@ -115,6 +121,17 @@ static inline void cpuid(uint32_t cmd, cpu_info_t *info)
 	);
 }
 
+static inline void cpuid_subleaf(uint32_t cmd, uint32_t subleaf,
+    cpu_info_t *info)
+{
+	asm volatile (
+	    "cpuid\n"
+	    : "=a" (info->cpuid_eax), "=b" (info->cpuid_ebx),
+	      "=c" (info->cpuid_ecx), "=d" (info->cpuid_edx)
+	    : "a" (cmd), "c" (subleaf)
+	);
+}
+
 #endif /* !def __ASSEMBLER__ */
 #endif
 
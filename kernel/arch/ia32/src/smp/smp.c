@@ -47,6 +47,8 @@
 #include <halt.h>
 #include <panic.h>
 #include <arch/asm.h>
+#include <arch/cpuid.h>
+#include <bitops.h>
 #include <mm/page.h>
 #include <mm/frame.h>
 #include <mm/km.h>
@@ -81,6 +83,105 @@ void smp_init(void)
 	}
 }
 
+/** Number of APIC ID bits needed to enumerate @a count items. */
+static unsigned int apic_id_bits(uint32_t count)
+{
+	return (count > 1) ? fnzb32(count - 1) + 1 : 0;
+}
+
+/** Find the APIC ID shift of the last-level cache
+ *
+ * @param leaf Deterministic cache parameters CPUID leaf.
+ * @param max  Highest supported CPUID leaf in the respective range.
+ * @param llc  Set to the APIC ID shift of the last-level cache.
+ *
+ * @return True if the leaf described at least one cache.
+ *
+ */
+static bool cpu_llc_shift(uint32_t leaf, uint32_t max, unsigned int *llc)
+{
+	if (max < leaf)
+		return false;
+
+	unsigned int best = 0;
+	for (uint32_t sub = 0; sub < 16; sub++) {
+		cpu_info_t info;
+		cpuid_subleaf(leaf, sub, &info);
+
+		/* Cache type 0 terminates the list. */
+		if ((info.cpuid_eax & 0x1f) == 0)
+			break;
+
+		unsigned int level = (info.cpuid_eax >> 5) & 0x07;
+		if (level >= best) {
+			best = level;
+			*llc = apic_id_bits(((info.cpuid_eax >> 14) & 0xfff) + 1);
+		}
+	}
+
+	return best != 0;
+}
+
+/** Derive the CPU topology from the APIC IDs
+ *
+ * The APIC ID of each CPU is split into SMT, core and package fields
+ * whose widths are reported by CPUID. Without CPUID support all CPUs
+ * keep the default topology.
+ *
+ */
+static void cpu_topology_init(void)
+{
+	if (!has_cpuid())
+		return;
+
+	cpu_info_t info;
+	cpuid(INTEL_CPUID_LEVEL, &info);
+	uint32_t max = info.cpuid_eax;
+	cpuid(INTEL_CPUID_EXTENDED, &info);
+	uint32_t max_ext = info.cpuid_eax;
+
+	unsigned int smt = 0;
+	unsigned int pkg = 0;
+
+	if (max >= INTEL_CPUID_TOPOLOGY) {
+		/* Extended topology enumeration, the last level is the package. */
+		for (uint32_t sub = 0; sub < 8; sub++) {
+			cpuid_subleaf(INTEL_CPUID_TOPOLOGY, sub, &info);
+
+			unsigned int type = (info.cpuid_ecx >> 8) & 0xff;
+			if (type == 0)
+				break;
+
+			unsigned int shift = info.cpuid_eax & 0x1f;
+			if (type == 1)
+				smt = shift;
+			pkg = shift;
+		}
+	} else {
+		cpuid(INTEL_CPUID_STANDARD, &info);
+		if (info.cpuid_edx & (1 << INTEL_HTT))
+			pkg = apic_id_bits((info.cpuid_ebx >> 16) & 0xff);
+	}
+
+	unsigned int llc = pkg;
+	if (!cpu_llc_shift(INTEL_CPUID_CACHE, max, &llc))
+		(void) cpu_llc_shift(AMD_CPUID_CACHE, max_ext, &llc);
+
+	if (llc > pkg)
+		llc = pkg;
+	if (smt > llc)
+		smt = llc;
+
+	for (unsigned int i = 0; i < config.cpu_count; i++) {
+		cpus[i].topology.core = cpus[i].arch.id >> smt;
+		cpus[i].topology.llc = cpus[i].arch.id >> llc;
+		cpus[i].topology.package = cpus[i].arch.id >> pkg;
+	}
+
+	log(LF_ARCH, LVL_NOTE, "APIC ID topology: SMT bits %u, LLC bits %u, "
+	    "package bits %u", smt, llc, pkg);
+}
+
 static void cpu_arch_id_init(void)
 {
 	assert(ops != NULL);
@@ -89,6 +190,8 @@ static void cpu_arch_id_init(void)
 	for (unsigned int i = 0; i < config.cpu_count; ++i) {
 		cpus[i].arch.id = ops->cpu_apic_id(i);
 	}
+
+	cpu_topology_init();
 }
 
 /*
@@ -106,7 +209,7 @@ void kmp(void *arg __attribute__((unused)))
 
 	/*
 	 * SMP initialized, cpus array allocated. Assign each CPU its
-	 * physical APIC ID.
+	 * physical APIC ID and derive the topology from it.
 	 */
 	cpu_arch_id_init();
 
@@ -45,6 +45,27 @@
 
 #define CPU                  CURRENT->cpu
 
+/** Distance between two CPUs in the cache and package hierarchy. */
+typedef enum {
+	CPU_DIST_SMT = 0,  /**< Hardware threads of the same core. */
+	CPU_DIST_LLC,      /**< Cores sharing the last-level cache. */
+	CPU_DIST_PACKAGE,  /**< Cores in the same package. */
+	CPU_DIST_REMOTE,   /**< Cores in different packages. */
+	CPU_DIST_COUNT
+} cpu_distance_t;
+
+/** CPU topology.
+ *
+ * CPUs with equal identifiers share the respective level. Unless the
+ * architecture knows better, every CPU is a separate core and all CPUs
+ * share one last-level cache and package.
+ */
+typedef struct {
+	unsigned int core;     /**< Physical core. */
+	unsigned int llc;      /**< Last-level cache. */
+	unsigned int package;  /**< Processor package. */
+} cpu_topology_t;
+
 /** CPU structure.
  *
  * There is one structure like this for every processor.
@@ -59,8 +80,18 @@ typedef struct cpu {
 
 	atomic_t nrdy;
 	runq_t rq[RQ_COUNT];
+	/** Bitmap of non-empty ready queues, see RQ_BIT(). */
+	atomic_uint rq_bitmap;
+	/** Threads readied by other CPUs, not yet placed into rq. */
+	_Atomic(struct thread *) rq_inbox;
 	volatile size_t needs_relink;
 
+	/** Number of clock ticks this CPU has seen. */
+	volatile size_t current_clock_tick;
+
+	/** Threads migrated to this CPU by kcpulb, per distance. */
+	uint64_t migrations[CPU_DIST_COUNT];
+
 	IRQ_SPINLOCK_DECLARE(timeoutlock);
 	list_t timeout_active_list;
 
@@ -93,6 +124,7 @@ typedef struct cpu {
 	uint32_t delay_loop_const;
 
 	cpu_arch_t arch;
+	cpu_topology_t topology;
 
 	struct thread *fpu_owner;
 
@@ -106,6 +138,7 @@ extern cpu_t *cpus;
 
 extern void cpu_init(void);
 extern void cpu_list(void);
+extern cpu_distance_t cpu_distance(cpu_t *, cpu_t *);
 
 extern void cpu_arch_init(void);
 extern void cpu_identify(void);
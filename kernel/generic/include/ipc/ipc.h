@@ -47,6 +47,7 @@
 struct answerbox;
 struct task;
 struct call;
+struct ipc_bulk;
 
 typedef enum {
 	/** Phone is free and can be allocated */
@@ -165,6 +166,9 @@ typedef struct call {
 
 	/** Buffer for IPC_M_DATA_WRITE and IPC_M_DATA_READ. */
 	uint8_t *buffer;
+
+	/** Borrowed caller's frames for IPC_XF_BULK data transfers. */
+	struct ipc_bulk *bulk;
 } call_t;
 
 extern slab_cache_t *phone_cache;
@@ -44,6 +44,16 @@
 #define RQ_COUNT          16
 #define NEEDS_RELINK_MAX  (HZ)
 
+/** Ticks after which a thread no longer counts as cache-hot (~20 ms). */
+#define CACHE_HOT_TICKS  ((HZ + 49) / 50)
+
+/** Bit of the per-CPU ready queue bitmap which corresponds to rq[i].
+ *
+ * Higher-priority queues use more significant bits so that the best
+ * non-empty queue can be found with a single fnzb32().
+ */
+#define RQ_BIT(i)  (1U << (RQ_COUNT - 1 - (i)))
+
 /** Scheduler run queue structure. */
 typedef struct {
 	IRQ_SPINLOCK_DECLARE(lock);
@@ -51,8 +61,12 @@ typedef struct {
 	size_t n;			/**< Number of threads in rq_ready. */
 } runq_t;
 
+struct cpu;
+struct thread;
+
 extern atomic_t nrdy;
 extern void scheduler_init(void);
+extern void scheduler_enqueue(struct cpu *, struct thread *, unsigned int);
 
 extern void scheduler_fpu_lazy_request(void);
 extern void scheduler(void);
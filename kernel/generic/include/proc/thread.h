@@ -70,6 +70,7 @@ typedef enum {
 /** Thread structure. There is one per thread. */
 typedef struct thread {
 	link_t rq_link;  /**< Run queue link. */
+	struct thread *inbox_next;  /**< Link in the CPU's remote wakeup inbox. */
 	link_t wq_link;  /**< Wait queue link. */
 	link_t th_link;  /**< Links to threads within containing task. */
 
@@ -178,6 +179,8 @@ typedef struct thread {
 
 	/** Ticks before preemption. */
 	uint64_t ticks;
+	/** Value of cpu->current_clock_tick when the thread last ran. */
+	size_t last_tick;
 
 	/** Thread accounting. */
 	uint64_t ucycles;
@@ -88,6 +88,13 @@ void cpu_init(void)
 				irq_spinlock_initialize(&cpus[i].rq[j].lock, "cpus[].rq[].lock");
 				list_initialize(&cpus[i].rq[j].rq);
 			}
+
+			atomic_init(&cpus[i].rq_bitmap, 0);
+			atomic_init(&cpus[i].rq_inbox, NULL);
+
+			cpus[i].topology.core = i;
+			cpus[i].topology.llc = 0;
+			cpus[i].topology.package = 0;
 		}
 
 #ifdef CONFIG_SMP
@@ -108,6 +115,28 @@ void cpu_init(void)
 	cpu_arch_init();
 }
 
+/** Get distance between two CPUs
+ *
+ * @param a First CPU.
+ * @param b Second CPU.
+ *
+ * @return The closest topology level shared by both CPUs.
+ *
+ */
+cpu_distance_t cpu_distance(cpu_t *a, cpu_t *b)
+{
+	if (a->topology.package != b->topology.package)
+		return CPU_DIST_REMOTE;
+
+	if (a->topology.llc != b->topology.llc)
+		return CPU_DIST_PACKAGE;
+
+	if (a->topology.core != b->topology.core)
+		return CPU_DIST_LLC;
+
+	return CPU_DIST_SMT;
+}
+
 /** List all processors. */
 void cpu_list(void)
 {
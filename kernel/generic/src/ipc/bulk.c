@@ -0,0 +1,250 @@
+/*
+ * Copyright (c) 2026 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup kernel_generic_ipc
+ * @{
+ */
+/** @file
+ *
+ * Zero-copy support for large IPC_M_DATA_READ and IPC_M_DATA_WRITE transfers.
+ *
+ * Instead of bouncing the data through a kernel buffer, the frames backing
+ * the caller's buffer are borrowed (their reference count is incremented)
+ * when the request is sent. When the callee answers, the data is copied
+ * once, directly between the callee's buffer and the borrowed frames.
+ */
+
+#include <assert.h>
+#include <ipc/bulk.h>
+#include <mm/as.h>
+#include <mm/page.h>
+#include <mm/frame.h>
+#include <mm/km.h>
+#include <genarch/mm/page_pt.h>
+#include <genarch/mm/page_ht.h>
+#include <syscall/copy.h>
+#include <abi/errno.h>
+#include <align.h>
+#include <macros.h>
+#include <config.h>
+#include <stdlib.h>
+#include <arch.h>
+
+/** Make sure that a user page is mapped in the current address space.
+ *
+ * Touching the page through the regular user memory accessors resolves
+ * any pending page fault, including copy-on-write when @a write is true.
+ *
+ * @param addr  User address within the page.
+ * @param write True if the page is going to be written to.
+ *
+ * @return EOK on success or an error code.
+ */
+static errno_t bulk_page_touch(uintptr_t addr, bool write)
+{
+	uint8_t byte;
+
+	errno_t rc = copy_from_uspace(&byte, (void *) addr, 1);
+	if ((rc == EOK) && (write))
+		rc = copy_to_uspace((void *) addr, &byte, 1);
+
+	return rc;
+}
+
+/** Borrow frames backing a buffer in the current address space.
+ *
+ * The caller of the IPC transfer must not modify the buffer while the
+ * transfer is in progress, which also makes it safe to write back the
+ * byte used to fault in a writable page.
+ *
+ * @param addr  Address of the user buffer.
+ * @param size  Size of the user buffer.
+ * @param write True if the callee is going to write into the buffer.
+ * @param bulkp Place to store the borrowed frames.
+ *
+ * @return EOK on success.
+ * @return ENOTSUP if the buffer is not backed by frames managed by the
+ *         frame allocator (e.g. it is a physical memory mapping).
+ * @return An error code on other failures.
+ */
+errno_t ipc_bulk_borrow(uintptr_t addr, size_t size, bool write,
+    ipc_bulk_t **bulkp)
+{
+	if ((size == 0) || (addr + size < addr))
+		return EINVAL;
+
+	uintptr_t base = ALIGN_DOWN(addr, PAGE_SIZE);
+	size_t count = (ALIGN_UP(addr + size, PAGE_SIZE) - base) >> PAGE_WIDTH;
+
+	ipc_bulk_t *bulk = malloc(sizeof(ipc_bulk_t) +
+	    count * sizeof(uintptr_t));
+	if (!bulk)
+		return ENOMEM;
+
+	bulk->offset = addr - base;
+	bulk->size = size;
+	bulk->count = 0;
+
+	for (size_t i = 0; i < count; i++) {
+		uintptr_t page = base + i * PAGE_SIZE;
+
+		errno_t rc = bulk_page_touch(max(page, addr), write);
+		if (rc != EOK) {
+			ipc_bulk_release(bulk);
+			return rc;
+		}
+
+		page_table_lock(AS, true);
+
+		pte_t pte;
+		bool found = page_mapping_find(AS, page, false, &pte);
+		if ((!found) || (!PTE_PRESENT(&pte)) ||
+		    ((write) && (!PTE_WRITABLE(&pte)))) {
+			/* Unmapped by another thread in the meantime. */
+			page_table_unlock(AS, true);
+			ipc_bulk_release(bulk);
+			return EFAULT;
+		}
+
+		uintptr_t frame = PTE_GET_FRAME(&pte);
+		if (find_zone(ADDR2PFN(frame), 1, 0) == (size_t) -1) {
+			page_table_unlock(AS, true);
+			ipc_bulk_release(bulk);
+			return ENOTSUP;
+		}
+
+		frame_reference_add(ADDR2PFN(frame));
+		page_table_unlock(AS, true);
+
+		bulk->frames[bulk->count++] = frame;
+	}
+
+	*bulkp = bulk;
+	return EOK;
+}
+
+/** Release frames borrowed by ipc_bulk_borrow().
+ *
+ * @param bulk Borrowed frames.
+ */
+void ipc_bulk_release(ipc_bulk_t *bulk)
+{
+	/*
+	 * Memory reservation is managed by the backend of the address space
+	 * area the frames were borrowed from, so do not touch it here even
+	 * if we happen to drop the last reference.
+	 */
+	for (size_t i = 0; i < bulk->count; i++)
+		frame_free_noreserve(bulk->frames[i], 1);
+
+	free(bulk);
+}
+
+/** Copy data between borrowed frames and the current address space.
+ *
+ * @param bulk       Borrowed frames.
+ * @param uspace     User buffer in the current address space.
+ * @param size       Number of bytes to copy.
+ * @param to_frames  True to copy from @a uspace to the frames, false to copy
+ *                   in the opposite direction.
+ *
+ * @return EOK on success or an error code.
+ */
+static errno_t bulk_copy(ipc_bulk_t *bulk, uintptr_t uspace, size_t size,
+    bool to_frames)
+{
+	assert(size <= bulk->size);
+
+	size_t offset = bulk->offset;
+	size_t done = 0;
+
+	for (size_t i = 0; done < size; i++) {
+		assert(i < bulk->count);
+
+		size_t chunk = min(PAGE_SIZE - offset, size - done);
+		uintptr_t frame = bulk->frames[i];
+		uintptr_t page;
+
+		if (frame >= config.identity_size) {
+			page = km_map(frame, PAGE_SIZE, PAGE_SIZE,
+			    PAGE_READ | PAGE_WRITE | PAGE_CACHEABLE);
+		} else {
+			page = PA2KA(frame);
+		}
+
+		errno_t rc;
+		if (to_frames) {
+			rc = copy_from_uspace((void *) (page + offset),
+			    (void *) (uspace + done), chunk);
+		} else {
+			rc = copy_to_uspace((void *) (uspace + done),
+			    (void *) (page + offset), chunk);
+		}
+
+		if (km_is_non_identity(page))
+			km_unmap(page, PAGE_SIZE);
+
+		if (rc != EOK)
+			return rc;
+
+		done += chunk;
+		offset = 0;
+	}
+
+	return EOK;
+}
+
+/** Copy data from the current address space to borrowed frames.
+ *
+ * @param bulk Borrowed frames.
+ * @param src  Source user buffer.
+ * @param size Number of bytes to copy.
+ *
+ * @return EOK on success or an error code.
+ */
+errno_t ipc_bulk_copy_from_uspace(ipc_bulk_t *bulk, const void *src,
+    size_t size)
+{
+	return bulk_copy(bulk, (uintptr_t) src, size, true);
+}
+
+/** Copy data from borrowed frames to the current address space.
+ *
+ * @param dst  Destination user buffer.
+ * @param bulk Borrowed frames.
+ * @param size Number of bytes to copy.
+ *
+ * @return EOK on success or an error code.
+ */
+errno_t ipc_bulk_copy_to_uspace(void *dst, ipc_bulk_t *bulk, size_t size)
+{
+	return bulk_copy(bulk, (uintptr_t) dst, size, false);
+}
+
+/** @}
+ */
@@ -46,6 +46,7 @@
 #include <ipc/ipcrsc.h>
 #include <abi/ipc/methods.h>
 #include <ipc/kbox.h>
+#include <ipc/bulk.h>
 #include <ipc/event.h>
 #include <ipc/sysipc_ops.h>
 #include <ipc/sysipc_priv.h>
@@ -86,6 +87,7 @@ static void _ipc_call_init(call_t *call)
 	call->sender = NULL;
 	call->callerbox = NULL;
 	call->buffer = NULL;
+	call->bulk = NULL;
 }
 
 static void call_destroy(void *arg)
@@ -94,6 +96,8 @@ static void call_destroy(void *arg)
 
 	if (call->buffer)
 		free(call->buffer);
+	if (call->bulk)
+		ipc_bulk_release(call->bulk);
 	if (call->caller_phone)
 		kobject_put(call->caller_phone->kobject);
 	slab_free(call_cache, call);
@@ -35,6 +35,7 @@
 #include <assert.h>
 #include <ipc/sysipc_ops.h>
 #include <ipc/ipc.h>
+#include <ipc/bulk.h>
 #include <stdlib.h>
 #include <abi/errno.h>
 #include <syscall/copy.h>
@@ -43,14 +44,39 @@
 static errno_t request_preprocess(call_t *call, phone_t *phone)
 {
 	size_t size = IPC_GET_ARG2(call->data);
+	int flags = IPC_GET_ARG3(call->data);
+	size_t limit = (flags & IPC_XF_BULK) ?
+	    DATA_XFER_BULK_LIMIT : DATA_XFER_LIMIT;
+
+	if (size > limit) {
+		if (flags & IPC_XF_RESTRICT) {
+			size = limit;
+			IPC_SET_ARG2(call->data, size);
+		} else
+			return ELIMIT;
+	}
 
-	if (size > DATA_XFER_LIMIT) {
-		int flags = IPC_GET_ARG3(call->data);
+	if ((flags & IPC_XF_BULK) && (size > 0)) {
+		uintptr_t dst = IPC_GET_ARG1(call->data);
 
-		if (flags & IPC_XF_RESTRICT)
-			IPC_SET_ARG2(call->data, DATA_XFER_LIMIT);
-		else
-			return ELIMIT;
+		errno_t rc = ipc_bulk_borrow(dst, size, true, &call->bulk);
+		if (rc == ENOTSUP) {
+			/*
+			 * Fall back to the kernel buffer. The buffer is limited
+			 * in size, so only a restricted transfer may be
+			 * shortened.
+			 */
+			if (size > DATA_XFER_LIMIT) {
+				if (!(flags & IPC_XF_RESTRICT))
+					return ELIMIT;
+
+				IPC_SET_ARG2(call->data, DATA_XFER_LIMIT);
+			}
+
+			return EOK;
+		}
+
+		return rc;
 	}
 
 	return EOK;
@@ -74,6 +100,15 @@ static errno_t answer_preprocess(call_t *answer, ipc_data_t *olddata)
 			 */
 			IPC_SET_ARG1(answer->data, dst);
 
+			if (answer->bulk) {
+				/* Copy directly to the borrowed frames. */
+				errno_t rc = ipc_bulk_copy_from_uspace(
+				    answer->bulk, (void *) src, size);
+				if (rc)
+					IPC_SET_RETVAL(answer->data, rc);
+				return EOK;
+			}
+
 			answer->buffer = malloc(size);
 			if (!answer->buffer) {
 				IPC_SET_RETVAL(answer->data, ENOMEM);
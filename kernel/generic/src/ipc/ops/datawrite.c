@@ -35,6 +35,7 @@
 #include <assert.h>
 #include <ipc/sysipc_ops.h>
 #include <ipc/ipc.h>
+#include <ipc/bulk.h>
 #include <stdlib.h>
 #include <abi/errno.h>
 #include <syscall/copy.h>
@@ -44,17 +45,36 @@ static errno_t request_preprocess(call_t *call, phone_t *phone)
 {
 	uintptr_t src = IPC_GET_ARG1(call->data);
 	size_t size = IPC_GET_ARG2(call->data);
+	int flags = IPC_GET_ARG3(call->data);
+	size_t limit = (flags & IPC_XF_BULK) ?
+	    DATA_XFER_BULK_LIMIT : DATA_XFER_LIMIT;
 
-	if (size > DATA_XFER_LIMIT) {
-		int flags = IPC_GET_ARG3(call->data);
-
+	if (size > limit) {
 		if (flags & IPC_XF_RESTRICT) {
-			size = DATA_XFER_LIMIT;
+			size = limit;
 			IPC_SET_ARG2(call->data, size);
 		} else
 			return ELIMIT;
 	}
 
+	if ((flags & IPC_XF_BULK) && (size > 0)) {
+		errno_t rc = ipc_bulk_borrow(src, size, false, &call->bulk);
+		if (rc != ENOTSUP)
+			return rc;
+
+		/*
+		 * Fall back to the kernel buffer. The buffer is limited
+		 * in size, so only a restricted transfer may be shortened.
+		 */
+		if (size > DATA_XFER_LIMIT) {
+			if (!(flags & IPC_XF_RESTRICT))
+				return ELIMIT;
+
+			size = DATA_XFER_LIMIT;
+			IPC_SET_ARG2(call->data, size);
+		}
+	}
+
 	call->buffer = (uint8_t *) malloc(size);
 	if (!call->buffer)
 		return ENOMEM;
@@ -72,7 +92,7 @@ static errno_t request_preprocess(call_t *call, phone_t *phone)
 
 static errno_t answer_preprocess(call_t *answer, ipc_data_t *olddata)
 {
-	assert(answer->buffer);
+	assert(answer->buffer || answer->bulk);
 
 	if (!IPC_GET_RETVAL(answer->data)) {
 		/* The recipient agreed to receive data. */
@@ -81,8 +101,17 @@ static errno_t answer_preprocess(call_t *answer, ipc_data_t *olddata)
 		size_t max_size = (size_t)IPC_GET_ARG2(*olddata);
 
 		if (size <= max_size) {
-			errno_t rc = copy_to_uspace((void *) dst,
-			    answer->buffer, size);
+			errno_t rc;
+
+			if (answer->bulk) {
+				/* Copy directly from the borrowed frames. */
+				rc = ipc_bulk_copy_to_uspace((void *) dst,
+				    answer->bulk, size);
+			} else {
+				rc = copy_to_uspace((void *) dst,
+				    answer->buffer, size);
+			}
+
 			if (rc)
 				IPC_SET_RETVAL(answer->data, rc);
 		} else {
@@ -350,24 +350,20 @@ static int check_call_limit(phone_t *phone)
 	return 0;
 }
 
-/** Make a fast asynchronous call over IPC.
+/** Get the phone and a new call for an asynchronous request.
  *
- * This function can only handle three arguments of payload, but is faster than
- * the generic function sys_ipc_call_async_slow().
- *
- * @param handle   Phone capability handle for the call.
- * @param imethod  Interface and method of the call.
- * @param arg1     Service-defined payload argument.
- * @param arg2     Service-defined payload argument.
- * @param arg3     Service-defined payload argument.
- * @param label    User-defined label.
+ * @param handle Phone capability handle for the call.
+ * @param rkobj  Place to store the referenced phone kobject.
+ * @param rcall  Place to store the new call.
  *
  * @return EOK on success.
- * @return An error code on error.
+ * @return ENOENT if there is no such phone.
+ * @return ELIMIT if the phone has too many active calls.
+ * @return ENOMEM if out of memory.
  *
  */
-sys_errno_t sys_ipc_call_async_fast(cap_phone_handle_t handle, sysarg_t imethod,
-    sysarg_t arg1, sysarg_t arg2, sysarg_t arg3, sysarg_t label)
+static errno_t call_async_prepare(cap_phone_handle_t handle, kobject_t **rkobj,
+    call_t **rcall)
 {
 	kobject_t *kobj = kobject_get(TASK, handle, KOBJECT_TYPE_PHONE);
 	if (!kobj)
@@ -384,17 +380,22 @@ sys_errno_t sys_ipc_call_async_fast(cap_phone_handle_t handle, sysarg_t imethod,
 		return ENOMEM;
 	}
 
-	IPC_SET_IMETHOD(call->data, imethod);
-	IPC_SET_ARG1(call->data, arg1);
-	IPC_SET_ARG2(call->data, arg2);
-	IPC_SET_ARG3(call->data, arg3);
-
-	/*
-	 * To achieve deterministic behavior, zero out arguments that are beyond
-	 * the limits of the fast version.
-	 */
-	IPC_SET_ARG5(call->data, 0);
+	*rkobj = kobj;
+	*rcall = call;
+	return EOK;
+}
 
+/** Send an asynchronous request prepared by call_async_prepare().
+ *
+ * Drops the reference to the phone kobject.
+ *
+ * @param kobj  Phone kobject.
+ * @param call  Call with the payload filled in.
+ * @param label User-defined label.
+ *
+ */
+static void call_async_send(kobject_t *kobj, call_t *call, sysarg_t label)
+{
 	/* Set the user-defined label */
 	call->data.answer_label = label;
 
@@ -406,6 +407,46 @@ sys_errno_t sys_ipc_call_async_fast(cap_phone_handle_t handle, sysarg_t imethod,
 		ipc_backsend_err(kobj->phone, call, res);
 
 	kobject_put(kobj);
+}
+
+/** Make a fast asynchronous call over IPC.
+ *
+ * This function can only handle three arguments of payload, but is faster than
+ * the generic function sys_ipc_call_async_slow().
+ *
+ * @param handle   Phone capability handle for the call.
+ * @param imethod  Interface and method of the call.
+ * @param arg1     Service-defined payload argument.
+ * @param arg2     Service-defined payload argument.
+ * @param arg3     Service-defined payload argument.
+ * @param label    User-defined label.
+ *
+ * @return EOK on success.
+ * @return An error code on error.
+ *
+ */
+sys_errno_t sys_ipc_call_async_fast(cap_phone_handle_t handle, sysarg_t imethod,
+    sysarg_t arg1, sysarg_t arg2, sysarg_t arg3, sysarg_t label)
+{
+	kobject_t *kobj;
+	call_t *call;
+
+	errno_t rc = call_async_prepare(handle, &kobj, &call);
+	if (rc != EOK)
+		return rc;
+
+	IPC_SET_IMETHOD(call->data, imethod);
+	IPC_SET_ARG1(call->data, arg1);
+	IPC_SET_ARG2(call->data, arg2);
+	IPC_SET_ARG3(call->data, arg3);
+
+	/*
+	 * To achieve deterministic behavior, zero out arguments that are beyond
+	 * the limits of the fast version.
+	 */
+	IPC_SET_ARG5(call->data, 0);
+
+	call_async_send(kobj, call, label);
 	return EOK;
 }
 
@@ -421,22 +462,14 @@ sys_errno_t sys_ipc_call_async_fast(cap_phone_handle_t handle, sysarg_t imethod,
 sys_errno_t sys_ipc_call_async_slow(cap_phone_handle_t handle, ipc_data_t *data,
     sysarg_t label)
 {
-	kobject_t *kobj = kobject_get(TASK, handle, KOBJECT_TYPE_PHONE);
-	if (!kobj)
-		return ENOENT;
+	kobject_t *kobj;
+	call_t *call;
 
-	if (check_call_limit(kobj->phone)) {
-		kobject_put(kobj);
-		return ELIMIT;
-	}
-
-	call_t *call = ipc_call_alloc();
-	if (!call) {
-		kobject_put(kobj);
-		return ENOMEM;
-	}
+	errno_t rc = call_async_prepare(handle, &kobj, &call);
+	if (rc != EOK)
+		return rc;
 
-	errno_t rc = copy_from_uspace(&call->data.args, &data->args,
+	rc = copy_from_uspace(&call->data.args, &data->args,
 	    sizeof(call->data.args));
 	if (rc != EOK) {
 		kobject_put(call->kobject);
@@ -444,18 +477,55 @@ sys_errno_t sys_ipc_call_async_slow(cap_phone_handle_t handle, ipc_data_t *data,
 		return (sys_errno_t) rc;
 	}
 
-	/* Set the user-defined label */
-	call->data.answer_label = label;
+	call_async_send(kobj, call, label);
+	return EOK;
+}
 
-	errno_t res = request_preprocess(call, kobj->phone);
+/** Make a batch of asynchronous IPC calls.
+ *
+ * The calls are sent in order. Sending stops at the first call that
+ * cannot be sent; the calls before it have been sent.
+ *
+ * @param calls  Userspace address of the array of calls.
+ * @param count  Number of calls in the array (at most IPC_BATCH_MAX).
+ * @param sent   Userspace address where to store the number of calls
+ *               that were sent.
+ *
+ * @return EOK if all calls were sent.
+ * @return EINVAL if @a count is out of range.
+ * @return Otherwise see sys_ipc_call_async_fast().
+ *
+ */
+sys_errno_t sys_ipc_call_async_batch(ipc_batch_call_t *calls, size_t count,
+    size_t *sent)
+{
+	ipc_batch_call_t bcall;
+	kobject_t *kobj;
+	call_t *call;
+	errno_t rc = EOK;
+	size_t i;
 
-	if (!res)
-		ipc_call(kobj->phone, call);
-	else
-		ipc_backsend_err(kobj->phone, call, res);
+	if (count == 0 || count > IPC_BATCH_MAX)
+		return EINVAL;
 
-	kobject_put(kobj);
-	return EOK;
+	for (i = 0; i < count; i++) {
+		rc = copy_from_uspace(&bcall, &calls[i], sizeof(bcall));
+		if (rc != EOK)
+			break;
+
+		rc = call_async_prepare(bcall.phone, &kobj, &call);
+		if (rc != EOK)
+			break;
+
+		memcpy(&call->data.args, &bcall.args, sizeof(call->data.args));
+		call_async_send(kobj, call, bcall.label);
+	}
+
+	errno_t crc = copy_to_uspace(sent, &i, sizeof(i));
+	if (rc == EOK)
+		rc = crc;
+
+	return (sys_errno_t) rc;
 }
 
 /** Forward a received call to another destination
@@ -765,7 +835,7 @@ sys_errno_t sys_ipc_hangup(cap_phone_handle_t handle)
  *
  * @return An error code on error.
  */
-sys_errno_t sys_ipc_wait_for_call(ipc_data_t *calldata, uint32_t usec,
+static errno_t wait_for_call(ipc_data_t *calldata, uint32_t usec,
     unsigned int flags)
 {
 	call_t *call = NULL;
@@ -865,6 +935,64 @@ error:
 	return rc;
 }
 
+/** Wait for an incoming IPC call or an answer.
+ *
+ * @param calldata Pointer to buffer where the call/answer data is stored.
+ * @param usec     Timeout. See waitq_sleep_timeout() for explanation.
+ * @param flags    Select mode of sleep operation. See waitq_sleep_timeout()
+ *                 for explanation.
+ *
+ * @return An error code on error.
+ */
+sys_errno_t sys_ipc_wait_for_call(ipc_data_t *calldata, uint32_t usec,
+    unsigned int flags)
+{
+	return (sys_errno_t) wait_for_call(calldata, usec, flags);
+}
+
+/** Wait for incoming IPC calls or answers and receive up to @a count of them.
+ *
+ * Waits for the first call as sys_ipc_wait_for_call() does and then picks
+ * up any other calls that are already pending, without blocking.
+ *
+ * @param calldata Userspace address of the array where the call/answer data
+ *                 is stored.
+ * @param count    Number of entries in the array (at most IPC_BATCH_MAX).
+ * @param usec     Timeout for the first call. See waitq_sleep_timeout() for
+ *                 explanation.
+ * @param flags    Select mode of sleep operation for the first call. See
+ *                 waitq_sleep_timeout() for explanation.
+ * @param received Userspace address where to store the number of received
+ *                 calls.
+ *
+ * @return EOK if at least one call was received.
+ * @return EINVAL if @a count is out of range.
+ * @return Otherwise see sys_ipc_wait_for_call().
+ */
+sys_errno_t sys_ipc_wait_for_call_batch(ipc_data_t *calldata, size_t count,
+    uint32_t usec, unsigned int flags, size_t *received)
+{
+	size_t i = 0;
+
+	if (count == 0 || count > IPC_BATCH_MAX)
+		return EINVAL;
+
+	errno_t rc = wait_for_call(&calldata[0], usec, flags);
+	if (rc == EOK) {
+		for (i = 1; i < count; i++) {
+			if (wait_for_call(&calldata[i], SYNCH_NO_TIMEOUT,
+			    SYNCH_FLAGS_NON_BLOCKING) != EOK)
+				break;
+		}
+	}
+
+	errno_t crc = copy_to_uspace(received, &i, sizeof(i));
+	if (rc == EOK)
+		rc = crc;
+
+	return (sys_errno_t) rc;
+}
+
 /** Interrupt one thread from sys_ipc_wait_for_call().
  *
  */
@@ -40,6 +40,7 @@
 
 #include <assert.h>
 #include <atomic.h>
+#include <bitops.h>
 #include <proc/scheduler.h>
 #include <proc/thread.h>
 #include <proc/task.h>
@@ -172,6 +173,120 @@ void scheduler_init(void)
 {
 }
 
+/** Append thread to a ready queue of a CPU
+ *
+ * Keeps the ready queue bitmap of the CPU in sync with the queue.
+ * The lock of the ready queue must be held.
+ *
+ * @param cpu    CPU owning the ready queue.
+ * @param i      Index of the ready queue.
+ * @param thread Thread to append.
+ *
+ */
+static void rq_append(cpu_t *cpu, unsigned int i, thread_t *thread)
+{
+	assert(irq_spinlock_locked(&cpu->rq[i].lock));
+
+	list_append(&thread->rq_link, &cpu->rq[i].rq);
+	if (cpu->rq[i].n++ == 0) {
+		atomic_fetch_or_explicit(&cpu->rq_bitmap, RQ_BIT(i),
+		    memory_order_relaxed);
+	}
+}
+
+/** Note that a thread was removed from a ready queue of a CPU
+ *
+ * The lock of the ready queue must be held.
+ *
+ * @param cpu CPU owning the ready queue.
+ * @param i   Index of the ready queue.
+ *
+ */
+static void rq_removed(cpu_t *cpu, unsigned int i)
+{
+	assert(irq_spinlock_locked(&cpu->rq[i].lock));
+
+	if (--cpu->rq[i].n == 0) {
+		atomic_fetch_and_explicit(&cpu->rq_bitmap, ~RQ_BIT(i),
+		    memory_order_relaxed);
+	}
+}
+
+/** Make a thread ready on a CPU
+ *
+ * The ready queues of a CPU are only ever appended to by the CPU itself.
+ * A thread readied on behalf of another CPU is pushed onto that CPU's
+ * lock-free inbox instead and the owner moves it into its ready queue
+ * the next time it looks for a thread to run. This way remote wakeups
+ * never contend for the ready queue locks of the target CPU.
+ *
+ * @param cpu    CPU which should run the thread.
+ * @param thread Thread to make ready. Its lock must be held (acquired
+ *               with interrupts disabled) and is released.
+ * @param i      Index of the ready queue to use.
+ *
+ */
+void scheduler_enqueue(cpu_t *cpu, thread_t *thread, unsigned int i)
+{
+	assert(irq_spinlock_locked(&thread->lock));
+	assert(thread->priority == (int) i);
+
+	if (cpu != CPU) {
+		thread_t *head = atomic_load_explicit(&cpu->rq_inbox,
+		    memory_order_relaxed);
+		do {
+			thread->inbox_next = head;
+		} while (!atomic_compare_exchange_weak_explicit(&cpu->rq_inbox,
+		    &head, thread, memory_order_release, memory_order_relaxed));
+
+		irq_spinlock_unlock(&thread->lock, true);
+	} else {
+		irq_spinlock_pass(&thread->lock, &(cpu->rq[i].lock));
+		rq_append(cpu, i, thread);
+		irq_spinlock_unlock(&(cpu->rq[i].lock), true);
+	}
+
+	atomic_inc(&nrdy);
+	atomic_inc(&cpu->nrdy);
+}
+
+/** Move threads readied by other CPUs into the local ready queues
+ *
+ * Interrupts must be disabled.
+ *
+ */
+static void rq_inbox_drain(void)
+{
+	if (atomic_load_explicit(&CPU->rq_inbox, memory_order_relaxed) == NULL)
+		return;
+
+	thread_t *thread = atomic_exchange_explicit(&CPU->rq_inbox, NULL,
+	    memory_order_acquire);
+
+	/* The inbox is a stack, restore the order of the wakeups. */
+	thread_t *prev = NULL;
+	while (thread != NULL) {
+		thread_t *next = thread->inbox_next;
+		thread->inbox_next = prev;
+		prev = thread;
+		thread = next;
+	}
+
+	while (prev != NULL) {
+		/*
+		 * Once the thread is in a ready queue, it can be stolen and
+		 * readied again elsewhere, so fetch the link beforehand.
+		 */
+		thread = prev;
+		prev = thread->inbox_next;
+
+		unsigned int i = thread->priority;
+		irq_spinlock_lock(&(CPU->rq[i].lock), false);
+		rq_append(CPU, i, thread);
+		irq_spinlock_unlock(&(CPU->rq[i].lock), false);
+	}
+}
+
 /** Get thread to be scheduled
  *
  * Get the optimal thread to be scheduled
@@ -210,45 +325,50 @@ loop:
 
 	assert(!CPU->idle);
 
-	unsigned int i;
-	for (i = 0; i < RQ_COUNT; i++) {
-		irq_spinlock_lock(&(CPU->rq[i].lock), false);
-		if (CPU->rq[i].n == 0) {
-			/*
-			 * If this queue is empty, try a lower-priority queue.
-			 */
-			irq_spinlock_unlock(&(CPU->rq[i].lock), false);
-			continue;
-		}
+	rq_inbox_drain();
 
-		atomic_dec(&CPU->nrdy);
-		atomic_dec(&nrdy);
-		CPU->rq[i].n--;
+	uint32_t bitmap = atomic_load_explicit(&CPU->rq_bitmap,
+	    memory_order_relaxed);
+	if (bitmap == 0)
+		goto loop;
 
-		/*
-		 * Take the first thread from the queue.
-		 */
-		thread_t *thread = list_get_instance(
-		    list_first(&CPU->rq[i].rq), thread_t, rq_link);
-		list_remove(&thread->rq_link);
+	/*
+	 * Only look into the highest-priority non-empty queue. The bitmap
+	 * is just a hint since kcpulb may steal from the queue meanwhile.
+	 */
+	unsigned int i = RQ_COUNT - 1 - fnzb32(bitmap);
 
-		irq_spinlock_pass(&(CPU->rq[i].lock), &thread->lock);
+	irq_spinlock_lock(&(CPU->rq[i].lock), false);
+	if (CPU->rq[i].n == 0) {
+		irq_spinlock_unlock(&(CPU->rq[i].lock), false);
+		goto loop;
+	}
 
-		thread->cpu = CPU;
-		thread->ticks = us2ticks((i + 1) * 10000);
-		thread->priority = i;  /* Correct rq index */
+	atomic_dec(&CPU->nrdy);
+	atomic_dec(&nrdy);
+	rq_removed(CPU, i);
 
-		/*
-		 * Clear the stolen flag so that it can be migrated
-		 * when load balancing needs emerge.
-		 */
-		thread->stolen = false;
-		irq_spinlock_unlock(&thread->lock, false);
+	/*
+	 * Take the first thread from the queue.
+	 */
+	thread_t *thread = list_get_instance(
+	    list_first(&CPU->rq[i].rq), thread_t, rq_link);
+	list_remove(&thread->rq_link);
 
-		return thread;
-	}
+	irq_spinlock_pass(&(CPU->rq[i].lock), &thread->lock);
 
-	goto loop;
+	thread->cpu = CPU;
+	thread->ticks = us2ticks((i + 1) * 10000);
+	thread->priority = i;  /* Correct rq index */
+
+	/*
+	 * Clear the stolen flag so that it can be migrated
+	 * when load balancing needs emerge.
+	 */
+	thread->stolen = false;
+	irq_spinlock_unlock(&thread->lock, false);
+
+	return thread;
 }
 
 /** Prevent rq starvation
@@ -272,12 +392,22 @@ static void relink_rq(int start)
 	if (CPU->needs_relink > NEEDS_RELINK_MAX) {
 		int i;
 		for (i = start; i < RQ_COUNT - 1; i++) {
+			/*
+			 * Only this CPU adds threads to its ready queues,
+			 * so an empty queue cannot fill up behind our back.
+			 */
+			if ((atomic_load_explicit(&CPU->rq_bitmap,
+			    memory_order_relaxed) & RQ_BIT(i + 1)) == 0)
+				continue;
+
 			/* Remember and empty rq[i + 1] */
 
 			irq_spinlock_lock(&CPU->rq[i + 1].lock, false);
 			list_concat(&list, &CPU->rq[i + 1].rq);
 			size_t n = CPU->rq[i + 1].n;
 			CPU->rq[i + 1].n = 0;
+			atomic_fetch_and_explicit(&CPU->rq_bitmap,
+			    ~RQ_BIT(i + 1), memory_order_relaxed);
 			irq_spinlock_unlock(&CPU->rq[i + 1].lock, false);
 
 			/* Append rq[i + 1] to rq[i] */
@@ -285,6 +415,10 @@ static void relink_rq(int start)
 			irq_spinlock_lock(&CPU->rq[i].lock, false);
 			list_concat(&CPU->rq[i].rq, &list);
 			CPU->rq[i].n += n;
+			if (CPU->rq[i].n > 0) {
+				atomic_fetch_or_explicit(&CPU->rq_bitmap,
+				    RQ_BIT(i), memory_order_relaxed);
+			}
 			irq_spinlock_unlock(&CPU->rq[i].lock, false);
 		}
 
@@ -404,6 +538,7 @@ void scheduler_separated_stack(void)
 	if (THREAD) {
 		/* Must be run after the switch to scheduler stack */
 		after_thread_ran();
+		THREAD->last_tick = CPU->current_clock_tick;
 
 		switch (THREAD->state) {
 		case Running:
@@ -537,49 +672,40 @@ void scheduler_separated_stack(void)
 }
 
 #ifdef CONFIG_SMP
-/** Load balancing thread
+/** Check whether a thread probably still has its working set in cache
  *
- * SMP load balancing thread, supervising thread supplies
- * for the CPU it's wired to.
+ * The lock of the thread must be held.
  *
- * @param arg Generic thread argument (unused).
+ * @param cpu    CPU whose ready queue holds the thread.
+ * @param thread Thread in question.
+ *
+ * @return True if the thread ran on @a cpu within the last
+ *         CACHE_HOT_TICKS clock ticks.
  *
  */
-void kcpulb(void *arg)
+static bool thread_cache_hot(cpu_t *cpu, thread_t *thread)
 {
-	size_t average;
-	size_t rdy;
+	if (thread->cpu != cpu)
+		return false;
 
-	/*
-	 * Detach kcpulb as nobody will call thread_join_timeout() on it.
-	 */
-	thread_detach(THREAD);
-
-loop:
-	/*
-	 * Work in 1s intervals.
-	 */
-	thread_sleep(1);
-
-not_satisfied:
-	/*
-	 * Calculate the number of threads that will be migrated/stolen from
-	 * other CPU's. Note that situation can have changed between two
-	 * passes. Each time get the most up to date counts.
-	 *
-	 */
-	average = atomic_load(&nrdy) / config.cpu_active + 1;
-	rdy = atomic_load(&CPU->nrdy);
-
-	if (average <= rdy)
-		goto satisfied;
-
-	size_t count = average - rdy;
+	return cpu->current_clock_tick - thread->last_tick < CACHE_HOT_TICKS;
+}
 
-	/*
-	 * Searching least priority queues on all CPU's first and most priority
-	 * queues on all CPU's last.
-	 */
+/** Steal threads from CPUs in the given distance
+ *
+ * Search least priority queues on all CPUs first and most priority
+ * queues on all CPUs last. Threads which are cache-hot on their CPU
+ * are left alone unless the CPU shares all caches with us.
+ *
+ * @param dist    Distance of the CPUs to steal from.
+ * @param average Average number of ready threads per CPU.
+ * @param count   Number of threads to steal.
+ *
+ * @return Number of threads which are still to be stolen.
+ *
+ */
+static size_t kcpulb_steal(cpu_distance_t dist, size_t average, size_t count)
+{
 	size_t acpu;
 	size_t acpu_bias = 0;
 	int rq;
@@ -597,9 +723,17 @@ not_satisfied:
 			if (CPU == cpu)
 				continue;
 
+			if (cpu_distance(CPU, cpu) != dist)
+				continue;
+
 			if (atomic_load(&cpu->nrdy) <= average)
 				continue;
 
+			/* Do not bother locking queues known to be empty. */
+			if ((atomic_load_explicit(&cpu->rq_bitmap,
+			    memory_order_relaxed) & RQ_BIT(rq)) == 0)
+				continue;
+
 			irq_spinlock_lock(&(cpu->rq[rq].lock), true);
 			if (cpu->rq[rq].n == 0) {
 				irq_spinlock_unlock(&(cpu->rq[rq].lock), true);
@@ -618,14 +752,17 @@ not_satisfied:
 				/*
 				 * Do not steal CPU-wired threads, threads
 				 * already stolen, threads for which migration
-				 * was temporarily disabled or threads whose
-				 * FPU context is still in the CPU.
+				 * was temporarily disabled, threads whose
+				 * FPU context is still in the CPU or threads
+				 * which would leave their cache behind.
 				 */
 				irq_spinlock_lock(&thread->lock, false);
 
 				if ((!thread->wired) && (!thread->stolen) &&
 				    (!thread->nomigrate) &&
-				    (!thread->fpu_context_engaged)) {
+				    (!thread->fpu_context_engaged) &&
+				    ((dist == CPU_DIST_SMT) ||
+				    (!thread_cache_hot(cpu, thread)))) {
 					/*
 					 * Remove thread from ready queue.
 					 */
@@ -635,7 +772,7 @@ not_satisfied:
 					atomic_dec(&cpu->nrdy);
 					atomic_dec(&nrdy);
 
-					cpu->rq[rq].n--;
+					rq_removed(cpu, rq);
 					list_remove(&thread->rq_link);
 
 					break;
@@ -658,9 +795,11 @@ not_satisfied:
 #ifdef KCPULB_VERBOSE
 				log(LF_OTHER, LVL_DEBUG,
 				    "kcpulb%u: TID %" PRIu64 " -> cpu%u, "
-				    "nrdy=%ld, avg=%ld", CPU->id, thread->tid,
-				    CPU->id, atomic_load(&CPU->nrdy),
-				    atomic_load(&nrdy) / config.cpu_active);
+				    "nrdy=%ld, avg=%ld, dist=%d", CPU->id,
+				    thread->tid, CPU->id,
+				    atomic_load(&CPU->nrdy),
+				    atomic_load(&nrdy) / config.cpu_active,
+				    dist);
 #endif
 
 				thread->stolen = true;
@@ -669,8 +808,12 @@ not_satisfied:
 				irq_spinlock_unlock(&thread->lock, true);
 				thread_ready(thread);
 
+				irq_spinlock_lock(&CPU->lock, true);
+				CPU->migrations[dist]++;
+				irq_spinlock_unlock(&CPU->lock, true);
+
 				if (--count == 0)
-					goto satisfied;
+					return 0;
 
 				/*
 				 * We are not satisfied yet, focus on another
@@ -686,6 +829,58 @@ not_satisfied:
 		}
 	}
 
+	return count;
+}
+
+/** Load balancing thread
+ *
+ * SMP load balancing thread, supervising thread supplies
+ * for the CPU it's wired to.
+ *
+ * Threads are stolen from the topologically closest CPUs first so that
+ * they keep as much of their cache footprint as possible.
+ *
+ * @param arg Generic thread argument (unused).
+ *
+ */
+void kcpulb(void *arg)
+{
+	size_t average;
+	size_t rdy;
+
+	/*
+	 * Detach kcpulb as nobody will call thread_join_timeout() on it.
+	 */
+	thread_detach(THREAD);
+
+loop:
+	/*
+	 * Work in 1s intervals.
+	 */
+	thread_sleep(1);
+
+not_satisfied:
+	/*
+	 * Calculate the number of threads that will be migrated/stolen from
+	 * other CPU's. Note that situation can have changed between two
+	 * passes. Each time get the most up to date counts.
+	 *
+	 */
+	average = atomic_load(&nrdy) / config.cpu_active + 1;
+	rdy = atomic_load(&CPU->nrdy);
+
+	if (average <= rdy)
+		goto satisfied;
+
+	size_t count = average - rdy;
+
+	for (cpu_distance_t dist = CPU_DIST_SMT; dist < CPU_DIST_COUNT;
+	    dist++) {
+		count = kcpulb_steal(dist, average, count);
+		if (count == 0)
+			goto satisfied;
+	}
+
 	if (atomic_load(&CPU->nrdy)) {
 		/*
 		 * Be a little bit light-weight and let migrated threads run.
@@ -720,9 +915,10 @@ void sched_print_list(void)
 
 		irq_spinlock_lock(&cpus[cpu].lock, true);
 
-		printf("cpu%u: address=%p, nrdy=%zu, needs_relink=%zu\n",
-		    cpus[cpu].id, &cpus[cpu], atomic_load(&cpus[cpu].nrdy),
-		    cpus[cpu].needs_relink);
+		printf("cpu%u: address=%p, nrdy=%zu, needs_relink=%zu, "
+		    "rq_bitmap=%#x\n", cpus[cpu].id, &cpus[cpu],
+		    atomic_load(&cpus[cpu].nrdy), cpus[cpu].needs_relink,
+		    atomic_load(&cpus[cpu].rq_bitmap));
 
 		unsigned int i;
 		for (i = 0; i < RQ_COUNT; i++) {
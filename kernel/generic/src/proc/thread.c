@@ -306,19 +306,8 @@ void thread_ready(thread_t *thread)
 
 	thread->state = Ready;
 
-	irq_spinlock_pass(&thread->lock, &(cpu->rq[i].lock));
-
-	/*
-	 * Append thread to respective ready queue
-	 * on respective processor.
-	 */
-
-	list_append(&thread->rq_link, &cpu->rq[i].rq);
-	cpu->rq[i].n++;
-	irq_spinlock_unlock(&(cpu->rq[i].lock), true);
-
-	atomic_inc(&nrdy);
-	atomic_inc(&cpu->nrdy);
+	/* Releases thread->lock. */
+	scheduler_enqueue(cpu, thread, i);
 }
 
 /** Create new thread
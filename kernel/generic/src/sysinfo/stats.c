@@ -118,6 +118,17 @@ static void *get_stats_cpus(struct sysinfo_item *item, size_t *size,
 		stats_cpus[i].busy_cycles = cpus[i].busy_cycles;
 		stats_cpus[i].idle_cycles = cpus[i].idle_cycles;
 
+		stats_cpus[i].migrations = 0;
+		stats_cpus[i].migrations_remote = 0;
+		for (cpu_distance_t dist = CPU_DIST_SMT; dist < CPU_DIST_COUNT;
+		    dist++) {
+			stats_cpus[i].migrations += cpus[i].migrations[dist];
+			if (dist > CPU_DIST_LLC) {
+				stats_cpus[i].migrations_remote +=
+				    cpus[i].migrations[dist];
+			}
+		}
+
 		irq_spinlock_unlock(&cpus[i].lock, true);
 	}
 
@@ -160,6 +160,7 @@ void clock(void)
 		/* Update counters and accounting */
 		clock_update_counters();
 		cpu_update_accounting();
+		CPU->current_clock_tick++;
 
 		irq_spinlock_lock(&CPU->timeoutlock, false);
 
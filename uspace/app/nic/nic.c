@@ -53,6 +53,8 @@ typedef struct {
 	nic_unicast_mode_t unicast_mode;
 	nic_multicast_mode_t multicast_mode;
 	nic_broadcast_mode_t broadcast_mode;
+	nic_poll_mode_t poll_mode;
+	nic_device_stats_t stats;
 	int speed;
 } nic_info_t;
 
@@ -174,6 +176,20 @@ static errno_t nic_get_info(service_id_t svc_id, char *svc_name,
 		goto error;
 	}
 
+	rc = nic_poll_get_mode(sess, &info->poll_mode, NULL);
+	if (rc != EOK) {
+		printf("Error getting NIC poll mode.\n");
+		rc = EIO;
+		goto error;
+	}
+
+	rc = nic_get_stats(sess, &info->stats);
+	if (rc != EOK) {
+		printf("Error getting NIC statistics.\n");
+		rc = EIO;
+		goto error;
+	}
+
 	return EOK;
 error:
 	return rc;
@@ -260,6 +276,25 @@ static const char *nic_broadcast_mode_str(nic_broadcast_mode_t mode)
 	}
 }
 
+static const char *nic_poll_mode_str(nic_poll_mode_t mode)
+{
+	switch (mode) {
+	case NIC_POLL_IMMEDIATE:
+		return "immediate";
+	case NIC_POLL_ON_DEMAND:
+		return "on demand";
+	case NIC_POLL_PERIODIC:
+		return "periodic";
+	case NIC_POLL_SOFTWARE_PERIODIC:
+		return "software periodic";
+	case NIC_POLL_ADAPTIVE:
+		return "adaptive";
+	default:
+		assert(false);
+		return NULL;
+	}
+}
+
 static char *nic_addr_format(nic_address_t *a)
 {
 	int rc;
@@ -329,6 +364,20 @@ static errno_t nic_list(void)
 		    nic_multicast_mode_str(nic_info.multicast_mode));
 		printf("\tBroadcast receive mode: %s\n",
 		    nic_broadcast_mode_str(nic_info.broadcast_mode));
+		printf("\tPoll mode: %s\n",
+		    nic_poll_mode_str(nic_info.poll_mode));
+
+		if (nic_info.poll_mode == NIC_POLL_ADAPTIVE) {
+			printf("\tInterrupts: %lu, polls: %lu, "
+			    "switches to polling: %lu\n",
+			    nic_info.stats.interrupts, nic_info.stats.polls,
+			    nic_info.stats.poll_switches);
+			if (nic_info.stats.polls != 0) {
+				printf("\tFrames per poll: %lu\n",
+				    nic_info.stats.poll_frames /
+				    nic_info.stats.polls);
+			}
+		}
 
 		if (nic_info.link_state == NIC_CS_PLUGGED) {
 			printf("\tSpeed: %dMbps %s\n", nic_info.speed,
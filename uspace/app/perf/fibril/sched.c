@@ -0,0 +1,206 @@
+/*
+ * Copyright (c) 2026 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <fibril.h>
+#include <fibril_synch.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <errno.h>
+#include "../perf.h"
+
+#define MIN_DURATION_SECS  5
+#define NUM_SAMPLES  3
+
+/** Maximum number of concurrently running fibril pairs */
+#define MAX_PAIRS  4
+
+/** Number of runners needed for all pairs to run in parallel */
+#define MAX_RUNNERS  (2 * MAX_PAIRS)
+
+/** Pair of fibrils passing control back and forth */
+typedef struct {
+	fibril_semaphore_t ping;
+	fibril_semaphore_t pong;
+	uint64_t niter;
+} sched_pair_t;
+
+static FIBRIL_SEMAPHORE_INITIALIZE(pairs_done, 0);
+static bool runners_spawned = false;
+
+static errno_t sched_pinger(void *arg)
+{
+	sched_pair_t *pair = (sched_pair_t *) arg;
+
+	for (uint64_t count = 0; count < pair->niter; count++) {
+		fibril_semaphore_up(&pair->ping);
+		fibril_semaphore_down(&pair->pong);
+	}
+
+	fibril_semaphore_up(&pairs_done);
+	return EOK;
+}
+
+static errno_t sched_ponger(void *arg)
+{
+	sched_pair_t *pair = (sched_pair_t *) arg;
+
+	for (uint64_t count = 0; count < pair->niter; count++) {
+		fibril_semaphore_down(&pair->ping);
+		fibril_semaphore_up(&pair->pong);
+	}
+
+	fibril_semaphore_up(&pairs_done);
+	return EOK;
+}
+
+static errno_t sched_measure(int npairs, uint64_t niter, uint64_t *rduration)
+{
+	sched_pair_t pairs[MAX_PAIRS];
+	struct timespec start;
+	int started = 0;
+	errno_t rc = EOK;
+
+	getuptime(&start);
+
+	for (int i = 0; i < npairs; i++) {
+		fibril_semaphore_initialize(&pairs[i].ping, 0);
+		fibril_semaphore_initialize(&pairs[i].pong, 0);
+		pairs[i].niter = niter;
+
+		fid_t pinger = fibril_create(sched_pinger, &pairs[i]);
+		if (pinger == 0) {
+			rc = ENOMEM;
+			break;
+		}
+
+		fid_t ponger = fibril_create(sched_ponger, &pairs[i]);
+		if (ponger == 0) {
+			fibril_destroy(pinger);
+			rc = ENOMEM;
+			break;
+		}
+
+		fibril_add_ready(pinger);
+		fibril_add_ready(ponger);
+		started++;
+	}
+
+	for (int i = 0; i < 2 * started; i++)
+		fibril_semaphore_down(&pairs_done);
+
+	struct timespec now;
+	getuptime(&now);
+
+	*rduration = ts_sub_diff(&now, &start) / 1000;
+	return rc;
+}
+
+static uint64_t sched_rate(int npairs, uint64_t niter, uint64_t duration)
+{
+	if (duration == 0)
+		return 0;
+
+	return npairs * niter * 1000 * 1000 / duration;
+}
+
+static void sched_report(int npairs, uint64_t niter, uint64_t duration)
+{
+	printf("%d pair(s) completed %" PRIu64 " round trips each in "
+	    "%" PRIu64 " us", npairs, niter, duration);
+
+	if (duration > 0) {
+		printf(", %" PRIu64 " rt/s.\n",
+		    sched_rate(npairs, niter, duration));
+	} else {
+		printf(".\n");
+	}
+}
+
+const char *bench_fibril_sched(void)
+{
+	errno_t rc;
+	uint64_t duration;
+	uint64_t base_rate = 0;
+
+	/* Each fibril of each pair can run on a runner of its own. */
+	if (!runners_spawned) {
+		if (fibril_test_spawn_runners(MAX_RUNNERS) != MAX_RUNNERS)
+			return "Failed to spawn fibril runners.";
+
+		runners_spawned = true;
+	}
+
+	printf("Warm up and determine work size...\n");
+
+	uint64_t niter = 1;
+
+	while (true) {
+		rc = sched_measure(1, niter, &duration);
+		if (rc != EOK)
+			return "Failed.";
+
+		sched_report(1, niter, duration);
+
+		if (duration >= MIN_DURATION_SECS * 1000000)
+			break;
+
+		niter *= 2;
+	}
+
+	for (int npairs = 1; npairs <= MAX_PAIRS; npairs *= 2) {
+		printf("Measure %d samples with %d pair(s)...\n", NUM_SAMPLES,
+		    npairs);
+
+		uint64_t sum = 0;
+
+		for (int i = 0; i < NUM_SAMPLES; i++) {
+			rc = sched_measure(npairs, niter, &duration);
+			if (rc != EOK)
+				return "Failed.";
+
+			sched_report(npairs, niter, duration);
+			sum += sched_rate(npairs, niter, duration);
+		}
+
+		uint64_t avg = sum / NUM_SAMPLES;
+		if (npairs == 1)
+			base_rate = avg;
+
+		printf("Average with %d pair(s): %" PRIu64 " rt/s", npairs, avg);
+
+		if (base_rate > 0) {
+			printf(", speedup %" PRIu64 ".%02" PRIu64 "x.\n",
+			    avg / base_rate, (avg * 100 / base_rate) % 100);
+		} else {
+			printf(".\n");
+		}
+	}
+
+	return NULL;
+}
@@ -0,0 +1,281 @@
+/*
+ * Copyright (c) 2026 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <str.h>
+#include <time.h>
+#include <vfs/vfs.h>
+#include "../perf.h"
+
+#define MIN_DURATION_SECS  2
+
+/** Size of the file */
+#define SEEK_FILE_SIZE  ((aoff64_t) 2 << 30)
+
+/** Size of writes used to create the file */
+#define SEEK_CHUNK_SIZE  (64 * 1024)
+
+/** Size of each random read */
+#define SEEK_READ_SIZE  512
+
+/** Pseudo-random number generator, so that runs are comparable */
+static uint32_t seek_rand(uint32_t *state)
+{
+	*state = *state * 1103515245 + 12345;
+	return *state;
+}
+
+/** Pick a random read position within the file */
+static aoff64_t seek_pos(uint32_t *state)
+{
+	aoff64_t pos;
+
+	pos = ((aoff64_t) (seek_rand(state) >> 8) << 24) ^ seek_rand(state);
+	return (pos % (SEEK_FILE_SIZE / SEEK_READ_SIZE)) * SEEK_READ_SIZE;
+}
+
+/** Check that the file can be used for the measurement.
+ *
+ * The file must reside on a FAT volume. An existing file is used as is
+ * if it has the right size, otherwise there must be enough free space
+ * on the volume to create it.
+ *
+ * @param path   Path of the file
+ * @param exists Place to store @c true if the file already exists
+ *
+ * @return @c NULL on success, error message otherwise
+ */
+static const char *seek_check(const char *path, bool *exists)
+{
+	vfs_stat_t stat;
+	vfs_statfs_t st;
+	char *dir;
+	char *slash;
+	errno_t rc;
+
+	rc = vfs_stat_path(path, &stat);
+	if (rc == EOK) {
+		if (!stat.is_file || stat.size != SEEK_FILE_SIZE)
+			return "Skipped, file exists and is not a benchmark file.";
+
+		*exists = true;
+		rc = vfs_statfs_path(path, &st);
+	} else {
+		/* The file does not exist yet, check the directory it goes to */
+		dir = str_dup(path);
+		if (dir == NULL)
+			return "Out of memory.";
+
+		slash = str_rchr(dir, '/');
+		if (slash == NULL)
+			str_cpy(dir, str_size(dir) + 1, ".");
+		else if (slash == dir)
+			slash[1] = '\0';
+		else
+			*slash = '\0';
+
+		*exists = false;
+		rc = vfs_statfs_path(dir, &st);
+		free(dir);
+	}
+
+	if (rc != EOK)
+		return "Skipped, cannot determine file system of the file.";
+
+	if (str_cmp(st.fs_name, "fat") != 0)
+		return "Skipped, file is not on a FAT volume.";
+
+	if (!*exists && st.f_bfree * st.f_bsize < SEEK_FILE_SIZE)
+		return "Skipped, not enough free space on the volume.";
+
+	return NULL;
+}
+
+/** Create the file.
+ *
+ * @param path Path of the file
+ *
+ * @return @c NULL on success, error message otherwise
+ */
+static const char *seek_create(const char *path)
+{
+	aoff64_t pos;
+	size_t nwr;
+	char *buf;
+	int fd;
+	errno_t rc;
+
+	rc = vfs_lookup_open(path, WALK_REGULAR | WALK_MUST_CREATE,
+	    MODE_WRITE, &fd);
+	if (rc != EOK)
+		return "Cannot create file.";
+
+	buf = malloc(SEEK_CHUNK_SIZE);
+	if (buf == NULL) {
+		vfs_put(fd);
+		(void) vfs_unlink_path(path);
+		return "Out of memory.";
+	}
+
+	printf("Creating %" PRIu64 " MiB file %s...\n",
+	    SEEK_FILE_SIZE >> 20, path);
+
+	/* Mark every block with its position so that reads can be checked */
+	for (pos = 0; pos < SEEK_FILE_SIZE; ) {
+		for (nwr = 0; nwr < SEEK_CHUNK_SIZE; nwr += SEEK_READ_SIZE)
+			*(aoff64_t *) (buf + nwr) = pos + nwr;
+
+		rc = vfs_write(fd, &pos, buf, SEEK_CHUNK_SIZE, &nwr);
+		if (rc != EOK)
+			break;
+	}
+
+	free(buf);
+	(void) vfs_sync(fd);
+	vfs_put(fd);
+
+	if (rc != EOK) {
+		(void) vfs_unlink_path(path);
+		return "Error writing file.";
+	}
+
+	return NULL;
+}
+
+/** Perform a number of random reads and check their contents.
+ *
+ * @param fd       File to read from
+ * @param niter    Number of reads
+ * @param seed     Random generator state
+ * @param duration Place to store duration in microseconds
+ *
+ * @return @c EOK on success, error code otherwise
+ */
+static errno_t seek_measure(int fd, uint64_t niter, uint32_t *seed,
+    uint64_t *duration)
+{
+	struct timespec start;
+	struct timespec now;
+	char buf[SEEK_READ_SIZE];
+	aoff64_t pos;
+	aoff64_t rpos;
+	uint64_t count;
+	size_t nread;
+	errno_t rc;
+
+	getuptime(&start);
+
+	for (count = 0; count < niter; count++) {
+		pos = seek_pos(seed);
+		rpos = pos;
+		rc = vfs_read(fd, &rpos, buf, SEEK_READ_SIZE, &nread);
+		if (rc != EOK)
+			return rc;
+
+		if (nread != SEEK_READ_SIZE || *(aoff64_t *) buf != pos)
+			return EIO;
+	}
+
+	getuptime(&now);
+
+	*duration = ts_sub_diff(&now, &start) / 1000;
+	return EOK;
+}
+
+const char *bench_fat_seek(void)
+{
+	const char *err;
+	uint64_t niter = 1;
+	uint64_t duration;
+	uint32_t seed = 1;
+	const char *path;
+	bool exists;
+	int fd;
+	errno_t rc;
+
+	if (bench_argc != 1)
+		return "Usage: perf fat_seek <file on a FAT volume>";
+
+	path = bench_argv[0];
+
+	err = seek_check(path, &exists);
+	if (err != NULL)
+		return err;
+
+	if (!exists) {
+		err = seek_create(path);
+		if (err != NULL)
+			return err;
+	}
+
+	rc = vfs_lookup_open(path, WALK_REGULAR, MODE_READ, &fd);
+	if (rc != EOK) {
+		err = "Cannot open file.";
+		goto out;
+	}
+
+	/*
+	 * The first read maps the cluster chain of the file up to the read
+	 * position, report it separately from the steady state.
+	 */
+	rc = seek_measure(fd, 1, &seed, &duration);
+	if (rc != EOK) {
+		err = "Error reading file.";
+		goto close;
+	}
+
+	printf("First read: %" PRIu64 " us.\n", duration);
+
+	while (true) {
+		rc = seek_measure(fd, niter, &seed, &duration);
+		if (rc != EOK) {
+			err = "Error reading file.";
+			goto close;
+		}
+
+		if (duration >= MIN_DURATION_SECS * 1000000)
+			break;
+
+		niter *= 2;
+	}
+
+	printf("%" PRIu64 " random reads of %u bytes in a %" PRIu64
+	    " MiB file: %" PRIu64 " reads/s.\n", niter, SEEK_READ_SIZE,
+	    SEEK_FILE_SIZE >> 20, niter * 1000000 / duration);
+
+close:
+	vfs_put(fd);
+out:
+	/* Do not leave a file we created behind, even after a failure */
+	if (!exists)
+		(void) vfs_unlink_path(path);
+	return err;
+}
@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) 2026 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <errno.h>
+#include <inet/checksum.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "../perf.h"
+
+#define MIN_DURATION_SECS  2
+
+/** Largest measured buffer size */
+#define CHECKSUM_MAX_SIZE  9000
+
+/** Measured buffer sizes: bare ACK, minimum MTU, Ethernet MTU, jumbo frame */
+static size_t checksum_sizes[] = { 40, 576, 1500, 9000 };
+
+typedef uint16_t (*checksum_fn_t)(uint16_t, const void *, size_t);
+
+/** Byte-pair checksum the network servers used before, for comparison */
+static uint16_t checksum_bytewise(uint16_t ivalue, const void *data,
+    size_t size)
+{
+	const uint8_t *bdata = (const uint8_t *) data;
+	uint32_t sum;
+	size_t i;
+
+	sum = (uint16_t) ~ivalue;
+	for (i = 0; i + 1 < size; i += 2) {
+		sum += ((uint16_t) bdata[i] << 8) | bdata[i + 1];
+		sum = (sum & 0xffff) + (sum >> 16);
+	}
+
+	if (i < size) {
+		sum += (uint16_t) bdata[i] << 8;
+		sum = (sum & 0xffff) + (sum >> 16);
+	}
+
+	return ~sum;
+}
+
+static uint64_t checksum_measure(checksum_fn_t fn, const uint8_t *buf,
+    size_t size, uint64_t niter, uint16_t *rcs)
+{
+	struct timespec start;
+	struct timespec now;
+	uint16_t cs = INET_CHECKSUM_INIT;
+	uint64_t count;
+
+	getuptime(&start);
+
+	/* Chain the results so that the calls cannot be optimized away */
+	for (count = 0; count < niter; count++)
+		cs = fn(cs, buf, size);
+
+	getuptime(&now);
+
+	*rcs = cs;
+	return ts_sub_diff(&now, &start) / 1000;
+}
+
+/** Measure one checksum function over one buffer size.
+ *
+ * @return Throughput in MB/s
+ */
+static uint64_t checksum_run(checksum_fn_t fn, const uint8_t *buf,
+    size_t size, uint16_t *rcs)
+{
+	uint64_t niter = 1;
+	uint64_t duration;
+
+	while (true) {
+		duration = checksum_measure(fn, buf, size, niter, rcs);
+		if (duration >= MIN_DURATION_SECS * 1000000)
+			break;
+
+		niter *= 2;
+	}
+
+	/* Bytes per microsecond equal MB/s */
+	return niter * size / duration;
+}
+
+const char *bench_inet_checksum(void)
+{
+	uint8_t *buf;
+	uint64_t ref_rate;
+	uint64_t opt_rate;
+	uint16_t ref_cs;
+	uint16_t opt_cs;
+	size_t i;
+
+	buf = malloc(CHECKSUM_MAX_SIZE);
+	if (buf == NULL)
+		return "Out of memory.";
+
+	for (i = 0; i < CHECKSUM_MAX_SIZE; i++)
+		buf[i] = i * 7 + 3;
+
+	for (i = 0; i < sizeof(checksum_sizes) / sizeof(checksum_sizes[0]);
+	    i++) {
+		ref_rate = checksum_run(checksum_bytewise, buf,
+		    checksum_sizes[i], &ref_cs);
+		opt_rate = checksum_run(inet_checksum_calc, buf,
+		    checksum_sizes[i], &opt_cs);
+
+		if (ref_cs != opt_cs) {
+			free(buf);
+			return "Checksum mismatch.";
+		}
+
+		printf("%5zu bytes: byte-wise %" PRIu64 " MB/s, "
+		    "word-wide %" PRIu64 " MB/s", checksum_sizes[i],
+		    ref_rate, opt_rate);
+
+		if (ref_rate > 0) {
+			printf(", speedup %" PRIu64 ".%02" PRIu64 "x.\n",
+			    opt_rate / ref_rate, (opt_rate * 100 / ref_rate) % 100);
+		} else {
+			printf(".\n");
+		}
+	}
+
+	free(buf);
+	return NULL;
+}
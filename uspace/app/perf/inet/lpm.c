@@ -0,0 +1,222 @@
+/*
+ * Copyright (c) 2026 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <errno.h>
+#include <inet/addr.h>
+#include <inet/lpm.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "../perf.h"
+
+#define MIN_DURATION_SECS  2
+
+/** Number of distinct destinations looked up */
+#define LPM_DEST_COUNT  1024
+
+/** Measured table sizes */
+static size_t lpm_sizes[] = { 10, 1000, 100000 };
+
+/** Routing table kept as an array scanned linearly, for comparison */
+typedef struct {
+	inet_naddr_t *dest;
+	size_t count;
+} lpm_list_t;
+
+/** Linear lookup, as static routes in inetsrv used to be found */
+static inet_naddr_t *lpm_list_lookup(lpm_list_t *list, inet_addr_t *addr)
+{
+	inet_naddr_t *best = NULL;
+	size_t i;
+
+	for (i = 0; i < list->count; i++) {
+		if (best != NULL && best->prefix >= list->dest[i].prefix)
+			continue;
+
+		if (inet_naddr_compare_mask(&list->dest[i], addr))
+			best = &list->dest[i];
+	}
+
+	return best;
+}
+
+/** Pseudo-random number generator, so that runs are comparable */
+static uint32_t lpm_rand(uint32_t *state)
+{
+	*state = *state * 1103515245 + 12345;
+	return *state;
+}
+
+static uint64_t lpm_measure(inet_lpm_t *lpm, lpm_list_t *list,
+    inet_addr_t *dests, uint64_t niter, uintptr_t *rsum)
+{
+	struct timespec start;
+	struct timespec now;
+	uintptr_t sum = 0;
+	uint64_t count;
+
+	getuptime(&start);
+
+	/* Sum the results so that the lookups cannot be optimized away */
+	for (count = 0; count < niter; count++) {
+		if (lpm != NULL) {
+			sum += (uintptr_t) inet_lpm_lookup(lpm,
+			    &dests[count % LPM_DEST_COUNT]);
+		} else {
+			sum += (uintptr_t) lpm_list_lookup(list,
+			    &dests[count % LPM_DEST_COUNT]);
+		}
+	}
+
+	getuptime(&now);
+
+	*rsum = sum;
+	return ts_sub_diff(&now, &start) / 1000;
+}
+
+/** Measure lookups in one of the tables.
+ *
+ * @return Lookups per second
+ */
+static uint64_t lpm_run(inet_lpm_t *lpm, lpm_list_t *list, inet_addr_t *dests)
+{
+	uintptr_t sum;
+	uint64_t niter = 1;
+	uint64_t duration;
+
+	while (true) {
+		duration = lpm_measure(lpm, list, dests, niter, &sum);
+		if (duration >= MIN_DURATION_SECS * 1000000)
+			break;
+
+		niter *= 2;
+	}
+
+	return niter * 1000000 / duration;
+}
+
+/** Fill both tables with the same random IPv4 routes.
+ *
+ * @return @c NULL on success, error message otherwise
+ */
+static const char *lpm_fill(inet_lpm_t *lpm, lpm_list_t *list, size_t size,
+    uint32_t *seed)
+{
+	inet_naddr_t *naddr;
+
+	list->count = 0;
+	while (list->count < size) {
+		naddr = &list->dest[list->count];
+		inet_naddr_set(lpm_rand(seed), 8 + lpm_rand(seed) % 25, naddr);
+
+		switch (inet_lpm_insert(lpm, naddr, naddr)) {
+		case EOK:
+			list->count++;
+			break;
+		case EEXIST:
+			/* Keep the networks distinct */
+			break;
+		default:
+			return "Out of memory.";
+		}
+	}
+
+	return NULL;
+}
+
+const char *bench_inet_lpm(void)
+{
+	lpm_list_t list;
+	inet_lpm_t lpm;
+	inet_addr_t *dests;
+	uint64_t list_rate;
+	uint64_t lpm_rate;
+	uint32_t seed = 1;
+	const char *err = NULL;
+	size_t i, j;
+
+	dests = calloc(LPM_DEST_COUNT, sizeof(inet_addr_t));
+	list.dest = calloc(lpm_sizes[sizeof(lpm_sizes) / sizeof(lpm_sizes[0]) - 1],
+	    sizeof(inet_naddr_t));
+	if (dests == NULL || list.dest == NULL) {
+		free(dests);
+		free(list.dest);
+		return "Out of memory.";
+	}
+
+	for (i = 0; i < sizeof(lpm_sizes) / sizeof(lpm_sizes[0]); i++) {
+		inet_lpm_init(&lpm);
+
+		err = lpm_fill(&lpm, &list, lpm_sizes[i], &seed);
+		if (err != NULL) {
+			inet_lpm_fini(&lpm);
+			break;
+		}
+
+		/* Half of the destinations fall into some of the routes */
+		for (j = 0; j < LPM_DEST_COUNT; j++) {
+			if (j % 2 == 0) {
+				inet_naddr_addr(&list.dest[lpm_rand(&seed) %
+				    list.count], &dests[j]);
+				dests[j].addr |= lpm_rand(&seed) & 0xff;
+			} else {
+				inet_addr_set(lpm_rand(&seed), &dests[j]);
+			}
+
+			if (inet_lpm_lookup(&lpm, &dests[j]) !=
+			    lpm_list_lookup(&list, &dests[j])) {
+				err = "Lookup mismatch.";
+				break;
+			}
+		}
+
+		if (err != NULL) {
+			inet_lpm_fini(&lpm);
+			break;
+		}
+
+		list_rate = lpm_run(NULL, &list, dests);
+		lpm_rate = lpm_run(&lpm, NULL, dests);
+		inet_lpm_fini(&lpm);
+
+		printf("%6zu routes: list %" PRIu64 " lookups/s, "
+		    "trie %" PRIu64 " lookups/s", lpm_sizes[i], list_rate,
+		    lpm_rate);
+
+		if (list_rate > 0) {
+			printf(", speedup %" PRIu64 ".%02" PRIu64 "x.\n",
+			    lpm_rate / list_rate, (lpm_rate * 100 / list_rate) % 100);
+		} else {
+			printf(".\n");
+		}
+	}
+
+	free(dests);
+	free(list.dest);
+	return err;
+}
@@ -0,0 +1,174 @@
+/*
+ * Copyright (c) 2026 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <ipc_test.h>
+#include <async.h>
+#include <async_ring.h>
+#include <errno.h>
+#include "../perf.h"
+
+#define MIN_DURATION_SECS  5
+#define NUM_SAMPLES 5
+
+/** Ring batch sizes to measure */
+static size_t batch_sizes[] = { 1, 8, ASYNC_RING_SLOTS };
+
+#define NUM_BATCHES (sizeof(batch_sizes) / sizeof(batch_sizes[0]))
+
+typedef struct {
+	ipc_test_t *test;
+	async_ring_t *ring;
+	/** Ring batch size or zero for plain IPC ping */
+	size_t batch;
+} ring_ping_t;
+
+static errno_t ring_ping_measure(ring_ping_t *rp, uint64_t niter,
+    uint64_t *rduration)
+{
+	struct timespec start;
+	uint64_t count;
+	errno_t retval;
+
+	getuptime(&start);
+
+	if (rp->batch == 0) {
+		for (count = 0; count < niter; count++) {
+			retval = ipc_test_ping(rp->test);
+			if (retval != EOK)
+				return EIO;
+		}
+	} else {
+		for (count = 0; count < niter; count += rp->batch) {
+			retval = ipc_test_ring_ping(rp->ring, rp->batch);
+			if (retval != EOK)
+				return EIO;
+		}
+	}
+
+	struct timespec now;
+	getuptime(&now);
+
+	*rduration = ts_sub_diff(&now, &start) / 1000;
+	return EOK;
+}
+
+/** Measure average round trip rate of one mode.
+ *
+ * @param rp Benchmark state
+ * @param ravg Place to store average number of round trips per second
+ * @return EOK on success or an error code
+ */
+static errno_t ring_ping_run(ring_ping_t *rp, double *ravg)
+{
+	uint64_t dsmp[NUM_SAMPLES];
+	uint64_t duration;
+	uint64_t niter;
+	errno_t rc;
+	int i;
+
+	/* Determine work size */
+	niter = rp->batch > 0 ? rp->batch : 1;
+
+	while (true) {
+		rc = ring_ping_measure(rp, niter, &duration);
+		if (rc != EOK)
+			return rc;
+
+		if (duration >= MIN_DURATION_SECS * 1000000)
+			break;
+
+		niter *= 2;
+	}
+
+	for (i = 0; i < NUM_SAMPLES; i++) {
+		rc = ring_ping_measure(rp, niter, &dsmp[i]);
+		if (rc != EOK)
+			return rc;
+	}
+
+	double sum = 0.0;
+
+	for (i = 0; i < NUM_SAMPLES; i++)
+		sum += (double)niter / ((double)dsmp[i] / 1000000.0l);
+
+	*ravg = sum / NUM_SAMPLES;
+	return EOK;
+}
+
+const char *bench_ring_ping(void)
+{
+	ring_ping_t rp;
+	double ipc_avg;
+	double avg;
+	errno_t rc;
+	const char *msg = NULL;
+	size_t i;
+
+	rp.ring = NULL;
+	rc = ipc_test_create(&rp.test);
+	if (rc != EOK)
+		return "Failed contacting IPC test server.";
+
+	rc = ipc_test_ring_create(rp.test, 0, &rp.ring);
+	if (rc != EOK) {
+		msg = "Failed setting up ring channel.";
+		goto out;
+	}
+
+	printf("Measuring IPC ping-pong...\n");
+	rp.batch = 0;
+	rc = ring_ping_run(&rp, &ipc_avg);
+	if (rc != EOK) {
+		msg = "Failed.";
+		goto out;
+	}
+
+	printf("IPC ping-pong: %.0f rt/s\n", ipc_avg);
+
+	for (i = 0; i < NUM_BATCHES; i++) {
+		printf("Measuring ring channel, batch of %zu...\n",
+		    batch_sizes[i]);
+		rp.batch = batch_sizes[i];
+		rc = ring_ping_run(&rp, &avg);
+		if (rc != EOK) {
+			msg = "Failed.";
+			goto out;
+		}
+
+		printf("Ring channel, batch of %zu: %.0f rt/s (%.2fx IPC)\n",
+		    batch_sizes[i], avg, avg / ipc_avg);
+	}
+
+out:
+	async_ring_destroy(rp.ring);
+	ipc_test_destroy(rp.test);
+	return msg;
+}
@@ -0,0 +1,215 @@
+/*
+ * Copyright (c) 2026 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <fibril.h>
+#include <fibril_synch.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <errno.h>
+#include "../perf.h"
+
+#define MIN_DURATION_SECS  5
+#define NUM_SAMPLES  3
+
+/** Maximum number of concurrently allocating worker fibrils */
+#define MAX_WORKERS  8
+
+/** Number of blocks each worker holds at a time */
+#define BATCH_SIZE  64
+
+/** Sizes of the allocated blocks */
+static const size_t block_sizes[] = {
+	8, 24, 40, 64, 100, 128, 200, 256, 500, 1000
+};
+
+#define BLOCK_SIZES_COUNT  (sizeof(block_sizes) / sizeof(block_sizes[0]))
+
+typedef struct {
+	uint64_t niter;
+	errno_t rc;
+} malloc3_worker_t;
+
+static FIBRIL_SEMAPHORE_INITIALIZE(workers_done, 0);
+static bool runners_spawned = false;
+
+static errno_t malloc3_worker(void *arg)
+{
+	malloc3_worker_t *worker = (malloc3_worker_t *) arg;
+	void *p[BATCH_SIZE];
+
+	worker->rc = EOK;
+
+	for (uint64_t count = 0; count < worker->niter; count++) {
+		size_t i;
+
+		for (i = 0; i < BATCH_SIZE; i++) {
+			p[i] = malloc(block_sizes[(count + i) % BLOCK_SIZES_COUNT]);
+			if (p[i] == NULL) {
+				worker->rc = ENOMEM;
+				break;
+			}
+		}
+
+		while (i > 0)
+			free(p[--i]);
+
+		if (worker->rc != EOK)
+			break;
+	}
+
+	fibril_semaphore_up(&workers_done);
+	return EOK;
+}
+
+static errno_t malloc3_measure(int nworkers, uint64_t niter,
+    uint64_t *rduration)
+{
+	malloc3_worker_t workers[MAX_WORKERS];
+	struct timespec start;
+	int started = 0;
+	errno_t rc = EOK;
+
+	getuptime(&start);
+
+	for (int i = 0; i < nworkers; i++) {
+		workers[i].niter = niter;
+
+		fid_t fid = fibril_create(malloc3_worker, &workers[i]);
+		if (fid == 0) {
+			rc = ENOMEM;
+			break;
+		}
+
+		fibril_add_ready(fid);
+		started++;
+	}
+
+	for (int i = 0; i < started; i++)
+		fibril_semaphore_down(&workers_done);
+
+	for (int i = 0; i < started; i++) {
+		if (workers[i].rc != EOK)
+			rc = workers[i].rc;
+	}
+
+	struct timespec now;
+	getuptime(&now);
+
+	*rduration = ts_sub_diff(&now, &start) / 1000;
+	return rc;
+}
+
+static uint64_t malloc3_rate(int nworkers, uint64_t niter, uint64_t duration)
+{
+	if (duration == 0)
+		return 0;
+
+	return nworkers * niter * BATCH_SIZE * 1000 * 1000 / duration;
+}
+
+static void malloc3_report(int nworkers, uint64_t niter, uint64_t duration)
+{
+	printf("%d worker(s) completed %" PRIu64 " allocations and "
+	    "deallocations each in %" PRIu64 " us", nworkers,
+	    niter * BATCH_SIZE, duration);
+
+	if (duration > 0) {
+		printf(", %" PRIu64 " cycles/s.\n",
+		    malloc3_rate(nworkers, niter, duration));
+	} else {
+		printf(".\n");
+	}
+}
+
+const char *bench_malloc3(void)
+{
+	errno_t rc;
+	uint64_t duration;
+	uint64_t base_rate = 0;
+
+	/*
+	 * The workers never block, therefore each of them
+	 * needs a separate runner to execute in parallel.
+	 */
+	if (!runners_spawned) {
+		if (fibril_test_spawn_runners(MAX_WORKERS) != MAX_WORKERS)
+			return "Failed to spawn fibril runners.";
+
+		runners_spawned = true;
+	}
+
+	printf("Warm up and determine work size...\n");
+
+	uint64_t niter = 1;
+
+	while (true) {
+		rc = malloc3_measure(1, niter, &duration);
+		if (rc != EOK)
+			return "Failed.";
+
+		malloc3_report(1, niter, duration);
+
+		if (duration >= MIN_DURATION_SECS * 1000000)
+			break;
+
+		niter *= 2;
+	}
+
+	for (int nworkers = 1; nworkers <= MAX_WORKERS; nworkers *= 2) {
+		printf("Measure %d samples with %d worker(s)...\n", NUM_SAMPLES,
+		    nworkers);
+
+		uint64_t sum = 0;
+
+		for (int i = 0; i < NUM_SAMPLES; i++) {
+			rc = malloc3_measure(nworkers, niter, &duration);
+			if (rc != EOK)
+				return "Failed.";
+
+			malloc3_report(nworkers, niter, duration);
+			sum += malloc3_rate(nworkers, niter, duration);
+		}
+
+		uint64_t avg = sum / NUM_SAMPLES;
+		if (nworkers == 1)
+			base_rate = avg;
+
+		printf("Average with %d worker(s): %" PRIu64 " cycles/s", nworkers,
+		    avg);
+
+		if (base_rate > 0) {
+			printf(", speedup %" PRIu64 ".%02" PRIu64 "x.\n",
+			    avg / base_rate, (avg * 100 / base_rate) % 100);
+		} else {
+			printf(".\n");
+		}
+	}
+
+	return NULL;
+}
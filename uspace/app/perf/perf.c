@@ -39,12 +39,21 @@
 #include <str.h>
 #include "perf.h"
 
+int bench_argc;
+char **bench_argv;
+
 benchmark_t benchmarks[] = {
+#include "fibril/sched.def"
+#include "fs/fat_seek.def"
+#include "inet/checksum.def"
+#include "inet/lpm.def"
 #include "ipc/ns_ping.def"
 #include "ipc/ping_pong.def"
+#include "ipc/ring_ping.def"
 #include "malloc/malloc1.def"
 #include "malloc/malloc2.def"
-	{ NULL, NULL, NULL }
+#include "malloc/malloc3.def"
+	{ NULL, NULL, NULL, false }
 };
 
 static bool run_benchmark(benchmark_t *bench)
@@ -61,7 +70,7 @@ static bool run_benchmark(benchmark_t *bench)
 	return false;
 }
 
-static int run_benchmarks(void)
+static int run_safe_benchmarks(void)
 {
 	benchmark_t *bench;
 	unsigned int i = 0;
@@ -69,9 +78,12 @@ static int run_benchmarks(void)
 
 	char *failed_names = NULL;
 
-	printf("\n*** Running all benchmarks ***\n\n");
+	printf("\n*** Running all safe benchmarks ***\n\n");
 
 	for (bench = benchmarks; bench->name != NULL; bench++) {
+		if (!bench->safe)
+			continue;
+
 		printf("%s (%s)\n", bench->name, bench->desc);
 		if (run_benchmark(bench)) {
 			i++;
@@ -116,22 +128,26 @@ static void list_benchmarks(void)
 	}
 
 	for (bench = benchmarks; bench->name != NULL; bench++)
-		printf("%-*s %s\n", _len, bench->name, bench->desc);
+		printf("%-*s %s%s\n", _len, bench->name, bench->desc,
+		    (bench->safe ? "" : " (unsafe)"));
 
-	printf("%-*s Run all benchmarks\n", _len, "*");
+	printf("%-*s Run all safe benchmarks\n", _len, "*");
 }
 
 int main(int argc, char *argv[])
 {
 	if (argc < 2) {
 		printf("Usage:\n\n");
-		printf("%s <benchmark>\n\n", argv[0]);
+		printf("%s <benchmark> [args ...]\n\n", argv[0]);
 		list_benchmarks();
 		return 0;
 	}
 
+	bench_argc = argc - 2;
+	bench_argv = argv + 2;
+
 	if (str_cmp(argv[1], "*") == 0) {
-		return run_benchmarks();
+		return run_safe_benchmarks();
 	}
 
 	benchmark_t *bench;
@@ -43,12 +43,22 @@ typedef struct {
 	const char *name;
 	const char *desc;
 	benchmark_entry_t entry;
+	bool safe;
 } benchmark_t;
 
+extern int bench_argc;
+extern char **bench_argv;
+
+extern const char *bench_fat_seek(void);
+extern const char *bench_fibril_sched(void);
+extern const char *bench_inet_checksum(void);
+extern const char *bench_inet_lpm(void);
 extern const char *bench_malloc1(void);
 extern const char *bench_malloc2(void);
+extern const char *bench_malloc3(void);
 extern const char *bench_ns_ping(void);
 extern const char *bench_ping_pong(void);
+extern const char *bench_ring_ping(void);
 
 extern benchmark_t benchmarks[];
 
@@ -260,6 +260,9 @@ static inline void print_cpu_info(data_t *data)
 			print_percent(data->cpus_perc[i].idle, 2);
 			fputs(", busy: ", stdout);
 			print_percent(data->cpus_perc[i].busy, 2);
+			printf(", migrations: %" PRIu64 " (%" PRIu64 " remote)",
+			    data->cpus[i].migrations,
+			    data->cpus[i].migrations_remote);
 		} else
 			printf("cpu%u inactive", data->cpus[i].id);
 
@@ -31,7 +31,10 @@
  */
 
 #include <as.h>
+#include <assert.h>
+#include <bitops.h>
 #include <errno.h>
+#include <macros.h>
 #include <stdio.h>
 #include <ddf/interrupt.h>
 #include <ddf/log.h>
@@ -116,8 +119,7 @@ static errno_t write_blocks(ddf_fun_t *, uint64_t, size_t, void *);
 
 static errno_t ahci_identify_device(sata_dev_t *);
 static errno_t ahci_set_highest_ultra_dma_mode(sata_dev_t *);
-static errno_t ahci_rb_fpdma(sata_dev_t *, uintptr_t, uint64_t);
-static errno_t ahci_wb_fpdma(sata_dev_t *, uintptr_t, uint64_t);
+static errno_t ahci_rw_fpdma(sata_dev_t *, uint64_t, size_t, void *, bool);
 
 static void ahci_sata_devices_create(ahci_dev_t *, ddf_dev_t *);
 static ahci_dev_t *ahci_ahci_create(ddf_dev_t *);
@@ -228,33 +230,7 @@ static errno_t read_blocks(ddf_fun_t *fun, uint64_t blocknum,
     size_t count, void *buf)
 {
 	sata_dev_t *sata = fun_sata_dev(fun);
-
-	uintptr_t phys;
-	void *ibuf = AS_AREA_ANY;
-	errno_t rc = dmamem_map_anonymous(sata->block_size, DMAMEM_4GiB,
-	    AS_AREA_READ | AS_AREA_WRITE, 0, &phys, &ibuf);
-	if (rc != EOK) {
-		ddf_msg(LVL_ERROR, "Cannot allocate read buffer.");
-		return rc;
-	}
-
-	memset(buf, 0, sata->block_size);
-
-	fibril_mutex_lock(&sata->lock);
-
-	for (size_t cur = 0; cur < count; cur++) {
-		rc = ahci_rb_fpdma(sata, phys, blocknum + cur);
-		if (rc != EOK)
-			break;
-
-		memcpy((void *) (((uint8_t *) buf) + (sata->block_size * cur)),
-		    ibuf, sata->block_size);
-	}
-
-	fibril_mutex_unlock(&sata->lock);
-	dmamem_unmap_anonymous(ibuf);
-
-	return rc;
+	return ahci_rw_fpdma(sata, blocknum, count, buf, false);
 }
 
 /** Write data blocks into SATA device.
@@ -271,30 +247,7 @@ static errno_t write_blocks(ddf_fun_t *fun, uint64_t blocknum,
     size_t count, void *buf)
 {
 	sata_dev_t *sata = fun_sata_dev(fun);
-
-	uintptr_t phys;
-	void *ibuf = AS_AREA_ANY;
-	errno_t rc = dmamem_map_anonymous(sata->block_size, DMAMEM_4GiB,
-	    AS_AREA_READ | AS_AREA_WRITE, 0, &phys, &ibuf);
-	if (rc != EOK) {
-		ddf_msg(LVL_ERROR, "Cannot allocate write buffer.");
-		return rc;
-	}
-
-	fibril_mutex_lock(&sata->lock);
-
-	for (size_t cur = 0; cur < count; cur++) {
-		memcpy(ibuf, (void *) (((uint8_t *) buf) + (sata->block_size * cur)),
-		    sata->block_size);
-		rc = ahci_wb_fpdma(sata, phys, blocknum + cur);
-		if (rc != EOK)
-			break;
-	}
-
-	fibril_mutex_unlock(&sata->lock);
-	dmamem_unmap_anonymous(ibuf);
-
-	return rc;
+	return ahci_rw_fpdma(sata, blocknum, count, buf, true);
 }
 
 /*----------------------------------------------------------------------------*/
@@ -478,6 +431,8 @@ static errno_t ahci_identify_device(sata_dev_t *sata)
 		goto error;
 	}
 
+	sata->queue_depth = (idata->queue_depth & 0x1f) + 1;
+
 	uint16_t logsec = idata->physical_logic_sector_size;
 	if ((logsec & 0xc000) == 0x4000) {
 		/* Length of sector may be larger than 512 B */
@@ -668,110 +623,152 @@ error:
 	return EINTR;
 }
 
-/** Set AHCI registers for reading one sector from the SATA device using FPDMA.
+/** Get virtual address of DMA buffer pool chunk.
  *
- * @param sata     SATA device structure.
- * @param phys     Physical address of buffer for sector data.
- * @param blocknum Block number to read.
+ * @param sata  SATA device structure.
+ * @param chunk Chunk number.
+ *
+ * @return Virtual address of chunk.
  *
  */
-static void ahci_rb_fpdma_cmd(sata_dev_t *sata, uintptr_t phys,
-    uint64_t blocknum)
+static void *ahci_chunk_virt(sata_dev_t *sata, unsigned int chunk)
 {
-	volatile sata_ncq_command_frame_t *cmd =
-	    (sata_ncq_command_frame_t *) sata->cmd_table;
+	return (uint8_t *) sata->pool_virt[chunk / AHCI_AREA_CHUNKS] +
+	    (chunk % AHCI_AREA_CHUNKS) * AHCI_CHUNK_SIZE;
+}
 
-	cmd->fis_type = SATA_CMD_FIS_TYPE;
-	cmd->c = SATA_CMD_FIS_COMMAND_INDICATOR;
-	cmd->command = 0x60;
-	cmd->tag = 0;
-	cmd->control = 0;
+/** Get physical address of DMA buffer pool chunk.
+ *
+ * @param sata  SATA device structure.
+ * @param chunk Chunk number.
+ *
+ * @return Physical address of chunk.
+ *
+ */
+static uintptr_t ahci_chunk_phys(sata_dev_t *sata, unsigned int chunk)
+{
+	return sata->pool_phys[chunk / AHCI_AREA_CHUNKS] +
+	    (chunk % AHCI_AREA_CHUNKS) * AHCI_CHUNK_SIZE;
+}
 
-	cmd->reserved1 = 0;
-	cmd->reserved2 = 0;
-	cmd->reserved3 = 0;
-	cmd->reserved4 = 0;
-	cmd->reserved5 = 0;
-	cmd->reserved6 = 0;
+/** Allocate NCQ command slot together with DMA buffers.
+ *
+ * @param sata  SATA device structure.
+ * @param size  Size of data transferred by the command.
+ * @param wait  Wait until a slot and enough buffers are available.
+ * @param rslot Place to store the allocated slot number.
+ *
+ * @return EOK if succeed, EBUSY if no slot is available and @a wait
+ *         is false.
+ *
+ */
+static errno_t ahci_slot_get(sata_dev_t *sata, size_t size, bool wait,
+    unsigned int *rslot)
+{
+	size_t nchunks = (size + AHCI_CHUNK_SIZE - 1) / AHCI_CHUNK_SIZE;
 
-	cmd->sector_count_low = 1;
-	cmd->sector_count_high = 0;
+	assert(nchunks <= AHCI_PRDT_ENTRIES);
 
-	cmd->lba0 = blocknum & 0xff;
-	cmd->lba1 = (blocknum >> 8) & 0xff;
-	cmd->lba2 = (blocknum >> 16) & 0xff;
-	cmd->lba3 = (blocknum >> 24) & 0xff;
-	cmd->lba4 = (blocknum >> 32) & 0xff;
-	cmd->lba5 = (blocknum >> 40) & 0xff;
+	fibril_mutex_lock(&sata->event_lock);
 
-	volatile ahci_cmd_prdt_t *prdt =
-	    (ahci_cmd_prdt_t *) (&sata->cmd_table[0x20]);
+	while ((sata->slots_free == 0) || (sata->pool_nfree < nchunks)) {
+		if (!wait) {
+			fibril_mutex_unlock(&sata->event_lock);
+			return EBUSY;
+		}
 
-	prdt->data_address_low = LO(phys);
-	prdt->data_address_upper = HI(phys);
-	prdt->reserved1 = 0;
-	prdt->dbc = sata->block_size - 1;
-	prdt->reserved2 = 0;
-	prdt->ioc = 0;
+		fibril_condvar_wait(&sata->slot_condvar, &sata->event_lock);
+	}
 
-	sata->cmd_header->prdtl = 1;
-	sata->cmd_header->flags =
-	    AHCI_CMDHDR_FLAGS_CLEAR_BUSY_UPON_OK |
-	    AHCI_CMDHDR_FLAGS_5DWCMD;
-	sata->cmd_header->bytesprocessed = 0;
+	unsigned int slot = fnzb32(sata->slots_free);
+	sata->slots_free &= ~(UINT32_C(1) << slot);
 
-	sata->port->pxsact |= 1;
-	sata->port->pxci |= 1;
+	ahci_slot_t *cslot = &sata->slots[slot];
+	for (size_t i = 0; i < nchunks; i++)
+		cslot->chunks[i] = sata->pool_free[--sata->pool_nfree];
+
+	cslot->nchunks = nchunks;
+	cslot->done = false;
+
+	fibril_mutex_unlock(&sata->event_lock);
+
+	*rslot = slot;
+	return EOK;
 }
 
-/** Read one sector from the SATA device using FPDMA.
+/** Release NCQ command slot together with its DMA buffers.
  *
- * @param sata     SATA device structure.
- * @param phys     Physical address of buffer for sector data.
- * @param blocknum Block number to read.
+ * @param sata SATA device structure.
+ * @param slot Slot number.
  *
- * @return EOK if succeed, error code otherwise
+ */
+static void ahci_slot_put(sata_dev_t *sata, unsigned int slot)
+{
+	ahci_slot_t *cslot = &sata->slots[slot];
+
+	fibril_mutex_lock(&sata->event_lock);
+
+	for (size_t i = 0; i < cslot->nchunks; i++)
+		sata->pool_free[sata->pool_nfree++] = cslot->chunks[i];
+
+	cslot->nchunks = 0;
+	sata->slots_free |= UINT32_C(1) << slot;
+	fibril_condvar_broadcast(&sata->slot_condvar);
+
+	fibril_mutex_unlock(&sata->event_lock);
+}
+
+/** Copy data between client buffer and DMA buffers of a command slot.
+ *
+ * @param sata  SATA device structure.
+ * @param slot  Slot number.
+ * @param buf   Client buffer.
+ * @param size  Number of bytes to copy.
+ * @param write Copy into DMA buffers if true, out of them otherwise.
  *
  */
-static errno_t ahci_rb_fpdma(sata_dev_t *sata, uintptr_t phys, uint64_t blocknum)
+static void ahci_slot_copy(sata_dev_t *sata, unsigned int slot, uint8_t *buf,
+    size_t size, bool write)
 {
-	if (sata->is_invalid_device) {
-		ddf_msg(LVL_ERROR,
-		    "%s: FPDMA read from invalid device", sata->model);
-		return EINTR;
-	}
+	ahci_slot_t *cslot = &sata->slots[slot];
 
-	ahci_rb_fpdma_cmd(sata, phys, blocknum);
-	ahci_port_is_t pxis = ahci_wait_event(sata);
+	for (size_t i = 0; i < cslot->nchunks; i++) {
+		size_t len = min(size, (size_t) AHCI_CHUNK_SIZE);
+		void *virt = ahci_chunk_virt(sata, cslot->chunks[i]);
 
-	if ((sata->is_invalid_device) || (ahci_port_is_error(pxis))) {
-		ddf_msg(LVL_ERROR,
-		    "%s: Unrecoverable error during FPDMA read", sata->model);
-		return EINTR;
-	}
+		if (write)
+			memcpy(virt, buf, len);
+		else
+			memcpy(buf, virt, len);
 
-	return EOK;
+		buf += len;
+		size -= len;
+	}
 }
 
-/** Set AHCI registers for writing one sector to the SATA device, use FPDMA.
+/** Set AHCI registers for reading or writing sectors using FPDMA.
  *
- * @param sata     SATA device structure.
- * @param phys     Physical address of buffer with sector data.
- * @param blocknum Block number to write.
+ * The PRD table of the slot describes all DMA buffers of the slot,
+ * so the whole transfer is performed by a single command.
  *
- * @return EOK if succeed, error code otherwise
+ * @param sata     SATA device structure.
+ * @param slot     Command slot (and NCQ tag) to use.
+ * @param blocknum Number of first block.
+ * @param count    Number of blocks to transfer.
+ * @param write    Write sectors if true, read them otherwise.
  *
  */
-static void ahci_wb_fpdma_cmd(sata_dev_t *sata, uintptr_t phys,
-    uint64_t blocknum)
+static void ahci_rw_fpdma_cmd(sata_dev_t *sata, unsigned int slot,
+    uint64_t blocknum, size_t count, bool write)
 {
+	ahci_slot_t *cslot = &sata->slots[slot];
 	volatile sata_ncq_command_frame_t *cmd =
-	    (sata_ncq_command_frame_t *) sata->cmd_table;
+	    (sata_ncq_command_frame_t *) cslot->table;
 
 	cmd->fis_type = SATA_CMD_FIS_TYPE;
 	cmd->c = SATA_CMD_FIS_COMMAND_INDICATOR;
-	cmd->command = 0x61;
-	cmd->tag = 0;
+	cmd->command = write ? 0x61 : 0x60;
+	cmd->tag = slot << 3;
 	cmd->control = 0;
 
 	cmd->reserved1 = 0;
@@ -781,8 +778,8 @@ static void ahci_wb_fpdma_cmd(sata_dev_t *sata, uintptr_t phys,
 	cmd->reserved5 = 0;
 	cmd->reserved6 = 0;
 
-	cmd->sector_count_low = 1;
-	cmd->sector_count_high = 0;
+	cmd->sector_count_low = count & 0xff;
+	cmd->sector_count_high = (count >> 8) & 0xff;
 
 	cmd->lba0 = blocknum & 0xff;
 	cmd->lba1 = (blocknum >> 8) & 0xff;
@@ -792,55 +789,171 @@ static void ahci_wb_fpdma_cmd(sata_dev_t *sata, uintptr_t phys,
 	cmd->lba5 = (blocknum >> 40) & 0xff;
 
 	volatile ahci_cmd_prdt_t *prdt =
-	    (ahci_cmd_prdt_t *) (&sata->cmd_table[0x20]);
+	    (ahci_cmd_prdt_t *) (&cslot->table[0x20]);
+	size_t size = count * sata->block_size;
 
-	prdt->data_address_low = LO(phys);
-	prdt->data_address_upper = HI(phys);
-	prdt->reserved1 = 0;
-	prdt->dbc = sata->block_size - 1;
-	prdt->reserved2 = 0;
-	prdt->ioc = 0;
+	for (size_t i = 0; i < cslot->nchunks; i++) {
+		uintptr_t phys = ahci_chunk_phys(sata, cslot->chunks[i]);
+		size_t len = min(size, (size_t) AHCI_CHUNK_SIZE);
 
-	sata->cmd_header->prdtl = 1;
-	sata->cmd_header->flags =
+		prdt[i].data_address_low = LO(phys);
+		prdt[i].data_address_upper = HI(phys);
+		prdt[i].reserved1 = 0;
+		prdt[i].dbc = len - 1;
+		prdt[i].reserved2 = 0;
+		prdt[i].ioc = 0;
+
+		size -= len;
+	}
+
+	volatile ahci_cmdhdr_t *hdr = &sata->cmd_header[slot];
+
+	hdr->prdtl = cslot->nchunks;
+	hdr->flags =
 	    AHCI_CMDHDR_FLAGS_CLEAR_BUSY_UPON_OK |
-	    AHCI_CMDHDR_FLAGS_WRITE |
 	    AHCI_CMDHDR_FLAGS_5DWCMD;
-	sata->cmd_header->bytesprocessed = 0;
+	if (write)
+		hdr->flags |= AHCI_CMDHDR_FLAGS_WRITE;
+	hdr->bytesprocessed = 0;
 
-	sata->port->pxsact |= 1;
-	sata->port->pxci |= 1;
+	/*
+	 * Writing zero bits to PxSACT and PxCI has no effect, so only
+	 * the bit of this slot is written. Issuing under the event lock
+	 * makes sure the interrupt handler sees the slot as issued.
+	 */
+	fibril_mutex_lock(&sata->event_lock);
+
+	sata->slots_issued |= UINT32_C(1) << slot;
+	sata->port->pxsact = UINT32_C(1) << slot;
+	sata->port->pxci = UINT32_C(1) << slot;
+
+	fibril_mutex_unlock(&sata->event_lock);
 }
 
-/** Write one sector into the SATA device, use FPDMA.
+/** Wait for completion of NCQ command.
  *
- * @param sata     SATA device structure.
- * @param phys     Physical address of buffer with sector data.
- * @param blocknum Block number to write.
+ * @param sata SATA device structure.
+ * @param slot Command slot.
  *
  * @return EOK if succeed, error code otherwise
  *
  */
-static errno_t ahci_wb_fpdma(sata_dev_t *sata, uintptr_t phys, uint64_t blocknum)
+static errno_t ahci_slot_wait(sata_dev_t *sata, unsigned int slot)
 {
-	if (sata->is_invalid_device) {
-		ddf_msg(LVL_ERROR,
-		    "%s: FPDMA write to invalid device", sata->model);
-		return EINTR;
-	}
+	ahci_slot_t *cslot = &sata->slots[slot];
 
-	ahci_wb_fpdma_cmd(sata, phys, blocknum);
-	ahci_port_is_t pxis = ahci_wait_event(sata);
+	fibril_mutex_lock(&sata->event_lock);
+
+	while (!cslot->done)
+		fibril_condvar_wait(&sata->event_condvar, &sata->event_lock);
+
+	ahci_port_is_t pxis = cslot->pxis;
+
+	fibril_mutex_unlock(&sata->event_lock);
 
 	if ((sata->is_invalid_device) || (ahci_port_is_error(pxis))) {
 		ddf_msg(LVL_ERROR,
-		    "%s: Unrecoverable error during FPDMA write", sata->model);
+		    "%s: Unrecoverable error during FPDMA transfer", sata->model);
 		return EINTR;
 	}
 
 	return EOK;
 }
 
+/** Read or write sectors of the SATA device using FPDMA.
+ *
+ * The request is split into commands of at most AHCI_PRDT_ENTRIES
+ * DMA buffer chunks each. As many commands as there are free slots
+ * and buffers are kept in flight, so concurrent requests share the
+ * device queue.
+ *
+ * @param sata     SATA device structure.
+ * @param blocknum Number of first block.
+ * @param count    Number of blocks to transfer.
+ * @param buf      Data buffer.
+ * @param write    Write sectors if true, read them otherwise.
+ *
+ * @return EOK if succeed, error code otherwise
+ *
+ */
+static errno_t ahci_rw_fpdma(sata_dev_t *sata, uint64_t blocknum,
+    size_t count, void *buf, bool write)
+{
+	struct {
+		unsigned int slot;
+		size_t first;
+		size_t count;
+	} pending[AHCI_NCQ_SLOTS];
+
+	size_t max_count = AHCI_PRDT_ENTRIES * AHCI_CHUNK_SIZE /
+	    sata->block_size;
+	size_t head = 0;
+	size_t npending = 0;
+	size_t issued = 0;
+	errno_t rc = EOK;
+
+	while (true) {
+		/* Issue commands while there are free slots and buffers */
+		while ((rc == EOK) && (issued < count) &&
+		    (npending < AHCI_NCQ_SLOTS)) {
+			if (sata->is_invalid_device) {
+				ddf_msg(LVL_ERROR,
+				    "%s: FPDMA transfer on invalid device",
+				    sata->model);
+				rc = EINTR;
+				break;
+			}
+
+			size_t cnt = min(count - issued, max_count);
+			unsigned int slot;
+
+			/* Only block if there is nothing to complete first */
+			if (ahci_slot_get(sata, cnt * sata->block_size,
+			    npending == 0, &slot) != EOK)
+				break;
+
+			if (write) {
+				ahci_slot_copy(sata, slot, (uint8_t *) buf +
+				    issued * sata->block_size,
+				    cnt * sata->block_size, true);
+			}
+
+			ahci_rw_fpdma_cmd(sata, slot, blocknum + issued, cnt,
+			    write);
+
+			size_t idx = (head + npending) % AHCI_NCQ_SLOTS;
+			pending[idx].slot = slot;
+			pending[idx].first = issued;
+			pending[idx].count = cnt;
+			npending++;
+
+			issued += cnt;
+		}
+
+		if (npending == 0)
+			break;
+
+		/* Complete the oldest command */
+		unsigned int slot = pending[head].slot;
+		errno_t crc = ahci_slot_wait(sata, slot);
+
+		if ((crc == EOK) && (rc == EOK) && (!write)) {
+			ahci_slot_copy(sata, slot, (uint8_t *) buf +
+			    pending[head].first * sata->block_size,
+			    pending[head].count * sata->block_size, false);
+		}
+
+		if (crc != EOK)
+			rc = crc;
+
+		ahci_slot_put(sata, slot);
+		head = (head + 1) % AHCI_NCQ_SLOTS;
+		npending--;
+	}
+
+	return rc;
+}
+
 /*----------------------------------------------------------------------------*/
 /*-- Interrupts handling -----------------------------------------------------*/
 /*----------------------------------------------------------------------------*/
@@ -912,7 +1025,31 @@ static void ahci_interrupt(ipc_call_t *icall, ddf_dev_t *dev)
 		fibril_mutex_lock(&sata->event_lock);
 
 		sata->event_pxis = pxis;
-		fibril_condvar_signal(&sata->event_condvar);
+
+		/*
+		 * Queued commands are complete once the device cleared their
+		 * PxSACT bit and the HBA their PxCI bit. Error recovery of
+		 * queued commands is not supported, an error fails all
+		 * of them.
+		 */
+		uint32_t done = sata->slots_issued;
+		if (ahci_port_is_error(pxis)) {
+			if (done != 0)
+				sata->is_invalid_device = true;
+		} else {
+			done &= ~(sata->port->pxsact | sata->port->pxci);
+		}
+
+		sata->slots_issued &= ~done;
+		while (done != 0) {
+			unsigned int slot = fnzb32(done);
+			done &= ~(UINT32_C(1) << slot);
+
+			sata->slots[slot].pxis = pxis;
+			sata->slots[slot].done = true;
+		}
+
+		fibril_condvar_broadcast(&sata->event_condvar);
 
 		fibril_mutex_unlock(&sata->event_lock);
 	}
@@ -968,19 +1105,47 @@ static sata_dev_t *ahci_sata_allocate(ahci_dev_t *ahci, volatile ahci_port_t *po
 	sata->port->pxclb = LO(phys);
 	sata->cmd_header = (ahci_cmdhdr_t *) virt_cmd;
 
-	/* Allocate and init command table structure. */
-	rc = dmamem_map_anonymous(size, DMAMEM_4GiB,
+	/* Allocate and init command tables of all command slots. */
+	size_t table_size = AHCI_NCQ_SLOTS * AHCI_CMD_TABLE_SIZE;
+	rc = dmamem_map_anonymous(table_size, DMAMEM_4GiB,
 	    AS_AREA_READ | AS_AREA_WRITE, 0, &phys, &virt_table);
 	if (rc != EOK)
 		goto error_table;
 
-	memset(virt_table, 0, size);
-	sata->cmd_header->cmdtableu = HI(phys);
-	sata->cmd_header->cmdtable = LO(phys);
-	sata->cmd_table = (uint32_t *) virt_table;
+	memset(virt_table, 0, table_size);
+	for (unsigned int slot = 0; slot < AHCI_NCQ_SLOTS; slot++) {
+		uintptr_t offset = slot * AHCI_CMD_TABLE_SIZE;
+
+		sata->cmd_header[slot].cmdtableu = HI(phys + offset);
+		sata->cmd_header[slot].cmdtable = LO(phys + offset);
+		sata->slots[slot].table =
+		    (uint32_t *) ((uint8_t *) virt_table + offset);
+	}
+
+	sata->cmd_table = sata->slots[0].table;
+
+	/* Allocate DMA buffer pool. */
+	size_t area;
+	for (area = 0; area < AHCI_POOL_AREAS; area++) {
+		sata->pool_virt[area] = AS_AREA_ANY;
+		rc = dmamem_map_anonymous(AHCI_AREA_CHUNKS * AHCI_CHUNK_SIZE,
+		    DMAMEM_4GiB, AS_AREA_READ | AS_AREA_WRITE, 0,
+		    &sata->pool_phys[area], &sata->pool_virt[area]);
+		if (rc != EOK)
+			goto error_pool;
+	}
+
+	for (unsigned int chunk = 0; chunk < AHCI_POOL_CHUNKS; chunk++)
+		sata->pool_free[chunk] = chunk;
+
+	sata->pool_nfree = AHCI_POOL_CHUNKS;
 
 	return sata;
 
+error_pool:
+	while (area > 0)
+		dmamem_unmap_anonymous(sata->pool_virt[--area]);
+	dmamem_unmap(virt_table, table_size);
 error_table:
 	dmamem_unmap(virt_cmd, size);
 error_cmd:
@@ -1056,6 +1221,7 @@ static errno_t ahci_sata_create(ahci_dev_t *ahci, ddf_dev_t *dev,
 	fibril_mutex_initialize(&sata->lock);
 	fibril_mutex_initialize(&sata->event_lock);
 	fibril_condvar_initialize(&sata->event_condvar);
+	fibril_condvar_initialize(&sata->slot_condvar);
 
 	ahci_sata_hw_start(sata);
 
@@ -1063,6 +1229,15 @@ static errno_t ahci_sata_create(ahci_dev_t *ahci, ddf_dev_t *dev,
 	if (ahci_identify_device(sata) != EOK)
 		goto error;
 
+	/* Use as many command slots as both the HBA and device support */
+	ahci_ghc_cap_t cap;
+	cap.u32 = ahci->memregs->ghc.cap;
+	sata->nslots = min(sata->queue_depth, cap.ncs + 1);
+	sata->slots_free = (sata->nslots == AHCI_NCQ_SLOTS) ? UINT32_MAX :
+	    (UINT32_C(1) << sata->nslots) - 1;
+	ddf_msg(LVL_DEBUG, "%s: Using %u NCQ command slots", sata->model,
+	    sata->nslots);
+
 	/* Set required UDMA mode */
 	if (ahci_set_highest_ultra_dma_mode(sata) != EOK)
 		goto error;
@@ -40,6 +40,27 @@
 #include <stdint.h>
 #include "ahci_hw.h"
 
+/** Number of NCQ command slots. */
+#define AHCI_NCQ_SLOTS  32
+
+/** Number of PRD entries in a command table. */
+#define AHCI_PRDT_ENTRIES  16
+
+/** Size of command table (command FIS area followed by PRD table). */
+#define AHCI_CMD_TABLE_SIZE  (0x80 + AHCI_PRDT_ENTRIES * 16)
+
+/** Size of DMA buffer pool chunk. */
+#define AHCI_CHUNK_SIZE  4096
+
+/** Number of chunks in one physically contiguous DMA buffer pool area. */
+#define AHCI_AREA_CHUNKS  16
+
+/** Number of DMA buffer pool areas. */
+#define AHCI_POOL_AREAS  8
+
+/** Total number of DMA buffer pool chunks. */
+#define AHCI_POOL_CHUNKS  (AHCI_POOL_AREAS * AHCI_AREA_CHUNKS)
+
 /** AHCI Device. */
 typedef struct {
 	/** Pointer to ddf device. */
@@ -55,6 +76,24 @@ typedef struct {
 	async_sess_t *parent_sess;
 } ahci_dev_t;
 
+/** NCQ command slot. */
+typedef struct {
+	/** Pointer to command table. */
+	volatile uint32_t *table;
+
+	/** DMA buffer pool chunks holding command data. */
+	unsigned int chunks[AHCI_PRDT_ENTRIES];
+
+	/** Number of chunks used. */
+	size_t nchunks;
+
+	/** Command has completed. */
+	bool done;
+
+	/** Interrupt state at command completion. */
+	ahci_port_is_t pxis;
+} ahci_slot_t;
+
 /** SATA Device. */
 typedef struct {
 	/** Pointer to AHCI device. */
@@ -72,16 +111,16 @@ typedef struct {
 	/** Pointer to SATA port. */
 	volatile ahci_port_t *port;
 
-	/** Pointer to command header. */
+	/** Pointer to command list (command header of slot 0). */
 	volatile ahci_cmdhdr_t *cmd_header;
 
-	/** Pointer to command table. */
+	/** Pointer to command table of slot 0. */
 	volatile uint32_t *cmd_table;
 
-	/** Mutex for single operation on device. */
+	/** Mutex for single non-queued operation on device. */
 	fibril_mutex_t lock;
 
-	/** Mutex for event signaling condition variable. */
+	/** Mutex for event signaling, command slots and DMA buffer pool. */
 	fibril_mutex_t event_lock;
 
 	/** Event signaling condition variable. */
@@ -90,6 +129,36 @@ typedef struct {
 	/** Event interrupt state. */
 	ahci_port_is_t event_pxis;
 
+	/** NCQ command slots. */
+	ahci_slot_t slots[AHCI_NCQ_SLOTS];
+
+	/** Number of usable command slots. */
+	unsigned int nslots;
+
+	/** Bitmap of free command slots. */
+	uint32_t slots_free;
+
+	/** Bitmap of commands issued to the device and not yet completed. */
+	uint32_t slots_issued;
+
+	/** Signalled when a command slot and its buffers are released. */
+	fibril_condvar_t slot_condvar;
+
+	/** DMA buffer pool areas. */
+	void *pool_virt[AHCI_POOL_AREAS];
+
+	/** Physical addresses of DMA buffer pool areas. */
+	uintptr_t pool_phys[AHCI_POOL_AREAS];
+
+	/** Stack of free DMA buffer pool chunks. */
+	unsigned int pool_free[AHCI_POOL_CHUNKS];
+
+	/** Number of free DMA buffer pool chunks. */
+	size_t pool_nfree;
+
+	/** Queue depth supported by device. */
+	unsigned int queue_depth;
+
 	/** Number of device data blocks. */
 	uint64_t blocks;
 
@@ -46,6 +46,13 @@
 
 #define NAME "ata_bd"
 
+/**
+ * Number of queued requests processed concurrently. The channel executes
+ * one command at a time, the second request keeps it busy while the
+ * completion of the first one is reported to the client.
+ */
+#define ATA_QUEUE_DEPTH 2
+
 /** Base addresses for ATA I/O blocks. */
 typedef struct {
 	uintptr_t cmd;	/**< Command block base address. */
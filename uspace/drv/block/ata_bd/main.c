@@ -191,6 +191,7 @@ errno_t ata_fun_create(disk_t *disk)
 	bd_srvs_init(&afun->bds);
 	afun->bds.ops = &ata_bd_ops;
 	afun->bds.sarg = disk;
+	afun->bds.queue_depth = ATA_QUEUE_DEPTH;
 
 	/* Set up a connection handler. */
 	ddf_fun_set_conn_handler(fun, ata_bd_connection);
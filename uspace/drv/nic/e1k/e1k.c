@@ -1161,12 +1161,17 @@ static uint32_t e1000_inc_tail(uint32_t tail, uint32_t descriptors_count)
 
 /** Receive frames
  *
- * @param nic NIC data
+ * @param nic    NIC data
+ * @param budget Maximal number of frames to receive
+ *
+ * @return Number of frames received
  *
  */
-static void e1000_receive_frames(nic_t *nic)
+static unsigned e1000_receive_frames(nic_t *nic, unsigned budget)
 {
 	e1000_t *e1000 = DRIVER_DATA_NIC(nic);
+	nic_frame_list_t *frames = nic_alloc_frame_list();
+	unsigned count = 0;
 
 	fibril_mutex_lock(&e1000->rx_lock);
 
@@ -1176,13 +1181,16 @@ static void e1000_receive_frames(nic_t *nic)
 	e1000_rx_descriptor_t *rx_descriptor = (e1000_rx_descriptor_t *)
 	    (e1000->rx_ring_virt + next_tail * sizeof(e1000_rx_descriptor_t));
 
-	while (rx_descriptor->status & 0x01) {
+	while (count < budget && (rx_descriptor->status & 0x01)) {
 		uint32_t frame_size = rx_descriptor->length - E1000_CRC_SIZE;
 
 		nic_frame_t *frame = nic_alloc_frame(nic, frame_size);
 		if (frame != NULL) {
 			memcpy(frame->data, e1000->rx_frame_virt[next_tail], frame_size);
-			nic_received_frame(nic, frame);
+			if (frames != NULL)
+				nic_frame_list_append(frames, frame);
+			else
+				nic_received_frame(nic, frame);
 		} else {
 			ddf_msg(LVL_ERROR, "Memory allocation failed. Frame dropped.");
 		}
@@ -1194,9 +1202,14 @@ static void e1000_receive_frames(nic_t *nic)
 
 		rx_descriptor = (e1000_rx_descriptor_t *)
 		    (e1000->rx_ring_virt + next_tail * sizeof(e1000_rx_descriptor_t));
+		count++;
 	}
 
+	if (frames != NULL)
+		nic_received_frame_list(nic, frames);
+
 	fibril_mutex_unlock(&e1000->rx_lock);
+	return count;
 }
 
 /** Enable E1000 interupts
@@ -1231,7 +1244,7 @@ static void e1000_disable_interrupts(e1000_t *e1000)
 static void e1000_interrupt_handler_impl(nic_t *nic, uint32_t icr)
 {
 	if (icr & ICR_RXT0)
-		e1000_receive_frames(nic);
+		e1000_receive_frames(nic, E1000_RX_FRAME_COUNT);
 }
 
 /** Handle device interrupt
@@ -1247,6 +1260,10 @@ static void e1000_interrupt_handler(ipc_call_t *icall,
 	nic_t *nic = NIC_DATA_DEV(dev);
 	e1000_t *e1000 = DRIVER_DATA_NIC(nic);
 
+	/* Interrupts stay disabled until the NIC is polled idle */
+	if ((icr & ICR_RXT0) && nic_adaptive_irq(nic))
+		return;
+
 	e1000_interrupt_handler_impl(nic, icr);
 	e1000_enable_interrupts(e1000);
 }
@@ -1298,6 +1315,42 @@ static void e1000_poll(nic_t *nic)
 	e1000_interrupt_handler_impl(nic, icr);
 }
 
+/** Receive frames in NIC_POLL_ADAPTIVE mode
+ *
+ * @param nic    NIC data
+ * @param budget Maximal number of frames to receive
+ *
+ * @return Number of frames received
+ *
+ */
+static unsigned e1000_poll_budget(nic_t *nic, unsigned budget)
+{
+	e1000_t *e1000 = nic_get_specific(nic);
+	assert(e1000);
+
+	/*
+	 * Acknowledge only the receive cause raised while the interrupts
+	 * were disabled. Reading ICR would clear all the other causes as
+	 * well, so they would never be delivered once the interrupts are
+	 * enabled again.
+	 */
+	E1000_REG_WRITE(e1000, E1000_ICR, ICR_RXT0);
+	return e1000_receive_frames(nic, budget);
+}
+
+/** Enable interrupts at the end of polling in NIC_POLL_ADAPTIVE mode
+ *
+ * @param nic NIC data
+ *
+ */
+static void e1000_poll_irq_enable(nic_t *nic)
+{
+	e1000_t *e1000 = nic_get_specific(nic);
+	assert(e1000);
+
+	e1000_enable_interrupts(e1000);
+}
+
 /** Calculates ITR register interrupt from timespec structure
  *
  * @param period Period
@@ -1341,6 +1394,12 @@ static errno_t e1000_poll_mode_change(nic_t *nic, nic_poll_mode_t mode,
 		E1000_REG_WRITE(e1000, E1000_ITR, (uint32_t) itr_interval);
 		e1000_enable_interrupts(e1000);
 		break;
+	case NIC_POLL_ADAPTIVE:
+		/* The period also limits the rate of interrupts starting polling */
+		E1000_REG_WRITE(e1000, E1000_ITR, (period != NULL) ?
+		    (uint32_t) e1000_calculate_itr_interval(period) : 0);
+		e1000_enable_interrupts(e1000);
+		break;
 	default:
 		return ENOTSUP;
 	}
@@ -1898,6 +1957,8 @@ static e1000_t *e1000_create_dev_data(ddf_dev_t *dev)
 	    e1000_on_unicast_mode_change, e1000_on_multicast_mode_change,
 	    e1000_on_broadcast_mode_change, NULL, e1000_on_vlan_mask_change);
 	nic_set_poll_handlers(nic, e1000_poll_mode_change, e1000_poll);
+	nic_set_adaptive_poll_handlers(nic, e1000_poll_budget,
+	    e1000_poll_irq_enable);
 
 	fibril_mutex_initialize(&e1000->ctrl_lock);
 	fibril_mutex_initialize(&e1000->rx_lock);
@@ -2184,7 +2245,7 @@ errno_t e1000_dev_add(ddf_dev_t *dev)
 	struct timespec period;
 	period.tv_sec = 0;
 	period.tv_nsec = USEC2NSEC(E1000_DEFAULT_INTERRUPT_INTERVAL_USEC);
-	rc = nic_report_poll_mode(nic, NIC_POLL_PERIODIC, &period);
+	rc = nic_report_poll_mode(nic, NIC_POLL_ADAPTIVE, &period);
 	if (rc != EOK)
 		goto err_rx_structure;
 
@@ -32,9 +32,12 @@
 #include <stdint.h>
 
 #include <as.h>
+#include <byteorder.h>
 #include <ddf/driver.h>
 #include <ddf/interrupt.h>
 #include <ddf/log.h>
+#include <inet/checksum.h>
+#include <macros.h>
 #include <ops/nic.h>
 #include <pci_dev_iface.h>
 #include <nic/nic.h>
@@ -69,41 +72,118 @@ static driver_t virtio_net_driver = {
 	.driver_ops = &virtio_net_driver_ops
 };
 
-static void virtio_net_irq_handler(ipc_call_t *icall, ddf_dev_t *dev)
+/** Complete a partial checksum of a received packet
+ *
+ * With VIRTIO_NET_F_GUEST_CSUM the device may hand over packets whose
+ * transport checksum field only holds the pseudo-header sum. The rest of
+ * the sum covers everything from csum_start to the end of the packet.
+ */
+static void virtio_net_csum_complete(virtio_net_hdr_t *hdr, uint8_t *data,
+    size_t size)
+{
+	size_t start = uint16_t_le2host(hdr->csum_start);
+	size_t offset = uint16_t_le2host(hdr->csum_offset);
+
+	if (start + offset + sizeof(uint16_t) > size) {
+		ddf_msg(LVL_WARN, "RX checksum location out of bounds");
+		return;
+	}
+
+	uint16_t cs = inet_checksum_calc(INET_CHECKSUM_INIT, data + start,
+	    size - start);
+	data[start + offset] = cs >> 8;
+	data[start + offset + 1] = cs & 0xff;
+}
+
+/** Pass received frames to the NIC framework and recycle the RX buffers
+ *
+ * All frames found in the used ring are delivered in a single list and the
+ * buffers are returned to the device with a single notification.
+ */
+static void virtio_net_rx_reap(nic_t *nic)
 {
-	nic_t *nic = ddf_dev_data_get(dev);
 	virtio_net_t *virtio_net = nic_get_specific(nic);
 	virtio_dev_t *vdev = &virtio_net->virtio_dev;
+	nic_frame_list_t *frames = nic_alloc_frame_list();
+	unsigned count = 0;
 
 	uint16_t descno;
 	uint32_t len;
-	while (virtio_virtq_consume_used(vdev, RX_QUEUE_1, &descno, &len)) {
+	while (count < virtio_net->rx_count &&
+	    virtio_virtq_consume_used(vdev, RX_QUEUE_1, &descno, &len)) {
 		virtio_net_hdr_t *hdr =
 		    (virtio_net_hdr_t *) virtio_net->rx_buf[descno];
+		size_t size = len - sizeof(*hdr);
+
+		count++;
+
 		if (len <= sizeof(*hdr)) {
 			ddf_msg(LVL_WARN,
 			    "RX data length too short, packet dropped");
-			virtio_virtq_produce_available(vdev, RX_QUEUE_1,
-			    descno);
+			virtio_virtq_put_available(vdev, RX_QUEUE_1, descno);
 			continue;
 		}
 
-		nic_frame_t *frame = nic_alloc_frame(nic, len - sizeof(*hdr));
+		nic_frame_t *frame = nic_alloc_frame(nic, size);
 		if (frame) {
-			memcpy(frame->data, &hdr[1], len - sizeof(*hdr));
-			nic_received_frame(nic, frame);
+			memcpy(frame->data, &hdr[1], size);
+			if (hdr->flags & VIRTIO_NET_HDR_F_NEEDS_CSUM)
+				virtio_net_csum_complete(hdr, frame->data, size);
+
+			if (frames)
+				nic_frame_list_append(frames, frame);
+			else
+				nic_received_frame(nic, frame);
 		} else {
 			ddf_msg(LVL_WARN,
 			    "Cannot allocate RX frame, packet dropped");
 		}
 
-		virtio_virtq_produce_available(vdev, RX_QUEUE_1, descno);
+		virtio_virtq_put_available(vdev, RX_QUEUE_1, descno);
 	}
 
+	if (count > 0)
+		virtio_virtq_notify(vdev, RX_QUEUE_1);
+
+	if (frames)
+		nic_received_frame_list(nic, frames);
+}
+
+/** Return descriptors of transmitted frames to the free list */
+static void virtio_net_tx_reap(virtio_net_t *virtio_net)
+{
+	virtio_dev_t *vdev = &virtio_net->virtio_dev;
+
+	uint16_t descno;
+	uint32_t len;
 	while (virtio_virtq_consume_used(vdev, TX_QUEUE_1, &descno, &len)) {
 		virtio_free_desc(vdev, TX_QUEUE_1, &virtio_net->tx_free_head,
 		    descno);
 	}
+}
+
+static void virtio_net_irq_handler(ipc_call_t *icall, ddf_dev_t *dev)
+{
+	nic_t *nic = ddf_dev_data_get(dev);
+	virtio_net_t *virtio_net = nic_get_specific(nic);
+	virtio_dev_t *vdev = &virtio_net->virtio_dev;
+
+	/* Interrupt on the next received frame, but not before reaping all */
+	do {
+		virtio_net_rx_reap(nic);
+	} while (virtio_virtq_arm_intr(vdev, RX_QUEUE_1, 1));
+
+	/*
+	 * TX completions are also reaped when sending runs out of
+	 * descriptors, so only ask for an interrupt once half of the ring
+	 * has been transmitted.
+	 */
+	virtio_net_tx_reap(virtio_net);
+	(void) virtio_virtq_arm_intr(vdev, TX_QUEUE_1,
+	    max(virtio_net->tx_count / 2, 1));
+
+	uint16_t descno;
+	uint32_t len;
 	while (virtio_virtq_consume_used(vdev, CT_QUEUE_1, &descno, &len)) {
 		virtio_free_desc(vdev, CT_QUEUE_1, &virtio_net->ct_free_head,
 		    descno);
@@ -166,6 +246,25 @@ static errno_t virtio_net_register_interrupt(ddf_dev_t *dev)
 	    virtio_net_irq_handler, &irq_code, &virtio_net->irq_handle);
 }
 
+/** Determine ring size for a virtqueue
+ *
+ * @param vdev	VIRTIO device
+ * @param num	Virtqueue index
+ * @param want	Preferred number of buffers (power of two)
+ * @return	@a want reduced to what the device supports, 0 if the queue
+ *		is not available
+ */
+static uint16_t virtio_net_queue_size(virtio_dev_t *vdev, uint16_t num,
+    uint16_t want)
+{
+	uint16_t max = virtio_virtq_max_size(vdev, num);
+
+	while (want > max)
+		want /= 2;
+
+	return want;
+}
+
 static errno_t virtio_net_initialize(ddf_dev_t *dev)
 {
 	nic_t *nic = nic_create_and_bind(dev);
@@ -197,7 +296,8 @@ static errno_t virtio_net_initialize(ddf_dev_t *dev)
 
 	/* Reset the device and negotiate the feature bits */
 	rc = virtio_device_setup_start(vdev,
-	    VIRTIO_NET_F_MAC | VIRTIO_NET_F_CTRL_VQ);
+	    VIRTIO_NET_F_MAC | VIRTIO_NET_F_CTRL_VQ,
+	    VIRTIO_F_EVENT_IDX | VIRTIO_NET_F_GUEST_CSUM);
 	if (rc != EOK)
 		goto fail;
 
@@ -219,10 +319,19 @@ static errno_t virtio_net_initialize(ddf_dev_t *dev)
 		goto fail;
 	}
 
-	rc = virtio_virtq_setup(vdev, RX_QUEUE_1, RX_BUFFERS);
+	virtio_net->rx_count = virtio_net_queue_size(vdev, RX_QUEUE_1,
+	    RX_BUFFERS);
+	virtio_net->tx_count = virtio_net_queue_size(vdev, TX_QUEUE_1,
+	    TX_BUFFERS);
+	if (virtio_net->rx_count == 0 || virtio_net->tx_count == 0) {
+		rc = ENOTSUP;
+		goto fail;
+	}
+
+	rc = virtio_virtq_setup(vdev, RX_QUEUE_1, virtio_net->rx_count);
 	if (rc != EOK)
 		goto fail;
-	rc = virtio_virtq_setup(vdev, TX_QUEUE_1, TX_BUFFERS);
+	rc = virtio_virtq_setup(vdev, TX_QUEUE_1, virtio_net->tx_count);
 	if (rc != EOK)
 		goto fail;
 	rc = virtio_virtq_setup(vdev, CT_QUEUE_1, CT_BUFFERS);
@@ -232,11 +341,11 @@ static errno_t virtio_net_initialize(ddf_dev_t *dev)
 	/*
 	 * Setup DMA buffers
 	 */
-	rc = virtio_setup_dma_bufs(RX_BUFFERS, RX_BUF_SIZE, false,
+	rc = virtio_setup_dma_bufs(virtio_net->rx_count, RX_BUF_SIZE, false,
 	    virtio_net->rx_buf, virtio_net->rx_buf_p);
 	if (rc != EOK)
 		goto fail;
-	rc = virtio_setup_dma_bufs(TX_BUFFERS, TX_BUF_SIZE, true,
+	rc = virtio_setup_dma_bufs(virtio_net->tx_count, TX_BUF_SIZE, true,
 	    virtio_net->tx_buf, virtio_net->tx_buf_p);
 	if (rc != EOK)
 		goto fail;
@@ -248,7 +357,7 @@ static errno_t virtio_net_initialize(ddf_dev_t *dev)
 	/*
 	 * Give all RX buffers to the NIC
 	 */
-	for (unsigned i = 0; i < RX_BUFFERS; i++) {
+	for (unsigned i = 0; i < virtio_net->rx_count; i++) {
 		/*
 		 * Associtate the buffer with the descriptor, set length and
 		 * flags.
@@ -260,13 +369,14 @@ static errno_t virtio_net_initialize(ddf_dev_t *dev)
 		 * Put the set descriptor into the available ring of the RX
 		 * queue.
 		 */
-		virtio_virtq_produce_available(vdev, RX_QUEUE_1, i);
+		virtio_virtq_put_available(vdev, RX_QUEUE_1, i);
 	}
+	virtio_virtq_notify(vdev, RX_QUEUE_1);
 
 	/*
 	 * Put all TX and CT buffers on a free list
 	 */
-	virtio_create_desc_free_list(vdev, TX_QUEUE_1, TX_BUFFERS,
+	virtio_create_desc_free_list(vdev, TX_QUEUE_1, virtio_net->tx_count,
 	    &virtio_net->tx_free_head);
 	virtio_create_desc_free_list(vdev, CT_QUEUE_1, CT_BUFFERS,
 	    &virtio_net->ct_free_head);
@@ -328,18 +438,24 @@ static void virtio_net_send(nic_t *nic, void *data, size_t size)
 	virtio_net_t *virtio_net = nic_get_specific(nic);
 	virtio_dev_t *vdev = &virtio_net->virtio_dev;
 
-	if (size > sizeof(virtio_net) + TX_BUF_SIZE) {
+	if (sizeof(virtio_net_hdr_t) + size > TX_BUF_SIZE) {
 		ddf_msg(LVL_WARN, "TX data too big, frame dropped");
 		return;
 	}
 
 	uint16_t descno = virtio_alloc_desc(vdev, TX_QUEUE_1,
 	    &virtio_net->tx_free_head);
+	if (descno == (uint16_t) -1U) {
+		/* TX interrupts are suppressed, reap completions now */
+		virtio_net_tx_reap(virtio_net);
+		descno = virtio_alloc_desc(vdev, TX_QUEUE_1,
+		    &virtio_net->tx_free_head);
+	}
 	if (descno == (uint16_t) -1U) {
 		ddf_msg(LVL_WARN, "No TX buffers available, frame dropped");
 		return;
 	}
-	assert(descno < TX_BUFFERS);
+	assert(descno < virtio_net->tx_count);
 
 	/* Setup the packed header */
 	virtio_net_hdr_t *hdr = (virtio_net_hdr_t *) virtio_net->tx_buf[descno];
@@ -33,8 +33,9 @@
 #include <abi/cap.h>
 #include <nic/nic.h>
 
-#define RX_BUFFERS	8
-#define TX_BUFFERS	8
+/** Maximum number of buffers, the rings are smaller if the device says so */
+#define RX_BUFFERS	256
+#define TX_BUFFERS	256
 #define CT_BUFFERS	4
 
 /** Device handles packets with partial checksum. */
@@ -46,6 +47,11 @@
 /** Control channel is available */
 #define VIRTIO_NET_F_CTRL_VQ		(1U << 17)
 
+/** Checksum from csum_start to the end of the packet needs to be computed */
+#define VIRTIO_NET_HDR_F_NEEDS_CSUM	1
+/** Checksum of the packet has been validated by the device */
+#define VIRTIO_NET_HDR_F_DATA_VALID	2
+
 #define VIRTIO_NET_HDR_GSO_NONE 0
 typedef struct {
 	uint8_t flags;
@@ -74,6 +80,10 @@ typedef struct {
 	void *ct_buf[CT_BUFFERS];
 	uintptr_t ct_buf_p[CT_BUFFERS];
 
+	/** Number of RX and TX buffers negotiated with the device */
+	uint16_t rx_count;
+	uint16_t tx_count;
+
 	uint16_t tx_free_head;
 	uint16_t ct_free_head;
 
@@ -43,6 +43,7 @@
 #include <as.h>
 #include <assert.h>
 #include <bd.h>
+#include <fibril.h>
 #include <fibril_synch.h>
 #include <adt/list.h>
 #include <adt/hash_table.h>
@@ -58,6 +59,30 @@
 
 #define MAX_WRITE_RETRIES 10
 
+/** Initial read-ahead window in blocks. */
+#define RA_MIN_BLOCKS	4
+/** Maximum read-ahead window in blocks. */
+#define RA_MAX_BLOCKS	32
+/** Maximum read-ahead window in bytes. */
+#define RA_MAX_BYTES	(128 * 1024)
+
+/** Period of the write-behind flusher. */
+#define FLUSH_INTERVAL	1000000
+/** Maximum number of dirty blocks written back in one pass. */
+#define FLUSH_BATCH	64
+/** Maximum size of a single coalesced write in bytes. */
+#define FLUSH_MAX_BYTES	(128 * 1024)
+/**
+ * Wake the flusher early once the number of dirty blocks released since the
+ * last pass reaches 1 / FLUSH_DIRTY_RATIO of the cached blocks.
+ */
+#define FLUSH_DIRTY_RATIO	2
+
+/** Maximum number of requests in flight to the block device. */
+#define QUEUE_DEPTH	16
+/** Maximum size of a single queued request in bytes. */
+#define QUEUE_SLOT_SIZE	(64 * 1024)
+
 /** Lock protecting the device connection list */
 static FIBRIL_MUTEX_INITIALIZE(dcl_lock);
 /** Device connection list head. */
@@ -72,6 +97,22 @@ typedef struct {
 	hash_table_t block_hash;
 	list_t free_list;
 	enum cache_mode mode;
+
+	aoff64_t ra_last;         /**< Last block of the sequential stream. */
+	aoff64_t ra_end;          /**< End of the blocks read ahead so far. */
+	unsigned ra_window;       /**< Read-ahead window in blocks. */
+	unsigned ra_max;          /**< Maximum read-ahead window in blocks. */
+	bool ra_busy;             /**< Read-ahead fibril is running. */
+	/** Signalled when blocks being read ahead become valid. */
+	fibril_condvar_t ra_cv;
+
+	fibril_condvar_t flush_cv;  /**< Wakes up the flusher. */
+	unsigned dirty_puts;      /**< Dirty blocks released since last pass. */
+	bool flusher_running;     /**< Flusher fibril is running. */
+	bool flusher_stop;        /**< Flusher fibril should terminate. */
+
+	/** Signalled when a background fibril terminates. */
+	fibril_condvar_t done_cv;
 } cache_t;
 
 typedef struct {
@@ -89,6 +130,8 @@ typedef struct {
 static errno_t read_blocks(devcon_t *, aoff64_t, size_t, void *, size_t);
 static errno_t write_blocks(devcon_t *, aoff64_t, size_t, void *, size_t);
 static aoff64_t ba_ltop(devcon_t *, aoff64_t);
+static errno_t cache_flusher(void *);
+static void cache_flush(devcon_t *);
 
 static devcon_t *devcon_search(service_id_t service_id)
 {
@@ -176,6 +219,9 @@ errno_t block_init(service_id_t service_id, size_t comm_size)
 		return rc;
 	}
 
+	/* Without the request queue, data is copied in synchronous requests */
+	(void) bd_queue_init(bd, QUEUE_DEPTH, QUEUE_SLOT_SIZE);
+
 	rc = devcon_add(service_id, sess, bsize, dev_size, bd);
 	if (rc != EOK) {
 		bd_close(bd);
@@ -295,12 +341,39 @@ errno_t block_cache_init(service_id_t service_id, size_t size, unsigned blocks,
 
 	cache->blocks_cluster = cache->lblock_size / devcon->pblock_size;
 
+	cache->ra_last = 0;
+	cache->ra_end = 0;
+	cache->ra_window = 0;
+	cache->ra_max = min(RA_MAX_BLOCKS, max(RA_MIN_BLOCKS,
+	    RA_MAX_BYTES / cache->lblock_size));
+	cache->ra_busy = false;
+
+	fibril_condvar_initialize(&cache->flush_cv);
+	cache->dirty_puts = 0;
+	cache->flusher_running = false;
+	cache->flusher_stop = false;
+	fibril_condvar_initialize(&cache->done_cv);
+	fibril_condvar_initialize(&cache->ra_cv);
+
 	if (!hash_table_create(&cache->block_hash, 0, 0, &cache_ops)) {
 		free(cache);
 		return ENOMEM;
 	}
 
 	devcon->cache = cache;
+
+	if (mode == CACHE_MODE_WB) {
+		/*
+		 * Without the flusher, dirty blocks are still written back on
+		 * eviction and in block_cache_fini().
+		 */
+		fid_t fid = fibril_create(cache_flusher, devcon);
+		if (fid != 0) {
+			cache->flusher_running = true;
+			fibril_add_ready(fid);
+		}
+	}
+
 	return EOK;
 }
 
@@ -316,6 +389,17 @@ errno_t block_cache_fini(service_id_t service_id)
 		return EOK;
 	cache = devcon->cache;
 
+	/* Stop the background fibrils. */
+	fibril_mutex_lock(&cache->lock);
+	cache->flusher_stop = true;
+	fibril_condvar_broadcast(&cache->flush_cv);
+	while (cache->flusher_running || cache->ra_busy)
+		fibril_condvar_wait(&cache->done_cv, &cache->lock);
+	fibril_mutex_unlock(&cache->lock);
+
+	/* Write back as much as possible in large requests. */
+	cache_flush(devcon);
+
 	/*
 	 * We are expecting to find all blocks for this device handle on the
 	 * free list, i.e. the block reference count should be zero. Do not
@@ -357,17 +441,206 @@ static bool cache_can_grow(cache_t *cache)
 	return true;
 }
 
+/** Number of cached blocks above which released blocks are freed. */
+static unsigned cache_hi_watermark(cache_t *cache)
+{
+	/* Leave room for the blocks read ahead. */
+	return CACHE_HI_WATERMARK + cache->ra_window;
+}
+
 static void block_initialize(block_t *b)
 {
 	fibril_mutex_initialize(&b->lock);
 	b->refcnt = 1;
+	b->refgen = 0;
 	b->write_failures = 0;
 	b->dirty = false;
 	b->toxic = false;
+	b->reading = false;
 	fibril_rwlock_initialize(&b->contents_lock);
 	link_initialize(&b->free_link);
 }
 
+/** Read-ahead request. */
+typedef struct {
+	devcon_t *devcon;
+	aoff64_t lba;   /**< First block to read. */
+	size_t count;   /**< Number of blocks to read. */
+} readahead_t;
+
+/** Read-ahead fibril.
+ *
+ * Instantiates the requested blocks which are not cached yet and reads them
+ * with a single request. The blocks are marked as being read, so that
+ * block_get() of any of them waits for the data to arrive. No locks are held
+ * during the read.
+ *
+ * @param arg	Read-ahead request.
+ *
+ * @return	Always EOK.
+ */
+static errno_t cache_readahead_fibril(void *arg)
+{
+	readahead_t *ra = (readahead_t *) arg;
+	devcon_t *devcon = ra->devcon;
+	cache_t *cache = devcon->cache;
+	block_t *blocks[RA_MAX_BLOCKS];
+	size_t n = 0;
+
+	assert(ra->count <= RA_MAX_BLOCKS);
+
+	fibril_mutex_lock(&cache->lock);
+	for (size_t i = 0; i < ra->count; i++) {
+		aoff64_t lba = ra->lba + i;
+
+		/* Only read the run of blocks which are not cached. */
+		if (hash_table_find(&cache->block_hash, &lba))
+			break;
+
+		block_t *b = malloc(sizeof(block_t));
+		if (!b)
+			break;
+		b->data = malloc(cache->lblock_size);
+		if (!b->data) {
+			free(b);
+			break;
+		}
+		cache->blocks_cached++;
+
+		block_initialize(b);
+		b->service_id = devcon->service_id;
+		b->size = cache->lblock_size;
+		b->lba = lba;
+		b->pba = ba_ltop(devcon, lba);
+		b->reading = true;
+		hash_table_insert(&cache->block_hash, &b->hash_link);
+
+		blocks[n++] = b;
+	}
+	fibril_mutex_unlock(&cache->lock);
+
+	if (n > 0) {
+		size_t size = n * cache->lblock_size;
+		void *buf = malloc(size);
+		errno_t rc = ENOMEM;
+		if (buf) {
+			rc = read_blocks(devcon, blocks[0]->pba,
+			    n * cache->blocks_cluster, buf, size);
+		}
+
+		for (size_t i = 0; i < n; i++) {
+			block_t *b = blocks[i];
+			bool toxic = false;
+
+			/*
+			 * If the whole run cannot be read, fall back to reading
+			 * the blocks one by one so that a bad block does not
+			 * poison its neighbours. Nobody else touches the data
+			 * of a block which is being read.
+			 */
+			if (rc == EOK) {
+				memcpy(b->data, buf + i * cache->lblock_size,
+				    cache->lblock_size);
+			} else if (read_blocks(devcon, b->pba,
+			    cache->blocks_cluster, b->data,
+			    cache->lblock_size) != EOK) {
+				toxic = true;
+			}
+
+			fibril_mutex_lock(&b->lock);
+			b->toxic = toxic;
+			b->reading = false;
+			fibril_mutex_unlock(&b->lock);
+		}
+
+		fibril_condvar_broadcast(&cache->ra_cv);
+		free(buf);
+
+		/* Only drop the references once all blocks are valid. */
+		for (size_t i = 0; i < n; i++)
+			(void) block_put(blocks[i]);
+	}
+
+	fibril_mutex_lock(&cache->lock);
+	cache->ra_busy = false;
+	fibril_condvar_broadcast(&cache->done_cv);
+	fibril_mutex_unlock(&cache->lock);
+
+	free(ra);
+	return EOK;
+}
+
+/** Track sequential access and start read-ahead.
+ *
+ * A block following the last block of the current stream extends the stream
+ * and doubles the read-ahead window. A cache miss elsewhere starts a new
+ * stream, while cache hits elsewhere (typically metadata) are ignored.
+ * Read-ahead is started in the background whenever less than half a window
+ * is left ahead of the stream.
+ *
+ * @param devcon	Device connection.
+ * @param ba		Logical address of the block just obtained.
+ * @param hit		The block was found in the cache.
+ */
+static void cache_readahead(devcon_t *devcon, aoff64_t ba, bool hit)
+{
+	cache_t *cache = devcon->cache;
+
+	fibril_mutex_lock(&cache->lock);
+
+	if (ba == cache->ra_last + 1) {
+		cache->ra_window = (cache->ra_window == 0) ? RA_MIN_BLOCKS :
+		    min(2 * cache->ra_window, cache->ra_max);
+		cache->ra_last = ba;
+	} else if ((ba != cache->ra_last) && !hit) {
+		cache->ra_last = ba;
+		cache->ra_end = ba + 1;
+		cache->ra_window = 0;
+	}
+
+	if ((cache->ra_window == 0) || cache->ra_busy ||
+	    (cache->ra_end > ba + cache->ra_window / 2)) {
+		fibril_mutex_unlock(&cache->lock);
+		return;
+	}
+
+	aoff64_t start = max(cache->ra_end, ba + 1);
+	aoff64_t end = ba + 1 + cache->ra_window;
+
+	/* Stay within the blocks block_get() would accept. */
+	aoff64_t limit = (devcon->pblocks - 1) / cache->blocks_cluster;
+	if (end > limit)
+		end = limit;
+
+	if (start >= end) {
+		fibril_mutex_unlock(&cache->lock);
+		return;
+	}
+
+	readahead_t *ra = malloc(sizeof(readahead_t));
+	if (!ra) {
+		fibril_mutex_unlock(&cache->lock);
+		return;
+	}
+
+	ra->devcon = devcon;
+	ra->lba = start;
+	ra->count = end - start;
+
+	fid_t fid = fibril_create(cache_readahead_fibril, ra);
+	if (fid == 0) {
+		fibril_mutex_unlock(&cache->lock);
+		free(ra);
+		return;
+	}
+
+	cache->ra_end = end;
+	cache->ra_busy = true;
+	fibril_mutex_unlock(&cache->lock);
+
+	fibril_add_ready(fid);
+}
+
 /** Instantiate a block in memory and get a reference to it.
  *
  * @param block			Pointer to where the function will store the
@@ -387,6 +660,7 @@ errno_t block_get(block_t **block, service_id_t service_id, aoff64_t ba, int fla
 	block_t *b;
 	link_t *link;
 	aoff64_t p_ba;
+	bool hit;
 	errno_t rc;
 
 	devcon = devcon_search(service_id);
@@ -410,6 +684,7 @@ errno_t block_get(block_t **block, service_id_t service_id, aoff64_t ba, int fla
 retry:
 	rc = EOK;
 	b = NULL;
+	hit = false;
 
 	fibril_mutex_lock(&cache->lock);
 	ht_link_t *hlink = hash_table_find(&cache->block_hash, &ba);
@@ -418,14 +693,20 @@ retry:
 		/*
 		 * We found the block in the cache.
 		 */
+		hit = true;
 		b = hash_table_get_inst(hlink, block_t, hash_link);
 		fibril_mutex_lock(&b->lock);
 		if (b->refcnt++ == 0)
 			list_remove(&b->free_link);
+		b->refgen++;
+		fibril_mutex_unlock(&cache->lock);
+
+		/* Wait for read-ahead of the block without the cache lock. */
+		while (b->reading)
+			fibril_condvar_wait(&cache->ra_cv, &b->lock);
 		if (b->toxic)
 			rc = EIO;
 		fibril_mutex_unlock(&b->lock);
-		fibril_mutex_unlock(&cache->lock);
 	} else {
 		/*
 		 * The block was not found in the cache.
@@ -565,6 +846,10 @@ out:
 		(void) block_put(b);
 		b = NULL;
 	}
+
+	if ((rc == EOK) && !(flags & BLOCK_FLAGS_NOREAD))
+		cache_readahead(devcon, ba, hit);
+
 	*block = b;
 	return rc;
 }
@@ -582,6 +867,7 @@ errno_t block_put(block_t *block)
 	devcon_t *devcon = devcon_search(block->service_id);
 	cache_t *cache;
 	unsigned blocks_cached;
+	unsigned hi_watermark;
 	enum cache_mode mode;
 	errno_t rc = EOK;
 
@@ -594,6 +880,7 @@ errno_t block_put(block_t *block)
 retry:
 	fibril_mutex_lock(&cache->lock);
 	blocks_cached = cache->blocks_cached;
+	hi_watermark = cache_hi_watermark(cache);
 	mode = cache->mode;
 	fibril_mutex_unlock(&cache->lock);
 
@@ -608,7 +895,7 @@ retry:
 	if (block->toxic)
 		block->dirty = false;	/* will not write back toxic block */
 	if (block->dirty && (block->refcnt == 1) &&
-	    (blocks_cached > CACHE_HI_WATERMARK || mode != CACHE_MODE_WB)) {
+	    (blocks_cached > hi_watermark || mode != CACHE_MODE_WB)) {
 		rc = write_blocks(devcon, block->pba, cache->blocks_cluster,
 		    block->data, block->size);
 		if (rc == EOK)
@@ -625,7 +912,7 @@ retry:
 		 * block or put it on the free list. In case of an I/O error,
 		 * free the block.
 		 */
-		if ((cache->blocks_cached > CACHE_HI_WATERMARK) ||
+		if ((cache->blocks_cached > cache_hi_watermark(cache)) ||
 		    (rc != EOK)) {
 			/*
 			 * Currently there are too many cached blocks or there
@@ -676,6 +963,12 @@ retry:
 			goto retry;
 		}
 		list_append(&block->free_link, &cache->free_list);
+
+		/* Wake up the flusher if too much dirty data piles up. */
+		if (block->dirty && cache->flusher_running &&
+		    ++cache->dirty_puts * FLUSH_DIRTY_RATIO >=
+		    cache->blocks_cached)
+			fibril_condvar_signal(&cache->flush_cv);
 	}
 	fibril_mutex_unlock(&block->lock);
 	fibril_mutex_unlock(&cache->lock);
@@ -683,6 +976,180 @@ retry:
 	return rc;
 }
 
+static int block_pba_cmp(const void *a, const void *b)
+{
+	const block_t *ba = *(const block_t **) a;
+	const block_t *bb = *(const block_t **) b;
+
+	if (ba->pba < bb->pba)
+		return -1;
+	if (ba->pba > bb->pba)
+		return 1;
+	return 0;
+}
+
+/** Write back a run of physically adjacent dirty blocks.
+ *
+ * Users modify the data of a referenced block without holding its lock,
+ * so a block is marked clean only if the flusher held the only reference
+ * when taking the snapshot and no other reference has been taken since.
+ * Otherwise the block stays dirty and is written back again later.
+ *
+ * @param devcon	Device connection.
+ * @param blocks	Referenced blocks, sorted by physical address.
+ * @param n		Number of blocks (at most FLUSH_BATCH).
+ *
+ * @return		Number of blocks written back.
+ */
+static size_t cache_write_extent(devcon_t *devcon, block_t **blocks, size_t n)
+{
+	cache_t *cache = devcon->cache;
+	size_t bsize = cache->lblock_size;
+	unsigned refgen[FLUSH_BATCH];
+	bool solo[FLUSH_BATCH];
+	void *buf = NULL;
+	errno_t rc;
+
+	assert(n <= FLUSH_BATCH);
+
+	if (n > 1) {
+		buf = malloc(n * bsize);
+		if (!buf) {
+			/* Write the blocks one by one. */
+			size_t written = 0;
+			for (size_t i = 0; i < n; i++)
+				written += cache_write_extent(devcon, &blocks[i], 1);
+			return written;
+		}
+
+		for (size_t i = 0; i < n; i++) {
+			fibril_mutex_lock(&blocks[i]->lock);
+			solo[i] = (blocks[i]->refcnt == 1);
+			refgen[i] = blocks[i]->refgen;
+			memcpy(buf + i * bsize, blocks[i]->data, bsize);
+			fibril_mutex_unlock(&blocks[i]->lock);
+		}
+
+		rc = write_blocks(devcon, blocks[0]->pba,
+		    n * cache->blocks_cluster, buf, n * bsize);
+		free(buf);
+	} else {
+		fibril_mutex_lock(&blocks[0]->lock);
+		solo[0] = (blocks[0]->refcnt == 1);
+		refgen[0] = blocks[0]->refgen;
+		rc = write_blocks(devcon, blocks[0]->pba, cache->blocks_cluster,
+		    blocks[0]->data, bsize);
+		fibril_mutex_unlock(&blocks[0]->lock);
+	}
+
+	for (size_t i = 0; i < n; i++) {
+		block_t *b = blocks[i];
+
+		fibril_mutex_lock(&b->lock);
+		if (rc != EOK) {
+			b->write_failures++;
+		} else {
+			b->write_failures = 0;
+			if (solo[i] && (b->refcnt == 1) &&
+			    (b->refgen == refgen[i]))
+				b->dirty = false;
+		}
+		fibril_mutex_unlock(&b->lock);
+	}
+
+	return (rc == EOK) ? n : 0;
+}
+
+/** Write back dirty unreferenced blocks.
+ *
+ * Dirty blocks on the free list are sorted by their physical address and
+ * runs of adjacent blocks are written back with a single request each.
+ *
+ * @param devcon	Device connection.
+ */
+static void cache_flush(devcon_t *devcon)
+{
+	cache_t *cache = devcon->cache;
+	block_t *batch[FLUSH_BATCH];
+	size_t extent_max = max(1, FLUSH_MAX_BYTES / cache->lblock_size);
+	size_t written;
+	size_t n;
+
+	do {
+		n = 0;
+
+		fibril_mutex_lock(&cache->lock);
+		list_foreach(cache->free_list, free_link, block_t, b) {
+			if (n == FLUSH_BATCH)
+				break;
+			if (b->dirty && !b->toxic &&
+			    (b->write_failures < MAX_WRITE_RETRIES))
+				batch[n++] = b;
+		}
+
+		/* Hold a reference so that the blocks are not recycled. */
+		for (size_t i = 0; i < n; i++) {
+			fibril_mutex_lock(&batch[i]->lock);
+			if (batch[i]->refcnt++ == 0)
+				list_remove(&batch[i]->free_link);
+			fibril_mutex_unlock(&batch[i]->lock);
+		}
+		fibril_mutex_unlock(&cache->lock);
+
+		qsort(batch, n, sizeof(block_t *), block_pba_cmp);
+
+		written = 0;
+		size_t i = 0;
+		while (i < n) {
+			size_t j = i + 1;
+			while ((j < n) && (j - i < extent_max) &&
+			    (batch[j]->pba == batch[j - 1]->pba +
+			    cache->blocks_cluster))
+				j++;
+
+			written += cache_write_extent(devcon, &batch[i], j - i);
+			i = j;
+		}
+
+		for (i = 0; i < n; i++)
+			(void) block_put(batch[i]);
+	} while ((n == FLUSH_BATCH) && (written > 0));
+}
+
+/** Write-behind fibril.
+ *
+ * Periodically writes back dirty blocks of a write-back cache, or sooner
+ * when block_put() reports that too many dirty blocks have accumulated.
+ *
+ * @param arg	Device connection.
+ *
+ * @return	Always EOK.
+ */
+static errno_t cache_flusher(void *arg)
+{
+	devcon_t *devcon = (devcon_t *) arg;
+	cache_t *cache = devcon->cache;
+
+	fibril_mutex_lock(&cache->lock);
+	while (!cache->flusher_stop) {
+		(void) fibril_condvar_wait_timeout(&cache->flush_cv,
+		    &cache->lock, FLUSH_INTERVAL);
+		if (cache->flusher_stop)
+			break;
+
+		cache->dirty_puts = 0;
+		fibril_mutex_unlock(&cache->lock);
+		cache_flush(devcon);
+		fibril_mutex_lock(&cache->lock);
+	}
+
+	cache->flusher_running = false;
+	fibril_condvar_broadcast(&cache->done_cv);
+	fibril_mutex_unlock(&cache->lock);
+
+	return EOK;
+}
+
 /** Read sequential data from a block device.
  *
  * @param service_id	Service ID of the block device.
@@ -66,10 +66,14 @@ typedef struct block {
 	fibril_mutex_t lock;
 	/** Number of references to the block_t structure. */
 	unsigned refcnt;
+	/** Incremented whenever a reference to the cached block is taken. */
+	unsigned refgen;
 	/** If true, the block needs to be written back to the block device. */
 	bool dirty;
 	/** If true, the blcok does not contain valid data. */
 	bool toxic;
+	/** If true, the contents are being read ahead and not valid yet. */
+	bool reading;
 	/** Readers / Writer lock protecting the contents of the block. */
 	fibril_rwlock_t contents_lock;
 	/** Service ID of service providing the block device. */
@@ -121,6 +121,9 @@
 #include "../private/libc.h"
 #include "../private/fibril.h"
 
+/** Minimal size of a data transfer done using IPC_XF_BULK */
+#define DATA_XFER_BULK_THRESHOLD  (4 * PAGE_SIZE)
+
 static fibril_rmutex_t message_mutex;
 
 /** Naming service session */
@@ -962,6 +965,22 @@ errno_t async_share_out_start(async_exch_t *exch, void *src, unsigned int flags)
 	    (sysarg_t) flags);
 }
 
+/** Get data transfer flags for IPC_M_DATA_READ and IPC_M_DATA_WRITE.
+ *
+ * Large transfers are done directly between the client's and the server's
+ * buffer, sparing the kernel from bouncing the data through an intermediate
+ * buffer and lifting the DATA_XFER_LIMIT restriction.
+ *
+ * @param size Size of the transfer (in bytes).
+ *
+ * @return Data transfer flags.
+ *
+ */
+static sysarg_t async_data_xfer_flags(size_t size)
+{
+	return (size >= DATA_XFER_BULK_THRESHOLD) ? IPC_XF_BULK : IPC_XF_NONE;
+}
+
 /** Start IPC_M_DATA_READ using the async framework.
  *
  * @param exch    Exchange for sending the message.
@@ -975,8 +994,8 @@ errno_t async_share_out_start(async_exch_t *exch, void *src, unsigned int flags)
 aid_t async_data_read(async_exch_t *exch, void *dst, size_t size,
     ipc_call_t *dataptr)
 {
-	return async_send_2(exch, IPC_M_DATA_READ, (sysarg_t) dst,
-	    (sysarg_t) size, dataptr);
+	return async_send_3(exch, IPC_M_DATA_READ, (sysarg_t) dst,
+	    (sysarg_t) size, async_data_xfer_flags(size), dataptr);
 }
 
 /** Wrapper for IPC_M_DATA_READ calls using the async framework.
@@ -993,8 +1012,8 @@ errno_t async_data_read_start(async_exch_t *exch, void *dst, size_t size)
 	if (exch == NULL)
 		return ENOENT;
 
-	return async_req_2_0(exch, IPC_M_DATA_READ, (sysarg_t) dst,
-	    (sysarg_t) size);
+	return async_req_3_0(exch, IPC_M_DATA_READ, (sysarg_t) dst,
+	    (sysarg_t) size, async_data_xfer_flags(size));
 }
 
 /** Wrapper for IPC_M_DATA_WRITE calls using the async framework.
@@ -1011,8 +1030,8 @@ errno_t async_data_write_start(async_exch_t *exch, const void *src, size_t size)
 	if (exch == NULL)
 		return ENOENT;
 
-	return async_req_2_0(exch, IPC_M_DATA_WRITE, (sysarg_t) src,
-	    (sysarg_t) size);
+	return async_req_3_0(exch, IPC_M_DATA_WRITE, (sysarg_t) src,
+	    (sysarg_t) size, async_data_xfer_flags(size));
 }
 
 errno_t async_state_change_start(async_exch_t *exch, sysarg_t arg1, sysarg_t arg2,
@@ -0,0 +1,520 @@
+/*
+ * Copyright (c) 2026 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup libc
+ * @{
+ */
+/** @file Shared-memory ring channel
+ *
+ * A ring channel carries small request/response messages between an async
+ * client and server through a memory area shared with IPC_M_SHARE_OUT,
+ * sparing a kernel IPC round trip per message.
+ *
+ * The area holds a single ring of message slots and two free-running
+ * sequence counters. The client writes a request into slot (head % nslots)
+ * and advances @c head. The server handles the request in place, turning
+ * it into the reply, and advances @c done. Slots are reused by the client
+ * once the reply has been copied out, so both directions are strictly
+ * single-producer, single-consumer.
+ *
+ * The kernel is only involved when one of the peers would otherwise have
+ * to sleep. A client waiting for replies spins for a while as long as the
+ * server is busy; when the server is idle (or the spin budget runs out),
+ * the client sends a synchronous doorbell call over the session. The
+ * server holds the doorbell until it has drained the ring and then answers
+ * it, which is the only wake-up the client needs.
+ */
+
+#include <align.h>
+#include <as.h>
+#include <assert.h>
+#include <async.h>
+#include <async_ring.h>
+#include <errno.h>
+#include <fibril_synch.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+/** Magic value identifying a ring channel area ("RING") */
+#define RING_MAGIC  0x52494e47
+
+/** Size of a cache line used to separate the producer and consumer state */
+#define RING_CACHELINE  64
+
+/** Maximum number of slots in a ring */
+#define RING_SLOTS_MAX  4096
+
+/** Number of polls of the shared counters before a peer goes to sleep */
+#define RING_SPIN  256
+
+/** Layout of the shared ring channel area. */
+typedef struct {
+	uint32_t magic;
+	uint32_t nslots;
+
+	/** Number of requests posted by the client */
+	atomic_size_t head __attribute__((aligned(RING_CACHELINE)));
+
+	/** Number of requests answered by the server */
+	atomic_size_t done __attribute__((aligned(RING_CACHELINE)));
+	/** Server has drained the ring and waits for a doorbell */
+	atomic_bool server_idle;
+
+	async_ring_msg_t slots[] __attribute__((aligned(RING_CACHELINE)));
+} ring_shared_t;
+
+/** Client side of a ring channel. */
+struct async_ring {
+	/** Session dedicated to the channel, used for doorbells */
+	async_sess_t *sess;
+	/** Method used for setting up the channel and for doorbells */
+	sysarg_t imethod;
+	/** Shared area */
+	ring_shared_t *shared;
+	/** Number of slots */
+	size_t nslots;
+
+	/** Protects the client state below */
+	fibril_mutex_t lock;
+	/** Signalled when replies arrive or slots become free */
+	fibril_condvar_t cv;
+	/** Copy of the shared head counter */
+	size_t head;
+	/** Oldest slot whose reply has not been consumed yet */
+	size_t tail;
+	/** Reply in the slot has been copied out */
+	bool *consumed;
+	/** Some fibril is blocked in the doorbell call */
+	bool ringing;
+};
+
+static size_t ring_area_size(size_t nslots)
+{
+	return ALIGN_UP(sizeof(ring_shared_t) +
+	    nslots * sizeof(async_ring_msg_t), PAGE_SIZE);
+}
+
+/** Create ring channel.
+ *
+ * The server connection behind @a sess must handle @a imethod by calling
+ * async_ring_serve(). From then on the connection serves the channel only,
+ * so @a sess should be dedicated to it. The session is hung up when the
+ * channel is destroyed.
+ *
+ * @param sess    Session to the server
+ * @param imethod Server method for setting up the channel
+ * @param nslots  Number of message slots (ASYNC_RING_SLOTS if zero)
+ * @param rring   Place to store pointer to the new channel
+ *
+ * @return EOK on success, ENOMEM if out of memory, EINVAL if @a nslots
+ *         is out of range or an error code returned by the server
+ */
+errno_t async_ring_create(async_sess_t *sess, sysarg_t imethod, size_t nslots,
+    async_ring_t **rring)
+{
+	async_ring_t *ring;
+	ipc_call_t answer;
+	errno_t retval;
+	errno_t rc;
+
+	if (nslots == 0)
+		nslots = ASYNC_RING_SLOTS;
+	if (nslots > RING_SLOTS_MAX)
+		return EINVAL;
+
+	ring = calloc(1, sizeof(async_ring_t));
+	if (ring == NULL)
+		return ENOMEM;
+
+	ring->consumed = calloc(nslots, sizeof(bool));
+	if (ring->consumed == NULL) {
+		free(ring);
+		return ENOMEM;
+	}
+
+	ring->shared = as_area_create(AS_AREA_ANY, ring_area_size(nslots),
+	    AS_AREA_READ | AS_AREA_WRITE | AS_AREA_CACHEABLE, AS_AREA_UNPAGED);
+	if (ring->shared == AS_MAP_FAILED) {
+		free(ring->consumed);
+		free(ring);
+		return ENOMEM;
+	}
+
+	ring->shared->magic = RING_MAGIC;
+	ring->shared->nslots = nslots;
+	atomic_init(&ring->shared->head, 0);
+	atomic_init(&ring->shared->done, 0);
+	atomic_init(&ring->shared->server_idle, false);
+
+	ring->sess = sess;
+	ring->imethod = imethod;
+	ring->nslots = nslots;
+	fibril_mutex_initialize(&ring->lock);
+	fibril_condvar_initialize(&ring->cv);
+
+	async_exch_t *exch = async_exchange_begin(sess);
+	aid_t req = async_send_1(exch, imethod, nslots, &answer);
+	rc = async_share_out_start(exch, ring->shared,
+	    AS_AREA_READ | AS_AREA_WRITE);
+	async_exchange_end(exch);
+
+	if (rc != EOK) {
+		async_forget(req);
+		goto error;
+	}
+
+	async_wait_for(req, &retval);
+	if (retval != EOK) {
+		rc = retval;
+		goto error;
+	}
+
+	*rring = ring;
+	return EOK;
+error:
+	as_area_destroy(ring->shared);
+	free(ring->consumed);
+	free(ring);
+	return rc;
+}
+
+/** Destroy ring channel.
+ *
+ * No calls may be in progress on the channel.
+ *
+ * @param ring Ring channel
+ */
+void async_ring_destroy(async_ring_t *ring)
+{
+	if (ring == NULL)
+		return;
+
+	assert(ring->head == ring->tail);
+
+	async_hangup(ring->sess);
+	as_area_destroy(ring->shared);
+	free(ring->consumed);
+	free(ring);
+}
+
+/** Determine whether the server has answered requests up to @a end.
+ *
+ * @param ring Ring channel
+ * @param end  Sequence number following the last request of interest
+ * @return @c true if all requests before @a end have been answered
+ */
+static bool ring_answered(async_ring_t *ring, size_t end)
+{
+	size_t done = atomic_load_explicit(&ring->shared->done,
+	    memory_order_acquire);
+
+	/* Both differences are bounded by nslots, wraparound is harmless */
+	return ring->head - done <= ring->head - end;
+}
+
+/** Wait until the server answers requests up to @a end.
+ *
+ * Must be called with the ring lock held.
+ *
+ * @param ring Ring channel
+ * @param end  Sequence number following the last request of interest
+ * @return EOK on success or an error code if the doorbell call failed
+ */
+static errno_t ring_wait(async_ring_t *ring, size_t end)
+{
+	errno_t rc;
+
+	while (!ring_answered(ring, end)) {
+		if (ring->ringing) {
+			fibril_condvar_wait(&ring->cv, &ring->lock);
+			continue;
+		}
+
+		/*
+		 * Poll while the server is working on the ring, it is likely
+		 * to answer before we could have gone to sleep.
+		 */
+		for (unsigned i = 0; i < RING_SPIN; i++) {
+			if (ring_answered(ring, end))
+				return EOK;
+			if (atomic_load(&ring->shared->server_idle))
+				break;
+		}
+
+		/*
+		 * Ring the doorbell. The server answers it once it has
+		 * drained the ring, so all requests posted so far, including
+		 * ours, are answered when the call returns.
+		 */
+		ring->ringing = true;
+		fibril_mutex_unlock(&ring->lock);
+
+		async_exch_t *exch = async_exchange_begin(ring->sess);
+		rc = async_req_0_0(exch, ring->imethod);
+		async_exchange_end(exch);
+
+		fibril_mutex_lock(&ring->lock);
+		ring->ringing = false;
+		fibril_condvar_broadcast(&ring->cv);
+
+		if (rc != EOK)
+			return rc;
+	}
+
+	return EOK;
+}
+
+/** Send a batch of requests through the ring channel and wait for replies.
+ *
+ * The requests are posted as one batch so that the server can handle all
+ * of them after a single wake-up. Each message is replaced with the
+ * server's reply.
+ *
+ * @param ring  Ring channel
+ * @param msgs  Array of messages
+ * @param count Number of messages
+ *
+ * @return EOK if all replies were received (the individual results are in
+ *         the @c retval fields) or an error code if the channel failed
+ */
+errno_t async_ring_call_batch(async_ring_t *ring, async_ring_msg_t *msgs,
+    size_t count)
+{
+	errno_t rc = EOK;
+
+	fibril_mutex_lock(&ring->lock);
+
+	while (count > 0) {
+		size_t avail = ring->nslots - (ring->head - ring->tail);
+		if (avail == 0) {
+			fibril_condvar_wait(&ring->cv, &ring->lock);
+			continue;
+		}
+
+		size_t n = count < avail ? count : avail;
+		size_t first = ring->head;
+
+		for (size_t i = 0; i < n; i++) {
+			async_ring_msg_t *slot =
+			    &ring->shared->slots[(first + i) % ring->nslots];
+			*slot = msgs[i];
+			ring->consumed[(first + i) % ring->nslots] = false;
+		}
+
+		ring->head = first + n;
+		atomic_store_explicit(&ring->shared->head, ring->head,
+		    memory_order_release);
+
+		rc = ring_wait(ring, first + n);
+		if (rc != EOK)
+			break;
+
+		for (size_t i = 0; i < n; i++) {
+			size_t idx = (first + i) % ring->nslots;
+
+			msgs[i] = ring->shared->slots[idx];
+			ring->consumed[idx] = true;
+		}
+
+		/* Release slots consumed by us and by fibrils before us */
+		while (ring->tail != ring->head &&
+		    ring->consumed[ring->tail % ring->nslots])
+			ring->tail++;
+
+		fibril_condvar_broadcast(&ring->cv);
+
+		msgs += n;
+		count -= n;
+	}
+
+	fibril_mutex_unlock(&ring->lock);
+	return rc;
+}
+
+/** Send a request through the ring channel and wait for the reply.
+ *
+ * @param ring Ring channel
+ * @param msg  Message, replaced with the reply
+ *
+ * @return EOK if the reply was received (the result is in
+ *         @c msg->retval) or an error code if the channel failed
+ */
+errno_t async_ring_call(async_ring_t *ring, async_ring_msg_t *msg)
+{
+	return async_ring_call_batch(ring, msg, 1);
+}
+
+/** Handle all requests posted to the ring.
+ *
+ * @param shared  Shared area
+ * @param nslots  Number of slots
+ * @param handler Message handler
+ * @param arg     Argument for @a handler
+ * @return EOK on success, EINVAL if the client corrupted the counters
+ */
+static errno_t ring_drain(ring_shared_t *shared, size_t nslots,
+    async_ring_handler_t handler, void *arg)
+{
+	size_t done = atomic_load_explicit(&shared->done,
+	    memory_order_relaxed);
+	size_t head;
+
+	while ((head = atomic_load_explicit(&shared->head,
+	    memory_order_acquire)) != done) {
+		if (head - done > nslots)
+			return EINVAL;
+
+		while (done != head) {
+			handler(&shared->slots[done % nslots], arg);
+			done++;
+			atomic_store_explicit(&shared->done, done,
+			    memory_order_release);
+		}
+	}
+
+	return EOK;
+}
+
+/** Serve a ring channel.
+ *
+ * To be called from a connection fibril upon receiving the method the
+ * client passed to async_ring_create(). Accepts the shared area and handles
+ * the messages posted to the ring until the client hangs up.
+ *
+ * @param icall   Channel setup call
+ * @param handler Message handler
+ * @param arg     Argument for @a handler
+ *
+ * @return EOK when the client hung up, an error code if the channel could
+ *         not be set up or the client violated the protocol
+ */
+errno_t async_ring_serve(ipc_call_t *icall, async_ring_handler_t handler,
+    void *arg)
+{
+	sysarg_t imethod = IPC_GET_IMETHOD(*icall);
+	size_t nslots = IPC_GET_ARG1(*icall);
+	ring_shared_t *shared;
+	ipc_call_t call;
+	ipc_call_t doorbell;
+	bool pending = false;
+	unsigned int flags;
+	size_t size;
+	errno_t rc;
+
+	if (!async_share_out_receive(&call, &size, &flags)) {
+		async_answer_0(icall, EINVAL);
+		return EINVAL;
+	}
+
+	if (nslots == 0 || nslots > RING_SLOTS_MAX ||
+	    size < ring_area_size(nslots) ||
+	    (flags & (AS_AREA_READ | AS_AREA_WRITE)) !=
+	    (AS_AREA_READ | AS_AREA_WRITE)) {
+		async_answer_0(&call, EINVAL);
+		async_answer_0(icall, EINVAL);
+		return EINVAL;
+	}
+
+	rc = async_share_out_finalize(&call, (void **) &shared);
+	if (rc != EOK || shared == AS_MAP_FAILED) {
+		async_answer_0(icall, ENOMEM);
+		return ENOMEM;
+	}
+
+	if (shared->magic != RING_MAGIC || shared->nslots != nslots) {
+		as_area_destroy(shared);
+		async_answer_0(icall, EINVAL);
+		return EINVAL;
+	}
+
+	async_answer_0(icall, EOK);
+
+	while (true) {
+		rc = ring_drain(shared, nslots, handler, arg);
+		if (rc != EOK)
+			break;
+
+		if (pending) {
+			async_answer_0(&doorbell, EOK);
+			pending = false;
+		}
+
+		/* Poll for a while before going to sleep */
+		bool busy = false;
+		for (unsigned i = 0; i < RING_SPIN; i++) {
+			if (atomic_load_explicit(&shared->head,
+			    memory_order_relaxed) !=
+			    atomic_load_explicit(&shared->done,
+			    memory_order_relaxed)) {
+				busy = true;
+				break;
+			}
+		}
+
+		if (busy)
+			continue;
+
+		/*
+		 * Advertise that we are about to sleep so that a waiting client
+		 * stops polling and rings the doorbell right away, then check
+		 * the ring once more to avoid a needless round trip.
+		 */
+		atomic_store(&shared->server_idle, true);
+		if (atomic_load(&shared->head) != atomic_load(&shared->done)) {
+			atomic_store(&shared->server_idle, false);
+			continue;
+		}
+
+		async_get_call(&call);
+		atomic_store(&shared->server_idle, false);
+
+		if (!IPC_GET_IMETHOD(call)) {
+			async_answer_0(&call, EOK);
+			rc = EOK;
+			break;
+		}
+
+		if (IPC_GET_IMETHOD(call) != imethod || pending) {
+			async_answer_0(&call, EINVAL);
+			continue;
+		}
+
+		doorbell = call;
+		pending = true;
+	}
+
+	if (pending)
+		async_answer_0(&doorbell, EIO);
+
+	as_area_destroy(shared);
+	return rc;
+}
+
+/** @}
+ */
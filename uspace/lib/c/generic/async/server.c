@@ -1415,7 +1415,8 @@ errno_t async_data_write_finalize(ipc_call_t *call, void *dst, size_t size)
  *                   raw transmitted data.
  * @param min_size   Minimum size (in bytes) of the data to receive.
  * @param max_size   Maximum size (in bytes) of the data to receive. 0 means
- *                   no limit.
+ *                   DATA_XFER_LIMIT, larger transfers have to be allowed
+ *                   explicitly.
  * @param granulariy If non-zero then the size of the received data has to
  *                   be divisible by this value.
  * @param received   If not NULL, the size of the received data is stored here.
@@ -1441,7 +1442,12 @@ errno_t async_data_write_accept(void **data, const bool nullterm,
 		return EINVAL;
 	}
 
-	if ((max_size > 0) && (size > max_size)) {
+	/*
+	 * Bulk transfers can be much larger than DATA_XFER_LIMIT, do not let
+	 * a client make the server allocate that much unless it has asked for
+	 * it.
+	 */
+	if (size > ((max_size > 0) ? max_size : DATA_XFER_LIMIT)) {
 		async_answer_0(&call, EINVAL);
 		return EINVAL;
 	}
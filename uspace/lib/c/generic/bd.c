@@ -34,6 +34,7 @@
  * @brief Block device client interface
  */
 
+#include <as.h>
 #include <async.h>
 #include <assert.h>
 #include <bd.h>
@@ -42,6 +43,7 @@
 #include <ipc/services.h>
 #include <loc.h>
 #include <macros.h>
+#include <mem.h>
 #include <stdlib.h>
 #include <offset.h>
 
@@ -54,6 +56,8 @@ errno_t bd_open(async_sess_t *sess, bd_t **rbd)
 		return ENOMEM;
 
 	bd->sess = sess;
+	fibril_mutex_initialize(&bd->qlock);
+	fibril_condvar_initialize(&bd->qcv);
 
 	async_exch_t *exch = async_exchange_begin(sess);
 
@@ -79,11 +83,253 @@ error:
 void bd_close(bd_t *bd)
 {
 	/* XXX Synchronize with bd_cb_conn */
+	if (bd->qbuf != NULL)
+		as_area_destroy(bd->qbuf);
+	free(bd->qslots);
 	free(bd);
 }
 
+/** Set up request queue.
+ *
+ * Once the queue is set up, bd_read_blocks() and bd_write_blocks() pass
+ * data through a buffer shared with the server. Requests issued by
+ * different fibrils are then in flight at the same time and the server
+ * may complete them in any order. Requests larger than @a slot_size are
+ * split into several queued requests.
+ *
+ * @param bd		Block device
+ * @param depth		Maximum number of queued requests in flight
+ * @param slot_size	Maximum data size of one queued request
+ * @return		EOK on success or an error code
+ */
+errno_t bd_queue_init(bd_t *bd, size_t depth, size_t slot_size)
+{
+	bd_qslot_t *slots;
+	size_t bsize;
+	void *buf;
+	errno_t rc;
+
+	if (depth == 0 || depth > BD_QUEUE_MAX_DEPTH)
+		return EINVAL;
+
+	if (bd->qbuf != NULL)
+		return EBUSY;
+
+	rc = bd_get_block_size(bd, &bsize);
+	if (rc != EOK)
+		return rc;
+
+	if (bsize == 0)
+		return EIO;
+
+	/* Slot holds a whole number of blocks */
+	slot_size = max(slot_size - slot_size % bsize, bsize);
+	if (slot_size > SIZE_MAX / depth)
+		return ENOMEM;
+
+	slots = calloc(depth, sizeof(bd_qslot_t));
+	if (slots == NULL)
+		return ENOMEM;
+
+	buf = as_area_create(AS_AREA_ANY, depth * slot_size,
+	    AS_AREA_READ | AS_AREA_WRITE | AS_AREA_CACHEABLE, AS_AREA_UNPAGED);
+	if (buf == AS_MAP_FAILED) {
+		free(slots);
+		return ENOMEM;
+	}
+
+	async_exch_t *exch = async_exchange_begin(bd->sess);
+
+	ipc_call_t answer;
+	aid_t req = async_send_1(exch, BD_QUEUE_CREATE, depth, &answer);
+	rc = async_share_out_start(exch, buf, AS_AREA_READ | AS_AREA_WRITE);
+	async_exchange_end(exch);
+
+	if (rc != EOK) {
+		async_forget(req);
+		goto error;
+	}
+
+	errno_t retval;
+	async_wait_for(req, &retval);
+	if (retval != EOK) {
+		rc = retval;
+		goto error;
+	}
+
+	fibril_mutex_lock(&bd->qlock);
+	bd->qslots = slots;
+	bd->qdepth = depth;
+	bd->qslot_size = slot_size;
+	bd->qbsize = bsize;
+	bd->qbuf = buf;
+	fibril_mutex_unlock(&bd->qlock);
+
+	return EOK;
+
+error:
+	as_area_destroy(buf);
+	free(slots);
+	return rc;
+}
+
+/** Allocate request queue slot.
+ *
+ * @param bd		Block device
+ * @param wait		Wait for a slot to become free
+ * @param rslot		Place to store slot number
+ * @return		EOK on success, EBUSY if there is no free slot
+ *			and @a wait is false
+ */
+static errno_t bd_qslot_get(bd_t *bd, bool wait, size_t *rslot)
+{
+	size_t i;
+
+	fibril_mutex_lock(&bd->qlock);
+
+	while (true) {
+		for (i = 0; i < bd->qdepth; i++) {
+			if (!bd->qslots[i].busy) {
+				bd->qslots[i].busy = true;
+				bd->qslots[i].done = false;
+				fibril_mutex_unlock(&bd->qlock);
+				*rslot = i;
+				return EOK;
+			}
+		}
+
+		if (!wait) {
+			fibril_mutex_unlock(&bd->qlock);
+			return EBUSY;
+		}
+
+		fibril_condvar_wait(&bd->qcv, &bd->qlock);
+	}
+}
+
+/** Release request queue slot. */
+static void bd_qslot_put(bd_t *bd, size_t slot)
+{
+	fibril_mutex_lock(&bd->qlock);
+	bd->qslots[slot].busy = false;
+	fibril_condvar_broadcast(&bd->qcv);
+	fibril_mutex_unlock(&bd->qlock);
+}
+
+/** Wait for completion of queued request.
+ *
+ * @param bd		Block device
+ * @param slot		Slot of the request
+ * @return		Completion status of the request
+ */
+static errno_t bd_qslot_wait(bd_t *bd, size_t slot)
+{
+	errno_t rc;
+
+	fibril_mutex_lock(&bd->qlock);
+
+	while (!bd->qslots[slot].done)
+		fibril_condvar_wait(&bd->qcv, &bd->qlock);
+
+	rc = bd->qslots[slot].rc;
+	fibril_mutex_unlock(&bd->qlock);
+
+	return rc;
+}
+
+/** Transfer blocks using the request queue.
+ *
+ * The transfer is split into requests of at most one slot each. As many
+ * requests as there are free slots are kept in flight.
+ *
+ * @param bd		Block device
+ * @param method	BD_QUEUE_READ or BD_QUEUE_WRITE
+ * @param ba		Address of first block
+ * @param cnt		Number of blocks
+ * @param data		Data buffer
+ * @param size		Size of data buffer
+ * @return		EOK on success or an error code
+ */
+static errno_t bd_queue_xfer(bd_t *bd, sysarg_t method, aoff64_t ba,
+    size_t cnt, void *data, size_t size)
+{
+	struct {
+		size_t slot;
+		size_t first;
+		size_t cnt;
+	} pending[BD_QUEUE_MAX_DEPTH];
+
+	size_t slot_blocks = bd->qslot_size / bd->qbsize;
+	size_t head = 0;
+	size_t npending = 0;
+	size_t issued = 0;
+	errno_t rc = EOK;
+
+	if (cnt > size / bd->qbsize)
+		return EINVAL;
+
+	while (true) {
+		/* Submit requests while there are free slots */
+		while (rc == EOK && issued < cnt && npending < bd->qdepth) {
+			size_t n = min(cnt - issued, slot_blocks);
+			size_t slot;
+
+			/* Only block if there is nothing to complete first */
+			if (bd_qslot_get(bd, npending == 0, &slot) != EOK)
+				break;
+
+			uint8_t *sbuf = (uint8_t *) bd->qbuf +
+			    slot * bd->qslot_size;
+
+			if (method == BD_QUEUE_WRITE) {
+				memcpy(sbuf, (uint8_t *) data +
+				    issued * bd->qbsize, n * bd->qbsize);
+			}
+
+			async_exch_t *exch = async_exchange_begin(bd->sess);
+			async_msg_5(exch, method, slot, LOWER32(ba + issued),
+			    UPPER32(ba + issued), n, slot * bd->qslot_size);
+			async_exchange_end(exch);
+
+			size_t idx = (head + npending) % BD_QUEUE_MAX_DEPTH;
+			pending[idx].slot = slot;
+			pending[idx].first = issued;
+			pending[idx].cnt = n;
+			npending++;
+
+			issued += n;
+		}
+
+		if (npending == 0)
+			break;
+
+		/* Complete the oldest request */
+		size_t slot = pending[head].slot;
+		errno_t crc = bd_qslot_wait(bd, slot);
+
+		if (crc == EOK && rc == EOK && method == BD_QUEUE_READ) {
+			memcpy((uint8_t *) data + pending[head].first *
+			    bd->qbsize, (uint8_t *) bd->qbuf +
+			    slot * bd->qslot_size,
+			    pending[head].cnt * bd->qbsize);
+		}
+
+		if (crc != EOK)
+			rc = crc;
+
+		bd_qslot_put(bd, slot);
+		head = (head + 1) % BD_QUEUE_MAX_DEPTH;
+		npending--;
+	}
+
+	return rc;
+}
+
 errno_t bd_read_blocks(bd_t *bd, aoff64_t ba, size_t cnt, void *data, size_t size)
 {
+	if (bd->qbuf != NULL)
+		return bd_queue_xfer(bd, BD_QUEUE_READ, ba, cnt, data, size);
+
 	async_exch_t *exch = async_exchange_begin(bd->sess);
 
 	ipc_call_t answer;
@@ -132,6 +378,11 @@ errno_t bd_read_toc(bd_t *bd, uint8_t session, void *buf, size_t size)
 errno_t bd_write_blocks(bd_t *bd, aoff64_t ba, size_t cnt, const void *data,
     size_t size)
 {
+	if (bd->qbuf != NULL) {
+		return bd_queue_xfer(bd, BD_QUEUE_WRITE, ba, cnt, (void *) data,
+		    size);
+	}
+
 	async_exch_t *exch = async_exchange_begin(bd->sess);
 
 	ipc_call_t answer;
@@ -195,12 +446,29 @@ errno_t bd_get_num_blocks(bd_t *bd, aoff64_t *rnb)
 	return EOK;
 }
 
+/** Queued request has completed. */
+static void bd_ev_complete(bd_t *bd, ipc_call_t *call)
+{
+	size_t slot = IPC_GET_ARG1(*call);
+	errno_t rc = IPC_GET_ARG2(*call);
+
+	fibril_mutex_lock(&bd->qlock);
+
+	if (slot < bd->qdepth && bd->qslots[slot].busy) {
+		bd->qslots[slot].rc = rc;
+		bd->qslots[slot].done = true;
+		fibril_condvar_broadcast(&bd->qcv);
+	}
+
+	fibril_mutex_unlock(&bd->qlock);
+
+	async_answer_0(call, EOK);
+}
+
 static void bd_cb_conn(ipc_call_t *icall, void *arg)
 {
 	bd_t *bd = (bd_t *)arg;
 
-	(void)bd;
-
 	while (true) {
 		ipc_call_t call;
 		async_get_call(&call);
@@ -211,6 +479,9 @@ static void bd_cb_conn(ipc_call_t *icall, void *arg)
 		}
 
 		switch (IPC_GET_IMETHOD(call)) {
+		case BD_EV_COMPLETE:
+			bd_ev_complete(bd, &call);
+			break;
 		default:
 			async_answer_0(&call, ENOTSUP);
 		}
@@ -33,7 +33,9 @@
  * @file
  * @brief Block device server stub
  */
+#include <as.h>
 #include <errno.h>
+#include <fibril.h>
 #include <ipc/bd.h>
 #include <macros.h>
 #include <stdlib.h>
@@ -42,6 +44,22 @@
 
 #include <bd_srv.h>
 
+/** Queued request */
+typedef struct {
+	/** Link to bd_srv_t.qreqs */
+	link_t lreqs;
+	/** BD_QUEUE_READ or BD_QUEUE_WRITE */
+	sysarg_t method;
+	/** Client tag */
+	sysarg_t tag;
+	/** Address of first block */
+	aoff64_t ba;
+	/** Number of blocks */
+	size_t cnt;
+	/** Offset of data in shared buffer */
+	size_t offset;
+} bd_srv_req_t;
+
 static void bd_read_blocks_srv(bd_srv_t *srv, ipc_call_t *call)
 {
 	aoff64_t ba;
@@ -203,6 +221,197 @@ static void bd_get_num_blocks_srv(bd_srv_t *srv, ipc_call_t *call)
 	async_answer_2(call, rc, LOWER32(num_blocks), UPPER32(num_blocks));
 }
 
+/** Notify client about completion of queued request. */
+static void bd_queue_complete(bd_srv_t *srv, sysarg_t tag, errno_t rc)
+{
+	async_exch_t *exch = async_exchange_begin(srv->client_sess);
+	async_msg_2(exch, BD_EV_COMPLETE, tag, rc);
+	async_exchange_end(exch);
+}
+
+/** Execute queued request. */
+static errno_t bd_queue_exec(bd_srv_t *srv, bd_srv_req_t *req)
+{
+	void *buf;
+	size_t size;
+
+	if (req->cnt > (srv->qsize - req->offset) / srv->qbsize)
+		return EINVAL;
+
+	buf = (uint8_t *) srv->qbuf + req->offset;
+	size = req->cnt * srv->qbsize;
+
+	if (req->method == BD_QUEUE_READ) {
+		if (srv->srvs->ops->read_blocks == NULL)
+			return ENOTSUP;
+		return srv->srvs->ops->read_blocks(srv, req->ba, req->cnt,
+		    buf, size);
+	}
+
+	if (srv->srvs->ops->write_blocks == NULL)
+		return ENOTSUP;
+	return srv->srvs->ops->write_blocks(srv, req->ba, req->cnt, buf, size);
+}
+
+/** Worker fibril processing queued requests. */
+static errno_t bd_queue_worker(void *arg)
+{
+	bd_srv_t *srv = (bd_srv_t *) arg;
+	bd_srv_req_t *req;
+	errno_t rc;
+
+	fibril_mutex_lock(&srv->qlock);
+
+	while (true) {
+		while (list_empty(&srv->qreqs) && !srv->qclosing)
+			fibril_condvar_wait(&srv->qcv, &srv->qlock);
+
+		if (list_empty(&srv->qreqs))
+			break;
+
+		req = list_get_instance(list_first(&srv->qreqs), bd_srv_req_t,
+		    lreqs);
+		list_remove(&req->lreqs);
+		fibril_mutex_unlock(&srv->qlock);
+
+		rc = bd_queue_exec(srv, req);
+		bd_queue_complete(srv, req->tag, rc);
+		free(req);
+
+		fibril_mutex_lock(&srv->qlock);
+	}
+
+	srv->qworkers--;
+	fibril_condvar_broadcast(&srv->qcv);
+	fibril_mutex_unlock(&srv->qlock);
+
+	return EOK;
+}
+
+/** Set up request queue.
+ *
+ * The client shares a buffer which is used for data of all queued
+ * requests. Requests are processed by up to queue_depth worker fibrils
+ * and completions are reported over the callback session, possibly
+ * out of order.
+ */
+static void bd_queue_create_srv(bd_srv_t *srv, ipc_call_t *call)
+{
+	size_t depth;
+	size_t size;
+	unsigned int flags;
+	void *buf;
+	errno_t rc;
+
+	depth = min((size_t) IPC_GET_ARG1(*call), srv->srvs->queue_depth);
+	if (depth == 0)
+		depth = 1;
+
+	ipc_call_t scall;
+	if (!async_share_out_receive(&scall, &size, &flags)) {
+		async_answer_0(call, EINVAL);
+		return;
+	}
+
+	if (srv->qbuf != NULL || srv->srvs->ops->get_block_size == NULL) {
+		async_answer_0(&scall, EBUSY);
+		async_answer_0(call, EBUSY);
+		return;
+	}
+
+	rc = srv->srvs->ops->get_block_size(srv, &srv->qbsize);
+	if (rc != EOK || srv->qbsize == 0) {
+		async_answer_0(&scall, EIO);
+		async_answer_0(call, EIO);
+		return;
+	}
+
+	rc = async_share_out_finalize(&scall, &buf);
+	if (rc != EOK) {
+		async_answer_0(call, rc);
+		return;
+	}
+
+	srv->qbuf = buf;
+	srv->qsize = size;
+
+	fibril_mutex_lock(&srv->qlock);
+
+	while (srv->qworkers < depth) {
+		fid_t fid = fibril_create(bd_queue_worker, srv);
+		if (fid == 0)
+			break;
+
+		srv->qworkers++;
+		fibril_add_ready(fid);
+	}
+
+	depth = srv->qworkers;
+	fibril_mutex_unlock(&srv->qlock);
+
+	if (depth == 0) {
+		async_answer_0(call, ENOMEM);
+		return;
+	}
+
+	async_answer_1(call, EOK, depth);
+}
+
+/** Queue read or write request. */
+static void bd_queue_submit_srv(bd_srv_t *srv, ipc_call_t *call)
+{
+	bd_srv_req_t *req;
+	sysarg_t tag;
+
+	tag = IPC_GET_ARG1(*call);
+	async_answer_0(call, EOK);
+
+	if (srv->qbuf == NULL) {
+		bd_queue_complete(srv, tag, EINVAL);
+		return;
+	}
+
+	req = calloc(1, sizeof(bd_srv_req_t));
+	if (req == NULL) {
+		bd_queue_complete(srv, tag, ENOMEM);
+		return;
+	}
+
+	req->method = IPC_GET_IMETHOD(*call);
+	req->tag = tag;
+	req->ba = MERGE_LOUP32(IPC_GET_ARG2(*call), IPC_GET_ARG3(*call));
+	req->cnt = IPC_GET_ARG4(*call);
+	req->offset = IPC_GET_ARG5(*call);
+
+	if (req->offset > srv->qsize) {
+		bd_queue_complete(srv, tag, EINVAL);
+		free(req);
+		return;
+	}
+
+	fibril_mutex_lock(&srv->qlock);
+	list_append(&req->lreqs, &srv->qreqs);
+	fibril_condvar_signal(&srv->qcv);
+	fibril_mutex_unlock(&srv->qlock);
+}
+
+/** Stop request queue, waiting for queued requests to complete. */
+static void bd_queue_destroy(bd_srv_t *srv)
+{
+	fibril_mutex_lock(&srv->qlock);
+
+	srv->qclosing = true;
+	fibril_condvar_broadcast(&srv->qcv);
+
+	while (srv->qworkers > 0)
+		fibril_condvar_wait(&srv->qcv, &srv->qlock);
+
+	fibril_mutex_unlock(&srv->qlock);
+
+	if (srv->qbuf != NULL)
+		as_area_destroy(srv->qbuf);
+}
+
 static bd_srv_t *bd_srv_create(bd_srvs_t *srvs)
 {
 	bd_srv_t *srv;
@@ -212,6 +421,9 @@ static bd_srv_t *bd_srv_create(bd_srvs_t *srvs)
 		return NULL;
 
 	srv->srvs = srvs;
+	fibril_mutex_initialize(&srv->qlock);
+	fibril_condvar_initialize(&srv->qcv);
+	list_initialize(&srv->qreqs);
 	return srv;
 }
 
@@ -219,6 +431,7 @@ void bd_srvs_init(bd_srvs_t *srvs)
 {
 	srvs->ops = NULL;
 	srvs->sarg = NULL;
+	srvs->queue_depth = 1;
 }
 
 errno_t bd_conn(ipc_call_t *icall, bd_srvs_t *srvs)
@@ -273,11 +486,20 @@ errno_t bd_conn(ipc_call_t *icall, bd_srvs_t *srvs)
 		case BD_GET_NUM_BLOCKS:
 			bd_get_num_blocks_srv(srv, &call);
 			break;
+		case BD_QUEUE_CREATE:
+			bd_queue_create_srv(srv, &call);
+			break;
+		case BD_QUEUE_READ:
+		case BD_QUEUE_WRITE:
+			bd_queue_submit_srv(srv, &call);
+			break;
 		default:
 			async_answer_0(&call, EINVAL);
 		}
 	}
 
+	bd_queue_destroy(srv);
+
 	rc = srvs->ops->close(srv);
 	free(srv);
 
@@ -0,0 +1,181 @@
+/*
+ * Copyright (c) 2026 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup libc
+ * @{
+ */
+/** @file Internet checksum
+ *
+ * One's complement sum of 16-bit big-endian words (RFC 1071). The sum
+ * does not depend on byte order of the words as long as they are all
+ * swapped alike, so it is computed over native 32-bit words in a 64-bit
+ * accumulator and converted to network byte order once at the end.
+ */
+
+#include <byteorder.h>
+#include <inet/checksum.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** Fold one's complement accumulator to 16 bits.
+ *
+ * @param acc Accumulator
+ * @return One's complement sum of the 16-bit halves of @a acc
+ */
+static uint16_t inet_checksum_fold(uint64_t acc)
+{
+	while ((acc >> 16) != 0)
+		acc = (acc & 0xffff) + (acc >> 16);
+
+	return acc;
+}
+
+/** Sum data starting at 16-bit aligned address.
+ *
+ * @param bdata Data, aligned to 16 bits
+ * @param size Size of data in bytes
+ * @return Folded sum in native byte order
+ */
+static uint16_t inet_checksum_sum_aligned(const uint8_t *bdata, size_t size)
+{
+	const uint32_t *wdata;
+	uint64_t acc = 0;
+
+	if (((uintptr_t) bdata & 2) != 0 && size >= 2) {
+		acc += *(const uint16_t *) bdata;
+		bdata += 2;
+		size -= 2;
+	}
+
+	/* 32-bit words cannot overflow the accumulator for any sane size */
+	wdata = (const uint32_t *) bdata;
+	while (size >= 32) {
+		acc += (uint64_t) wdata[0] + wdata[1] + wdata[2] + wdata[3];
+		acc += (uint64_t) wdata[4] + wdata[5] + wdata[6] + wdata[7];
+		wdata += 8;
+		size -= 32;
+	}
+
+	while (size >= 4) {
+		acc += *wdata++;
+		size -= 4;
+	}
+
+	bdata = (const uint8_t *) wdata;
+	if (size >= 2) {
+		acc += *(const uint16_t *) bdata;
+		bdata += 2;
+		size -= 2;
+	}
+
+	/* Odd trailing byte is padded with zero */
+	if (size > 0)
+		acc += host2uint16_t_be((uint16_t) bdata[0] << 8);
+
+	return inet_checksum_fold(acc);
+}
+
+/** Compute internet checksum.
+ *
+ * Checksum of data split into several pieces can be computed by
+ * chaining, passing the result for the preceding piece as @a ivalue.
+ * All pieces except the last one must have even size.
+ *
+ * @param ivalue Initial value (INET_CHECKSUM_INIT or checksum of
+ *               preceding data)
+ * @param data Data
+ * @param size Size of data in bytes
+ * @return Checksum in host byte order
+ */
+uint16_t inet_checksum_calc(uint16_t ivalue, const void *data, size_t size)
+{
+	const uint8_t *bdata = (const uint8_t *) data;
+	uint64_t acc;
+
+	acc = host2uint16_t_be((uint16_t) ~ivalue);
+
+	if (((uintptr_t) bdata & 1) != 0 && size > 0) {
+		/*
+		 * Words summed from the next byte have their halves
+		 * swapped with respect to the real word boundaries.
+		 */
+		acc += host2uint16_t_be((uint16_t) bdata[0] << 8);
+		acc += uint16_t_byteorder_swap(
+		    inet_checksum_sum_aligned(bdata + 1, size - 1));
+	} else {
+		acc += inet_checksum_sum_aligned(bdata, size);
+	}
+
+	return ~uint16_t_be2host(inet_checksum_fold(acc));
+}
+
+/** Update checksum after a 16-bit field has changed.
+ *
+ * Uses HC' = ~(~HC + ~m + m') from RFC 1624. The result differs from
+ * recomputation only if the whole checksummed data becomes zero.
+ *
+ * @param cs Old checksum in host byte order
+ * @param oval Old value of the field in host byte order
+ * @param nval New value of the field in host byte order
+ * @return New checksum in host byte order
+ */
+uint16_t inet_checksum_update16(uint16_t cs, uint16_t oval, uint16_t nval)
+{
+	uint64_t acc;
+
+	acc = (uint16_t) ~cs;
+	acc += (uint16_t) ~oval;
+	acc += nval;
+
+	return ~inet_checksum_fold(acc);
+}
+
+/** Update checksum after a 32-bit field has changed.
+ *
+ * The field must start at an even offset (e.g. an IPv4 address).
+ *
+ * @param cs Old checksum in host byte order
+ * @param oval Old value of the field in host byte order
+ * @param nval New value of the field in host byte order
+ * @return New checksum in host byte order
+ */
+uint16_t inet_checksum_update32(uint16_t cs, uint32_t oval, uint32_t nval)
+{
+	uint64_t acc;
+
+	acc = (uint16_t) ~cs;
+	acc += (uint16_t) ~(oval >> 16);
+	acc += (uint16_t) ~oval;
+	acc += nval >> 16;
+	acc += nval & 0xffff;
+
+	return ~inet_checksum_fold(acc);
+}
+
+/** @}
+ */
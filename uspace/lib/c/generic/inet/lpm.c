@@ -0,0 +1,479 @@
+/*
+ * Copyright (c) 2026 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup libc
+ * @{
+ */
+/** @file Longest-prefix-match table
+ *
+ * Addresses are kept as four 32-bit words so that prefixes can be compared
+ * a word at a time. Nodes that only join two subtrees are created when
+ * two prefixes diverge and removed as soon as they join less than two.
+ */
+
+#include <bitops.h>
+#include <errno.h>
+#include <inet/addr.h>
+#include <inet/lpm.h>
+#include <macros.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+/** Get trie and key for an address.
+ *
+ * @param lpm   LPM table
+ * @param ver   IP version
+ * @param addr  IPv4 address
+ * @param addr6 IPv6 address
+ * @param key   Place to store key
+ * @param nbits Place to store number of bits in key
+ *
+ * @return Link to the trie root or @c NULL if @a ver is not supported
+ */
+static inet_lpm_node_t **inet_lpm_key(inet_lpm_t *lpm, ip_ver_t ver,
+    addr32_t addr, const addr128_t addr6, uint32_t *key, unsigned *nbits)
+{
+	unsigned i;
+
+	switch (ver) {
+	case ip_v4:
+		key[0] = addr;
+		key[1] = 0;
+		key[2] = 0;
+		key[3] = 0;
+		*nbits = 32;
+		return &lpm->root4;
+	case ip_v6:
+		for (i = 0; i < 4; i++) {
+			key[i] = ((uint32_t) addr6[4 * i] << 24) |
+			    ((uint32_t) addr6[4 * i + 1] << 16) |
+			    ((uint32_t) addr6[4 * i + 2] << 8) |
+			    addr6[4 * i + 3];
+		}
+		*nbits = 128;
+		return &lpm->root6;
+	default:
+		return NULL;
+	}
+}
+
+/** Clear bits of a key past prefix.
+ *
+ * @param key  Key
+ * @param bits Prefix length
+ */
+static void inet_lpm_mask(uint32_t *key, unsigned bits)
+{
+	unsigned i;
+
+	for (i = 0; i < 4; i++) {
+		if (bits <= 32 * i)
+			key[i] = 0;
+		else if (bits < 32 * (i + 1))
+			key[i] &= ~(UINT32_MAX >> (bits - 32 * i));
+	}
+}
+
+/** Get trie and masked key for a network address.
+ *
+ * @param lpm   LPM table
+ * @param naddr Network address
+ * @param key   Place to store key
+ * @param plen  Place to store prefix length
+ *
+ * @return Link to the trie root or @c NULL if @a naddr is not valid
+ */
+static inet_lpm_node_t **inet_lpm_nkey(inet_lpm_t *lpm,
+    const inet_naddr_t *naddr, uint32_t *key, unsigned *plen)
+{
+	inet_lpm_node_t **root;
+	addr32_t addr;
+	addr128_t addr6;
+	uint8_t prefix;
+	unsigned nbits;
+	ip_ver_t ver;
+
+	addr = 0;
+	ver = inet_naddr_get(naddr, &addr, &addr6, &prefix);
+	root = inet_lpm_key(lpm, ver, addr, addr6, key, &nbits);
+	if (root == NULL || prefix > nbits)
+		return NULL;
+
+	/* Clear host part */
+	inet_lpm_mask(key, prefix);
+
+	*plen = prefix;
+	return root;
+}
+
+/** Get bit of a key.
+ *
+ * @param key Key
+ * @param i   Bit index, zero is the most significant bit
+ * @return    Value of the bit
+ */
+static inline unsigned inet_lpm_bit(const uint32_t *key, unsigned i)
+{
+	return (key[i / 32] >> (31 - i % 32)) & 1;
+}
+
+/** Determine length of common prefix of two keys.
+ *
+ * @param a     First key
+ * @param b     Second key
+ * @param nbits Maximum number of bits to compare
+ * @return      Number of leading bits the keys have in common,
+ *              at most @a nbits
+ */
+static inline unsigned inet_lpm_common(const uint32_t *a, const uint32_t *b,
+    unsigned nbits)
+{
+	uint32_t diff;
+	unsigned i;
+
+	for (i = 0; 32 * i < nbits; i++) {
+		diff = a[i] ^ b[i];
+		if (diff != 0)
+			return min(32 * i + 31 - fnzb32(diff), nbits);
+	}
+
+	return nbits;
+}
+
+/** Allocate new trie node.
+ *
+ * @param key   Key, bits past @a bits must be zero
+ * @param bits  Prefix length
+ * @return      New node or @c NULL if out of memory
+ */
+static inet_lpm_node_t *inet_lpm_node_create(const uint32_t *key,
+    unsigned bits)
+{
+	inet_lpm_node_t *node;
+	unsigned i;
+
+	node = calloc(1, sizeof(inet_lpm_node_t));
+	if (node == NULL)
+		return NULL;
+
+	for (i = 0; i < 4; i++)
+		node->key[i] = key[i];
+	node->bits = bits;
+	return node;
+}
+
+/** Destroy trie.
+ *
+ * @param node Trie root or @c NULL
+ */
+static void inet_lpm_node_destroy(inet_lpm_node_t *node)
+{
+	if (node == NULL)
+		return;
+
+	inet_lpm_node_destroy(node->child[0]);
+	inet_lpm_node_destroy(node->child[1]);
+	free(node);
+}
+
+/** Remove node if it neither holds an entry nor joins two subtrees.
+ *
+ * @param link Link to the node
+ */
+static void inet_lpm_prune(inet_lpm_node_t **link)
+{
+	inet_lpm_node_t *node = *link;
+
+	if (node->used || (node->child[0] != NULL && node->child[1] != NULL))
+		return;
+
+	*link = (node->child[0] != NULL) ? node->child[0] : node->child[1];
+	free(node);
+}
+
+/** Find node with exactly the given prefix.
+ *
+ * @param link  Link to the trie root
+ * @param key   Masked key
+ * @param plen  Prefix length
+ * @param plink Place to store link to the parent node (if not @c NULL)
+ * @return      Link to the node or @c NULL if not found
+ */
+static inet_lpm_node_t **inet_lpm_find(inet_lpm_node_t **link,
+    const uint32_t *key, unsigned plen, inet_lpm_node_t ***plink)
+{
+	inet_lpm_node_t *node;
+	inet_lpm_node_t **parent = NULL;
+
+	while ((node = *link) != NULL && node->bits <= plen &&
+	    inet_lpm_common(node->key, key, node->bits) == node->bits) {
+		if (node->bits == plen) {
+			if (plink != NULL)
+				*plink = parent;
+			return link;
+		}
+
+		parent = link;
+		link = &node->child[inet_lpm_bit(key, node->bits)];
+	}
+
+	return NULL;
+}
+
+/** Initialize LPM table.
+ *
+ * @param lpm LPM table
+ */
+void inet_lpm_init(inet_lpm_t *lpm)
+{
+	lpm->root4 = NULL;
+	lpm->root6 = NULL;
+	lpm->count = 0;
+}
+
+/** Finalize LPM table.
+ *
+ * Values of the entries are not touched.
+ *
+ * @param lpm LPM table
+ */
+void inet_lpm_fini(inet_lpm_t *lpm)
+{
+	inet_lpm_node_destroy(lpm->root4);
+	inet_lpm_node_destroy(lpm->root6);
+	inet_lpm_init(lpm);
+}
+
+/** Insert entry into LPM table.
+ *
+ * Host part of @a naddr is ignored.
+ *
+ * @param lpm   LPM table
+ * @param naddr Network address
+ * @param value Entry value
+ *
+ * @return EOK on success, EEXIST if there already is an entry for
+ *         the network, EINVAL if @a naddr is not valid, ENOMEM if out
+ *         of memory
+ */
+errno_t inet_lpm_insert(inet_lpm_t *lpm, const inet_naddr_t *naddr,
+    void *value)
+{
+	inet_lpm_node_t **link;
+	inet_lpm_node_t *node;
+	inet_lpm_node_t *nnode;
+	inet_lpm_node_t *inner;
+	uint32_t key[4];
+	unsigned plen;
+	unsigned common;
+
+	link = inet_lpm_nkey(lpm, naddr, key, &plen);
+	if (link == NULL)
+		return EINVAL;
+
+	while ((node = *link) != NULL) {
+		common = inet_lpm_common(node->key, key, min(node->bits, plen));
+
+		if (common == node->bits && common == plen) {
+			/* Node for this prefix already exists */
+			if (node->used)
+				return EEXIST;
+
+			node->used = true;
+			node->value = value;
+			lpm->count++;
+			return EOK;
+		}
+
+		if (common < node->bits)
+			break;
+
+		/* Node prefix is a prefix of the new one */
+		link = &node->child[inet_lpm_bit(key, node->bits)];
+	}
+
+	nnode = inet_lpm_node_create(key, plen);
+	if (nnode == NULL)
+		return ENOMEM;
+
+	nnode->used = true;
+	nnode->value = value;
+
+	if (node == NULL) {
+		*link = nnode;
+	} else if (common == plen) {
+		/* New prefix is a prefix of the node */
+		nnode->child[inet_lpm_bit(node->key, plen)] = node;
+		*link = nnode;
+	} else {
+		/* Prefixes diverge, join them by a new inner node */
+		inner = inet_lpm_node_create(key, common);
+		if (inner == NULL) {
+			free(nnode);
+			return ENOMEM;
+		}
+
+		inet_lpm_mask(inner->key, common);
+
+		inner->child[inet_lpm_bit(node->key, common)] = node;
+		inner->child[inet_lpm_bit(key, common)] = nnode;
+		*link = inner;
+	}
+
+	lpm->count++;
+	return EOK;
+}
+
+/** Remove entry from LPM table.
+ *
+ * @param lpm   LPM table
+ * @param naddr Network address
+ *
+ * @return EOK on success, ENOENT if there is no entry for the network
+ */
+errno_t inet_lpm_remove(inet_lpm_t *lpm, const inet_naddr_t *naddr)
+{
+	inet_lpm_node_t **root;
+	inet_lpm_node_t **link;
+	inet_lpm_node_t **plink;
+	uint32_t key[4];
+	unsigned plen;
+
+	root = inet_lpm_nkey(lpm, naddr, key, &plen);
+	if (root == NULL)
+		return ENOENT;
+
+	link = inet_lpm_find(root, key, plen, &plink);
+	if (link == NULL || !(*link)->used)
+		return ENOENT;
+
+	(*link)->used = false;
+	(*link)->value = NULL;
+	lpm->count--;
+
+	/* Removing the node can leave its parent with a single subtree */
+	inet_lpm_prune(link);
+	if (plink != NULL)
+		inet_lpm_prune(plink);
+
+	return EOK;
+}
+
+/** Change value of an entry.
+ *
+ * @param lpm   LPM table
+ * @param naddr Network address
+ * @param value New entry value
+ *
+ * @return EOK on success, ENOENT if there is no entry for the network
+ */
+errno_t inet_lpm_update(inet_lpm_t *lpm, const inet_naddr_t *naddr,
+    void *value)
+{
+	inet_lpm_node_t **root;
+	inet_lpm_node_t **link;
+	uint32_t key[4];
+	unsigned plen;
+
+	root = inet_lpm_nkey(lpm, naddr, key, &plen);
+	if (root == NULL)
+		return ENOENT;
+
+	link = inet_lpm_find(root, key, plen, NULL);
+	if (link == NULL || !(*link)->used)
+		return ENOENT;
+
+	(*link)->value = value;
+	return EOK;
+}
+
+/** Get entry for exactly the given network.
+ *
+ * @param lpm   LPM table
+ * @param naddr Network address
+ *
+ * @return Entry value or @c NULL if there is no entry for the network
+ */
+void *inet_lpm_get(inet_lpm_t *lpm, const inet_naddr_t *naddr)
+{
+	inet_lpm_node_t **root;
+	inet_lpm_node_t **link;
+	uint32_t key[4];
+	unsigned plen;
+
+	root = inet_lpm_nkey(lpm, naddr, key, &plen);
+	if (root == NULL)
+		return NULL;
+
+	link = inet_lpm_find(root, key, plen, NULL);
+	if (link == NULL || !(*link)->used)
+		return NULL;
+
+	return (*link)->value;
+}
+
+/** Find entry with the longest prefix matching an address.
+ *
+ * @param lpm  LPM table
+ * @param addr Address
+ *
+ * @return Entry value or @c NULL if no entry matches
+ */
+void *inet_lpm_lookup(inet_lpm_t *lpm, const inet_addr_t *addr)
+{
+	inet_lpm_node_t **root;
+	inet_lpm_node_t *node;
+	addr32_t addr4;
+	addr128_t addr6;
+	uint32_t key[4];
+	unsigned nbits;
+	void *value = NULL;
+	ip_ver_t ver;
+
+	addr4 = 0;
+	ver = inet_addr_get(addr, &addr4, &addr6);
+	root = inet_lpm_key(lpm, ver, addr4, addr6, key, &nbits);
+	if (root == NULL)
+		return NULL;
+
+	node = *root;
+	while (node != NULL &&
+	    inet_lpm_common(node->key, key, node->bits) == node->bits) {
+		if (node->used)
+			value = node->value;
+		if (node->bits == nbits)
+			break;
+
+		node = node->child[inet_lpm_bit(key, node->bits)];
+	}
+
+	return value;
+}
+
+/** @}
+ */
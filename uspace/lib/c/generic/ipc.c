@@ -109,6 +109,28 @@ errno_t ipc_call_async_slow(cap_phone_handle_t phandle, sysarg_t imethod,
 	    (sysarg_t) label);
 }
 
+/** Batch of asynchronous calls.
+ *
+ * Submits several calls, possibly over different phones, in a single
+ * system call. The calls are sent in order until the first one that
+ * cannot be sent.
+ *
+ * @param calls  Array of calls. The @c label of each call is its answer
+ *               label.
+ * @param count  Number of calls (at most IPC_BATCH_MAX).
+ * @param rsent  Place to store the number of calls actually sent.
+ *
+ * @return EOK if all calls were sent or the error code of the first call
+ *         that could not be sent.
+ *
+ */
+errno_t ipc_call_async_batch(ipc_batch_call_t *calls, size_t count,
+    size_t *rsent)
+{
+	return (errno_t) __SYSCALL3(SYS_IPC_CALL_ASYNC_BATCH,
+	    (sysarg_t) calls, (sysarg_t) count, (sysarg_t) rsent);
+}
+
 /** Answer received call (fast version).
  *
  * The fast answer makes use of passing retval and first four arguments in
@@ -176,6 +198,27 @@ errno_t ipc_wait(ipc_call_t *call, sysarg_t usec, unsigned int flags)
 	return __SYSCALL3(SYS_IPC_WAIT, (sysarg_t) call, usec, flags);
 }
 
+/** Wait for several calls or answers.
+ *
+ * Waits for the first call like ipc_wait() does and then receives any other
+ * calls or answers that are already pending, without blocking.
+ *
+ * @param calls  Array where to store the received calls.
+ * @param count  Number of entries in @a calls (at most IPC_BATCH_MAX).
+ * @param rcount Place to store the number of received calls.
+ * @param usec   Timeout for the first call in microseconds.
+ * @param flags  Flags passed to SYS_IPC_WAIT_BATCH.
+ *
+ * @return EOK if at least one call was received or an error code.
+ *
+ */
+errno_t ipc_wait_batch(ipc_call_t *calls, size_t count, size_t *rcount,
+    sysarg_t usec, unsigned int flags)
+{
+	return (errno_t) __SYSCALL5(SYS_IPC_WAIT_BATCH, (sysarg_t) calls,
+	    (sysarg_t) count, usec, flags, (sysarg_t) rcount);
+}
+
 /** Hang up a phone.
  *
  * @param phandle  Handle of the phone to be hung up.
@@ -71,6 +71,8 @@ errno_t ipc_test_create(ipc_test_t **rtest)
 		goto error;
 	}
 
+	test->svcid = test_svcid;
+
 	*rtest = test;
 	return EOK;
 error:
@@ -220,5 +222,68 @@ errno_t ipc_test_share_in_rw(ipc_test_t *test, size_t size, void **rptr)
 	return EOK;
 }
 
+/** Set up ring channel to the IPC test service.
+ *
+ * The channel uses a connection of its own, so @a test remains usable
+ * for regular requests.
+ *
+ * @param test IPC test service
+ * @param nslots Number of ring slots (default if zero)
+ * @param rring Place to store pointer to the ring channel
+ * @return EOK on success or an error code
+ */
+errno_t ipc_test_ring_create(ipc_test_t *test, size_t nslots,
+    async_ring_t **rring)
+{
+	async_sess_t *sess;
+	errno_t rc;
+
+	sess = loc_service_connect(test->svcid, INTERFACE_IPC_TEST, 0);
+	if (sess == NULL)
+		return EIO;
+
+	rc = async_ring_create(sess, IPC_TEST_RING, nslots, rring);
+	if (rc != EOK) {
+		async_hangup(sess);
+		return rc;
+	}
+
+	return EOK;
+}
+
+/** Send a batch of pings through a ring channel.
+ *
+ * @param ring Ring channel created by ipc_test_ring_create()
+ * @param count Number of pings in the batch
+ * @return EOK on success or an error code
+ */
+errno_t ipc_test_ring_ping(async_ring_t *ring, size_t count)
+{
+	async_ring_msg_t msgs[ASYNC_RING_SLOTS];
+	size_t n;
+	size_t i;
+	errno_t rc;
+
+	while (count > 0) {
+		n = count < ASYNC_RING_SLOTS ? count : ASYNC_RING_SLOTS;
+
+		for (i = 0; i < n; i++)
+			msgs[i].imethod = IPC_TEST_PING;
+
+		rc = async_ring_call_batch(ring, msgs, n);
+		if (rc != EOK)
+			return rc;
+
+		for (i = 0; i < n; i++) {
+			if (msgs[i].retval != EOK)
+				return msgs[i].retval;
+		}
+
+		count -= n;
+	}
+
+	return EOK;
+}
+
 /** @}
  */
@@ -34,6 +34,7 @@
  * @brief IP link client stub
  */
 
+#include <align.h>
 #include <async.h>
 #include <assert.h>
 #include <errno.h>
@@ -42,6 +43,7 @@
 #include <ipc/iplink.h>
 #include <ipc/services.h>
 #include <loc.h>
+#include <macros.h>
 #include <stdlib.h>
 
 static void iplink_cb_conn(ipc_call_t *icall, void *arg);
@@ -261,6 +263,52 @@ static void iplink_ev_recv(iplink_t *iplink, ipc_call_t *icall)
 	async_answer_0(icall, rc);
 }
 
+static void iplink_ev_recv_batch(iplink_t *iplink, ipc_call_t *icall)
+{
+	iplink_batch_hdr_t *hdr;
+	iplink_recv_sdu_t sdu;
+	uint8_t *buf;
+	size_t size;
+	size_t offs;
+	size_t count;
+	size_t i;
+
+	count = IPC_GET_ARG1(*icall);
+
+	errno_t rc = async_data_write_accept((void **) &buf, false, 0,
+	    IPLINK_BATCH_MAX_SIZE, 0, &size);
+	if (rc != EOK) {
+		async_answer_0(icall, rc);
+		return;
+	}
+
+	offs = 0;
+	for (i = 0; i < count; i++) {
+		if (size - offs < sizeof(*hdr)) {
+			rc = EINVAL;
+			break;
+		}
+
+		hdr = (iplink_batch_hdr_t *) (buf + offs);
+		if (size - offs - sizeof(*hdr) < hdr->size) {
+			rc = EINVAL;
+			break;
+		}
+
+		sdu.data = &hdr[1];
+		sdu.size = hdr->size;
+
+		/* A bad SDU does not prevent delivery of the rest */
+		(void) iplink->ev_ops->recv(iplink, &sdu, hdr->ver);
+
+		offs += sizeof(*hdr) + hdr->size;
+		offs = min(ALIGN_UP(offs, sizeof(*hdr)), size);
+	}
+
+	free(buf);
+	async_answer_0(icall, rc);
+}
+
 static void iplink_ev_change_addr(iplink_t *iplink, ipc_call_t *icall)
 {
 	addr48_t *addr;
@@ -298,6 +346,9 @@ static void iplink_cb_conn(ipc_call_t *icall, void *arg)
 		case IPLINK_EV_CHANGE_ADDR:
 			iplink_ev_change_addr(iplink, &call);
 			break;
+		case IPLINK_EV_RECV_BATCH:
+			iplink_ev_recv_batch(iplink, &call);
+			break;
 		default:
 			async_answer_0(&call, ENOTSUP);
 		}
@@ -34,8 +34,10 @@
  * @brief IP link server stub
  */
 
+#include <align.h>
 #include <errno.h>
 #include <ipc/iplink.h>
+#include <mem.h>
 #include <stdlib.h>
 #include <stddef.h>
 #include <inet/addr.h>
@@ -219,6 +221,7 @@ void iplink_srv_init(iplink_srv_t *srv)
 	srv->ops = NULL;
 	srv->arg = NULL;
 	srv->client_sess = NULL;
+	srv->batch_unsupported = false;
 }
 
 errno_t iplink_conn(ipc_call_t *icall, void *arg)
@@ -347,5 +350,161 @@ errno_t iplink_ev_change_addr(iplink_srv_t *srv, addr48_t *addr)
 	return EOK;
 }
 
+/** Initialize batch of received SDUs.
+ *
+ * @param batch Batch
+ * @param srv IP link server the SDUs are delivered through
+ */
+void iplink_srv_batch_init(iplink_srv_batch_t *batch, iplink_srv_t *srv)
+{
+	batch->srv = srv;
+	batch->buf = NULL;
+	batch->size = 0;
+	batch->count = 0;
+}
+
+/** Finalize batch of received SDUs.
+ *
+ * Any SDUs not yet flushed are discarded.
+ *
+ * @param batch Batch
+ */
+void iplink_srv_batch_fini(iplink_srv_batch_t *batch)
+{
+	free(batch->buf);
+	batch->buf = NULL;
+	batch->size = 0;
+	batch->count = 0;
+}
+
+/** Deliver batched SDUs one by one.
+ *
+ * Used with clients that do not support IPLINK_EV_RECV_BATCH.
+ */
+static errno_t iplink_srv_batch_unpack(iplink_srv_batch_t *batch)
+{
+	iplink_batch_hdr_t *hdr;
+	iplink_recv_sdu_t sdu;
+	size_t offs = 0;
+	errno_t rc;
+	errno_t retval = EOK;
+
+	while (offs < batch->size) {
+		hdr = (iplink_batch_hdr_t *) (batch->buf + offs);
+		sdu.data = &hdr[1];
+		sdu.size = hdr->size;
+
+		rc = iplink_ev_recv(batch->srv, &sdu, hdr->ver);
+		if (rc != EOK)
+			retval = rc;
+
+		offs += ALIGN_UP(sizeof(*hdr) + hdr->size, sizeof(*hdr));
+	}
+
+	return retval;
+}
+
+/** Deliver all SDUs collected in a batch with a single IPC.
+ *
+ * @param batch Batch
+ * @return EOK on success or an error code
+ */
+errno_t iplink_srv_batch_flush(iplink_srv_batch_t *batch)
+{
+	iplink_srv_t *srv = batch->srv;
+	errno_t rc;
+
+	if (batch->count == 0)
+		return EOK;
+
+	if (srv->client_sess == NULL) {
+		rc = EIO;
+		goto out;
+	}
+
+	if (srv->batch_unsupported) {
+		rc = iplink_srv_batch_unpack(batch);
+		goto out;
+	}
+
+	async_exch_t *exch = async_exchange_begin(srv->client_sess);
+
+	ipc_call_t answer;
+	aid_t req = async_send_1(exch, IPLINK_EV_RECV_BATCH, batch->count,
+	    &answer);
+
+	errno_t rc_write = async_data_write_start(exch, batch->buf,
+	    batch->size);
+	async_exchange_end(exch);
+
+	/*
+	 * An older client refuses the batch without accepting the data,
+	 * so the write fails too. Always wait for the answer to tell this
+	 * apart from other errors.
+	 */
+	async_wait_for(req, &rc);
+	if (rc == EOK)
+		rc = rc_write;
+
+	if (rc == ENOTSUP) {
+		/* Older client, fall back to one IPC per SDU from now on */
+		srv->batch_unsupported = true;
+		rc = iplink_srv_batch_unpack(batch);
+	}
+
+out:
+	batch->size = 0;
+	batch->count = 0;
+	return rc;
+}
+
+/** Add received SDU to a batch.
+ *
+ * The SDU data are copied. The batch is flushed first if the SDU
+ * would not fit. SDUs too large for any batch are delivered directly.
+ *
+ * @param batch Batch
+ * @param sdu Received SDU
+ * @param ver IP version
+ * @return EOK on success or an error code
+ */
+errno_t iplink_srv_batch_add(iplink_srv_batch_t *batch, iplink_recv_sdu_t *sdu,
+    ip_ver_t ver)
+{
+	iplink_batch_hdr_t *hdr;
+	size_t rsize;
+	errno_t rc;
+
+	rsize = ALIGN_UP(sizeof(*hdr) + sdu->size, sizeof(*hdr));
+	if (rsize > IPLINK_BATCH_MAX_SIZE) {
+		rc = iplink_srv_batch_flush(batch);
+		if (rc != EOK)
+			return rc;
+
+		return iplink_ev_recv(batch->srv, sdu, ver);
+	}
+
+	if (batch->size + rsize > IPLINK_BATCH_MAX_SIZE) {
+		rc = iplink_srv_batch_flush(batch);
+		if (rc != EOK)
+			return rc;
+	}
+
+	if (batch->buf == NULL) {
+		batch->buf = malloc(IPLINK_BATCH_MAX_SIZE);
+		if (batch->buf == NULL)
+			return ENOMEM;
+	}
+
+	hdr = (iplink_batch_hdr_t *) (batch->buf + batch->size);
+	hdr->size = sdu->size;
+	hdr->ver = ver;
+	memcpy(&hdr[1], sdu->data, sdu->size);
+
+	batch->size += rsize;
+	batch->count++;
+	return EOK;
+}
+
 /** @}
  */
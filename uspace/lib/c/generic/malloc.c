@@ -76,6 +76,29 @@
  */
 #define SHRINK_GRANULARITY  (64 * PAGE_SIZE)
 
+/** Number of thread caches
+ *
+ * Each fibril runner (thread) is mapped to one of the caches.
+ * Runners mapped to the same cache merely contend on its lock.
+ *
+ */
+#define THREAD_CACHE_ORDER  3
+#define THREAD_CACHE_COUNT  (1 << THREAD_CACHE_ORDER)
+
+/** Number of objects held by a single magazine */
+#define MAGAZINE_ROUNDS  32
+
+/** Maximum number of full magazines kept in the depot per size class
+ *
+ * Objects in excess of this limit are returned back to the heap,
+ * so that the memory can be coalesced and eventually released.
+ *
+ */
+#define DEPOT_FULL_LIMIT  8
+
+/** Maximum number of empty magazines kept in the depot per size class */
+#define DEPOT_EMPTY_LIMIT  8
+
 /** Overhead of each heap block. */
 #define STRUCT_OVERHEAD \
 	(sizeof(heap_block_head_t) + sizeof(heap_block_foot_t))
@@ -166,6 +189,9 @@ typedef struct {
 	/* Indication of a free block */
 	bool free;
 
+	/* Size class + 1 if the block is owned by the thread caches, 0 otherwise */
+	uint8_t size_class;
+
 	/** Heap area this block belongs to */
 	heap_area_t *area;
 
@@ -184,6 +210,79 @@ typedef struct {
 	uint32_t magic;
 } heap_block_foot_t;
 
+/** Net sizes of the size classes served by the thread caches
+ *
+ * Requests larger than the largest size class go directly
+ * to the heap.
+ *
+ */
+static const size_t size_classes[] = {
+	16, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024
+};
+
+#define SIZE_CLASS_COUNT  (sizeof(size_classes) / sizeof(size_classes[0]))
+
+/** Magazine of cached heap blocks of one size class
+ *
+ * Magazines are allocated directly from the heap and they are
+ * never cached themselves.
+ *
+ */
+typedef struct magazine {
+	/** Next magazine in the depot */
+	struct magazine *next;
+
+	/** Number of valid rounds */
+	size_t rounds;
+
+	/** Cached blocks (addresses as returned by malloc()) */
+	void *round[MAGAZINE_ROUNDS];
+} magazine_t;
+
+/** Thread cache of a single size class
+ *
+ * The loaded magazine is used for both allocations and deallocations,
+ * the previous magazine is always either full or empty (or missing).
+ * This avoids thrashing the depot when a thread alternates between
+ * allocating and freeing objects around the magazine boundary.
+ *
+ */
+typedef struct {
+	magazine_t *loaded;
+	magazine_t *previous;
+} cache_class_t;
+
+/** Thread cache
+ *
+ * Each fibril runner is mapped to one thread cache. The lock is
+ * therefore almost never contended and it never causes a syscall.
+ *
+ */
+typedef struct {
+	fibril_rmutex_t lock;
+	cache_class_t classes[SIZE_CLASS_COUNT];
+} thread_cache_t;
+
+/** Central depot of magazines of a single size class */
+typedef struct {
+	/** List of full magazines */
+	magazine_t *full;
+	size_t full_count;
+
+	/** List of empty magazines */
+	magazine_t *empty;
+	size_t empty_count;
+} depot_class_t;
+
+/** Thread caches */
+static thread_cache_t thread_caches[THREAD_CACHE_COUNT];
+
+/** Central depot */
+static depot_class_t depot[SIZE_CLASS_COUNT];
+
+/** Futex for thread-safe depot manipulation */
+static fibril_rmutex_t depot_mutex;
+
 /** First heap area */
 static heap_area_t *first_heap_area = NULL;
 
@@ -486,12 +585,24 @@ void __malloc_init(void)
 	if (fibril_rmutex_initialize(&malloc_mutex) != EOK)
 		abort();
 
+	if (fibril_rmutex_initialize(&depot_mutex) != EOK)
+		abort();
+
+	for (size_t i = 0; i < THREAD_CACHE_COUNT; i++) {
+		if (fibril_rmutex_initialize(&thread_caches[i].lock) != EOK)
+			abort();
+	}
+
 	if (!area_create(PAGE_SIZE))
 		abort();
 }
 
 void __malloc_fini(void)
 {
+	for (size_t i = 0; i < THREAD_CACHE_COUNT; i++)
+		fibril_rmutex_destroy(&thread_caches[i].lock);
+
+	fibril_rmutex_destroy(&depot_mutex);
 	fibril_rmutex_destroy(&malloc_mutex);
 }
 
@@ -520,6 +631,8 @@ static void split_mark(heap_block_head_t *cur, const size_t size)
 		/* Block too small -> use as is. */
 		cur->free = false;
 	}
+
+	cur->size_class = 0;
 }
 
 /** Allocate memory from heap area starting from given block
@@ -763,6 +876,394 @@ static void *malloc_internal(const size_t size, const size_t align)
 	return heap_grow_and_alloc(gross_size, falign);
 }
 
+/** Free a memory block
+ *
+ * Should be called only inside the critical section.
+ *
+ * @param addr The address of the block.
+ *
+ */
+static void free_internal(void *const addr)
+{
+	/* Calculate the position of the header. */
+	heap_block_head_t *head =
+	    (heap_block_head_t *) (addr - sizeof(heap_block_head_t));
+
+	block_check(head);
+	malloc_assert(!head->free);
+
+	heap_area_t *area = head->area;
+
+	area_check(area);
+	malloc_assert((void *) head >= (void *) AREA_FIRST_BLOCK_HEAD(area));
+	malloc_assert((void *) head < area->end);
+
+	/* Mark the block itself as free. */
+	head->free = true;
+
+	/* Look at the next block. If it is free, merge the two. */
+	heap_block_head_t *next_head =
+	    (heap_block_head_t *) (((void *) head) + head->size);
+
+	if ((void *) next_head < area->end) {
+		block_check(next_head);
+		if (next_head->free)
+			block_init(head, head->size + next_head->size, true, area);
+	}
+
+	/* Look at the previous block. If it is free, merge the two. */
+	if ((void *) head > (void *) AREA_FIRST_BLOCK_HEAD(area)) {
+		heap_block_foot_t *prev_foot =
+		    (heap_block_foot_t *) (((void *) head) - sizeof(heap_block_foot_t));
+
+		heap_block_head_t *prev_head =
+		    (heap_block_head_t *) (((void *) head) - prev_foot->size);
+
+		block_check(prev_head);
+
+		if (prev_head->free)
+			block_init(prev_head, prev_head->size + head->size, true,
+			    area);
+	}
+
+	heap_shrink(area);
+}
+
+/** Find the size class serving allocations of the given size
+ *
+ * @param size Number of bytes to allocate.
+ *
+ * @return Index of the size class or SIZE_CLASS_COUNT if the
+ *         allocation is not served by the thread caches.
+ *
+ */
+static size_t size_class_find(const size_t size)
+{
+	for (size_t i = 0; i < SIZE_CLASS_COUNT; i++) {
+		if (size <= size_classes[i])
+			return i;
+	}
+
+	return SIZE_CLASS_COUNT;
+}
+
+/** Lock the thread cache of the current runner
+ *
+ * The cache is selected according to the thread context of the
+ * current fibril, which identifies the runner the fibril is executing
+ * on. Since no fibril switch can occur while a restricted mutex is held,
+ * only runners mapped to the same cache ever contend on it. In that case
+ * the remaining caches are tried instead of blocking.
+ *
+ * @return Locked thread cache or NULL if all caches are busy.
+ *
+ */
+static thread_cache_t *cache_lock(void)
+{
+	fibril_t *self = fibril_self();
+	fibril_t *ctx = (self->thread_ctx != NULL) ? self->thread_ctx : self;
+
+	uint32_t hash = (uint32_t) ((uintptr_t) ctx >> 4) * UINT32_C(2654435761);
+	size_t hint = hash >> (32 - THREAD_CACHE_ORDER);
+
+	for (size_t i = 0; i < THREAD_CACHE_COUNT; i++) {
+		thread_cache_t *cache =
+		    &thread_caches[(hint + i) % THREAD_CACHE_COUNT];
+
+		if (fibril_rmutex_trylock(&cache->lock))
+			return cache;
+	}
+
+	return NULL;
+}
+
+/** Unlock a thread cache
+ *
+ * @param cache Thread cache locked by cache_lock().
+ *
+ */
+static void cache_unlock(thread_cache_t *cache)
+{
+	fibril_rmutex_unlock(&cache->lock);
+}
+
+/** Return all rounds of a magazine back to the heap
+ *
+ * Should be called only inside the critical section
+ * of the depot.
+ *
+ * @param mag Magazine to drain.
+ *
+ */
+static void magazine_drain(magazine_t *mag)
+{
+	heap_lock();
+
+	for (size_t i = 0; i < mag->rounds; i++)
+		free_internal(mag->round[i]);
+
+	heap_unlock();
+
+	mag->rounds = 0;
+}
+
+/** Get a full magazine from the depot
+ *
+ * Should be called only inside the critical section
+ * of the depot.
+ *
+ * @param sc Size class.
+ *
+ * @return Full magazine or NULL if there is none.
+ *
+ */
+static magazine_t *depot_get_full(size_t sc)
+{
+	magazine_t *mag = depot[sc].full;
+	if (mag != NULL) {
+		depot[sc].full = mag->next;
+		depot[sc].full_count--;
+	}
+
+	return mag;
+}
+
+/** Get an empty magazine from the depot
+ *
+ * Should be called only inside the critical section
+ * of the depot. If there are no empty magazines in the
+ * depot, a new magazine is allocated from the heap.
+ *
+ * @param sc Size class.
+ *
+ * @return Empty magazine or NULL on not enough memory.
+ *
+ */
+static magazine_t *depot_get_empty(size_t sc)
+{
+	magazine_t *mag = depot[sc].empty;
+	if (mag != NULL) {
+		depot[sc].empty = mag->next;
+		depot[sc].empty_count--;
+		return mag;
+	}
+
+	heap_lock();
+	mag = malloc_internal(sizeof(magazine_t), BASE_ALIGN);
+	heap_unlock();
+
+	if (mag != NULL)
+		mag->rounds = 0;
+
+	return mag;
+}
+
+/** Return an empty magazine to the depot
+ *
+ * Should be called only inside the critical section
+ * of the depot. Magazines in excess of DEPOT_EMPTY_LIMIT
+ * are freed.
+ *
+ * @param sc  Size class.
+ * @param mag Empty magazine.
+ *
+ */
+static void depot_put_empty(size_t sc, magazine_t *mag)
+{
+	malloc_assert(mag->rounds == 0);
+
+	if (depot[sc].empty_count >= DEPOT_EMPTY_LIMIT) {
+		heap_lock();
+		free_internal(mag);
+		heap_unlock();
+		return;
+	}
+
+	mag->next = depot[sc].empty;
+	depot[sc].empty = mag;
+	depot[sc].empty_count++;
+}
+
+/** Return a full magazine to the depot
+ *
+ * Should be called only inside the critical section
+ * of the depot. Magazines in excess of DEPOT_FULL_LIMIT
+ * are drained back to the heap.
+ *
+ * @param sc  Size class.
+ * @param mag Full magazine.
+ *
+ */
+static void depot_put_full(size_t sc, magazine_t *mag)
+{
+	if (depot[sc].full_count >= DEPOT_FULL_LIMIT) {
+		magazine_drain(mag);
+		depot_put_empty(sc, mag);
+		return;
+	}
+
+	mag->next = depot[sc].full;
+	depot[sc].full = mag;
+	depot[sc].full_count++;
+}
+
+/** Fill a magazine directly from the heap
+ *
+ * Only half of the magazine is filled so that a subsequent
+ * burst of deallocations does not immediately overflow it.
+ *
+ * @param sc  Size class.
+ * @param mag Empty magazine.
+ *
+ */
+static void magazine_fill(size_t sc, magazine_t *mag)
+{
+	heap_lock();
+
+	while (mag->rounds < MAGAZINE_ROUNDS / 2) {
+		void *addr = malloc_internal(size_classes[sc], BASE_ALIGN);
+		if (addr == NULL)
+			break;
+
+		heap_block_head_t *head =
+		    (heap_block_head_t *) (addr - sizeof(heap_block_head_t));
+		head->size_class = sc + 1;
+
+		mag->round[mag->rounds++] = addr;
+	}
+
+	heap_unlock();
+}
+
+/** Allocate a memory block from the thread cache
+ *
+ * @param size The size of the block to allocate.
+ *
+ * @return Address of the allocated block or NULL if the
+ *         allocation has to be served directly by the heap.
+ *
+ */
+static void *cache_alloc(const size_t size)
+{
+	size_t sc = size_class_find(size);
+	if (sc == SIZE_CLASS_COUNT)
+		return NULL;
+
+	thread_cache_t *cache = cache_lock();
+	if (cache == NULL)
+		return NULL;
+
+	cache_class_t *cc = &cache->classes[sc];
+
+	if ((cc->loaded == NULL) || (cc->loaded->rounds == 0)) {
+		if ((cc->previous != NULL) && (cc->previous->rounds > 0)) {
+			/* The previous magazine is full, swap. */
+			magazine_t *tmp = cc->loaded;
+			cc->loaded = cc->previous;
+			cc->previous = tmp;
+		} else {
+			fibril_rmutex_lock(&depot_mutex);
+
+			magazine_t *full = depot_get_full(sc);
+			if (full != NULL) {
+				if (cc->loaded == NULL) {
+					cc->loaded = full;
+				} else {
+					if (cc->previous != NULL)
+						depot_put_empty(sc, cc->previous);
+
+					cc->previous = cc->loaded;
+					cc->loaded = full;
+				}
+			} else if (cc->loaded == NULL) {
+				cc->loaded = depot_get_empty(sc);
+			}
+
+			fibril_rmutex_unlock(&depot_mutex);
+
+			/* No full magazine in the depot, go to the heap. */
+			if ((full == NULL) && (cc->loaded != NULL))
+				magazine_fill(sc, cc->loaded);
+		}
+	}
+
+	void *addr = NULL;
+	if ((cc->loaded != NULL) && (cc->loaded->rounds > 0))
+		addr = cc->loaded->round[--cc->loaded->rounds];
+
+	cache_unlock(cache);
+	return addr;
+}
+
+/** Return a memory block to the thread cache
+ *
+ * @param addr The address of the block.
+ *
+ * @return True if the block has been cached, false if it
+ *         has to be returned directly to the heap.
+ *
+ */
+static bool cache_free(void *const addr)
+{
+	heap_block_head_t *head =
+	    (heap_block_head_t *) (addr - sizeof(heap_block_head_t));
+
+	/*
+	 * The header of an allocated block is owned by the caller,
+	 * thus it is safe to inspect without holding the heap lock.
+	 */
+	malloc_assert(head->magic == HEAP_BLOCK_HEAD_MAGIC);
+	malloc_assert(!head->free);
+
+	if (head->size_class == 0)
+		return false;
+
+	size_t sc = head->size_class - 1;
+	malloc_assert(sc < SIZE_CLASS_COUNT);
+
+	thread_cache_t *cache = cache_lock();
+	if (cache == NULL)
+		return false;
+
+	cache_class_t *cc = &cache->classes[sc];
+
+	if ((cc->loaded == NULL) || (cc->loaded->rounds == MAGAZINE_ROUNDS)) {
+		if ((cc->previous != NULL) && (cc->previous->rounds == 0)) {
+			/* The previous magazine is empty, swap. */
+			magazine_t *tmp = cc->loaded;
+			cc->loaded = cc->previous;
+			cc->previous = tmp;
+		} else {
+			fibril_rmutex_lock(&depot_mutex);
+
+			magazine_t *empty = depot_get_empty(sc);
+			if (empty != NULL) {
+				if (cc->loaded == NULL) {
+					cc->loaded = empty;
+				} else {
+					if (cc->previous != NULL)
+						depot_put_full(sc, cc->previous);
+
+					cc->previous = cc->loaded;
+					cc->loaded = empty;
+				}
+			}
+
+			fibril_rmutex_unlock(&depot_mutex);
+
+			if (empty == NULL) {
+				cache_unlock(cache);
+				return false;
+			}
+		}
+	}
+
+	cc->loaded->round[cc->loaded->rounds++] = addr;
+
+	cache_unlock(cache);
+	return true;
+}
+
 /** Allocate memory by number of elements
  *
  * @param nmemb Number of members to allocate.
@@ -792,8 +1293,12 @@ void *calloc(const size_t nmemb, const size_t size)
  */
 void *malloc(const size_t size)
 {
+	void *block = cache_alloc(size);
+	if (block != NULL)
+		return block;
+
 	heap_lock();
-	void *block = malloc_internal(size, BASE_ALIGN);
+	block = malloc_internal(size, BASE_ALIGN);
 	heap_unlock();
 
 	return block;
@@ -849,6 +1354,12 @@ void *realloc(void *const addr, const size_t size)
 	block_check(head);
 	malloc_assert(!head->free);
 
+	/*
+	 * The block is going to be resized in place, thus it can
+	 * no longer be returned to the thread caches.
+	 */
+	head->size_class = 0;
+
 	heap_area_t *area = head->area;
 
 	area_check(area);
@@ -949,51 +1460,11 @@ void free(void *const addr)
 	if (addr == NULL)
 		return;
 
-	heap_lock();
-
-	/* Calculate the position of the header. */
-	heap_block_head_t *head =
-	    (heap_block_head_t *) (addr - sizeof(heap_block_head_t));
-
-	block_check(head);
-	malloc_assert(!head->free);
-
-	heap_area_t *area = head->area;
-
-	area_check(area);
-	malloc_assert((void *) head >= (void *) AREA_FIRST_BLOCK_HEAD(area));
-	malloc_assert((void *) head < area->end);
-
-	/* Mark the block itself as free. */
-	head->free = true;
-
-	/* Look at the next block. If it is free, merge the two. */
-	heap_block_head_t *next_head =
-	    (heap_block_head_t *) (((void *) head) + head->size);
-
-	if ((void *) next_head < area->end) {
-		block_check(next_head);
-		if (next_head->free)
-			block_init(head, head->size + next_head->size, true, area);
-	}
-
-	/* Look at the previous block. If it is free, merge the two. */
-	if ((void *) head > (void *) AREA_FIRST_BLOCK_HEAD(area)) {
-		heap_block_foot_t *prev_foot =
-		    (heap_block_foot_t *) (((void *) head) - sizeof(heap_block_foot_t));
-
-		heap_block_head_t *prev_head =
-		    (heap_block_head_t *) (((void *) head) - prev_foot->size);
-
-		block_check(prev_head);
-
-		if (prev_head->free)
-			block_init(prev_head, prev_head->size + head->size, true,
-			    area);
-	}
-
-	heap_shrink(area);
+	if (cache_free(addr))
+		return;
 
+	heap_lock();
+	free_internal(addr);
 	heap_unlock();
 }
 
@@ -61,6 +61,13 @@ struct fibril {
 
 	fibril_t *thread_ctx;
 
+	/*
+	 * One plus the index of the ready queue of the runner thread that
+	 * last ran the fibril, zero if none. For helper fibrils, this
+	 * identifies the queue of their own thread.
+	 */
+	int runner;
+
 	bool is_running : 1;
 	bool is_writer : 1;
 	/* In some places, we use fibril structs that can't be freed. */
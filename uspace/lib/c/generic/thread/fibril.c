@@ -74,8 +74,27 @@ typedef struct {
 	errno_t rc;
 	link_t link;
 	ipc_call_t call;
+	/** Buffer holds an extra call of a batch and is not backed by a token */
+	bool staged;
 } _ipc_buffer_t;
 
+/** Maximum number of calls received by a thread in one IPC wait. */
+#define IPC_WAIT_BATCH  16
+
+/** Number of areas for receiving batches of calls. */
+#define IPC_BATCH_AREAS  4
+
+/** Number of staging buffers for the extra calls of batches. */
+#define IPC_STAGE_COUNT  (IPC_BATCH_AREAS * IPC_WAIT_BATCH * 4)
+
+/** Area for receiving a batch of calls. */
+typedef struct {
+	link_t link;
+	ipc_call_t calls[IPC_WAIT_BATCH];
+	/** Staging buffers reserved for the extra calls of the batch */
+	list_t stage;
+} _ipc_batch_t;
+
 typedef enum {
 	SWITCH_FROM_DEAD,
 	SWITCH_FROM_HELPER,
@@ -83,6 +102,28 @@ typedef enum {
 	SWITCH_FROM_BLOCKED,
 } _switch_type_t;
 
+/*
+ * Number of ready queues. Each runner thread is assigned one of the queues
+ * upon creation; with more runners than queues, some runners share a queue.
+ */
+#define READY_QUEUES  16
+
+/*
+ * Ready fibrils are kept in per-runner queues. A fibril is made ready in the
+ * queue of the runner that last ran it (or of the runner that readied it,
+ * if it has never run), so that it tends to stay on the same thread. An idle
+ * runner takes fibrils from its own queue first and steals from the other
+ * queues when its own queue is empty.
+ *
+ * The queues are protected by fibril_futex. Pushing a fibril and taking its
+ * token from the ready semaphore must be atomic with respect to scanning
+ * the queues, or the scan could miss the fibril and mistake its token for
+ * a free IPC buffer.
+ */
+typedef struct {
+	list_t list;
+} _ready_queue_t;
+
 static bool multithreaded = false;
 
 /* This futex serializes access to global data. */
@@ -90,7 +131,9 @@ static futex_t fibril_futex;
 static futex_t ready_semaphore;
 static long ready_st_count;
 
-static LIST_INITIALIZE(ready_list);
+static _ready_queue_t ready_queues[READY_QUEUES];
+static atomic_uint runner_next;
+
 static LIST_INITIALIZE(fibril_list);
 static LIST_INITIALIZE(timeout_list);
 
@@ -98,6 +141,10 @@ static futex_t ipc_lists_futex;
 static LIST_INITIALIZE(ipc_waiter_list);
 static LIST_INITIALIZE(ipc_buffer_list);
 static LIST_INITIALIZE(ipc_buffer_free_list);
+static LIST_INITIALIZE(ipc_stage_free_list);
+static LIST_INITIALIZE(ipc_batch_free_list);
+static _ipc_batch_t ipc_batches[IPC_BATCH_AREAS];
+static _ipc_buffer_t ipc_stage[IPC_STAGE_COUNT];
 
 /* Only used as unique markers for triggered events. */
 static fibril_t _fibril_event_triggered;
@@ -110,8 +157,9 @@ static inline void _ready_debug_check(void)
 {
 #ifdef READY_DEBUG
 	assert(!multithreaded);
-	long count = (long) list_count(&ready_list) +
-	    (long) list_count(&ipc_buffer_free_list);
+	long count = (long) list_count(&ipc_buffer_free_list);
+	for (int i = 0; i < READY_QUEUES; i++)
+		count += (long) list_count(&ready_queues[i].list);
 	assert(ready_st_count == count);
 #endif
 }
@@ -138,6 +186,49 @@ static inline errno_t _ready_down(const struct timespec *expires)
 
 static atomic_int threads_in_ipc_wait;
 
+/* Assigns a ready queue to the runner whose helper fibril is `ctx`. */
+static void _runner_assign(fibril_t *ctx)
+{
+	if (ctx->runner == 0)
+		ctx->runner = 1 + atomic_fetch_add_explicit(&runner_next, 1,
+		    memory_order_relaxed) % READY_QUEUES;
+}
+
+/* Returns the index of the ready queue of the current runner. */
+static int _runner_current(void)
+{
+	fibril_t *ctx = fibril_self()->thread_ctx;
+	if (ctx && ctx->runner)
+		return ctx->runner - 1;
+
+	return 0;
+}
+
+/*
+ * Takes a ready fibril, preferably from the queue of the current runner.
+ * If that queue is empty, tries to steal the oldest fibril from one
+ * of the other queues.
+ *
+ * Must be called with fibril_futex held.
+ */
+static fibril_t *_ready_queues_pop(void)
+{
+	futex_assert_is_locked(&fibril_futex);
+
+	int own = _runner_current();
+
+	for (int i = 0; i < READY_QUEUES; i++) {
+		_ready_queue_t *q = &ready_queues[(own + i) % READY_QUEUES];
+		fibril_t *f = list_pop(&q->list, fibril_t, link);
+		if (f)
+			return f;
+	}
+
+	return NULL;
+}
+
+static void _ready_list_push(fibril_t *);
+
 /** Function that spans the whole life-cycle of a fibril.
  *
  * Each fibril begins execution in this function. Then the function implementing
@@ -237,22 +328,126 @@ static fibril_t *_fibril_trigger_internal(fibril_event_t *event, fibril_t *reaso
 	return f;
 }
 
-static errno_t _ipc_wait(ipc_call_t *call, const struct timespec *expires)
+static errno_t _ipc_wait_common(ipc_call_t *calls, size_t count,
+    size_t *rcount, sysarg_t usec, unsigned int flags)
+{
+	if (count == 1) {
+		*rcount = 1;
+		return ipc_wait(calls, usec, flags);
+	}
+
+	return ipc_wait_batch(calls, count, rcount, usec, flags);
+}
+
+/*
+ * Waits for up to `count` calls. On success, `*rcount` is set to the number
+ * of received calls, which is at least one.
+ */
+static errno_t _ipc_wait(ipc_call_t *calls, size_t count, size_t *rcount,
+    const struct timespec *expires)
 {
 	if (!expires)
-		return ipc_wait(call, SYNCH_NO_TIMEOUT, SYNCH_FLAGS_NONE);
+		return _ipc_wait_common(calls, count, rcount, SYNCH_NO_TIMEOUT,
+		    SYNCH_FLAGS_NONE);
 
 	if (expires->tv_sec == 0)
-		return ipc_wait(call, SYNCH_NO_TIMEOUT, SYNCH_FLAGS_NON_BLOCKING);
+		return _ipc_wait_common(calls, count, rcount, SYNCH_NO_TIMEOUT,
+		    SYNCH_FLAGS_NON_BLOCKING);
 
 	struct timespec now;
 	getuptime(&now);
 
 	if (ts_gteq(&now, expires))
-		return ipc_wait(call, SYNCH_NO_TIMEOUT, SYNCH_FLAGS_NON_BLOCKING);
+		return _ipc_wait_common(calls, count, rcount, SYNCH_NO_TIMEOUT,
+		    SYNCH_FLAGS_NON_BLOCKING);
+
+	return _ipc_wait_common(calls, count, rcount,
+	    NSEC2USEC(ts_sub_diff(expires, &now)), SYNCH_FLAGS_NONE);
+}
+
+/*
+ * Reserves a batch area together with staging buffers for the extra calls.
+ * Returns NULL if no batch area is available, in which case only a single
+ * call may be received.
+ */
+static _ipc_batch_t *_ipc_batch_reserve(void)
+{
+	futex_lock(&ipc_lists_futex);
+
+	_ipc_batch_t *batch = list_pop(&ipc_batch_free_list, _ipc_batch_t, link);
+	if (batch) {
+		list_initialize(&batch->stage);
+
+		for (int i = 1; i < IPC_WAIT_BATCH; i++) {
+			_ipc_buffer_t *buf = list_pop(&ipc_stage_free_list,
+			    _ipc_buffer_t, link);
+			if (!buf)
+				break;
+			list_append(&buf->link, &batch->stage);
+		}
+	}
 
-	return ipc_wait(call, NSEC2USEC(ts_sub_diff(expires, &now)),
-	    SYNCH_FLAGS_NONE);
+	futex_unlock(&ipc_lists_futex);
+	return batch;
+}
+
+/*
+ * Hands the extra calls of a batch over to waiting fibrils or queues them
+ * in staging buffers, then releases the batch area.
+ * Must be called with both fibril_futex and ipc_lists_futex held.
+ */
+static void _ipc_batch_dispatch(_ipc_batch_t *batch, size_t count)
+{
+	futex_assert_is_locked(&fibril_futex);
+
+	for (size_t i = 1; i < count; i++) {
+		_ipc_waiter_t *w = list_pop(&ipc_waiter_list, _ipc_waiter_t, link);
+		if (w) {
+			*w->call = batch->calls[i];
+			w->rc = EOK;
+			_ready_list_push(_fibril_trigger_internal(&w->event,
+			    _EVENT_TRIGGERED));
+		} else {
+			_ipc_buffer_t *buf = list_pop(&batch->stage,
+			    _ipc_buffer_t, link);
+			assert(buf);
+			*buf = (_ipc_buffer_t) {
+				.call = batch->calls[i],
+				.rc = EOK,
+				.staged = true
+			};
+			list_append(&buf->link, &ipc_buffer_list);
+		}
+	}
+
+	/* Return unused staging buffers. */
+	list_concat(&ipc_stage_free_list, &batch->stage);
+	list_append(&batch->link, &ipc_batch_free_list);
+}
+
+static void _ipc_batch_release(_ipc_batch_t *batch)
+{
+	futex_lock(&ipc_lists_futex);
+	list_concat(&ipc_stage_free_list, &batch->stage);
+	list_append(&batch->link, &ipc_batch_free_list);
+	futex_unlock(&ipc_lists_futex);
+}
+
+/* Checks that only staging buffers can be queued at the time of IPC wait. */
+static inline bool _ipc_buffers_staged_only(void)
+{
+	futex_lock(&ipc_lists_futex);
+
+	bool staged_only = true;
+	list_foreach(ipc_buffer_list, link, _ipc_buffer_t, buf) {
+		if (!buf->staged) {
+			staged_only = false;
+			break;
+		}
+	}
+
+	futex_unlock(&ipc_lists_futex);
+	return staged_only;
 }
 
 /*
@@ -282,34 +477,66 @@ static fibril_t *_ready_list_pop(const struct timespec *expires, bool locked)
 	 * for each entry of the call buffer.
 	 */
 
+	/*
+	 * Announce a possible IPC wait before looking at the ready queues.
+	 * A fibril made ready after we have looked at its queue is then
+	 * guaranteed to see the announcement and poke us out of the wait.
+	 */
+	atomic_fetch_add(&threads_in_ipc_wait, 1);
+
 	if (!locked)
 		futex_lock(&fibril_futex);
-	fibril_t *f = list_pop(&ready_list, fibril_t, link);
-	if (!f)
-		atomic_fetch_add_explicit(&threads_in_ipc_wait, 1,
-		    memory_order_relaxed);
+
+	fibril_t *f = _ready_queues_pop();
+
 	if (!locked)
 		futex_unlock(&fibril_futex);
 
-	if (f)
+	if (f) {
+		atomic_fetch_sub_explicit(&threads_in_ipc_wait, 1,
+		    memory_order_relaxed);
 		return f;
+	}
 
 	if (!multithreaded)
-		assert(list_empty(&ipc_buffer_list));
+		assert(_ipc_buffers_staged_only());
 
-	/* No fibril is ready, IPC wait it is. */
+	/*
+	 * No fibril is ready, IPC wait it is. If we manage to reserve a batch
+	 * area, we pick up all calls that are already pending, up to the
+	 * number of staging buffers we have reserved for them.
+	 */
+	_ipc_batch_t *batch = _ipc_batch_reserve();
 	ipc_call_t call = { 0 };
-	rc = _ipc_wait(&call, expires);
+	ipc_call_t *calls = &call;
+	size_t limit = 1;
+	size_t count = 1;
+
+	if (batch) {
+		calls = batch->calls;
+		memset(&calls[0], 0, sizeof(calls[0]));
+		limit += list_count(&batch->stage);
+	}
+
+	rc = _ipc_wait(calls, limit, &count, expires);
 
 	atomic_fetch_sub_explicit(&threads_in_ipc_wait, 1,
 	    memory_order_relaxed);
 
 	if (rc != EOK && rc != ENOENT) {
+		if (batch)
+			_ipc_batch_release(batch);
 		/* Return token. */
 		_ready_up();
 		return NULL;
 	}
 
+	if (rc != EOK)
+		count = 1;
+
+	if (batch)
+		call = calls[0];
+
 	/*
 	 * We might get ENOENT due to a poke.
 	 * In that case, we propagate the null call out of fibril_ipc_wait(),
@@ -345,6 +572,9 @@ static fibril_t *_ready_list_pop(const struct timespec *expires, bool locked)
 		list_append(&buf->link, &ipc_buffer_list);
 	}
 
+	if (batch)
+		_ipc_batch_dispatch(batch, count);
+
 	futex_unlock(&ipc_lists_futex);
 
 	if (!locked)
@@ -366,11 +596,15 @@ static void _ready_list_push(fibril_t *f)
 
 	futex_assert_is_locked(&fibril_futex);
 
-	/* Enqueue in ready_list. */
-	list_append(&f->link, &ready_list);
+	/* Enqueue in the ready queue of the runner that last ran the fibril. */
+	_ready_queue_t *q = &ready_queues[f->runner ? f->runner - 1 :
+	    _runner_current()];
+
+	list_append(&f->link, &q->list);
+
 	_ready_up();
 
-	if (atomic_load_explicit(&threads_in_ipc_wait, memory_order_relaxed)) {
+	if (atomic_load(&threads_in_ipc_wait)) {
 		DPRINTF("Poking.\n");
 		/* Wakeup one thread sleeping in SYS_IPC_WAIT. */
 		ipc_poke();
@@ -388,10 +622,14 @@ static errno_t _wait_ipc(ipc_call_t *call, const struct timespec *expires)
 		*call = buf->call;
 		errno_t rc = buf->rc;
 
-		/* Return to freelist. */
-		list_append(&buf->link, &ipc_buffer_free_list);
-		/* Return IPC wait token. */
-		_ready_up();
+		if (buf->staged) {
+			list_append(&buf->link, &ipc_stage_free_list);
+		} else {
+			/* Return to freelist. */
+			list_append(&buf->link, &ipc_buffer_free_list);
+			/* Return IPC wait token. */
+			_ready_up();
+		}
 
 		futex_unlock(&ipc_lists_futex);
 		return rc;
@@ -486,6 +724,8 @@ static void _fibril_switch_to(_switch_type_t type, fibril_t *dstf, bool locked)
 	}
 
 	dstf->thread_ctx = srcf->thread_ctx;
+	if (dstf->thread_ctx)
+		dstf->runner = dstf->thread_ctx->runner;
 	srcf->thread_ctx = NULL;
 
 	/* Just some bookkeeping to allow better debugging of futex locks. */
@@ -517,6 +757,7 @@ static errno_t _helper_fibril_fn(void *arg)
 {
 	/* Set itself as the thread's own context. */
 	fibril_self()->thread_ctx = fibril_self();
+	_runner_assign(fibril_self());
 
 	(void) arg;
 
@@ -631,6 +872,7 @@ errno_t fibril_wait_timeout(fibril_event_t *event,
 		    fibril_create_generic(_helper_fibril_fn, NULL, PAGE_SIZE);
 		if (!fibril_self()->thread_ctx)
 			return ENOMEM;
+		_runner_assign(fibril_self()->thread_ctx);
 	}
 
 	futex_lock(&fibril_futex);
@@ -866,6 +1108,9 @@ void __fibrils_init(void)
 	if (futex_initialize(&ipc_lists_futex, 1) != EOK)
 		abort();
 
+	for (int i = 0; i < READY_QUEUES; i++)
+		list_initialize(&ready_queues[i].list);
+
 	/*
 	 * We allow a fixed, small amount of parallelism for IPC reads, but
 	 * since IPC is currently serialized in kernel, there's not much
@@ -879,6 +1124,18 @@ void __fibrils_init(void)
 		list_append(&buffers[i].link, &ipc_buffer_free_list);
 		_ready_up();
 	}
+
+	/*
+	 * Extra calls received in batches are held in staging buffers, which
+	 * are not accounted for in the ready semaphore. The number of batch
+	 * areas limits how many threads can receive batches at once.
+	 */
+
+	for (int i = 0; i < IPC_BATCH_AREAS; i++)
+		list_append(&ipc_batches[i].link, &ipc_batch_free_list);
+
+	for (int i = 0; i < IPC_STAGE_COUNT; i++)
+		list_append(&ipc_stage[i].link, &ipc_stage_free_list);
 }
 
 void __fibrils_fini(void)
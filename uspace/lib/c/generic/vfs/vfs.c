@@ -883,8 +883,8 @@ errno_t vfs_read_short(int file, aoff64_t pos, void *buf, size_t nbyte,
 	ipc_call_t answer;
 	aid_t req;
 
-	if (nbyte > DATA_XFER_LIMIT)
-		nbyte = DATA_XFER_LIMIT;
+	if (nbyte > DATA_XFER_BULK_LIMIT)
+		nbyte = DATA_XFER_BULK_LIMIT;
 
 	async_exch_t *exch = vfs_exchange_begin();
 
@@ -1347,8 +1347,8 @@ errno_t vfs_write_short(int file, aoff64_t pos, const void *buf, size_t nbyte,
 	ipc_call_t answer;
 	aid_t req;
 
-	if (nbyte > DATA_XFER_LIMIT)
-		nbyte = DATA_XFER_LIMIT;
+	if (nbyte > DATA_XFER_BULK_LIMIT)
+		nbyte = DATA_XFER_BULK_LIMIT;
 
 	async_exch_t *exch = vfs_exchange_begin();
 
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2026 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup libc
+ * @{
+ */
+/** @file Shared-memory ring channel
+ */
+
+#ifndef LIBC_ASYNC_RING_H_
+#define LIBC_ASYNC_RING_H_
+
+#include <async.h>
+#include <errno.h>
+#include <stddef.h>
+#include <types/common.h>
+
+/** Number of arguments carried by a ring message. */
+#define ASYNC_RING_MSG_ARGS  4
+
+/** Default number of slots in a ring channel. */
+#define ASYNC_RING_SLOTS  64
+
+/** Ring channel message.
+ *
+ * The client fills in @c imethod and @c arg. The server handler replaces
+ * the message with the reply by setting @c retval and, optionally,
+ * overwriting @c arg.
+ */
+typedef struct {
+	sysarg_t imethod;
+	errno_t retval;
+	sysarg_t arg[ASYNC_RING_MSG_ARGS];
+} async_ring_msg_t;
+
+/** Server-side ring message handler. */
+typedef void (*async_ring_handler_t)(async_ring_msg_t *, void *);
+
+struct async_ring;
+typedef struct async_ring async_ring_t;
+
+extern errno_t async_ring_create(async_sess_t *, sysarg_t, size_t,
+    async_ring_t **);
+extern void async_ring_destroy(async_ring_t *);
+extern errno_t async_ring_call(async_ring_t *, async_ring_msg_t *);
+extern errno_t async_ring_call_batch(async_ring_t *, async_ring_msg_t *,
+    size_t);
+
+extern errno_t async_ring_serve(ipc_call_t *, async_ring_handler_t, void *);
+
+#endif
+
+/** @}
+ */
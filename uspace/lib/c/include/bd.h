@@ -36,14 +36,44 @@
 #define LIBC_BD_H_
 
 #include <async.h>
+#include <fibril_synch.h>
 #include <offset.h>
+#include <stdbool.h>
+
+/** Maximum number of slots in request queue */
+#define BD_QUEUE_MAX_DEPTH 64
+
+/** Request queue slot */
+typedef struct {
+	/** Slot is in use */
+	bool busy;
+	/** Request has completed */
+	bool done;
+	/** Completion status */
+	errno_t rc;
+} bd_qslot_t;
 
 typedef struct {
 	async_sess_t *sess;
+	/** Buffer shared with server for queued requests or @c NULL */
+	void *qbuf;
+	/** Number of queue slots */
+	size_t qdepth;
+	/** Size of data buffer of one slot */
+	size_t qslot_size;
+	/** Block size */
+	size_t qbsize;
+	/** Queue slots */
+	bd_qslot_t *qslots;
+	/** Synchronizes access to queue slots */
+	fibril_mutex_t qlock;
+	/** Signalled when request completes */
+	fibril_condvar_t qcv;
 } bd_t;
 
 extern errno_t bd_open(async_sess_t *, bd_t **);
 extern void bd_close(bd_t *);
+extern errno_t bd_queue_init(bd_t *, size_t, size_t);
 extern errno_t bd_read_blocks(bd_t *, aoff64_t, size_t, void *, size_t);
 extern errno_t bd_read_toc(bd_t *, uint8_t, void *, size_t);
 extern errno_t bd_write_blocks(bd_t *, aoff64_t, size_t, const void *, size_t);
@@ -47,6 +47,8 @@ typedef struct bd_ops bd_ops_t;
 typedef struct {
 	bd_ops_t *ops;
 	void *sarg;
+	/** Number of queued requests that may be processed concurrently */
+	size_t queue_depth;
 } bd_srvs_t;
 
 /** Server structure (per client session) */
@@ -54,6 +56,22 @@ typedef struct {
 	bd_srvs_t *srvs;
 	async_sess_t *client_sess;
 	void *carg;
+	/** Buffer shared with the client for queued requests */
+	void *qbuf;
+	/** Size of shared buffer */
+	size_t qsize;
+	/** Block size */
+	size_t qbsize;
+	/** Synchronizes access to request queue */
+	fibril_mutex_t qlock;
+	/** Signalled when request is queued or worker exits */
+	fibril_condvar_t qcv;
+	/** Queued requests */
+	list_t qreqs;
+	/** Number of running worker fibrils */
+	size_t qworkers;
+	/** Connection is being closed */
+	bool qclosing;
 } bd_srv_t;
 
 struct bd_ops {
@@ -49,8 +49,21 @@ typedef struct {
 	struct iplink_ops *ops;
 	void *arg;
 	async_sess_t *client_sess;
+	/** Client does not understand IPLINK_EV_RECV_BATCH */
+	bool batch_unsupported;
 } iplink_srv_t;
 
+/** Batch of received SDUs to be delivered with a single IPC */
+typedef struct {
+	iplink_srv_t *srv;
+	/** Buffer (allocated on first use) */
+	uint8_t *buf;
+	/** Number of used bytes in @c buf */
+	size_t size;
+	/** Number of SDUs in @c buf */
+	size_t count;
+} iplink_srv_batch_t;
+
 typedef struct iplink_ops {
 	errno_t (*open)(iplink_srv_t *);
 	errno_t (*close)(iplink_srv_t *);
@@ -69,6 +82,12 @@ extern errno_t iplink_conn(ipc_call_t *, void *);
 extern errno_t iplink_ev_recv(iplink_srv_t *, iplink_recv_sdu_t *, ip_ver_t);
 extern errno_t iplink_ev_change_addr(iplink_srv_t *, addr48_t *);
 
+extern void iplink_srv_batch_init(iplink_srv_batch_t *, iplink_srv_t *);
+extern void iplink_srv_batch_fini(iplink_srv_batch_t *);
+extern errno_t iplink_srv_batch_add(iplink_srv_batch_t *, iplink_recv_sdu_t *,
+    ip_ver_t);
+extern errno_t iplink_srv_batch_flush(iplink_srv_batch_t *);
+
 #endif
 
 /** @}
@@ -43,9 +43,16 @@ typedef enum {
 	BD_READ_BLOCKS,
 	BD_SYNC_CACHE,
 	BD_WRITE_BLOCKS,
-	BD_READ_TOC
+	BD_READ_TOC,
+	BD_QUEUE_CREATE,
+	BD_QUEUE_READ,
+	BD_QUEUE_WRITE
 } bd_request_t;
 
+typedef enum {
+	BD_EV_COMPLETE = IPC_FIRST_USER_METHOD
+} bd_event_t;
+
 #endif
 
 /** @}
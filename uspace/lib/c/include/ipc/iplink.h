@@ -36,6 +36,7 @@
 #define LIBC_IPC_IPLINK_H_
 
 #include <ipc/common.h>
+#include <stdint.h>
 
 typedef enum {
 	IPLINK_GET_MTU = IPC_FIRST_USER_METHOD,
@@ -50,8 +51,24 @@ typedef enum {
 typedef enum {
 	IPLINK_EV_RECV = IPC_FIRST_USER_METHOD,
 	IPLINK_EV_CHANGE_ADDR,
+	IPLINK_EV_RECV_BATCH
 } iplink_event_t;
 
+/** Maximum size of an IPLINK_EV_RECV_BATCH buffer */
+#define IPLINK_BATCH_MAX_SIZE  DATA_XFER_LIMIT
+
+/** Header of an SDU in an IPLINK_EV_RECV_BATCH buffer.
+ *
+ * SDU data follow the header. The next header starts at the nearest
+ * offset aligned to the size of the header.
+ */
+typedef struct {
+	/** Size of SDU data */
+	uint32_t size;
+	/** IP version (ip_ver_t) */
+	uint32_t ver;
+} iplink_batch_hdr_t;
+
 #endif
 
 /**
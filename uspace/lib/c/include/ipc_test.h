@@ -36,10 +36,13 @@
 #define LIBC_IPC_TEST_H_
 
 #include <async.h>
+#include <async_ring.h>
 #include <errno.h>
+#include <ipc/loc.h>
 
 typedef struct {
 	async_sess_t *sess;
+	service_id_t svcid;
 } ipc_test_t;
 
 extern errno_t ipc_test_create(ipc_test_t **);
@@ -49,6 +52,8 @@ extern errno_t ipc_test_get_ro_area_size(ipc_test_t *, size_t *);
 extern errno_t ipc_test_get_rw_area_size(ipc_test_t *, size_t *);
 extern errno_t ipc_test_share_in_ro(ipc_test_t *, size_t, const void **);
 extern errno_t ipc_test_share_in_rw(ipc_test_t *, size_t, void **);
+extern errno_t ipc_test_ring_create(ipc_test_t *, size_t, async_ring_t **);
+extern errno_t ipc_test_ring_ping(async_ring_t *, size_t);
 
 #endif
 
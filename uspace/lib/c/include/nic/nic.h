@@ -222,6 +222,17 @@ typedef struct nic_device_stats {
 	unsigned long receive_compressed;
 	/** Total compressed packet transmitted. */
 	unsigned long send_compressed;
+
+	/* for NIC_POLL_ADAPTIVE */
+
+	/** Receive interrupts handled. */
+	unsigned long interrupts;
+	/** Budgeted polls performed. */
+	unsigned long polls;
+	/** Frames processed by budgeted polls. */
+	unsigned long poll_frames;
+	/** Switches from interrupt-driven to polled reception. */
+	unsigned long poll_switches;
 } nic_device_stats_t;
 
 /** Errors corresponding to those in the nic_device_stats_t */
@@ -432,7 +443,14 @@ typedef enum nic_poll_mode {
 	 * must create software timer, internal hardware timer of NIC must not be
 	 * used even if the NIC supports it.
 	 */
-	NIC_POLL_SOFTWARE_PERIODIC
+	NIC_POLL_SOFTWARE_PERIODIC,
+	/**
+	 * NIC issues an interrupt for the first frame of a burst, then it is
+	 * polled with a budget and interrupts disabled until it becomes idle
+	 * again. The period (optional) is the interval between polls while the
+	 * NIC is being polled.
+	 */
+	NIC_POLL_ADAPTIVE
 } nic_poll_mode_t;
 
 /**
@@ -0,0 +1,163 @@
+/*
+ * Copyright (c) 2026 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <inet/checksum.h>
+#include <pcut/pcut.h>
+#include <stddef.h>
+#include <stdint.h>
+
+PCUT_INIT;
+
+PCUT_TEST_SUITE(inet_checksum);
+
+enum {
+	test_buf_size = 300
+};
+
+static uint8_t test_buf[test_buf_size + 8];
+
+/** Straightforward checksum computation for reference */
+static uint16_t test_checksum_ref(uint16_t ivalue, const uint8_t *data,
+    size_t size)
+{
+	uint32_t sum;
+	size_t i;
+
+	sum = (uint16_t) ~ivalue;
+	for (i = 0; i < size; i++) {
+		if (i % 2 == 0)
+			sum += (uint32_t) data[i] << 8;
+		else
+			sum += data[i];
+		sum = (sum & 0xffff) + (sum >> 16);
+	}
+
+	return ~sum;
+}
+
+static void test_buf_fill(void)
+{
+	size_t i;
+	uint32_t x = 1;
+
+	for (i = 0; i < sizeof(test_buf); i++) {
+		x = x * 1103515245 + 12345;
+		test_buf[i] = x >> 16;
+	}
+}
+
+/** Example from RFC 1071 section 3 */
+PCUT_TEST(rfc1071_example)
+{
+	uint8_t data[] = { 0x00, 0x01, 0xf2, 0x03, 0xf4, 0xf5, 0xf6, 0xf7 };
+
+	PCUT_ASSERT_INT_EQUALS(0x220d,
+	    inet_checksum_calc(INET_CHECKSUM_INIT, data, sizeof(data)));
+}
+
+/** Empty data and all-zero data */
+PCUT_TEST(zero)
+{
+	uint8_t data[4] = { 0 };
+
+	PCUT_ASSERT_INT_EQUALS(0xffff,
+	    inet_checksum_calc(INET_CHECKSUM_INIT, data, 0));
+	PCUT_ASSERT_INT_EQUALS(0xffff,
+	    inet_checksum_calc(INET_CHECKSUM_INIT, data, sizeof(data)));
+}
+
+/** All sizes and alignments match the reference computation */
+PCUT_TEST(sizes_alignments)
+{
+	size_t offs;
+	size_t size;
+
+	test_buf_fill();
+
+	for (offs = 0; offs < 8; offs++) {
+		for (size = 0; size <= test_buf_size; size++) {
+			PCUT_ASSERT_INT_EQUALS(test_checksum_ref(
+			    INET_CHECKSUM_INIT, test_buf + offs, size),
+			    inet_checksum_calc(INET_CHECKSUM_INIT,
+			    test_buf + offs, size));
+		}
+	}
+}
+
+/** Chaining over pieces gives the same result as a single call */
+PCUT_TEST(chain)
+{
+	uint16_t cs;
+
+	test_buf_fill();
+
+	cs = inet_checksum_calc(INET_CHECKSUM_INIT, test_buf, 12);
+	cs = inet_checksum_calc(cs, test_buf + 12, 20);
+	cs = inet_checksum_calc(cs, test_buf + 32, 101);
+
+	PCUT_ASSERT_INT_EQUALS(
+	    inet_checksum_calc(INET_CHECKSUM_INIT, test_buf, 133), cs);
+}
+
+/** Incremental update matches recomputation */
+PCUT_TEST(update)
+{
+	uint16_t cs;
+	uint16_t ov16, nv16;
+	uint32_t ov32, nv32;
+
+	test_buf_fill();
+
+	/* Change 16-bit word at offset 10 */
+	cs = inet_checksum_calc(INET_CHECKSUM_INIT, test_buf, 20);
+	ov16 = ((uint16_t) test_buf[10] << 8) | test_buf[11];
+	nv16 = ov16 - 1;
+	test_buf[10] = nv16 >> 8;
+	test_buf[11] = nv16 & 0xff;
+
+	PCUT_ASSERT_INT_EQUALS(
+	    inet_checksum_calc(INET_CHECKSUM_INIT, test_buf, 20),
+	    inet_checksum_update16(cs, ov16, nv16));
+
+	/* Change 32-bit word at offset 12 */
+	cs = inet_checksum_calc(INET_CHECKSUM_INIT, test_buf, 20);
+	ov32 = ((uint32_t) test_buf[12] << 24) |
+	    ((uint32_t) test_buf[13] << 16) |
+	    ((uint32_t) test_buf[14] << 8) | test_buf[15];
+	nv32 = 0x0a000001;
+	test_buf[12] = nv32 >> 24;
+	test_buf[13] = (nv32 >> 16) & 0xff;
+	test_buf[14] = (nv32 >> 8) & 0xff;
+	test_buf[15] = nv32 & 0xff;
+
+	PCUT_ASSERT_INT_EQUALS(
+	    inet_checksum_calc(INET_CHECKSUM_INIT, test_buf, 20),
+	    inet_checksum_update32(cs, ov32, nv32));
+}
+
+PCUT_EXPORT(inet_checksum);
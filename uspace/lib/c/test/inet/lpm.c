@@ -0,0 +1,191 @@
+/*
+ * Copyright (c) 2026 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <errno.h>
+#include <inet/addr.h>
+#include <inet/lpm.h>
+#include <pcut/pcut.h>
+#include <stddef.h>
+
+PCUT_INIT;
+
+PCUT_TEST_SUITE(inet_lpm);
+
+static int test_values[4];
+
+/** Look up an IPv4 address given as four octets */
+static void *test_lookup4(inet_lpm_t *lpm, uint8_t a, uint8_t b, uint8_t c,
+    uint8_t d)
+{
+	inet_addr_t addr;
+
+	inet_addr(&addr, a, b, c, d);
+	return inet_lpm_lookup(lpm, &addr);
+}
+
+/** Empty table matches nothing */
+PCUT_TEST(empty)
+{
+	inet_lpm_t lpm;
+
+	inet_lpm_init(&lpm);
+	PCUT_ASSERT_NULL(test_lookup4(&lpm, 10, 0, 0, 1));
+	PCUT_ASSERT_INT_EQUALS(0, lpm.count);
+	inet_lpm_fini(&lpm);
+}
+
+/** The most specific of the matching IPv4 prefixes wins */
+PCUT_TEST(longest_match)
+{
+	inet_lpm_t lpm;
+	inet_naddr_t naddr;
+
+	inet_lpm_init(&lpm);
+
+	inet_naddr(&naddr, 0, 0, 0, 0, 0);
+	PCUT_ASSERT_ERRNO_VAL(EOK, inet_lpm_insert(&lpm, &naddr,
+	    &test_values[0]));
+	inet_naddr(&naddr, 10, 0, 0, 0, 8);
+	PCUT_ASSERT_ERRNO_VAL(EOK, inet_lpm_insert(&lpm, &naddr,
+	    &test_values[1]));
+	inet_naddr(&naddr, 10, 1, 2, 0, 24);
+	PCUT_ASSERT_ERRNO_VAL(EOK, inet_lpm_insert(&lpm, &naddr,
+	    &test_values[2]));
+	/* Host part is ignored */
+	inet_naddr(&naddr, 10, 1, 3, 7, 24);
+	PCUT_ASSERT_ERRNO_VAL(EOK, inet_lpm_insert(&lpm, &naddr,
+	    &test_values[3]));
+	PCUT_ASSERT_INT_EQUALS(4, lpm.count);
+
+	PCUT_ASSERT_EQUALS(&test_values[0], test_lookup4(&lpm, 192, 168, 0, 1));
+	PCUT_ASSERT_EQUALS(&test_values[1], test_lookup4(&lpm, 10, 9, 2, 1));
+	PCUT_ASSERT_EQUALS(&test_values[2], test_lookup4(&lpm, 10, 1, 2, 255));
+	PCUT_ASSERT_EQUALS(&test_values[3], test_lookup4(&lpm, 10, 1, 3, 0));
+
+	inet_lpm_fini(&lpm);
+}
+
+/** Inserting the same network twice fails, updating it does not */
+PCUT_TEST(insert_exists)
+{
+	inet_lpm_t lpm;
+	inet_naddr_t naddr;
+
+	inet_lpm_init(&lpm);
+
+	inet_naddr(&naddr, 10, 1, 0, 0, 16);
+	PCUT_ASSERT_ERRNO_VAL(EOK, inet_lpm_insert(&lpm, &naddr,
+	    &test_values[0]));
+	inet_naddr(&naddr, 10, 1, 255, 255, 16);
+	PCUT_ASSERT_ERRNO_VAL(EEXIST, inet_lpm_insert(&lpm, &naddr,
+	    &test_values[1]));
+	PCUT_ASSERT_EQUALS(&test_values[0], inet_lpm_get(&lpm, &naddr));
+
+	PCUT_ASSERT_ERRNO_VAL(EOK, inet_lpm_update(&lpm, &naddr,
+	    &test_values[1]));
+	PCUT_ASSERT_EQUALS(&test_values[1], inet_lpm_get(&lpm, &naddr));
+	inet_naddr(&naddr, 10, 2, 0, 0, 16);
+	PCUT_ASSERT_ERRNO_VAL(ENOENT, inet_lpm_update(&lpm, &naddr,
+	    &test_values[1]));
+
+	/* Prefix length is out of range */
+	naddr.prefix = 33;
+	PCUT_ASSERT_ERRNO_VAL(EINVAL, inet_lpm_insert(&lpm, &naddr,
+	    &test_values[1]));
+
+	inet_lpm_fini(&lpm);
+}
+
+/** Removed entry no longer matches, less specific entries take over */
+PCUT_TEST(remove)
+{
+	inet_lpm_t lpm;
+	inet_naddr_t naddr;
+
+	inet_lpm_init(&lpm);
+
+	inet_naddr(&naddr, 10, 0, 0, 0, 8);
+	PCUT_ASSERT_ERRNO_VAL(EOK, inet_lpm_insert(&lpm, &naddr,
+	    &test_values[0]));
+	inet_naddr(&naddr, 10, 1, 0, 0, 16);
+	PCUT_ASSERT_ERRNO_VAL(EOK, inet_lpm_insert(&lpm, &naddr,
+	    &test_values[1]));
+	inet_naddr(&naddr, 10, 2, 0, 0, 16);
+	PCUT_ASSERT_ERRNO_VAL(EOK, inet_lpm_insert(&lpm, &naddr,
+	    &test_values[2]));
+
+	inet_naddr(&naddr, 10, 1, 0, 0, 16);
+	PCUT_ASSERT_ERRNO_VAL(EOK, inet_lpm_remove(&lpm, &naddr));
+	PCUT_ASSERT_ERRNO_VAL(ENOENT, inet_lpm_remove(&lpm, &naddr));
+	PCUT_ASSERT_NULL(inet_lpm_get(&lpm, &naddr));
+	PCUT_ASSERT_EQUALS(&test_values[0], test_lookup4(&lpm, 10, 1, 0, 1));
+	PCUT_ASSERT_EQUALS(&test_values[2], test_lookup4(&lpm, 10, 2, 0, 1));
+
+	inet_naddr(&naddr, 10, 0, 0, 0, 8);
+	PCUT_ASSERT_ERRNO_VAL(EOK, inet_lpm_remove(&lpm, &naddr));
+	PCUT_ASSERT_NULL(test_lookup4(&lpm, 10, 1, 0, 1));
+	PCUT_ASSERT_EQUALS(&test_values[2], test_lookup4(&lpm, 10, 2, 0, 1));
+	PCUT_ASSERT_INT_EQUALS(1, lpm.count);
+
+	inet_naddr(&naddr, 10, 2, 0, 0, 16);
+	PCUT_ASSERT_ERRNO_VAL(EOK, inet_lpm_remove(&lpm, &naddr));
+	PCUT_ASSERT_NULL(lpm.root4);
+
+	inet_lpm_fini(&lpm);
+}
+
+/** IPv6 prefixes are kept apart from IPv4 prefixes */
+PCUT_TEST(ipv6)
+{
+	inet_lpm_t lpm;
+	inet_naddr_t naddr;
+	inet_addr_t addr;
+
+	inet_lpm_init(&lpm);
+
+	inet_naddr6(&naddr, 0x2001, 0xdb8, 0, 0, 0, 0, 0, 0, 32);
+	PCUT_ASSERT_ERRNO_VAL(EOK, inet_lpm_insert(&lpm, &naddr,
+	    &test_values[0]));
+	inet_naddr6(&naddr, 0x2001, 0xdb8, 0x1234, 0x5678, 0, 0, 0, 0, 64);
+	PCUT_ASSERT_ERRNO_VAL(EOK, inet_lpm_insert(&lpm, &naddr,
+	    &test_values[1]));
+	inet_naddr(&naddr, 0, 0, 0, 0, 0);
+	PCUT_ASSERT_ERRNO_VAL(EOK, inet_lpm_insert(&lpm, &naddr,
+	    &test_values[2]));
+
+	inet_addr6(&addr, 0x2001, 0xdb8, 0x1234, 0x5678, 0, 0, 0, 1);
+	PCUT_ASSERT_EQUALS(&test_values[1], inet_lpm_lookup(&lpm, &addr));
+	inet_addr6(&addr, 0x2001, 0xdb8, 0x1234, 0x5679, 0, 0, 0, 1);
+	PCUT_ASSERT_EQUALS(&test_values[0], inet_lpm_lookup(&lpm, &addr));
+	inet_addr6(&addr, 0x2001, 0xdb9, 0, 0, 0, 0, 0, 1);
+	PCUT_ASSERT_NULL(inet_lpm_lookup(&lpm, &addr));
+
+	inet_lpm_fini(&lpm);
+}
+
+PCUT_EXPORT(inet_lpm);
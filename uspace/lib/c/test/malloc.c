@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2026 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <malloc.h>
+#include <mem.h>
+#include <stdint.h>
+#include <pcut/pcut.h>
+
+PCUT_INIT;
+
+PCUT_TEST_SUITE(malloc);
+
+#define NUM_BLOCKS  256
+
+/** Small blocks of many sizes can be allocated, used and freed */
+PCUT_TEST(small_blocks)
+{
+	void *p[NUM_BLOCKS];
+	size_t i;
+
+	for (i = 0; i < NUM_BLOCKS; i++) {
+		p[i] = malloc(i * 5);
+		PCUT_ASSERT_NOT_NULL(p[i]);
+		PCUT_ASSERT_INT_EQUALS(0, (uintptr_t) p[i] % sizeof(void *));
+		memset(p[i], (int) i, i * 5);
+	}
+
+	for (i = 0; i < NUM_BLOCKS; i++) {
+		if (i * 5 > 0)
+			PCUT_ASSERT_INT_EQUALS((uint8_t) i, ((uint8_t *) p[i])[i * 5 - 1]);
+	}
+
+	for (i = 0; i < NUM_BLOCKS; i += 2)
+		free(p[i]);
+
+	PCUT_ASSERT_NULL(heap_check());
+
+	for (i = 1; i < NUM_BLOCKS; i += 2)
+		free(p[i]);
+
+	PCUT_ASSERT_NULL(heap_check());
+}
+
+/** A freed small block can be recycled for a new allocation */
+PCUT_TEST(recycle)
+{
+	void *p = malloc(40);
+	PCUT_ASSERT_NOT_NULL(p);
+	free(p);
+
+	void *q = malloc(40);
+	PCUT_ASSERT_NOT_NULL(q);
+	memset(q, 0xaa, 40);
+	free(q);
+
+	PCUT_ASSERT_NULL(heap_check());
+}
+
+/** Small blocks can be grown and shrunk by realloc */
+PCUT_TEST(realloc_small)
+{
+	uint8_t *p = malloc(24);
+	PCUT_ASSERT_NOT_NULL(p);
+
+	for (size_t i = 0; i < 24; i++)
+		p[i] = (uint8_t) i;
+
+	p = realloc(p, 4000);
+	PCUT_ASSERT_NOT_NULL(p);
+
+	for (size_t i = 0; i < 24; i++)
+		PCUT_ASSERT_INT_EQUALS((uint8_t) i, p[i]);
+
+	p = realloc(p, 8);
+	PCUT_ASSERT_NOT_NULL(p);
+
+	for (size_t i = 0; i < 8; i++)
+		PCUT_ASSERT_INT_EQUALS((uint8_t) i, p[i]);
+
+	free(p);
+
+	/* A shrunk block must not be handed out for a larger size. */
+	p = malloc(1000);
+	PCUT_ASSERT_NOT_NULL(p);
+	memset(p, 0x55, 1000);
+	free(p);
+
+	PCUT_ASSERT_NULL(heap_check());
+}
+
+/** Aligned and large blocks coexist with small cached blocks */
+PCUT_TEST(memalign_large)
+{
+	void *small = malloc(16);
+	PCUT_ASSERT_NOT_NULL(small);
+
+	void *aligned = memalign(256, 100);
+	PCUT_ASSERT_NOT_NULL(aligned);
+	PCUT_ASSERT_INT_EQUALS(0, (uintptr_t) aligned % 256);
+
+	void *large = malloc(100000);
+	PCUT_ASSERT_NOT_NULL(large);
+	memset(large, 0, 100000);
+
+	free(small);
+	free(aligned);
+	free(large);
+
+	PCUT_ASSERT_NULL(heap_check());
+}
+
+PCUT_EXPORT(malloc);
@@ -147,15 +147,27 @@ errno_t ahci_read_blocks(async_sess_t *sess, uint64_t blocknum, size_t count,
 	if (!exch)
 		return EINVAL;
 
-	aid_t req;
-	req = async_send_4(exch, DEV_IFACE_ID(AHCI_DEV_IFACE),
-	    IPC_M_AHCI_READ_BLOCKS, HI(blocknum),  LO(blocknum), count, NULL);
+	/* The whole area is shared, pass offset of the buffer in it */
+	as_area_info_t info;
+	errno_t rc = as_area_get_info(buf, &info);
+	if (rc != EOK) {
+		async_exchange_end(exch);
+		return rc;
+	}
+
+	aid_t req = async_send_5(exch, DEV_IFACE_ID(AHCI_DEV_IFACE),
+	    IPC_M_AHCI_READ_BLOCKS, HI(blocknum), LO(blocknum), count,
+	    (uintptr_t) buf - info.start_addr, NULL);
 
-	async_share_out_start(exch, buf, AS_AREA_READ | AS_AREA_WRITE);
+	rc = async_share_out_start(exch, buf, AS_AREA_READ | AS_AREA_WRITE);
 
 	async_exchange_end(exch);
 
-	errno_t rc;
+	if (rc != EOK) {
+		async_forget(req);
+		return rc;
+	}
+
 	async_wait_for(req, &rc);
 
 	return rc;
@@ -168,14 +180,27 @@ errno_t ahci_write_blocks(async_sess_t *sess, uint64_t blocknum, size_t count,
 	if (!exch)
 		return EINVAL;
 
-	aid_t req = async_send_4(exch, DEV_IFACE_ID(AHCI_DEV_IFACE),
-	    IPC_M_AHCI_WRITE_BLOCKS, HI(blocknum),  LO(blocknum), count, NULL);
+	/* The whole area is shared, pass offset of the buffer in it */
+	as_area_info_t info;
+	errno_t rc = as_area_get_info(buf, &info);
+	if (rc != EOK) {
+		async_exchange_end(exch);
+		return rc;
+	}
+
+	aid_t req = async_send_5(exch, DEV_IFACE_ID(AHCI_DEV_IFACE),
+	    IPC_M_AHCI_WRITE_BLOCKS, HI(blocknum), LO(blocknum), count,
+	    (uintptr_t) buf - info.start_addr, NULL);
 
-	async_share_out_start(exch, buf, AS_AREA_READ | AS_AREA_WRITE);
+	rc = async_share_out_start(exch, buf, AS_AREA_READ | AS_AREA_WRITE);
 
 	async_exchange_end(exch);
 
-	errno_t rc;
+	if (rc != EOK) {
+		async_forget(req);
+		return rc;
+	}
+
 	async_wait_for(req, &rc);
 
 	return rc;
@@ -278,7 +303,8 @@ void remote_ahci_read_blocks(ddf_fun_t *fun, void *iface, ipc_call_t *call)
 {
 	const ahci_iface_t *ahci_iface = (ahci_iface_t *) iface;
 
-	if (ahci_iface->read_blocks == NULL) {
+	if ((ahci_iface->read_blocks == NULL) ||
+	    (ahci_iface->get_block_size == NULL)) {
 		async_answer_0(call, ENOTSUP);
 		return;
 	}
@@ -286,18 +312,35 @@ void remote_ahci_read_blocks(ddf_fun_t *fun, void *iface, ipc_call_t *call)
 	ipc_call_t data;
 	size_t maxblock_size;
 	unsigned int flags;
-	async_share_out_receive(&data, &maxblock_size, &flags);
+	if (!async_share_out_receive(&data, &maxblock_size, &flags)) {
+		async_answer_0(call, EINVAL);
+		return;
+	}
 
-	void *buf;
-	async_share_out_finalize(&data, &buf);
+	void *area;
+	errno_t ret = async_share_out_finalize(&data, &area);
+	if (ret != EOK) {
+		async_answer_0(call, ret);
+		return;
+	}
 
 	const uint64_t blocknum =
 	    (((uint64_t) (DEV_IPC_GET_ARG1(*call))) << 32) |
 	    (((uint64_t) (DEV_IPC_GET_ARG2(*call))) & 0xffffffff);
 	const size_t cnt = (size_t) DEV_IPC_GET_ARG3(*call);
+	const size_t offset = (size_t) DEV_IPC_GET_ARG4(*call);
 
-	const errno_t ret = ahci_iface->read_blocks(fun, blocknum, cnt, buf);
+	size_t block_size;
+	ret = ahci_iface->get_block_size(fun, &block_size);
+	if ((ret == EOK) && ((offset > maxblock_size) || (block_size == 0) ||
+	    (cnt > (maxblock_size - offset) / block_size)))
+		ret = EINVAL;
 
+	if (ret == EOK)
+		ret = ahci_iface->read_blocks(fun, blocknum, cnt,
+		    (uint8_t *) area + offset);
+
+	as_area_destroy(area);
 	async_answer_0(call, ret);
 }
 
@@ -305,7 +348,8 @@ void remote_ahci_write_blocks(ddf_fun_t *fun, void *iface, ipc_call_t *call)
 {
 	const ahci_iface_t *ahci_iface = (ahci_iface_t *) iface;
 
-	if (ahci_iface->read_blocks == NULL) {
+	if ((ahci_iface->write_blocks == NULL) ||
+	    (ahci_iface->get_block_size == NULL)) {
 		async_answer_0(call, ENOTSUP);
 		return;
 	}
@@ -313,18 +357,35 @@ void remote_ahci_write_blocks(ddf_fun_t *fun, void *iface, ipc_call_t *call)
 	ipc_call_t data;
 	size_t maxblock_size;
 	unsigned int flags;
-	async_share_out_receive(&data, &maxblock_size, &flags);
+	if (!async_share_out_receive(&data, &maxblock_size, &flags)) {
+		async_answer_0(call, EINVAL);
+		return;
+	}
 
-	void *buf;
-	async_share_out_finalize(&data, &buf);
+	void *area;
+	errno_t ret = async_share_out_finalize(&data, &area);
+	if (ret != EOK) {
+		async_answer_0(call, ret);
+		return;
+	}
 
 	const uint64_t blocknum =
-	    (((uint64_t)(DEV_IPC_GET_ARG1(*call))) << 32) |
-	    (((uint64_t)(DEV_IPC_GET_ARG2(*call))) & 0xffffffff);
+	    (((uint64_t) (DEV_IPC_GET_ARG1(*call))) << 32) |
+	    (((uint64_t) (DEV_IPC_GET_ARG2(*call))) & 0xffffffff);
 	const size_t cnt = (size_t) DEV_IPC_GET_ARG3(*call);
+	const size_t offset = (size_t) DEV_IPC_GET_ARG4(*call);
+
+	size_t block_size;
+	ret = ahci_iface->get_block_size(fun, &block_size);
+	if ((ret == EOK) && ((offset > maxblock_size) || (block_size == 0) ||
+	    (cnt > (maxblock_size - offset) / block_size)))
+		ret = EINVAL;
 
-	const errno_t ret = ahci_iface->write_blocks(fun, blocknum, cnt, buf);
+	if (ret == EOK)
+		ret = ahci_iface->write_blocks(fun, blocknum, cnt,
+		    (uint8_t *) area + offset);
 
+	as_area_destroy(area);
 	async_answer_0(call, ret);
 }
 
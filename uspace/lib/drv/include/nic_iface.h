@@ -42,9 +42,23 @@
 typedef enum {
 	NIC_EV_ADDR_CHANGED = IPC_FIRST_USER_METHOD,
 	NIC_EV_RECEIVED,
-	NIC_EV_DEVICE_STATE
+	NIC_EV_DEVICE_STATE,
+	NIC_EV_RECEIVED_BATCH
 } nic_event_t;
 
+/** Maximum size of a NIC_EV_RECEIVED_BATCH buffer */
+#define NIC_BATCH_MAX_SIZE  DATA_XFER_LIMIT
+
+/** Header of a frame in a NIC_EV_RECEIVED_BATCH buffer.
+ *
+ * Frame data follow the header. The next header starts at the nearest
+ * offset aligned to the size of the header.
+ */
+typedef struct {
+	/** Size of frame data */
+	uint32_t size;
+} nic_batch_hdr_t;
+
 extern errno_t nic_send_frame(async_sess_t *, void *, size_t);
 extern errno_t nic_callback_create(async_sess_t *, async_port_handler_t, void *);
 extern errno_t nic_get_state(async_sess_t *, nic_device_state_t *);
@@ -36,12 +36,28 @@
 #include <stdint.h>
 #include "types.h"
 
+/** Number of blocks reserved ahead for a file being written */
+#define EXT4_BALLOC_PREALLOC_BLOCKS  64
+
 extern errno_t ext4_balloc_free_block(ext4_inode_ref_t *, uint32_t);
 extern errno_t ext4_balloc_free_blocks(ext4_inode_ref_t *, uint32_t, uint32_t);
 extern uint32_t ext4_balloc_get_first_data_block_in_group(ext4_superblock_t *,
     ext4_block_group_ref_t *);
 extern errno_t ext4_balloc_alloc_block(ext4_inode_ref_t *, uint32_t *);
+extern errno_t ext4_balloc_alloc_blocks(ext4_inode_ref_t *, uint32_t, uint32_t,
+    uint32_t *, uint32_t *);
 extern errno_t ext4_balloc_try_alloc_block(ext4_inode_ref_t *, uint32_t, bool *);
+extern ext4_alloc_ctx_t *ext4_balloc_ctx_find(ext4_filesystem_t *, uint32_t);
+extern errno_t ext4_balloc_ctx_get(ext4_filesystem_t *, uint32_t,
+    ext4_alloc_ctx_t **);
+extern void ext4_balloc_ctx_destroy(ext4_alloc_ctx_t *);
+extern errno_t ext4_balloc_discard_prealloc(ext4_filesystem_t *,
+    ext4_alloc_ctx_t *);
+extern uint32_t ext4_balloc_get_avail(ext4_filesystem_t *);
+extern errno_t ext4_balloc_dalloc_reserve(ext4_inode_ref_t *,
+    ext4_alloc_ctx_t *, uint32_t);
+extern void ext4_balloc_dalloc_release(ext4_filesystem_t *,
+    ext4_alloc_ctx_t *);
 
 #endif
 
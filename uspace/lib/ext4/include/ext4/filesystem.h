@@ -59,6 +59,8 @@ extern errno_t ext4_filesystem_put_inode_ref(ext4_inode_ref_t *);
 extern errno_t ext4_filesystem_alloc_inode(ext4_filesystem_t *, ext4_inode_ref_t **,
     int);
 extern errno_t ext4_filesystem_free_inode(ext4_inode_ref_t *);
+extern errno_t ext4_filesystem_flush_delayed(ext4_inode_ref_t *);
+extern errno_t ext4_filesystem_release_alloc_ctx(ext4_inode_ref_t *, bool);
 extern errno_t ext4_filesystem_truncate_inode(ext4_inode_ref_t *, aoff64_t);
 extern errno_t ext4_filesystem_get_inode_data_block_index(ext4_inode_ref_t *,
     aoff64_t iblock, uint32_t *);
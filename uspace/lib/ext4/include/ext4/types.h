@@ -35,6 +35,7 @@
 #ifndef LIBEXT4_TYPES_H_
 #define LIBEXT4_TYPES_H_
 
+#include <adt/list.h>
 #include <block.h>
 
 /*
@@ -232,8 +233,25 @@ typedef struct ext4_filesystem {
 	ext4_superblock_t *superblock;
 	aoff64_t inode_block_limits[4];
 	aoff64_t inode_blocks_per_level[4];
+	list_t alloc_ctxs;      /* Allocation contexts of files being written */
+	uint32_t da_reserved;   /* Free blocks promised to delayed allocation */
 } ext4_filesystem_t;
 
+/*
+ * Allocation context of a file being written. It lives from the first
+ * allocation until the file is closed.
+ */
+typedef struct ext4_alloc_ctx {
+	link_t link;            /* Link in ext4_filesystem_t.alloc_ctxs */
+	uint32_t index;         /* I-node number */
+	uint32_t pa_start;      /* First block of the preallocation window */
+	uint32_t pa_count;      /* Number of blocks in the preallocation window */
+	uint32_t da_iblock;     /* First logical block waiting for allocation */
+	uint32_t da_count;      /* Number of blocks waiting for allocation */
+	uint8_t *da_data;       /* Contents of blocks waiting for allocation */
+	uint32_t da_reserved;   /* Blocks reserved for mapping da_data */
+} ext4_alloc_ctx_t;
+
 /** Size of buffer for volume name. To hold 16 latin-1 chars encoded as UTF-8
  * and a null terminator we need 2 * 16 + 1 bytes
  */
@@ -35,12 +35,16 @@
  * @brief Physical block allocator.
  */
 
+#include <assert.h>
 #include <errno.h>
+#include <macros.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include "ext4/balloc.h"
 #include "ext4/bitmap.h"
 #include "ext4/block_group.h"
+#include "ext4/extent.h"
 #include "ext4/filesystem.h"
 #include "ext4/inode.h"
 #include "ext4/superblock.h"
@@ -119,10 +123,21 @@ errno_t ext4_balloc_free_block(ext4_inode_ref_t *inode_ref, uint32_t block_addr)
 	return ext4_filesystem_put_block_group_ref(bg_ref);
 }
 
-static errno_t ext4_balloc_free_blocks_internal(ext4_inode_ref_t *inode_ref,
+/** Return continuous set of blocks within one block group to free space.
+ *
+ * Only the bitmap and the free blocks counters are updated, the caller
+ * takes care of the owner's blocks count.
+ *
+ * @param fs    Filesystem, where the blocks are allocated
+ * @param first First block to release
+ * @param count Number of blocks to release
+ *
+ * @return Error code
+ *
+ */
+static errno_t ext4_balloc_release_internal(ext4_filesystem_t *fs,
     uint32_t first, uint32_t count)
 {
-	ext4_filesystem_t *fs = inode_ref->fs;
 	ext4_superblock_t *sb = fs->superblock;
 
 	/* Compute indexes */
@@ -165,21 +180,12 @@ static errno_t ext4_balloc_free_blocks_internal(ext4_inode_ref_t *inode_ref,
 		return rc;
 	}
 
-	uint32_t block_size = ext4_superblock_get_block_size(sb);
-
 	/* Update superblock free blocks count */
 	uint32_t sb_free_blocks =
 	    ext4_superblock_get_free_blocks_count(sb);
 	sb_free_blocks += count;
 	ext4_superblock_set_free_blocks_count(sb, sb_free_blocks);
 
-	/* Update inode blocks count */
-	uint64_t ino_blocks =
-	    ext4_inode_get_blocks_count(sb, inode_ref->inode);
-	ino_blocks -= count * (block_size / EXT4_INODE_BLOCK_SIZE);
-	ext4_inode_set_blocks_count(sb, inode_ref->inode, ino_blocks);
-	inode_ref->dirty = true;
-
 	/* Update block group free blocks count */
 	uint32_t free_blocks =
 	    ext4_block_group_get_free_blocks_count(bg_ref->block_group, sb);
@@ -192,20 +198,21 @@ static errno_t ext4_balloc_free_blocks_internal(ext4_inode_ref_t *inode_ref,
 	return ext4_filesystem_put_block_group_ref(bg_ref);
 }
 
-/** Free continuous set of blocks.
+/** Return continuous set of blocks to free space.
  *
- * @param inode_ref Inode, where the blocks are allocated
- * @param first     First block to release
- * @param count     Number of blocks to release
+ * @param fs    Filesystem, where the blocks are allocated
+ * @param first First block to release
+ * @param count Number of blocks to release
+ *
+ * @return Error code
  *
  */
-errno_t ext4_balloc_free_blocks(ext4_inode_ref_t *inode_ref,
-    uint32_t first, uint32_t count)
+static errno_t ext4_balloc_release(ext4_filesystem_t *fs, uint32_t first,
+    uint32_t count)
 {
 	errno_t r;
 	uint32_t gid;
 	uint64_t limit;
-	ext4_filesystem_t *fs = inode_ref->fs;
 	ext4_superblock_t *sb = fs->superblock;
 
 	while (count) {
@@ -220,22 +227,48 @@ errno_t ext4_balloc_free_blocks(ext4_inode_ref_t *inode_ref,
 			 */
 			uint32_t s = limit - first;
 
-			r = ext4_balloc_free_blocks_internal(inode_ref,
-			    first, s);
+			r = ext4_balloc_release_internal(fs, first, s);
 			if (r != EOK)
 				return r;
 
 			first = limit;
 			count -= s;
 		} else {
-			return ext4_balloc_free_blocks_internal(inode_ref,
-			    first, count);
+			return ext4_balloc_release_internal(fs, first, count);
 		}
 	}
 
 	return EOK;
 }
 
+/** Free continuous set of blocks.
+ *
+ * @param inode_ref Inode, where the blocks are allocated
+ * @param first     First block to release
+ * @param count     Number of blocks to release
+ *
+ */
+errno_t ext4_balloc_free_blocks(ext4_inode_ref_t *inode_ref,
+    uint32_t first, uint32_t count)
+{
+	ext4_superblock_t *sb = inode_ref->fs->superblock;
+
+	errno_t rc = ext4_balloc_release(inode_ref->fs, first, count);
+	if (rc != EOK)
+		return rc;
+
+	uint32_t block_size = ext4_superblock_get_block_size(sb);
+
+	/* Update inode blocks count */
+	uint64_t ino_blocks =
+	    ext4_inode_get_blocks_count(sb, inode_ref->inode);
+	ino_blocks -= count * (block_size / EXT4_INODE_BLOCK_SIZE);
+	ext4_inode_set_blocks_count(sb, inode_ref->inode, ino_blocks);
+	inode_ref->dirty = true;
+
+	return EOK;
+}
+
 /** Compute first block for data in block group.
  *
  * @param sb   Pointer to superblock
@@ -312,7 +345,7 @@ static errno_t ext4_balloc_find_goal(ext4_inode_ref_t *inode_ref, uint32_t *goal
 		if (rc != EOK)
 			return rc;
 
-		if (goal != 0) {
+		if (*goal != 0) {
 			(*goal)++;
 			return EOK;
 		}
@@ -354,6 +387,10 @@ errno_t ext4_balloc_alloc_block(ext4_inode_ref_t *inode_ref, uint32_t *fblock)
 	uint32_t goal;
 	uint32_t block_size;
 
+	/* Blocks promised to delayed allocation must stay free */
+	if (ext4_balloc_get_avail(inode_ref->fs) == 0)
+		return ENOSPC;
+
 	/* Find GOAL */
 	errno_t rc = ext4_balloc_find_goal(inode_ref, &goal);
 	if (rc != EOK)
@@ -614,6 +651,446 @@ success:
 	return rc;
 }
 
+/** Find allocation context of i-node.
+ *
+ * @param fs    Filesystem
+ * @param index Index of i-node
+ *
+ * @return Allocation context or NULL if the i-node has none
+ *
+ */
+ext4_alloc_ctx_t *ext4_balloc_ctx_find(ext4_filesystem_t *fs, uint32_t index)
+{
+	list_foreach(fs->alloc_ctxs, link, ext4_alloc_ctx_t, ctx) {
+		if (ctx->index == index)
+			return ctx;
+	}
+
+	return NULL;
+}
+
+/** Get allocation context of i-node, create it if it does not exist.
+ *
+ * @param fs    Filesystem
+ * @param index Index of i-node
+ * @param rctx  Output value - allocation context
+ *
+ * @return Error code
+ *
+ */
+errno_t ext4_balloc_ctx_get(ext4_filesystem_t *fs, uint32_t index,
+    ext4_alloc_ctx_t **rctx)
+{
+	ext4_alloc_ctx_t *ctx = ext4_balloc_ctx_find(fs, index);
+	if (ctx == NULL) {
+		ctx = calloc(1, sizeof(ext4_alloc_ctx_t));
+		if (ctx == NULL)
+			return ENOMEM;
+
+		link_initialize(&ctx->link);
+		ctx->index = index;
+		list_append(&ctx->link, &fs->alloc_ctxs);
+	}
+
+	*rctx = ctx;
+	return EOK;
+}
+
+/** Destroy allocation context.
+ *
+ * Preallocated blocks must be discarded, delayed data flushed
+ * or dropped and its reservation returned by the caller.
+ *
+ * @param ctx Allocation context
+ *
+ */
+void ext4_balloc_ctx_destroy(ext4_alloc_ctx_t *ctx)
+{
+	assert(ctx->pa_count == 0);
+	assert(ctx->da_reserved == 0);
+
+	list_remove(&ctx->link);
+	free(ctx->da_data);
+	free(ctx);
+}
+
+/** Return preallocation window of i-node to free space.
+ *
+ * @param fs  Filesystem
+ * @param ctx Allocation context of the i-node
+ *
+ * @return Error code
+ *
+ */
+errno_t ext4_balloc_discard_prealloc(ext4_filesystem_t *fs,
+    ext4_alloc_ctx_t *ctx)
+{
+	if (ctx->pa_count == 0)
+		return EOK;
+
+	errno_t rc = ext4_balloc_release(fs, ctx->pa_start, ctx->pa_count);
+	if (rc != EOK)
+		return rc;
+
+	ctx->pa_start = 0;
+	ctx->pa_count = 0;
+	return EOK;
+}
+
+/** Get number of free blocks not promised to delayed allocation.
+ *
+ * @param fs Filesystem
+ *
+ * @return Number of blocks available for allocation
+ *
+ */
+uint32_t ext4_balloc_get_avail(ext4_filesystem_t *fs)
+{
+	uint32_t free_blocks =
+	    ext4_superblock_get_free_blocks_count(fs->superblock);
+
+	if (free_blocks <= fs->da_reserved)
+		return 0;
+
+	return free_blocks - fs->da_reserved;
+}
+
+/** Reserve space for blocks waiting for delayed allocation.
+ *
+ * Besides the data block itself, the extent tree may need a new block
+ * on each level and a new root level when the block gets mapped as a
+ * separate extent. All of them are reserved, so that mapping buffered
+ * data can never run out of space.
+ *
+ * @param inode_ref I-node the blocks belong to
+ * @param ctx       Allocation context of the i-node
+ * @param count     Number of data blocks
+ *
+ * @return Error code, ENOSPC if there is not enough space
+ *
+ */
+errno_t ext4_balloc_dalloc_reserve(ext4_inode_ref_t *inode_ref,
+    ext4_alloc_ctx_t *ctx, uint32_t count)
+{
+	ext4_extent_header_t *header =
+	    ext4_inode_get_extent_header(inode_ref->inode);
+	uint32_t need = count * (2 + ext4_extent_header_get_depth(header));
+
+	if (ext4_balloc_get_avail(inode_ref->fs) < need)
+		return ENOSPC;
+
+	inode_ref->fs->da_reserved += need;
+	ctx->da_reserved += need;
+	return EOK;
+}
+
+/** Return space reserved for delayed allocation of i-node.
+ *
+ * @param fs  Filesystem
+ * @param ctx Allocation context of the i-node
+ *
+ */
+void ext4_balloc_dalloc_release(ext4_filesystem_t *fs, ext4_alloc_ctx_t *ctx)
+{
+	assert(fs->da_reserved >= ctx->da_reserved);
+
+	fs->da_reserved -= ctx->da_reserved;
+	ctx->da_reserved = 0;
+}
+
+/** Find run of free bits in bitmap.
+ *
+ * @param bitmap Pointer to bitmap
+ * @param start  Index of first bit to check
+ * @param end    Index behind the last bit to check
+ * @param need   Minimal length of the run
+ * @param want   Maximal length of the run
+ * @param ridx   Output value - index of first bit of the run
+ * @param rlen   Output value - length of the run
+ *
+ * @return True if a run of at least @a need free bits was found
+ *
+ */
+static bool ext4_balloc_find_run(uint8_t *bitmap, uint32_t start,
+    uint32_t end, uint32_t need, uint32_t want, uint32_t *ridx,
+    uint32_t *rlen)
+{
+	uint32_t idx = start;
+
+	while (idx < end) {
+		/* Skip fully used bytes at once */
+		if (((idx % 8) == 0) && (bitmap[idx / 8] == 0xff)) {
+			idx += 8;
+			continue;
+		}
+
+		if (!ext4_bitmap_is_free_bit(bitmap, idx)) {
+			idx++;
+			continue;
+		}
+
+		uint32_t len = 1;
+		while ((idx + len < end) && (len < want) &&
+		    (ext4_bitmap_is_free_bit(bitmap, idx + len)))
+			len++;
+
+		if (len >= need) {
+			*ridx = idx;
+			*rlen = len;
+			return true;
+		}
+
+		idx += len;
+	}
+
+	return false;
+}
+
+/** Reserve run of free blocks in block group.
+ *
+ * @param fs     Filesystem
+ * @param bgid   Index of block group
+ * @param start  Index in group to start searching from
+ * @param need   Minimal number of blocks
+ * @param want   Maximal number of blocks
+ * @param rfirst Output value - first reserved block
+ * @param rcount Output value - number of reserved blocks
+ *
+ * @return Error code, ENOSPC if there is no run long enough
+ *
+ */
+static errno_t ext4_balloc_reserve_in_group(ext4_filesystem_t *fs,
+    uint32_t bgid, uint32_t start, uint32_t need, uint32_t want,
+    uint32_t *rfirst, uint32_t *rcount)
+{
+	ext4_superblock_t *sb = fs->superblock;
+	uint32_t idx;
+	uint32_t len;
+
+	/* Load block group reference */
+	ext4_block_group_ref_t *bg_ref;
+	errno_t rc = ext4_filesystem_get_block_group_ref(fs, bgid, &bg_ref);
+	if (rc != EOK)
+		return rc;
+
+	uint32_t free_blocks =
+	    ext4_block_group_get_free_blocks_count(bg_ref->block_group, sb);
+	if (free_blocks < need) {
+		ext4_filesystem_put_block_group_ref(bg_ref);
+		return ENOSPC;
+	}
+
+	/* Compute indexes */
+	uint32_t first_in_group =
+	    ext4_balloc_get_first_data_block_in_group(sb, bg_ref);
+	uint32_t first_in_group_index =
+	    ext4_filesystem_blockaddr2_index_in_group(sb, first_in_group);
+	uint32_t blocks_in_group =
+	    ext4_superblock_get_blocks_in_group(sb, bgid);
+
+	if (start < first_in_group_index)
+		start = first_in_group_index;
+
+	/* Load block with bitmap */
+	uint32_t bitmap_block_addr =
+	    ext4_block_group_get_block_bitmap(bg_ref->block_group, sb);
+
+	block_t *bitmap_block;
+	rc = block_get(&bitmap_block, fs->device, bitmap_block_addr,
+	    BLOCK_FLAGS_NONE);
+	if (rc != EOK) {
+		ext4_filesystem_put_block_group_ref(bg_ref);
+		return rc;
+	}
+
+	/* Search behind the start first, then wrap around */
+	bool found = ext4_balloc_find_run(bitmap_block->data, start,
+	    blocks_in_group, need, want, &idx, &len);
+	if ((!found) && (start > first_in_group_index)) {
+		found = ext4_balloc_find_run(bitmap_block->data,
+		    first_in_group_index, blocks_in_group, need, want,
+		    &idx, &len);
+	}
+
+	if (!found) {
+		rc = block_put(bitmap_block);
+		ext4_filesystem_put_block_group_ref(bg_ref);
+		return (rc != EOK) ? rc : ENOSPC;
+	}
+
+	/* Modify bitmap */
+	ext4_bitmap_set_bits(bitmap_block->data, idx, len);
+	bitmap_block->dirty = true;
+
+	rc = block_put(bitmap_block);
+	if (rc != EOK) {
+		ext4_filesystem_put_block_group_ref(bg_ref);
+		return rc;
+	}
+
+	/* Update superblock free blocks count */
+	uint32_t sb_free_blocks = ext4_superblock_get_free_blocks_count(sb);
+	sb_free_blocks -= len;
+	ext4_superblock_set_free_blocks_count(sb, sb_free_blocks);
+
+	/* Update block group free blocks count */
+	free_blocks -= len;
+	ext4_block_group_set_free_blocks_count(bg_ref->block_group, sb,
+	    free_blocks);
+	bg_ref->dirty = true;
+
+	*rfirst = ext4_filesystem_index_in_group2blockaddr(sb, idx, bgid);
+	*rcount = len;
+
+	return ext4_filesystem_put_block_group_ref(bg_ref);
+}
+
+/** Reserve run of free blocks near goal.
+ *
+ * Block groups are searched starting with the one of the goal for
+ * a run holding the whole request. If there is none, any run is taken.
+ *
+ * @param fs     Filesystem
+ * @param goal   Preferred first block
+ * @param count  Number of blocks requested
+ * @param want   Maximal number of blocks to reserve
+ * @param rfirst Output value - first reserved block
+ * @param rcount Output value - number of reserved blocks
+ *
+ * @return Error code
+ *
+ */
+static errno_t ext4_balloc_reserve(ext4_filesystem_t *fs, uint32_t goal,
+    uint32_t count, uint32_t want, uint32_t *rfirst, uint32_t *rcount)
+{
+	ext4_superblock_t *sb = fs->superblock;
+	uint32_t block_group_count = ext4_superblock_get_block_group_count(sb);
+
+	uint32_t block_group = ext4_filesystem_blockaddr2group(sb, goal);
+	uint32_t index_in_group =
+	    ext4_filesystem_blockaddr2_index_in_group(sb, goal);
+
+	if (block_group >= block_group_count) {
+		block_group = 0;
+		index_in_group = 0;
+	}
+
+	uint32_t need = count;
+
+	while (true) {
+		for (uint32_t i = 0; i < block_group_count; i++) {
+			uint32_t bgid = (block_group + i) % block_group_count;
+
+			errno_t rc = ext4_balloc_reserve_in_group(fs, bgid,
+			    (i == 0) ? index_in_group : 0, need, want,
+			    rfirst, rcount);
+			if (rc != ENOSPC)
+				return rc;
+		}
+
+		if (need == 1)
+			break;
+
+		/* Settle for a shorter run */
+		need = 1;
+	}
+
+	return ENOSPC;
+}
+
+/** Allocate run of data blocks.
+ *
+ * Blocks are taken from the preallocation window of the i-node if
+ * the window continues at @a goal. Otherwise a contiguous run is
+ * reserved near the goal in one bitmap pass. For regular files the
+ * run is extended to EXT4_BALLOC_PREALLOC_BLOCKS and the blocks not
+ * handed out are kept as the new preallocation window, so a file
+ * growing in small steps still gets long extents.
+ *
+ * @param inode_ref Inode to allocate blocks for
+ * @param goal      Preferred first block, 0 to compute one
+ * @param count     Number of blocks requested
+ * @param fblock    Output value - first allocated block
+ * @param allocated Output value - number of allocated blocks, at least 1
+ *
+ * @return Error code
+ *
+ */
+errno_t ext4_balloc_alloc_blocks(ext4_inode_ref_t *inode_ref, uint32_t goal,
+    uint32_t count, uint32_t *fblock, uint32_t *allocated)
+{
+	ext4_filesystem_t *fs = inode_ref->fs;
+	ext4_superblock_t *sb = fs->superblock;
+	ext4_alloc_ctx_t *ctx = NULL;
+	uint32_t first;
+	uint32_t n;
+	errno_t rc;
+
+	assert(count > 0);
+
+	if (goal == 0) {
+		rc = ext4_balloc_find_goal(inode_ref, &goal);
+		if (rc != EOK)
+			return rc;
+	}
+
+	if (ext4_inode_is_type(sb, inode_ref->inode, EXT4_INODE_MODE_FILE)) {
+		rc = ext4_balloc_ctx_get(fs, inode_ref->index, &ctx);
+		if (rc != EOK)
+			return rc;
+
+		/* Window not continuing the file is of no use */
+		if ((ctx->pa_count > 0) && (ctx->pa_start != goal)) {
+			rc = ext4_balloc_discard_prealloc(fs, ctx);
+			if (rc != EOK)
+				return rc;
+		}
+	}
+
+	if ((ctx != NULL) && (ctx->pa_count > 0)) {
+		/* Take blocks from the preallocation window */
+		first = ctx->pa_start;
+		n = min(count, ctx->pa_count);
+		ctx->pa_start += n;
+		ctx->pa_count -= n;
+	} else {
+		uint32_t avail = ext4_balloc_get_avail(fs);
+		uint32_t want = count;
+		uint32_t reserved;
+
+		/* Blocks promised to delayed allocation must stay free */
+		if (avail == 0)
+			return ENOSPC;
+
+		if ((ctx != NULL) && (want < EXT4_BALLOC_PREALLOC_BLOCKS))
+			want = EXT4_BALLOC_PREALLOC_BLOCKS;
+
+		rc = ext4_balloc_reserve(fs, goal, min(count, avail),
+		    min(want, avail), &first, &reserved);
+		if (rc != EOK)
+			return rc;
+
+		n = min(count, reserved);
+		if (reserved > n) {
+			ctx->pa_start = first + n;
+			ctx->pa_count = reserved - n;
+		}
+	}
+
+	uint32_t block_size = ext4_superblock_get_block_size(sb);
+
+	/* Update inode blocks (different block size!) count */
+	uint64_t ino_blocks =
+	    ext4_inode_get_blocks_count(sb, inode_ref->inode);
+	ino_blocks += n * (block_size / EXT4_INODE_BLOCK_SIZE);
+	ext4_inode_set_blocks_count(sb, inode_ref->inode, ino_blocks);
+	inode_ref->dirty = true;
+
+	*fblock = first;
+	*allocated = n;
+	return EOK;
+}
+
 /** Try to allocate concrete block.
  *
  * @param inode_ref Inode to allocate block for
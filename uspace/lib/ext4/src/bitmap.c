@@ -36,6 +36,7 @@
 
 #include <errno.h>
 #include <block.h>
+#include <mem.h>
 #include <stdint.h>
 #include "ext4/bitmap.h"
 
@@ -134,6 +135,40 @@ void ext4_bitmap_set_bit(uint8_t *bitmap, uint32_t index)
 	*target |= 1 << bit_index;
 }
 
+/** Set range of bits in bitmap to 1 (used).
+ *
+ * @param bitmap Pointer to bitmap
+ * @param index  Index of first bit to set
+ * @param count  Number of bits to set
+ *
+ */
+void ext4_bitmap_set_bits(uint8_t *bitmap, uint32_t index, uint32_t count)
+{
+	uint32_t idx = index;
+	uint32_t remaining = count;
+
+	/* Set single bits until the index is aligned to a whole byte */
+	while (((idx % 8) != 0) && (remaining > 0)) {
+		ext4_bitmap_set_bit(bitmap, idx);
+		idx++;
+		remaining--;
+	}
+
+	/* Set the whole bytes */
+	if (remaining >= 8) {
+		memset(bitmap + idx / 8, 0xff, remaining / 8);
+		idx += remaining & ~7U;
+		remaining %= 8;
+	}
+
+	/* Set remaining bits */
+	while (remaining > 0) {
+		ext4_bitmap_set_bit(bitmap, idx);
+		idx++;
+		remaining--;
+	}
+}
+
 /** Check if requested bit is free.
  *
  * @param bitmap Pointer to bitmap
@@ -36,6 +36,7 @@
 
 #include <byteorder.h>
 #include <errno.h>
+#include <macros.h>
 #include <mem.h>
 #include <stdlib.h>
 #include "ext4/balloc.h"
@@ -642,7 +643,7 @@ errno_t ext4_extent_release_blocks_from(ext4_inode_ref_t *inode_ref,
 	uint16_t block_count = ext4_extent_get_block_count(path_ptr->extent);
 
 	uint16_t delete_count = block_count -
-	    (ext4_extent_get_start(path_ptr->extent) - first_fblock);
+	    (first_fblock - ext4_extent_get_start(path_ptr->extent));
 
 	/* Release all blocks */
 	rc = ext4_balloc_free_blocks(inode_ref, first_fblock, delete_count);
@@ -948,39 +949,34 @@ static errno_t ext4_extent_append_extent(ext4_inode_ref_t *inode_ref,
 	return EOK;
 }
 
-/** Append data block to the i-node.
+/** Append run of data blocks to the i-node.
  *
- * This function allocates data block, tries to append it
- * to some existing extent or creates new extents.
- * It includes possible extent tree modifications (splitting).
+ * Up to @a count blocks are allocated in one step, preferably right
+ * behind the last extent. The last extent is extended if the run
+ * continues it, otherwise a new extent is created for the run
+ * (including possible tree splitting). The i-node size is not updated.
  *
- * @param inode_ref I-node to append block to
- * @param iblock    Output logical number of newly allocated block
- * @param fblock    Output physical block address of newly allocated block
+ * @param inode_ref I-node to append blocks to
+ * @param iblock    Logical number of first block to append
+ * @param count     Number of blocks to append
+ * @param fblock    Output physical address of first appended block
+ * @param appended  Output number of appended blocks (at least one)
  *
  * @return Error code
  *
  */
-errno_t ext4_extent_append_block(ext4_inode_ref_t *inode_ref, uint32_t *iblock,
-    uint32_t *fblock, bool update_size)
+errno_t ext4_extent_append_blocks(ext4_inode_ref_t *inode_ref, uint32_t iblock,
+    uint32_t count, uint32_t *fblock, uint32_t *appended)
 {
-	ext4_superblock_t *sb = inode_ref->fs->superblock;
-	uint64_t inode_size = ext4_inode_get_size(sb, inode_ref->inode);
-	uint32_t block_size = ext4_superblock_get_block_size(sb);
-
-	/* Calculate number of new logical block */
-	uint32_t new_block_idx = 0;
-	if (inode_size > 0) {
-		if ((inode_size % block_size) != 0)
-			inode_size += block_size - (inode_size % block_size);
-
-		new_block_idx = inode_size / block_size;
-	}
+	uint32_t block_limit = (1 << 15);
+	uint32_t phys_block = 0;
+	uint32_t goal = 0;
+	uint32_t n = 0;
 
 	/* Load the nearest leaf (with extent) */
 	ext4_extent_path_t *path;
 	errno_t rc2;
-	errno_t rc = ext4_extent_find_extent(inode_ref, new_block_idx, &path);
+	errno_t rc = ext4_extent_find_extent(inode_ref, iblock, &path);
 	if (rc != EOK)
 		return rc;
 
@@ -989,80 +985,62 @@ errno_t ext4_extent_append_block(ext4_inode_ref_t *inode_ref, uint32_t *iblock,
 	while (path_ptr->depth != 0)
 		path_ptr++;
 
-	/* Add new extent to the node if not present */
-	if (path_ptr->extent == NULL)
-		goto append_extent;
-
-	uint16_t block_count = ext4_extent_get_block_count(path_ptr->extent);
-	uint16_t block_limit = (1 << 15);
-
-	uint32_t phys_block = 0;
-	if (block_count < block_limit) {
-		/* There is space for new block in the extent */
-		if (block_count == 0) {
-			/* Existing extent is empty */
-			rc = ext4_balloc_alloc_block(inode_ref, &phys_block);
-			if (rc != EOK)
-				goto finish;
+	ext4_extent_t *extent = path_ptr->extent;
+	uint32_t block_count = 0;
 
-			/* Initialize extent */
-			ext4_extent_set_first_block(path_ptr->extent, new_block_idx);
-			ext4_extent_set_start(path_ptr->extent, phys_block);
-			ext4_extent_set_block_count(path_ptr->extent, 1);
-
-			/* Update i-node */
-			if (update_size) {
-				ext4_inode_set_size(inode_ref->inode, inode_size + block_size);
-				inode_ref->dirty = true;
-			}
+	if (extent != NULL) {
+		block_count = ext4_extent_get_block_count(extent);
 
-			path_ptr->block->dirty = true;
+		/* Prefer blocks physically following the last extent */
+		if (block_count > 0)
+			goal = ext4_extent_get_start(extent) + block_count;
+	}
 
+	if ((extent != NULL) && (block_count == 0)) {
+		/* Existing extent is empty */
+		rc = ext4_balloc_alloc_blocks(inode_ref, 0,
+		    min(count, block_limit), &phys_block, &n);
+		if (rc != EOK)
 			goto finish;
-		} else {
-			/* Existing extent contains some blocks */
-			phys_block = ext4_extent_get_start(path_ptr->extent);
-			phys_block += ext4_extent_get_block_count(path_ptr->extent);
 
-			/* Check if the following block is free for allocation */
-			bool free;
-			rc = ext4_balloc_try_alloc_block(inode_ref, phys_block, &free);
-			if (rc != EOK)
-				goto finish;
+		/* Initialize extent */
+		ext4_extent_set_first_block(extent, iblock);
+		ext4_extent_set_start(extent, phys_block);
+		ext4_extent_set_block_count(extent, n);
 
-			if (!free) {
-				/* Target is not free, new block must be appended to new extent */
-				goto append_extent;
-			}
+		path_ptr->block->dirty = true;
 
-			/* Update extent */
-			ext4_extent_set_block_count(path_ptr->extent, block_count + 1);
+		goto finish;
+	}
 
-			/* Update i-node */
-			if (update_size) {
-				ext4_inode_set_size(inode_ref->inode, inode_size + block_size);
-				inode_ref->dirty = true;
-			}
+	if ((extent != NULL) && (block_count < block_limit) &&
+	    (ext4_extent_get_first_block(extent) + block_count == iblock)) {
+		/* There is space for new blocks in the extent */
+		rc = ext4_balloc_alloc_blocks(inode_ref, goal,
+		    min(count, block_limit - block_count), &phys_block, &n);
+		if (rc != EOK)
+			goto finish;
 
+		if (phys_block == goal) {
+			/* Run continues the extent */
+			ext4_extent_set_block_count(extent, block_count + n);
 			path_ptr->block->dirty = true;
 
 			goto finish;
 		}
-	}
-
-append_extent:
-	/* Append new extent to the tree */
-	phys_block = 0;
 
-	/* Allocate new data block */
-	rc = ext4_balloc_alloc_block(inode_ref, &phys_block);
-	if (rc != EOK)
-		goto finish;
+		/* Run lies elsewhere, new extent must be appended for it */
+	} else {
+		rc = ext4_balloc_alloc_blocks(inode_ref, goal,
+		    min(count, block_limit), &phys_block, &n);
+		if (rc != EOK)
+			goto finish;
+	}
 
-	/* Append extent for new block (includes tree splitting if needed) */
-	rc = ext4_extent_append_extent(inode_ref, path, new_block_idx);
+	/* Append extent for new blocks (includes tree splitting if needed) */
+	rc = ext4_extent_append_extent(inode_ref, path, iblock);
 	if (rc != EOK) {
-		ext4_balloc_free_block(inode_ref, phys_block);
+		ext4_balloc_free_blocks(inode_ref, phys_block, n);
 		goto finish;
 	}
 
@@ -1070,24 +1048,18 @@ append_extent:
 	path_ptr = path + tree_depth;
 
 	/* Initialize newly created extent */
-	ext4_extent_set_block_count(path_ptr->extent, 1);
-	ext4_extent_set_first_block(path_ptr->extent, new_block_idx);
+	ext4_extent_set_block_count(path_ptr->extent, n);
+	ext4_extent_set_first_block(path_ptr->extent, iblock);
 	ext4_extent_set_start(path_ptr->extent, phys_block);
 
-	/* Update i-node */
-	if (update_size) {
-		ext4_inode_set_size(inode_ref->inode, inode_size + block_size);
-		inode_ref->dirty = true;
-	}
-
 	path_ptr->block->dirty = true;
 
 finish:
 	rc2 = EOK;
 
 	/* Set return values */
-	*iblock = new_block_idx;
 	*fblock = phys_block;
+	*appended = (rc == EOK) ? n : 0;
 
 	/*
 	 * Put loaded blocks
@@ -1107,6 +1079,52 @@ finish:
 	return rc;
 }
 
+/** Append data block to the i-node.
+ *
+ * This function allocates data block, tries to append it
+ * to some existing extent or creates new extents.
+ * It includes possible extent tree modifications (splitting).
+ *
+ * @param inode_ref I-node to append block to
+ * @param iblock    Output logical number of newly allocated block
+ * @param fblock    Output physical block address of newly allocated block
+ *
+ * @return Error code
+ *
+ */
+errno_t ext4_extent_append_block(ext4_inode_ref_t *inode_ref, uint32_t *iblock,
+    uint32_t *fblock, bool update_size)
+{
+	ext4_superblock_t *sb = inode_ref->fs->superblock;
+	uint64_t inode_size = ext4_inode_get_size(sb, inode_ref->inode);
+	uint32_t block_size = ext4_superblock_get_block_size(sb);
+
+	/* Calculate number of new logical block */
+	uint32_t new_block_idx = 0;
+	if (inode_size > 0) {
+		if ((inode_size % block_size) != 0)
+			inode_size += block_size - (inode_size % block_size);
+
+		new_block_idx = inode_size / block_size;
+	}
+
+	*iblock = new_block_idx;
+
+	uint32_t appended;
+	errno_t rc = ext4_extent_append_blocks(inode_ref, new_block_idx, 1,
+	    fblock, &appended);
+	if (rc != EOK)
+		return rc;
+
+	/* Update i-node */
+	if (update_size) {
+		ext4_inode_set_size(inode_ref->inode, inode_size + block_size);
+		inode_ref->dirty = true;
+	}
+
+	return EOK;
+}
+
 /**
  * @}
  */
@@ -58,6 +58,7 @@
 
 static errno_t ext4_filesystem_check_features(ext4_filesystem_t *, bool *);
 static errno_t ext4_filesystem_init_block_groups(ext4_filesystem_t *);
+static errno_t ext4_filesystem_release_alloc_ctxs(ext4_filesystem_t *);
 static errno_t ext4_filesystem_alloc_this_inode(ext4_filesystem_t *,
     uint32_t, ext4_inode_ref_t **, int);
 static uint32_t ext4_filesystem_inodes_per_block(ext4_superblock_t *);
@@ -80,6 +81,8 @@ static errno_t ext4_filesystem_init(ext4_filesystem_t *fs, service_id_t service_
 	ext4_superblock_t *temp_superblock = NULL;
 
 	fs->device = service_id;
+	list_initialize(&fs->alloc_ctxs);
+	fs->da_reserved = 0;
 
 	/* Initialize block library (4096 is size of communication channel) */
 	rc = block_init(fs->device, 4096);
@@ -472,6 +475,10 @@ error:
 }
 
 /** Close filesystem.
+ *
+ * Data of files still being written which cannot be written out are
+ * dropped, so that a failing write does not keep the file system
+ * mounted and unclean.
  *
  * @param fs Filesystem to be destroyed
  *
@@ -481,6 +488,9 @@ error:
  */
 errno_t ext4_filesystem_close(ext4_filesystem_t *fs)
 {
+	/* Write out data of files still being written */
+	(void) ext4_filesystem_release_alloc_ctxs(fs);
+
 	/* Write the superblock to the device */
 	ext4_superblock_set_state(fs->superblock, EXT4_SUPERBLOCK_STATE_VALID_FS);
 	errno_t rc = ext4_superblock_write_direct(fs->device, fs->superblock);
@@ -1512,6 +1522,171 @@ finish:
 	return rc;
 }
 
+/** Allocate blocks for data waiting for delayed allocation.
+ *
+ * The waiting blocks are mapped to extents in runs as long as the
+ * allocator can provide and their contents are written to the device.
+ *
+ * @param inode_ref I-node to flush
+ *
+ * @return Error code. Blocks which could not be allocated or written
+ *         keep waiting.
+ *
+ */
+errno_t ext4_filesystem_flush_delayed(ext4_inode_ref_t *inode_ref)
+{
+	ext4_filesystem_t *fs = inode_ref->fs;
+	ext4_alloc_ctx_t *ctx = ext4_balloc_ctx_find(fs, inode_ref->index);
+	if (ctx == NULL)
+		return EOK;
+
+	/* Allocations below use up the space reserved for the data */
+	ext4_balloc_dalloc_release(fs, ctx);
+	if (ctx->da_count == 0)
+		return EOK;
+
+	uint32_t block_size = ext4_superblock_get_block_size(fs->superblock);
+	uint32_t done = 0;
+	errno_t rc = EOK;
+
+	while (done < ctx->da_count) {
+		uint32_t fblock;
+		uint32_t count;
+
+		rc = ext4_extent_append_blocks(inode_ref, ctx->da_iblock + done,
+		    ctx->da_count - done, &fblock, &count);
+		if (rc != EOK)
+			break;
+
+		/* Write contents of the newly mapped blocks */
+		for (uint32_t i = 0; i < count; i++) {
+			block_t *block;
+			rc = block_get(&block, fs->device, fblock + i,
+			    BLOCK_FLAGS_NOREAD);
+			if (rc != EOK)
+				break;
+
+			memcpy(block->data, ctx->da_data +
+			    (done + i) * block_size, block_size);
+			block->dirty = true;
+
+			rc = block_put(block);
+			if (rc != EOK)
+				break;
+		}
+
+		if (rc != EOK) {
+			/*
+			 * Unmap the run, its blocks would expose whatever
+			 * they contained before. The data stay buffered.
+			 */
+			(void) ext4_extent_release_blocks_from(inode_ref,
+			    ctx->da_iblock + done);
+			break;
+		}
+
+		done += count;
+	}
+
+	if ((done > 0) && (done < ctx->da_count)) {
+		memmove(ctx->da_data, ctx->da_data + done * block_size,
+		    (ctx->da_count - done) * block_size);
+	}
+
+	ctx->da_iblock += done;
+	ctx->da_count -= done;
+
+	/* Keep space for the data still buffered, if there is any left */
+	if (ctx->da_count > 0)
+		(void) ext4_balloc_dalloc_reserve(inode_ref, ctx, ctx->da_count);
+
+	return rc;
+}
+
+/** Release allocation context of i-node.
+ *
+ * The preallocation window is returned to free space.
+ *
+ * @param inode_ref I-node
+ * @param flush     Write data waiting for delayed allocation if true,
+ *                  drop it otherwise
+ *
+ * @return Error code
+ *
+ */
+errno_t ext4_filesystem_release_alloc_ctx(ext4_inode_ref_t *inode_ref,
+    bool flush)
+{
+	ext4_alloc_ctx_t *ctx = ext4_balloc_ctx_find(inode_ref->fs,
+	    inode_ref->index);
+	if (ctx == NULL)
+		return EOK;
+
+	errno_t rc;
+	if (flush) {
+		rc = ext4_filesystem_flush_delayed(inode_ref);
+		if (rc != EOK)
+			return rc;
+	}
+
+	rc = ext4_balloc_discard_prealloc(inode_ref->fs, ctx);
+	if (rc != EOK)
+		return rc;
+
+	ext4_balloc_dalloc_release(inode_ref->fs, ctx);
+	ext4_balloc_ctx_destroy(ctx);
+	return EOK;
+}
+
+/** Release allocation contexts of all i-nodes.
+ *
+ * Waiting data are written out. Contexts which cannot be released
+ * cleanly are destroyed anyway, dropping their data. Blocks of their
+ * preallocation windows may then stay allocated until the file system
+ * is checked.
+ *
+ * @param fs Filesystem
+ *
+ * @return Error code of the first failure
+ *
+ */
+static errno_t ext4_filesystem_release_alloc_ctxs(ext4_filesystem_t *fs)
+{
+	errno_t rc = EOK;
+
+	while (!list_empty(&fs->alloc_ctxs)) {
+		ext4_alloc_ctx_t *ctx = list_get_instance(
+		    list_first(&fs->alloc_ctxs), ext4_alloc_ctx_t, link);
+		uint32_t index = ctx->index;
+
+		ext4_inode_ref_t *inode_ref;
+		errno_t rc2 = ext4_filesystem_get_inode_ref(fs, index,
+		    &inode_ref);
+		if (rc2 == EOK) {
+			rc2 = ext4_filesystem_release_alloc_ctx(inode_ref, true);
+			errno_t rc3 = ext4_filesystem_put_inode_ref(inode_ref);
+			if (rc2 == EOK)
+				rc2 = rc3;
+		}
+
+		if (rc2 == EOK)
+			continue;
+
+		if (rc == EOK)
+			rc = rc2;
+
+		ctx = ext4_balloc_ctx_find(fs, index);
+		if (ctx != NULL) {
+			(void) ext4_balloc_discard_prealloc(fs, ctx);
+			ctx->pa_count = 0;
+			ext4_balloc_dalloc_release(fs, ctx);
+			ext4_balloc_ctx_destroy(ctx);
+		}
+	}
+
+	return rc;
+}
+
 /** Truncate i-node data blocks.
  *
  * @param inode_ref I-node to be truncated
@@ -1529,6 +1704,11 @@ errno_t ext4_filesystem_truncate_inode(ext4_inode_ref_t *inode_ref,
 	if (!ext4_inode_can_truncate(sb, inode_ref->inode))
 		return EINVAL;
 
+	/* Map delayed data first, nothing of it survives truncation to zero */
+	errno_t rc = ext4_filesystem_release_alloc_ctx(inode_ref, new_size > 0);
+	if (rc != EOK)
+		return rc;
+
 	/* If sizes are equal, nothing has to be done. */
 	aoff64_t old_size = ext4_inode_get_size(sb, inode_ref->inode);
 	if (old_size == new_size)
@@ -1553,7 +1733,7 @@ errno_t ext4_filesystem_truncate_inode(ext4_inode_ref_t *inode_ref,
 	    EXT4_FEATURE_INCOMPAT_EXTENTS)) &&
 	    (ext4_inode_has_flag(inode_ref->inode, EXT4_INODE_FLAG_EXTENTS))) {
 		/* Extents require special operation */
-		errno_t rc = ext4_extent_release_blocks_from(inode_ref,
+		rc = ext4_extent_release_blocks_from(inode_ref,
 		    old_blocks_count - diff_blocks_count);
 		if (rc != EOK)
 			return rc;
@@ -1562,7 +1742,7 @@ errno_t ext4_filesystem_truncate_inode(ext4_inode_ref_t *inode_ref,
 
 		/* Starting from 1 because of logical blocks are numbered from 0 */
 		for (uint32_t i = 1; i <= diff_blocks_count; ++i) {
-			errno_t rc = ext4_filesystem_release_inode_block(inode_ref,
+			rc = ext4_filesystem_release_inode_block(inode_ref,
 			    old_blocks_count - i);
 			if (rc != EOK)
 				return rc;
@@ -55,6 +55,9 @@
 #include "ext4/fstypes.h"
 #include "ext4/superblock.h"
 
+/** Number of appended blocks buffered before they get allocated */
+#define EXT4_DALLOC_BLOCKS  32
+
 /* Forward declarations of auxiliary functions */
 
 static errno_t ext4_read_directory(ipc_call_t *, aoff64_t, size_t,
@@ -861,8 +864,8 @@ errno_t ext4_free_block_count(service_id_t service_id, uint64_t *count)
 	if (rc != EOK)
 		return rc;
 
-	ext4_superblock_t *sb = inst->filesystem->superblock;
-	*count = ext4_superblock_get_free_blocks_count(sb);
+	/* Blocks promised to delayed allocation are not free anymore */
+	*count = ext4_balloc_get_avail(inst->filesystem);
 
 	return EOK;
 }
@@ -1232,6 +1235,19 @@ errno_t ext4_read_file(ipc_call_t *call, aoff64_t pos, size_t size,
 	 */
 	uint8_t *buffer;
 	if (fs_block == 0) {
+		/* Block may be waiting for delayed allocation */
+		ext4_alloc_ctx_t *ctx = ext4_balloc_ctx_find(inst->filesystem,
+		    inode_ref->index);
+		if ((ctx != NULL) && (file_block >= ctx->da_iblock) &&
+		    (file_block < ctx->da_iblock + ctx->da_count)) {
+			buffer = ctx->da_data +
+			    (file_block - ctx->da_iblock) * block_size;
+			rc = async_data_read_finalize(call,
+			    buffer + offset_in_block, bytes);
+			*rbytes = bytes;
+			return rc;
+		}
+
 		buffer = malloc(bytes);
 		if (buffer == NULL) {
 			async_answer_0(call, ENOMEM);
@@ -1270,6 +1286,109 @@ errno_t ext4_read_file(ipc_call_t *call, aoff64_t pos, size_t size,
 	return EOK;
 }
 
+/** Write data of one block to the delayed allocation buffer.
+ *
+ * Blocks appended to the end of an extent-mapped file are collected
+ * in the allocation context of the file and mapped to extents all at
+ * once when the buffer gets flushed. A write which does not continue
+ * the buffered blocks flushes them and is left to the caller.
+ *
+ * @param call      IPC call with the data
+ * @param inode_ref I-node of the file
+ * @param pos       Position in file to start writing to
+ * @param bytes     Number of bytes to write, within one block
+ * @param buffered  Output value - true if the data were buffered
+ *
+ * @return Error code. The call is answered on error.
+ *
+ */
+static errno_t ext4_write_delayed(ipc_call_t *call, ext4_inode_ref_t *inode_ref,
+    aoff64_t pos, uint32_t bytes, bool *buffered)
+{
+	ext4_filesystem_t *fs = inode_ref->fs;
+	ext4_superblock_t *sb = fs->superblock;
+	uint32_t block_size = ext4_superblock_get_block_size(sb);
+	uint32_t iblock = pos / block_size;
+	ext4_alloc_ctx_t *ctx;
+
+	*buffered = false;
+
+	errno_t rc = ext4_balloc_ctx_get(fs, inode_ref->index, &ctx);
+	if (rc != EOK) {
+		async_answer_0(call, rc);
+		return rc;
+	}
+
+	if ((ctx->da_count == 0) || (iblock < ctx->da_iblock) ||
+	    (iblock > ctx->da_iblock + ctx->da_count)) {
+		uint64_t size = ext4_inode_get_size(sb, inode_ref->inode);
+		uint32_t end = (size + block_size - 1) / block_size;
+
+		if ((ctx->da_count > 0) || (iblock != end)) {
+			/* Not an append, let the caller map the block */
+			rc = ext4_filesystem_flush_delayed(inode_ref);
+			if (rc != EOK)
+				async_answer_0(call, rc);
+
+			return rc;
+		}
+
+		ctx->da_iblock = iblock;
+	}
+
+	bool append = (iblock == ctx->da_iblock + ctx->da_count);
+	if (append) {
+		if (ctx->da_count == EXT4_DALLOC_BLOCKS) {
+			rc = ext4_filesystem_flush_delayed(inode_ref);
+			if (rc != EOK) {
+				async_answer_0(call, rc);
+				return rc;
+			}
+
+			ctx->da_iblock = iblock;
+		}
+
+		/*
+		 * Do not buffer more than can be allocated later. Without
+		 * space to reserve, the caller allocates the block right
+		 * away, failing with ENOSPC if there is none.
+		 */
+		rc = ext4_balloc_dalloc_reserve(inode_ref, ctx, 1);
+		if (rc != EOK) {
+			rc = ext4_filesystem_flush_delayed(inode_ref);
+			if (rc != EOK)
+				async_answer_0(call, rc);
+
+			return rc;
+		}
+
+		if (ctx->da_data == NULL) {
+			ctx->da_data = malloc(EXT4_DALLOC_BLOCKS * block_size);
+			if (ctx->da_data == NULL) {
+				async_answer_0(call, ENOMEM);
+				return ENOMEM;
+			}
+		}
+
+		memset(ctx->da_data + ctx->da_count * block_size, 0,
+		    block_size);
+		ctx->da_count++;
+	}
+
+	uint8_t *data = ctx->da_data + (iblock - ctx->da_iblock) * block_size;
+	rc = async_data_write_finalize(call, data + (pos % block_size), bytes);
+	if (rc != EOK) {
+		/* The reservation is returned with the rest by the flush */
+		if (append)
+			ctx->da_count--;
+
+		return rc;
+	}
+
+	*buffered = true;
+	return EOK;
+}
+
 /** Write bytes to file
  *
  * @param service_id Device identifier
@@ -1322,11 +1441,25 @@ static errno_t ext4_write(service_id_t service_id, fs_index_t index, aoff64_t po
 		goto exit;
 	}
 
+	bool extents = (ext4_superblock_has_feature_incompatible(fs->superblock,
+	    EXT4_FEATURE_INCOMPAT_EXTENTS)) &&
+	    (ext4_inode_has_flag(inode_ref->inode, EXT4_INODE_FLAG_EXTENTS));
+
+	/* Unmapped blocks of regular files get allocated later */
+	if ((fblock == 0) && (extents) && (ext4_inode_is_type(fs->superblock,
+	    inode_ref->inode, EXT4_INODE_MODE_FILE))) {
+		bool buffered;
+		rc = ext4_write_delayed(&call, inode_ref, pos, bytes, &buffered);
+		if (rc != EOK)
+			goto exit;
+
+		if (buffered)
+			goto done;
+	}
+
 	/* Check for sparse file */
 	if (fblock == 0) {
-		if ((ext4_superblock_has_feature_incompatible(fs->superblock,
-		    EXT4_FEATURE_INCOMPAT_EXTENTS)) &&
-		    (ext4_inode_has_flag(inode_ref->inode, EXT4_INODE_FLAG_EXTENTS))) {
+		if (extents) {
 			uint32_t last_iblock =
 			    ext4_inode_get_size(fs->superblock, inode_ref->inode) /
 			    block_size;
@@ -1390,6 +1523,7 @@ static errno_t ext4_write(service_id_t service_id, fs_index_t index, aoff64_t po
 	if (rc != EOK)
 		goto exit;
 
+done:
 	/* Do some counting */
 	uint32_t old_inode_size = ext4_inode_get_size(fs->superblock,
 	    inode_ref->inode);
@@ -1444,7 +1578,25 @@ static errno_t ext4_truncate(service_id_t service_id, fs_index_t index,
  */
 static errno_t ext4_close(service_id_t service_id, fs_index_t index)
 {
-	return EOK;
+	ext4_instance_t *inst;
+	errno_t rc = ext4_instance_get(service_id, &inst);
+	if (rc != EOK)
+		return rc;
+
+	/* Nothing to do unless the file has been written */
+	if (ext4_balloc_ctx_find(inst->filesystem, index) == NULL)
+		return EOK;
+
+	fs_node_t *fn;
+	rc = ext4_node_get(&fn, service_id, index);
+	if (rc != EOK)
+		return rc;
+
+	ext4_node_t *enode = EXT4_NODE(fn);
+	rc = ext4_filesystem_release_alloc_ctx(enode->inode_ref, true);
+	errno_t const rc2 = ext4_node_put(fn);
+
+	return rc == EOK ? rc2 : rc;
 }
 
 /** Destroy node specified by index.
@@ -1480,9 +1632,11 @@ static errno_t ext4_sync(service_id_t service_id, fs_index_t index)
 		return rc;
 
 	ext4_node_t *enode = EXT4_NODE(fn);
+	rc = ext4_filesystem_flush_delayed(enode->inode_ref);
 	enode->inode_ref->dirty = true;
 
-	return ext4_node_put(fn);
+	errno_t const rc2 = ext4_node_put(fn);
+	return rc == EOK ? rc2 : rc;
 }
 
 /** VFS operations
@@ -36,21 +36,38 @@
 #ifndef LIBNETTL_PORTRNG_H_
 #define LIBNETTL_PORTRNG_H_
 
+#include <adt/hash_table.h>
+#include <adt/list.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 /** Allocated port */
 typedef struct {
+	/** Link to portrng_t.used_list */
+	link_t lprng_list;
 	/** Link to portrng_t.used */
-	link_t lprng;
+	ht_link_t lprng;
 	/** Port number */
 	uint16_t pn;
 	/** User argument */
 	void *arg;
 } portrng_port_t;
 
+/** Port range.
+ *
+ * Most ranges only ever have a few ports allocated, these are kept in
+ * a list. The hash table is only created once the range grows larger.
+ */
 typedef struct {
-	list_t used; /* of portrng_port_t */
+	list_t used_list; /* of portrng_port_t */
+	hash_table_t used; /* of portrng_port_t, valid if @c hashed is set */
+	/** Ports are kept in @c used instead of @c used_list */
+	bool hashed;
+	/** Number of allocated ports */
+	size_t nused;
+	/** Next dynamic port number to try when allocating any port */
+	uint16_t dyn_next;
 } portrng_t;
 
 typedef enum {
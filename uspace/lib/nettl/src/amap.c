@@ -47,8 +47,15 @@
  *
  * In the unspecified case only the local port is known and the entry matches
  * all remote and local addresses.
+ *
+ * Repla and laddr entries are kept in hash tables and ports within each
+ * entry are hashed, too, so that finding the association for an incoming
+ * datagram or segment takes constant time regardless of the number of
+ * associations.
  */
 
+#include <adt/hash.h>
+#include <adt/hash_table.h>
 #include <adt/list.h>
 #include <errno.h>
 #include <inet/addr.h>
@@ -58,6 +65,69 @@
 #include <stdint.h>
 #include <stdlib.h>
 
+/** Repla lookup key */
+typedef struct {
+	/** Remote endpoint */
+	inet_ep_t *rep;
+	/** Local address */
+	inet_addr_t *laddr;
+} amap_repla_key_t;
+
+static size_t amap_repla_hash(const ht_link_t *);
+static size_t amap_repla_key_hash(void *);
+static bool amap_repla_key_equal(void *, const ht_link_t *);
+static size_t amap_laddr_hash(const ht_link_t *);
+static size_t amap_laddr_key_hash(void *);
+static bool amap_laddr_key_equal(void *, const ht_link_t *);
+
+static hash_table_ops_t amap_repla_ops = {
+	.hash = amap_repla_hash,
+	.key_hash = amap_repla_key_hash,
+	.key_equal = amap_repla_key_equal,
+	.equal = NULL,
+	.remove_callback = NULL
+};
+
+static hash_table_ops_t amap_laddr_ops = {
+	.hash = amap_laddr_hash,
+	.key_hash = amap_laddr_key_hash,
+	.key_equal = amap_laddr_key_equal,
+	.equal = NULL,
+	.remove_callback = NULL
+};
+
+/** Compute hash of an internet address.
+ *
+ * @param addr Address
+ * @return Hash value consistent with inet_addr_compare()
+ */
+static size_t amap_addr_hash(inet_addr_t *addr)
+{
+	size_t hash;
+	size_t i;
+
+	hash = hash_mix(addr->version);
+
+	switch (addr->version) {
+	case ip_v4:
+		hash = hash_combine(hash, hash_mix(addr->addr));
+		break;
+	case ip_v6:
+		for (i = 0; i < sizeof(addr128_t); i += 4) {
+			hash = hash_combine(hash, hash_mix(
+			    ((uint32_t) addr->addr6[i] << 24) |
+			    ((uint32_t) addr->addr6[i + 1] << 16) |
+			    ((uint32_t) addr->addr6[i + 2] << 8) |
+			    addr->addr6[i + 3]));
+		}
+		break;
+	default:
+		break;
+	}
+
+	return hash;
+}
+
 /** Convert association map flags to port range flags.
  *
  * @param flags Association map flags
@@ -97,8 +167,19 @@ errno_t amap_create(amap_t **rmap)
 		return ENOMEM;
 	}
 
-	list_initialize(&map->repla);
-	list_initialize(&map->laddr);
+	if (!hash_table_create(&map->repla, 0, 0, &amap_repla_ops)) {
+		portrng_destroy(map->unspec);
+		free(map);
+		return ENOMEM;
+	}
+
+	if (!hash_table_create(&map->laddr, 0, 0, &amap_laddr_ops)) {
+		hash_table_destroy(&map->repla);
+		portrng_destroy(map->unspec);
+		free(map);
+		return ENOMEM;
+	}
+
 	list_initialize(&map->llink);
 
 	*rmap = map;
@@ -113,9 +194,11 @@ void amap_destroy(amap_t *map)
 {
 	log_msg(LOG_DEFAULT, LVL_DEBUG2, "amap_destroy()");
 
-	assert(list_empty(&map->repla));
-	assert(list_empty(&map->laddr));
+	assert(hash_table_empty(&map->repla));
+	assert(hash_table_empty(&map->laddr));
 	assert(list_empty(&map->llink));
+	hash_table_destroy(&map->repla);
+	hash_table_destroy(&map->laddr);
 	free(map);
 }
 
@@ -133,34 +216,27 @@ void amap_destroy(amap_t *map)
 static errno_t amap_repla_find(amap_t *map, inet_ep_t *rep, inet_addr_t *la,
     amap_repla_t **rrepla)
 {
-	char *sraddr, *sladdr;
-
-	(void) inet_addr_format(&rep->addr, &sraddr);
-	(void) inet_addr_format(la, &sladdr);
-
-	log_msg(LOG_DEFAULT, LVL_DEBUG2, "amap_repla_find(): rep=(%s,%" PRIu16
-	    ") la=%s", sraddr, rep->port, sladdr);
-	free(sraddr);
-	free(sladdr);
-
-	list_foreach(map->repla, lamap, amap_repla_t, repla) {
-		(void) inet_addr_format(&repla->rep.addr, &sraddr);
-		(void) inet_addr_format(&repla->laddr, &sladdr);
-		log_msg(LOG_DEFAULT, LVL_DEBUG2, "amap_repla_find(): "
-		    "compare to rep=(%s, %" PRIu16 ") la=%s",
-		    sraddr, repla->rep.port, sladdr);
-		free(sraddr);
-		free(sladdr);
-		if (inet_addr_compare(&repla->rep.addr, &rep->addr) &&
-		    repla->rep.port == rep->port &&
-		    inet_addr_compare(&repla->laddr, la)) {
-			*rrepla = repla;
-			return EOK;
-		}
+	amap_repla_key_t key;
+	ht_link_t *link;
+
+	/*
+	 * This is called for every received datagram. Do not format
+	 * addresses here, logging only the port is cheap.
+	 */
+	log_msg(LOG_DEFAULT, LVL_DEBUG2, "amap_repla_find(): rport=%" PRIu16,
+	    rep->port);
+
+	key.rep = rep;
+	key.laddr = la;
+
+	link = hash_table_find(&map->repla, &key);
+	if (link == NULL) {
+		*rrepla = NULL;
+		return ENOENT;
 	}
 
-	*rrepla = NULL;
-	return ENOENT;
+	*rrepla = hash_table_get_inst(link, amap_repla_t, lamap);
+	return EOK;
 }
 
 /** Insert repla.
@@ -194,7 +270,7 @@ static errno_t amap_repla_insert(amap_t *map, inet_ep_t *rep, inet_addr_t *la,
 
 	repla->rep = *rep;
 	repla->laddr = *la;
-	list_append(&repla->lamap, &map->repla);
+	hash_table_insert(&map->repla, &repla->lamap);
 
 	*rrepla = repla;
 	return EOK;
@@ -209,7 +285,7 @@ static errno_t amap_repla_insert(amap_t *map, inet_ep_t *rep, inet_addr_t *la,
  */
 static void amap_repla_remove(amap_t *map, amap_repla_t *repla)
 {
-	list_remove(&repla->lamap);
+	hash_table_remove_item(&map->repla, &repla->lamap);
 	portrng_destroy(repla->portrng);
 	free(repla);
 }
@@ -227,15 +303,16 @@ static void amap_repla_remove(amap_t *map, amap_repla_t *repla)
 static errno_t amap_laddr_find(amap_t *map, inet_addr_t *addr,
     amap_laddr_t **rladdr)
 {
-	list_foreach(map->laddr, lamap, amap_laddr_t, laddr) {
-		if (inet_addr_compare(&laddr->laddr, addr)) {
-			*rladdr = laddr;
-			return EOK;
-		}
+	ht_link_t *link;
+
+	link = hash_table_find(&map->laddr, addr);
+	if (link == NULL) {
+		*rladdr = NULL;
+		return ENOENT;
 	}
 
-	*rladdr = NULL;
-	return ENOENT;
+	*rladdr = hash_table_get_inst(link, amap_laddr_t, lamap);
+	return EOK;
 }
 
 /** Insert laddr.
@@ -266,7 +343,7 @@ static errno_t amap_laddr_insert(amap_t *map, inet_addr_t *addr,
 	}
 
 	laddr->laddr = *addr;
-	list_append(&laddr->lamap, &map->laddr);
+	hash_table_insert(&map->laddr, &laddr->lamap);
 
 	*rladdr = laddr;
 	return EOK;
@@ -281,7 +358,7 @@ static errno_t amap_laddr_insert(amap_t *map, inet_addr_t *addr,
  */
 static void amap_laddr_remove(amap_t *map, amap_laddr_t *laddr)
 {
-	list_remove(&laddr->lamap);
+	hash_table_remove_item(&map->laddr, &laddr->lamap);
 	portrng_destroy(laddr->portrng);
 	free(laddr);
 }
@@ -755,8 +832,8 @@ errno_t amap_find_match(amap_t *map, inet_ep2_t *epp, void **rarg)
 	}
 
 	/* Local link */
-	rc = amap_llink_find(map, epp->local_link, &llink);
-	if (epp->local_link != 0 && rc == EOK) {
+	if (epp->local_link != 0 &&
+	    amap_llink_find(map, epp->local_link, &llink) == EOK) {
 		rc = portrng_find_port(llink->portrng, epp->local.port,
 		    rarg);
 		if (rc == EOK) {
@@ -778,6 +855,61 @@ errno_t amap_find_match(amap_t *map, inet_ep2_t *epp, void **rarg)
 	return ENOENT;
 }
 
+/** Return hash of repla entry. */
+static size_t amap_repla_hash(const ht_link_t *item)
+{
+	amap_repla_t *repla = hash_table_get_inst(item, amap_repla_t, lamap);
+	amap_repla_key_t key;
+
+	key.rep = &repla->rep;
+	key.laddr = &repla->laddr;
+	return amap_repla_key_hash(&key);
+}
+
+/** Return hash of repla key. */
+static size_t amap_repla_key_hash(void *arg)
+{
+	amap_repla_key_t *key = (amap_repla_key_t *) arg;
+	size_t hash;
+
+	hash = amap_addr_hash(&key->rep->addr);
+	hash = hash_combine(hash, hash_mix(key->rep->port));
+	return hash_combine(hash, amap_addr_hash(key->laddr));
+}
+
+/** Determine if repla entry matches key. */
+static bool amap_repla_key_equal(void *arg, const ht_link_t *item)
+{
+	amap_repla_key_t *key = (amap_repla_key_t *) arg;
+	amap_repla_t *repla = hash_table_get_inst(item, amap_repla_t, lamap);
+
+	return repla->rep.port == key->rep->port &&
+	    inet_addr_compare(&repla->rep.addr, &key->rep->addr) &&
+	    inet_addr_compare(&repla->laddr, key->laddr);
+}
+
+/** Return hash of laddr entry. */
+static size_t amap_laddr_hash(const ht_link_t *item)
+{
+	amap_laddr_t *laddr = hash_table_get_inst(item, amap_laddr_t, lamap);
+
+	return amap_addr_hash(&laddr->laddr);
+}
+
+/** Return hash of laddr key. */
+static size_t amap_laddr_key_hash(void *arg)
+{
+	return amap_addr_hash((inet_addr_t *) arg);
+}
+
+/** Determine if laddr entry matches key. */
+static bool amap_laddr_key_equal(void *arg, const ht_link_t *item)
+{
+	amap_laddr_t *laddr = hash_table_get_inst(item, amap_laddr_t, lamap);
+
+	return inet_addr_compare(&laddr->laddr, (inet_addr_t *) arg);
+}
+
 /**
  * @}
  */
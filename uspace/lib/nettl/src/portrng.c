@@ -36,8 +36,10 @@
  * Allocates port numbers from IETF port number ranges.
  */
 
-#include <adt/list.h>
+#include <adt/hash.h>
+#include <adt/hash_table.h>
 #include <errno.h>
+#include <adt/list.h>
 #include <inet/endpoint.h>
 #include <nettl/portrng.h>
 #include <stdint.h>
@@ -45,6 +47,68 @@
 
 #include <io/log.h>
 
+static size_t portrng_port_hash(const ht_link_t *);
+static size_t portrng_port_key_hash(void *);
+static bool portrng_port_key_equal(void *, const ht_link_t *);
+
+static hash_table_ops_t portrng_port_ops = {
+	.hash = portrng_port_hash,
+	.key_hash = portrng_port_key_hash,
+	.key_equal = portrng_port_key_equal,
+	.equal = NULL,
+	.remove_callback = NULL
+};
+
+/** Number of allocated ports above which a port range uses a hash table */
+#define PORTRNG_LIST_MAX  16
+
+/** Find allocated port.
+ *
+ * @param pr   Port range
+ * @param pnum Port number
+ * @return Allocated port or @c NULL if @a pnum is not allocated
+ */
+static portrng_port_t *portrng_lookup(portrng_t *pr, uint16_t pnum)
+{
+	ht_link_t *link;
+
+	if (pr->hashed) {
+		link = hash_table_find(&pr->used, &pnum);
+		if (link == NULL)
+			return NULL;
+
+		return hash_table_get_inst(link, portrng_port_t, lprng);
+	}
+
+	list_foreach(pr->used_list, lprng_list, portrng_port_t, port) {
+		if (port->pn == pnum)
+			return port;
+	}
+
+	return NULL;
+}
+
+/** Move allocated ports of a port range from list to hash table.
+ *
+ * If the hash table cannot be created, the ports stay in the list.
+ *
+ * @param pr Port range
+ */
+static void portrng_make_hashed(portrng_t *pr)
+{
+	if (!hash_table_create(&pr->used, 0, 0, &portrng_port_ops))
+		return;
+
+	while (!list_empty(&pr->used_list)) {
+		portrng_port_t *port = list_get_instance(
+		    list_first(&pr->used_list), portrng_port_t, lprng_list);
+		list_remove(&port->lprng_list);
+		hash_table_insert(&pr->used, &port->lprng);
+	}
+
+	pr->hashed = true;
+}
+
 /** Create port range.
  *
  * @param rpr Place to store pointer to new port range
@@ -60,7 +124,8 @@ errno_t portrng_create(portrng_t **rpr)
 	if (pr == NULL)
 		return ENOMEM;
 
-	list_initialize(&pr->used);
+	list_initialize(&pr->used_list);
+	pr->dyn_next = inet_port_dyn_lo;
 	*rpr = pr;
 	log_msg(LOG_DEFAULT, LVL_DEBUG2, "portrng_create() - end");
 	return EOK;
@@ -73,7 +138,8 @@ errno_t portrng_create(portrng_t **rpr)
 void portrng_destroy(portrng_t *pr)
 {
 	log_msg(LOG_DEFAULT, LVL_DEBUG2, "portrng_destroy()");
-	assert(list_empty(&pr->used));
+	assert(pr->nused == 0);
+	assert(!pr->hashed);
 	free(pr);
 }
 
@@ -97,32 +163,33 @@ errno_t portrng_alloc(portrng_t *pr, uint16_t pnum, void *arg,
 {
 	portrng_port_t *p;
 	uint32_t i;
-	bool found;
+	uint16_t pn;
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG2, "portrng_alloc() - begin");
 
 	if (pnum == inet_port_any) {
-
+		/*
+		 * Continue where the previous allocation left off so that
+		 * we do not need to skip all ports allocated so far.
+		 */
+		pn = pr->dyn_next;
 		for (i = inet_port_dyn_lo; i <= inet_port_dyn_hi; i++) {
-			log_msg(LOG_DEFAULT, LVL_DEBUG2, "trying %" PRIu32, i);
-			found = false;
-			list_foreach(pr->used, lprng, portrng_port_t, port) {
-				if (port->pn == pnum) {
-					found = true;
-					break;
-				}
-			}
-
-			if (!found) {
-				pnum = i;
+			if (portrng_lookup(pr, pn) == NULL) {
+				pnum = pn;
 				break;
 			}
+
+			pn = (pn < inet_port_dyn_hi) ? pn + 1 :
+			    inet_port_dyn_lo;
 		}
 
 		if (pnum == inet_port_any) {
 			/* No free port found */
 			return ENOENT;
 		}
+
+		pr->dyn_next = (pnum < inet_port_dyn_hi) ? pnum + 1 :
+		    inet_port_dyn_lo;
 		log_msg(LOG_DEFAULT, LVL_DEBUG2, "selected %" PRIu16, pnum);
 	} else {
 		log_msg(LOG_DEFAULT, LVL_DEBUG2, "user asked for %" PRIu16, pnum);
@@ -133,11 +200,9 @@ errno_t portrng_alloc(portrng_t *pr, uint16_t pnum, void *arg,
 			return EINVAL;
 		}
 
-		list_foreach(pr->used, lprng, portrng_port_t, port) {
-			if (port->pn == pnum) {
-				log_msg(LOG_DEFAULT, LVL_DEBUG2, "port already used");
-				return EEXIST;
-			}
+		if (portrng_lookup(pr, pnum) != NULL) {
+			log_msg(LOG_DEFAULT, LVL_DEBUG2, "port already used");
+			return EEXIST;
 		}
 	}
 
@@ -147,7 +212,15 @@ errno_t portrng_alloc(portrng_t *pr, uint16_t pnum, void *arg,
 
 	p->pn = pnum;
 	p->arg = arg;
-	list_append(&p->lprng, &pr->used);
+
+	if (!pr->hashed && pr->nused >= PORTRNG_LIST_MAX)
+		portrng_make_hashed(pr);
+
+	if (pr->hashed)
+		hash_table_insert(&pr->used, &p->lprng);
+	else
+		list_append(&p->lprng_list, &pr->used_list);
+	pr->nused++;
 	*apnum = pnum;
 	log_msg(LOG_DEFAULT, LVL_DEBUG2, "portrng_alloc() - end OK pn=%" PRIu16,
 	    pnum);
@@ -164,14 +237,14 @@ errno_t portrng_alloc(portrng_t *pr, uint16_t pnum, void *arg,
  */
 errno_t portrng_find_port(portrng_t *pr, uint16_t pnum, void **rarg)
 {
-	list_foreach(pr->used, lprng, portrng_port_t, port) {
-		if (port->pn == pnum) {
-			*rarg = port->arg;
-			return EOK;
-		}
-	}
+	portrng_port_t *port;
+
+	port = portrng_lookup(pr, pnum);
+	if (port == NULL)
+		return ENOENT;
 
-	return ENOENT;
+	*rarg = port->arg;
+	return EOK;
 }
 
 /** Free port in port range.
@@ -181,21 +254,28 @@ errno_t portrng_find_port(portrng_t *pr, uint16_t pnum, void **rarg)
  */
 void portrng_free_port(portrng_t *pr, uint16_t pnum)
 {
+	portrng_port_t *port;
+
 	log_msg(LOG_DEFAULT, LVL_DEBUG2, "portrng_free_port(%u)", pnum);
-	log_msg(LOG_DEFAULT, LVL_DEBUG2, "portrng_free_port() - begin");
-	list_foreach(pr->used, lprng, portrng_port_t, port) {
-		log_msg(LOG_DEFAULT, LVL_DEBUG2, "portrng_free_port - check port %u", port->pn);
-		if (port->pn == pnum) {
-			log_msg(LOG_DEFAULT, LVL_DEBUG2, "portrng_free_port - OK");
-			list_remove(&port->lprng);
-			free(port);
-			log_msg(LOG_DEFAULT, LVL_DEBUG2, "portrng_free_port() - end");
-			return;
-		}
+
+	port = portrng_lookup(pr, pnum);
+	if (port == NULL) {
+		log_msg(LOG_DEFAULT, LVL_DEBUG2, "portrng_free_port - FAIL");
+		assert(false);
+		return;
 	}
 
-	log_msg(LOG_DEFAULT, LVL_DEBUG2, "portrng_free_port - FAIL");
-	assert(false);
+	if (pr->hashed)
+		hash_table_remove_item(&pr->used, &port->lprng);
+	else
+		list_remove(&port->lprng_list);
+	free(port);
+
+	/* Give the memory of the hash table back once the range is empty */
+	if (--pr->nused == 0 && pr->hashed) {
+		hash_table_destroy(&pr->used);
+		pr->hashed = false;
+	}
 }
 
 /** Determine if port range is empty.
@@ -205,8 +285,31 @@ void portrng_free_port(portrng_t *pr, uint16_t pnum)
  */
 bool portrng_empty(portrng_t *pr)
 {
-	log_msg(LOG_DEFAULT, LVL_DEBUG2, "portrng_empty()");
-	return list_empty(&pr->used);
+	return pr->nused == 0;
+}
+
+/** Return hash of allocated port. */
+static size_t portrng_port_hash(const ht_link_t *item)
+{
+	portrng_port_t *port = hash_table_get_inst(item, portrng_port_t,
+	    lprng);
+
+	return hash_mix(port->pn);
+}
+
+/** Return hash of port number key. */
+static size_t portrng_port_key_hash(void *key)
+{
+	return hash_mix(*(uint16_t *)key);
+}
+
+/** Determine if allocated port has the port number @a key. */
+static bool portrng_port_key_equal(void *key, const ht_link_t *item)
+{
+	portrng_port_t *port = hash_table_get_inst(item, portrng_port_t,
+	    lprng);
+
+	return port->pn == *(uint16_t *)key;
 }
 
 /**
@@ -43,6 +43,7 @@
 #include <ddf/driver.h>
 #include <device/hw_res_parsed.h>
 #include <ops/nic.h>
+#include <stdbool.h>
 
 #define DEVICE_CATEGORY_NIC "nic"
 
@@ -205,6 +206,25 @@ typedef errno_t (*poll_mode_change_handler)(nic_t *,
  */
 typedef void (*poll_request_handler)(nic_t *);
 
+/**
+ * Event handler called in NIC_POLL_ADAPTIVE mode when the NIC should process
+ * its received frames.
+ *
+ * @param nic_data	NICF main structure
+ * @param budget	Maximal number of frames to process
+ *
+ * @return Number of frames processed
+ */
+typedef unsigned (*poll_budget_handler)(nic_t *, unsigned);
+
+/**
+ * Event handler called in NIC_POLL_ADAPTIVE mode when the NIC should enable
+ * receive interrupts again.
+ *
+ * @param nic_data	NICF main structure
+ */
+typedef void (*irq_enable_handler)(nic_t *);
+
 /* nic_t allocation and deallocation */
 extern nic_t *nic_create_and_bind(ddf_dev_t *);
 extern void nic_unbind_and_destroy(ddf_dev_t *);
@@ -228,6 +248,8 @@ extern void nic_set_wol_virtue_change_handlers(nic_t *,
     wol_virtue_add_handler, wol_virtue_remove_handler);
 extern void nic_set_poll_handlers(nic_t *,
     poll_mode_change_handler, poll_request_handler);
+extern void nic_set_adaptive_poll_handlers(nic_t *,
+    poll_budget_handler, irq_enable_handler);
 
 /* General driver functions */
 extern ddf_dev_t *nic_get_ddf_dev(nic_t *);
@@ -244,6 +266,7 @@ extern void nic_query_address(nic_t *, nic_address_t *);
 extern void nic_received_frame(nic_t *, nic_frame_t *);
 extern void nic_received_frame_list(nic_t *, nic_frame_list_t *);
 extern nic_poll_mode_t nic_query_poll_mode(nic_t *, struct timespec *);
+extern bool nic_adaptive_irq(nic_t *);
 
 /* Statistics updates */
 extern void nic_report_send_ok(nic_t *, size_t, size_t);
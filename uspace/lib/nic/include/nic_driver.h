@@ -56,6 +56,16 @@ struct sw_poll_info {
 	volatile int running;
 };
 
+struct adaptive_poll_info {
+	fid_t fibril;
+	/** Protects scheduled */
+	fibril_mutex_t lock;
+	/** Signalled when an interrupt schedules polling */
+	fibril_condvar_t cv;
+	/** Interrupt arrived, the NIC is being polled with interrupts disabled */
+	bool scheduled;
+};
+
 struct nic {
 	/**
 	 * Device from device manager's point of view.
@@ -79,6 +89,8 @@ struct nic {
 	nic_address_t default_mac;
 	/** Client callback session */
 	async_sess_t *client_session;
+	/** Client does not understand NIC_EV_RECEIVED_BATCH */
+	bool batch_unsupported;
 	/** Current polling mode of the NIC */
 	nic_poll_mode_t poll_mode;
 	/** Polling period (applicable when poll_mode == NIC_POLL_PERIODIC) */
@@ -89,6 +101,8 @@ struct nic {
 	struct timespec default_poll_period;
 	/** Software period fibrill information */
 	struct sw_poll_info sw_poll_info;
+	/** Adaptive polling fibril information */
+	struct adaptive_poll_info adaptive_poll_info;
 	/**
 	 * Lock on everything but statistics, rx control and wol virtues. This lock
 	 * cannot be used if filters_lock or stats_lock is already held - you must
@@ -194,6 +208,20 @@ struct nic {
 	 * The implementation is optional.
 	 */
 	poll_request_handler on_poll_request;
+	/**
+	 * Event handler called when the NIC should process received frames
+	 * in NIC_POLL_ADAPTIVE mode.
+	 * Called with the main_lock locked for reading.
+	 * The implementation is optional.
+	 */
+	poll_budget_handler on_poll_budget;
+	/**
+	 * Event handler called when the NIC should enable receive interrupts
+	 * at the end of polling in NIC_POLL_ADAPTIVE mode.
+	 * Called with the main_lock locked for reading.
+	 * Must be implemented if on_poll_budget is.
+	 */
+	irq_enable_handler on_irq_enable;
 	/** Data specific for particular driver */
 	void *specific;
 };
@@ -36,6 +36,7 @@
  * @brief Internal implementation of general NIC operations
  */
 
+#include <align.h>
 #include <assert.h>
 #include <fibril_synch.h>
 #include <ns.h>
@@ -46,6 +47,8 @@
 #include <ddf/interrupt.h>
 #include <ops/nic.h>
 #include <errno.h>
+#include <macros.h>
+#include <nic_iface.h>
 
 #include "nic_driver.h"
 #include "nic_ev.h"
@@ -53,6 +56,13 @@
 
 #define NIC_GLOBALS_MAX_CACHE_SIZE 16
 
+/** Maximal number of frames processed by one poll in NIC_POLL_ADAPTIVE */
+#define NIC_POLL_BUDGET  64
+/** Number of empty polls after which interrupts are enabled again */
+#define NIC_POLL_IDLE_LIMIT  2
+/** Interval between polls in NIC_POLL_ADAPTIVE if no period was given */
+#define NIC_POLL_INTERVAL_USEC  100
+
 nic_globals_t nic_globals;
 
 /**
@@ -232,6 +242,20 @@ void nic_set_poll_handlers(nic_t *nic_data,
 	nic_data->on_poll_request = on_poll_req;
 }
 
+/**
+ * Setup handlers for the NIC_POLL_ADAPTIVE mode.
+ * This function can be called only in the add_device handler.
+ *
+ * @param on_poll_budget	Called to process at most given number of frames
+ * @param on_irq_enable		Called when receive interrupts should be enabled
+ */
+void nic_set_adaptive_poll_handlers(nic_t *nic_data,
+    poll_budget_handler on_poll_budget, irq_enable_handler on_irq_enable)
+{
+	nic_data->on_poll_budget = on_poll_budget;
+	nic_data->on_irq_enable = on_irq_enable;
+}
+
 /**
  * Connect to the parent's driver and get HW resources list in parsed format.
  * Note: this function should be called only from add_device handler, therefore
@@ -412,6 +436,14 @@ errno_t nic_report_poll_mode(nic_t *nic_data, nic_poll_mode_t mode,
 		} else {
 			rc = EINVAL;
 		}
+	} else if (mode == NIC_POLL_ADAPTIVE) {
+		if (nic_data->on_poll_budget == NULL ||
+		    nic_data->on_irq_enable == NULL) {
+			rc = EINVAL;
+		} else if (period) {
+			memcpy(&nic_data->default_poll_period, period, sizeof(struct timespec));
+			memcpy(&nic_data->poll_period, period, sizeof(struct timespec));
+		}
 	}
 	fibril_rwlock_write_unlock(&nic_data->main_lock);
 	return rc;
@@ -562,26 +594,218 @@ void nic_received_frame(nic_t *nic_data, nic_frame_t *frame)
 	nic_release_frame(nic_data, frame);
 }
 
+/** Send a batch of frames to the client.
+ *
+ * If the client does not understand batches, the frames are unpacked and
+ * sent one by one, now and for the rest of the session.
+ *
+ * @param nic_data
+ * @param buf		Frames, each preceded by nic_batch_hdr_t
+ * @param size		Size of @a buf in bytes
+ * @param count		Number of frames in @a buf
+ */
+static void nic_send_batch(nic_t *nic_data, uint8_t *buf, size_t size,
+    size_t count)
+{
+	nic_batch_hdr_t *hdr;
+	size_t offs;
+	errno_t rc;
+
+	if (count == 0)
+		return;
+
+	rc = nic_ev_received_batch(nic_data->client_session, buf, size, count);
+	if (rc != ENOTSUP)
+		return;
+
+	nic_data->batch_unsupported = true;
+
+	offs = 0;
+	while (offs < size) {
+		hdr = (nic_batch_hdr_t *) (buf + offs);
+		nic_ev_received(nic_data->client_session, &hdr[1], hdr->size);
+		offs += ALIGN_UP(sizeof(*hdr) + hdr->size, sizeof(*hdr));
+	}
+}
+
+/** Deliver accepted frames to the client and release them.
+ *
+ * Frames are packed into as few NIC_EV_RECEIVED_BATCH events as possible.
+ *
+ * @param nic_data
+ * @param frames	List of accepted frames
+ */
+static void nic_deliver_frames(nic_t *nic_data, list_t *frames)
+{
+	nic_batch_hdr_t *hdr;
+	uint8_t *buf = NULL;
+	size_t total = 0;
+	size_t size = 0;
+	size_t count = 0;
+	size_t rsize;
+
+	list_foreach(*frames, link, nic_frame_t, frame) {
+		total += ALIGN_UP(sizeof(*hdr) + frame->size, sizeof(*hdr));
+		count++;
+	}
+
+	/* A batch is not worth it for a single frame */
+	if (count > 1 && !nic_data->batch_unsupported)
+		buf = malloc(min(total, NIC_BATCH_MAX_SIZE));
+
+	count = 0;
+	while (!list_empty(frames)) {
+		nic_frame_t *frame =
+		    list_get_instance(list_first(frames), nic_frame_t, link);
+		list_remove(&frame->link);
+
+		rsize = ALIGN_UP(sizeof(*hdr) + frame->size, sizeof(*hdr));
+		if (buf == NULL || rsize > NIC_BATCH_MAX_SIZE) {
+			nic_ev_received(nic_data->client_session, frame->data,
+			    frame->size);
+			nic_release_frame(nic_data, frame);
+			continue;
+		}
+
+		if (size + rsize > NIC_BATCH_MAX_SIZE) {
+			nic_send_batch(nic_data, buf, size, count);
+			size = 0;
+			count = 0;
+		}
+
+		hdr = (nic_batch_hdr_t *) (buf + size);
+		hdr->size = frame->size;
+		memcpy(&hdr[1], frame->data, frame->size);
+		size += rsize;
+		count++;
+
+		nic_release_frame(nic_data, frame);
+	}
+
+	nic_send_batch(nic_data, buf, size, count);
+	free(buf);
+}
+
+/** Count received frame into statistics.
+ *
+ * @param stats		Statistics
+ * @param frame		Received frame
+ * @param frame_type	Frame type
+ * @param accepted	Frame has passed the receive filters
+ */
+static void nic_stats_count_received(nic_device_stats_t *stats,
+    nic_frame_t *frame, nic_frame_type_t frame_type, bool accepted)
+{
+	if (accepted) {
+		stats->receive_packets++;
+		stats->receive_bytes += frame->size;
+		switch (frame_type) {
+		case NIC_FRAME_MULTICAST:
+			stats->receive_multicast++;
+			break;
+		case NIC_FRAME_BROADCAST:
+			stats->receive_broadcast++;
+			break;
+		default:
+			break;
+		}
+	} else {
+		switch (frame_type) {
+		case NIC_FRAME_UNICAST:
+			stats->receive_filtered_unicast++;
+			break;
+		case NIC_FRAME_MULTICAST:
+			stats->receive_filtered_multicast++;
+			break;
+		case NIC_FRAME_BROADCAST:
+			stats->receive_filtered_broadcast++;
+			break;
+		}
+	}
+}
+
 /**
  * Some NICs can receive multiple frames during single interrupt. These can
  * send them in whole list of frames (actually nic_frame_t structures), then
- * the list is deallocated and each frame is passed to the
- * nic_received_packet function.
+ * the list is deallocated.
+ *
+ * Unlike calling nic_received_frame for each frame, the receive control and
+ * statistics locks are taken only once for the whole list and the accepted
+ * frames reach the client in as few IPC calls as possible.
  *
  * @param nic_data
  * @param frames		List of received frames
  */
 void nic_received_frame_list(nic_t *nic_data, nic_frame_list_t *frames)
 {
+	nic_device_stats_t acc_stats;
+	nic_device_stats_t rej_stats;
+	nic_frame_type_t frame_type;
+	list_t accepted;
+	list_t rejected;
+	bool check;
+
 	if (frames == NULL)
 		return;
+
+	list_initialize(&accepted);
+	list_initialize(&rejected);
+	memset(&acc_stats, 0, sizeof(acc_stats));
+	memset(&rej_stats, 0, sizeof(rej_stats));
+
+	/*
+	 * Note: like nic_received_frame, this must not lock main lock
+	 */
+	fibril_rwlock_read_lock(&nic_data->rxc_lock);
 	while (!list_empty(frames)) {
 		nic_frame_t *frame =
 		    list_get_instance(list_first(frames), nic_frame_t, link);
+		list_remove(&frame->link);
+
+		check = nic_rxc_check(&nic_data->rx_control, frame->data,
+		    frame->size, &frame_type);
+		nic_stats_count_received(check ? &acc_stats : &rej_stats,
+		    frame, frame_type, check);
+		list_append(&frame->link, check ? &accepted : &rejected);
+	}
+	fibril_rwlock_read_unlock(&nic_data->rxc_lock);
+
+	fibril_rwlock_write_lock(&nic_data->stats_lock);
+	if (nic_data->state == NIC_STATE_ACTIVE) {
+		nic_data->stats.receive_packets += acc_stats.receive_packets;
+		nic_data->stats.receive_bytes += acc_stats.receive_bytes;
+		nic_data->stats.receive_multicast +=
+		    acc_stats.receive_multicast;
+		nic_data->stats.receive_broadcast +=
+		    acc_stats.receive_broadcast;
+	} else {
+		/* Device is not active, frames that passed are dropped too */
+		rej_stats.receive_filtered_multicast +=
+		    acc_stats.receive_multicast;
+		rej_stats.receive_filtered_broadcast +=
+		    acc_stats.receive_broadcast;
+		rej_stats.receive_filtered_unicast +=
+		    acc_stats.receive_packets - acc_stats.receive_multicast -
+		    acc_stats.receive_broadcast;
+		list_concat(&rejected, &accepted);
+	}
+	nic_data->stats.receive_filtered_unicast +=
+	    rej_stats.receive_filtered_unicast;
+	nic_data->stats.receive_filtered_multicast +=
+	    rej_stats.receive_filtered_multicast;
+	nic_data->stats.receive_filtered_broadcast +=
+	    rej_stats.receive_filtered_broadcast;
+	fibril_rwlock_write_unlock(&nic_data->stats_lock);
+
+	nic_deliver_frames(nic_data, &accepted);
 
+	while (!list_empty(&rejected)) {
+		nic_frame_t *frame =
+		    list_get_instance(list_first(&rejected), nic_frame_t, link);
 		list_remove(&frame->link);
-		nic_received_frame(nic_data, frame);
+		nic_release_frame(nic_data, frame);
 	}
+
 	nic_driver_release_frame_list(frames);
 }
 
@@ -622,6 +846,9 @@ static nic_t *nic_create(ddf_dev_t *dev)
 	fibril_rwlock_initialize(&nic_data->rxc_lock);
 	fibril_rwlock_initialize(&nic_data->wv_lock);
 
+	fibril_mutex_initialize(&nic_data->adaptive_poll_info.lock);
+	fibril_condvar_initialize(&nic_data->adaptive_poll_info.cv);
+
 	memset(&nic_data->mac, 0, sizeof(nic_address_t));
 	memset(&nic_data->default_mac, 0, sizeof(nic_address_t));
 	memset(&nic_data->stats, 0, sizeof(nic_device_stats_t));
@@ -1132,5 +1359,158 @@ void nic_sw_period_stop(nic_t *nic_data)
 	nic_data->sw_poll_info.running = 0;
 }
 
+/** Finish polling in NIC_POLL_ADAPTIVE mode
+ *
+ *  @param nic_data Nic data structure
+ *  @param enable_irq Enable receive interrupts of the NIC
+ */
+static void nic_adaptive_poll_done(nic_t *nic_data, bool enable_irq)
+{
+	struct adaptive_poll_info *info = &nic_data->adaptive_poll_info;
+
+	/*
+	 * Interrupts are still disabled, so no interrupt can schedule polling
+	 * before we enable them.
+	 */
+	fibril_mutex_lock(&info->lock);
+	info->scheduled = false;
+	fibril_mutex_unlock(&info->lock);
+
+	if (enable_irq)
+		nic_data->on_irq_enable(nic_data);
+}
+
+/** Poll the NIC until it becomes idle
+ *
+ *  The NIC is polled repeatedly while each poll exhausts the budget. Once
+ *  it is not able to, the NIC is polled in nic->poll_period intervals until
+ *  NIC_POLL_IDLE_LIMIT polls in a row find no frames. If the first poll
+ *  does not exhaust the budget, interrupts are enabled right away.
+ *
+ *  @param nic The NIC structure pointer
+ */
+static void nic_adaptive_poll(nic_t *nic)
+{
+	bool polling = false;
+	unsigned idle = 0;
+
+	while (true) {
+		fibril_rwlock_read_lock(&nic->main_lock);
+
+		/* Interrupts are set up by the mode or state change */
+		if (nic->poll_mode != NIC_POLL_ADAPTIVE ||
+		    nic->state != NIC_STATE_ACTIVE) {
+			nic_adaptive_poll_done(nic, false);
+			fibril_rwlock_read_unlock(&nic->main_lock);
+			return;
+		}
+
+		unsigned frames = nic->on_poll_budget(nic, NIC_POLL_BUDGET);
+		bool exhausted = frames >= NIC_POLL_BUDGET;
+
+		fibril_rwlock_write_lock(&nic->stats_lock);
+		nic->stats.polls++;
+		nic->stats.poll_frames += frames;
+		if (exhausted && !polling)
+			nic->stats.poll_switches++;
+		fibril_rwlock_write_unlock(&nic->stats_lock);
+
+		if (exhausted) {
+			polling = true;
+			idle = 0;
+		} else if (frames != 0) {
+			idle = 0;
+		} else {
+			idle++;
+		}
+
+		if (!polling || idle >= NIC_POLL_IDLE_LIMIT) {
+			nic_adaptive_poll_done(nic, true);
+			fibril_rwlock_read_unlock(&nic->main_lock);
+			return;
+		}
+
+		usec_t interval = SEC2USEC(nic->poll_period.tv_sec) +
+		    NSEC2USEC(nic->poll_period.tv_nsec);
+		if (interval <= 0)
+			interval = NIC_POLL_INTERVAL_USEC;
+
+		fibril_rwlock_read_unlock(&nic->main_lock);
+
+		if (exhausted)
+			fibril_yield();
+		else
+			fibril_usleep(interval);
+	}
+}
+
+/** Main function of the adaptive polling fibril
+ *
+ *  Waits for an interrupt to schedule polling and polls the NIC until
+ *  it becomes idle.
+ *
+ *  @param  data The NIC structure pointer
+ *
+ *  @return 0, never reached
+ */
+static errno_t adaptive_fibril_fun(void *data)
+{
+	nic_t *nic = data;
+	struct adaptive_poll_info *info = &nic->adaptive_poll_info;
+
+	while (true) {
+		fibril_mutex_lock(&info->lock);
+		while (!info->scheduled)
+			fibril_condvar_wait(&info->cv, &info->lock);
+		fibril_mutex_unlock(&info->lock);
+
+		nic_adaptive_poll(nic);
+	}
+	return EOK;
+}
+
+/** Handle receive interrupt in NIC_POLL_ADAPTIVE mode
+ *
+ *  Should be called from the driver's interrupt handler with the receive
+ *  interrupts of the NIC disabled. If the NIC is in NIC_POLL_ADAPTIVE mode,
+ *  polling is scheduled and the driver must neither process the received
+ *  frames nor enable the interrupts - the on_irq_enable handler is called
+ *  when the NIC becomes idle.
+ *
+ *  @param nic_data Nic data structure
+ *
+ *  @return true if polling was scheduled
+ *  @return false if the driver should handle the interrupt itself
+ */
+bool nic_adaptive_irq(nic_t *nic_data)
+{
+	struct adaptive_poll_info *info = &nic_data->adaptive_poll_info;
+
+	/* The poller checks the mode again with the main_lock held */
+	if (nic_data->poll_mode != NIC_POLL_ADAPTIVE)
+		return false;
+
+	fibril_mutex_lock(&info->lock);
+	if (info->fibril == 0) {
+		info->fibril = fibril_create(adaptive_fibril_fun, nic_data);
+		if (info->fibril == 0) {
+			fibril_mutex_unlock(&info->lock);
+			return false;
+		}
+
+		fibril_add_ready(info->fibril);
+	}
+
+	info->scheduled = true;
+	fibril_condvar_signal(&info->cv);
+	fibril_mutex_unlock(&info->lock);
+
+	fibril_rwlock_write_lock(&nic_data->stats_lock);
+	nic_data->stats.interrupts++;
+	fibril_rwlock_write_unlock(&nic_data->stats_lock);
+
+	return true;
+}
+
 /** @}
  */
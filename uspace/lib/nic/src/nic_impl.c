@@ -202,6 +202,7 @@ errno_t nic_callback_create_impl(ddf_fun_t *fun)
 		fibril_rwlock_write_unlock(&nic->main_lock);
 		return ENOMEM;
 	}
+	nic->batch_unsupported = false;
 
 	fibril_rwlock_write_unlock(&nic->main_lock);
 	return EOK;
@@ -748,6 +749,15 @@ errno_t nic_poll_set_mode_impl(ddf_fun_t *fun,
 	if ((mode == NIC_POLL_ON_DEMAND) && nic_data->on_poll_request == NULL)
 		return ENOTSUP;
 
+	if (mode == NIC_POLL_ADAPTIVE && (nic_data->on_poll_budget == NULL ||
+	    nic_data->on_irq_enable == NULL))
+		return ENOTSUP;
+
+	if (mode == NIC_POLL_ADAPTIVE && period != NULL) {
+		if (period->tv_sec < 0 || period->tv_nsec < 0)
+			return EINVAL;
+	}
+
 	if (mode == NIC_POLL_PERIODIC || mode == NIC_POLL_SOFTWARE_PERIODIC) {
 		if (period == NULL)
 			return EINVAL;
@@ -771,6 +781,8 @@ errno_t nic_poll_set_mode_impl(ddf_fun_t *fun,
 		nic_data->poll_mode = mode;
 		if (period)
 			nic_data->poll_period = *period;
+		else if (mode == NIC_POLL_ADAPTIVE)
+			memset(&nic_data->poll_period, 0, sizeof(struct timespec));
 	}
 	fibril_rwlock_write_unlock(&nic_data->main_lock);
 	return rc;
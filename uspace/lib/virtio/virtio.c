@@ -35,6 +35,7 @@
 #include <align.h>
 #include <macros.h>
 
+#include <assert.h>
 #include <ddf/log.h>
 #include <barrier.h>
 
@@ -168,7 +169,16 @@ void virtio_free_desc(virtio_dev_t *vdev, uint16_t num, uint16_t *head,
 	fibril_mutex_unlock(&q->lock);
 }
 
-void virtio_virtq_produce_available(virtio_dev_t *vdev, uint16_t num,
+/** Put a descriptor into the available ring without notifying the device
+ *
+ * Several descriptors can be made available this way and the device then
+ * notified only once by virtio_virtq_notify().
+ *
+ * @param vdev[in]    VIRTIO device.
+ * @param num[in]     Index of the virtqueue.
+ * @param descno[in]  Head of the descriptor chain.
+ */
+void virtio_virtq_put_available(virtio_dev_t *vdev, uint16_t num,
     uint16_t descno)
 {
 	virtq_t *q = &vdev->queues[num];
@@ -178,23 +188,84 @@ void virtio_virtq_produce_available(virtio_dev_t *vdev, uint16_t num,
 	pio_write_le16(&q->avail->ring[idx % q->queue_size], descno);
 	write_barrier();
 	pio_write_le16(&q->avail->idx, idx + 1);
-	write_barrier();
-	pio_write_le16(q->notify, num);
 	fibril_mutex_unlock(&q->lock);
 }
 
+/** Notify the device about new available descriptors
+ *
+ * The notification is skipped if the device indicated that it does not
+ * need it, either through the avail_event field or the NO_NOTIFY flag.
+ *
+ * @param vdev[in]  VIRTIO device.
+ * @param num[in]   Index of the virtqueue.
+ */
+void virtio_virtq_notify(virtio_dev_t *vdev, uint16_t num)
+{
+	virtq_t *q = &vdev->queues[num];
+	bool notify;
+
+	fibril_mutex_lock(&q->lock);
+
+	/* Make the new index visible before reading the device's wishes */
+	memory_barrier();
+
+	uint16_t new_idx = pio_read_le16(&q->avail->idx);
+	uint16_t old_idx = q->avail_notified_idx;
+
+	if (new_idx == old_idx) {
+		notify = false;
+	} else if (q->event_idx) {
+		/*
+		 * Notify only if the device asked to be notified about an
+		 * index between the old and the new one (exclusive/inclusive)
+		 */
+		uint16_t event = pio_read_le16(q->avail_event);
+		notify = (uint16_t) (new_idx - event - 1) <
+		    (uint16_t) (new_idx - old_idx);
+	} else {
+		notify = !(pio_read_le16(&q->used->flags) &
+		    VIRTQ_USED_F_NO_NOTIFY);
+	}
+
+	q->avail_notified_idx = new_idx;
+	if (notify)
+		pio_write_le16(q->notify, num);
+
+	fibril_mutex_unlock(&q->lock);
+}
+
+/** Put a descriptor into the available ring and notify the device
+ *
+ * @param vdev[in]    VIRTIO device.
+ * @param num[in]     Index of the virtqueue.
+ * @param descno[in]  Head of the descriptor chain.
+ */
+void virtio_virtq_produce_available(virtio_dev_t *vdev, uint16_t num,
+    uint16_t descno)
+{
+	virtio_virtq_put_available(vdev, num, descno);
+	virtio_virtq_notify(vdev, num);
+}
+
 bool virtio_virtq_consume_used(virtio_dev_t *vdev, uint16_t num,
     uint16_t *descno, uint32_t *len)
 {
 	virtq_t *q = &vdev->queues[num];
 
 	fibril_mutex_lock(&q->lock);
-	uint16_t last_idx = q->used_last_idx % q->queue_size;
-	if (last_idx == (pio_read_le16(&q->used->idx) % q->queue_size)) {
+	/*
+	 * Compare the free-running indices, the ring positions are equal
+	 * also when the device has filled the whole ring
+	 */
+	if (q->used_last_idx == pio_read_le16(&q->used->idx)) {
 		fibril_mutex_unlock(&q->lock);
 		return false;
 	}
 
+	/* Read the element only after seeing the index */
+	read_barrier();
+
+	uint16_t last_idx = q->used_last_idx % q->queue_size;
 	*descno = (uint16_t) pio_read_le32(&q->used->ring[last_idx].id);
 	*len = pio_read_le32(&q->used->ring[last_idx].len);
 
@@ -204,6 +275,55 @@ bool virtio_virtq_consume_used(virtio_dev_t *vdev, uint16_t num,
 	return true;
 }
 
+/** Ask for an interrupt after more buffers have been used
+ *
+ * With event index the interrupt is suppressed until @a count more buffers
+ * have been used by the device, which lets the driver reap completions in
+ * batches. Without it the device is asked to interrupt on every buffer.
+ *
+ * @param vdev[in]   VIRTIO device.
+ * @param num[in]    Index of the virtqueue.
+ * @param count[in]  Number of used buffers after which to interrupt (>= 1).
+ *
+ * @return  True if there are used buffers already pending and the caller
+ *          should consume them rather than wait for the interrupt.
+ */
+bool virtio_virtq_arm_intr(virtio_dev_t *vdev, uint16_t num, uint16_t count)
+{
+	virtq_t *q = &vdev->queues[num];
+
+	assert(count >= 1);
+
+	fibril_mutex_lock(&q->lock);
+	if (q->event_idx) {
+		pio_write_le16(q->used_event, q->used_last_idx + count - 1);
+	} else {
+		pio_write_le16(&q->avail->flags, 0);
+	}
+
+	/* The device might have used buffers before seeing the update */
+	memory_barrier();
+	bool pending = q->used_last_idx != pio_read_le16(&q->used->idx);
+	fibril_mutex_unlock(&q->lock);
+
+	return pending;
+}
+
+/** Get the maximum size of a virtqueue supported by the device
+ *
+ * @param vdev[in]  VIRTIO device.
+ * @param num[in]   Index of the virtqueue.
+ *
+ * @return  Maximum number of descriptors in the virtqueue.
+ */
+uint16_t virtio_virtq_max_size(virtio_dev_t *vdev, uint16_t num)
+{
+	virtio_pci_common_cfg_t *cfg = vdev->common_cfg;
+
+	pio_write_le16(&cfg->queue_select, num);
+	return pio_read_le16(&cfg->queue_size);
+}
+
 errno_t virtio_virtq_setup(virtio_dev_t *vdev, uint16_t num, uint16_t size)
 {
 	virtq_t *q = &vdev->queues[num];
@@ -256,6 +376,10 @@ errno_t virtio_virtq_setup(virtio_dev_t *vdev, uint16_t num, uint16_t size)
 	q->avail = q->virt + avail_offset;
 	q->used = q->virt + used_offset;
 	q->used_last_idx = 0;
+	q->event_idx = (vdev->features & VIRTIO_F_EVENT_IDX) != 0;
+	q->used_event = &q->avail->ring[size];
+	q->avail_event = (ioport16_t *) &q->used->ring[size];
+	q->avail_notified_idx = 0;
 
 	memset(q->virt, 0, q->size);
 
@@ -297,8 +421,15 @@ void virtio_virtq_teardown(virtio_dev_t *vdev, uint16_t num)
 /**
  * Perform device initialization as described in section 3.1.1 of the
  * specification, steps 1 - 6.
+ *
+ * @param vdev[in]      VIRTIO device.
+ * @param features[in]  Feature bits the driver cannot work without.
+ * @param optional[in]  Feature bits accepted if the device offers them.
+ *
+ * @return  EOK on success, ENOTSUP if a required feature is missing.
  */
-errno_t virtio_device_setup_start(virtio_dev_t *vdev, uint32_t features)
+errno_t virtio_device_setup_start(virtio_dev_t *vdev, uint32_t features,
+    uint32_t optional)
 {
 	virtio_pci_common_cfg_t *cfg = vdev->common_cfg;
 
@@ -322,13 +453,14 @@ errno_t virtio_device_setup_start(virtio_dev_t *vdev, uint32_t features)
 
 	if (features != (features & device_features))
 		return ENOTSUP;
-	features &= device_features;
+	features |= optional & device_features;
 
 	/* 4. Write the accepted feature flags */
 	pio_write_le32(&cfg->driver_feature_select, VIRTIO_FEATURES_0_31);
 	pio_write_le32(&cfg->driver_feature, features);
 
 	ddf_msg(LVL_NOTE, "accepted features %x", features);
+	vdev->features = features;
 
 	/* 5. Set FEATURES_OK */
 	status |= VIRTIO_DEV_STATUS_FEATURES_OK;
@@ -42,7 +42,6 @@
 #include <async.h>
 #include <as.h>
 #include <bd_srv.h>
-#include <fibril_synch.h>
 #include <loc.h>
 #include <stddef.h>
 #include <stdint.h>
@@ -52,18 +51,22 @@
 #include <task.h>
 #include <macros.h>
 #include <str.h>
+#include <vfs/vfs.h>
 
 #define NAME "file_bd"
 
 #define DEFAULT_BLOCK_SIZE 512
 
+/** Number of queued requests processed concurrently. */
+#define QUEUE_DEPTH 8
+
 static size_t block_size;
 static aoff64_t num_blocks;
 static FILE *img;
+static int img_fd;
 
 static service_id_t service_id;
 static bd_srvs_t bd_srvs;
-static fibril_mutex_t dev_lock;
 
 static void print_usage(void);
 static errno_t file_bd_init(const char *fname);
@@ -173,6 +176,7 @@ static errno_t file_bd_init(const char *fname)
 {
 	bd_srvs_init(&bd_srvs);
 	bd_srvs.ops = &file_bd_ops;
+	bd_srvs.queue_depth = QUEUE_DEPTH;
 
 	async_set_fallback_port_handler(file_bd_connection, NULL);
 	errno_t rc = loc_server_register(NAME);
@@ -198,7 +202,14 @@ static errno_t file_bd_init(const char *fname)
 
 	num_blocks = img_size / block_size;
 
-	fibril_mutex_initialize(&dev_lock);
+	/*
+	 * Blocks are accessed with positional reads and writes so that
+	 * requests can be processed concurrently.
+	 */
+	if (vfs_fhandle(img, &img_fd) != EOK) {
+		fclose(img);
+		return EIO;
+	}
 
 	return EOK;
 }
@@ -224,6 +235,7 @@ static errno_t file_bd_close(bd_srv_t *bd)
 static errno_t file_bd_read_blocks(bd_srv_t *bd, uint64_t ba, size_t cnt, void *buf,
     size_t size)
 {
+	aoff64_t pos;
 	size_t n_rd;
 
 	if (size < cnt * block_size)
@@ -237,24 +249,11 @@ static errno_t file_bd_read_blocks(bd_srv_t *bd, uint64_t ba, size_t cnt, void *
 		return ELIMIT;
 	}
 
-	fibril_mutex_lock(&dev_lock);
-
-	clearerr(img);
-	if (fseek(img, ba * block_size, SEEK_SET) < 0) {
-		fibril_mutex_unlock(&dev_lock);
-		return EIO;
-	}
-
-	n_rd = fread(buf, block_size, cnt, img);
-
-	if (ferror(img)) {
-		fibril_mutex_unlock(&dev_lock);
+	pos = ba * block_size;
+	if (vfs_read(img_fd, &pos, buf, cnt * block_size, &n_rd) != EOK)
 		return EIO;	/* Read error */
-	}
-
-	fibril_mutex_unlock(&dev_lock);
 
-	if (n_rd < cnt)
+	if (n_rd < cnt * block_size)
 		return EINVAL;	/* Read beyond end of device */
 
 	return EOK;
@@ -264,6 +263,7 @@ static errno_t file_bd_read_blocks(bd_srv_t *bd, uint64_t ba, size_t cnt, void *
 static errno_t file_bd_write_blocks(bd_srv_t *bd, uint64_t ba, size_t cnt,
     const void *buf, size_t size)
 {
+	aoff64_t pos;
 	size_t n_wr;
 
 	if (size < cnt * block_size)
@@ -277,27 +277,10 @@ static errno_t file_bd_write_blocks(bd_srv_t *bd, uint64_t ba, size_t cnt,
 		return ELIMIT;
 	}
 
-	fibril_mutex_lock(&dev_lock);
-
-	clearerr(img);
-	if (fseek(img, ba * block_size, SEEK_SET) < 0) {
-		fibril_mutex_unlock(&dev_lock);
-		return EIO;
-	}
-
-	n_wr = fwrite(buf, block_size, cnt, img);
-
-	if (ferror(img) || n_wr < cnt) {
-		fibril_mutex_unlock(&dev_lock);
+	pos = ba * block_size;
+	if (vfs_write(img_fd, &pos, buf, cnt * block_size, &n_wr) != EOK ||
+	    n_wr < cnt * block_size)
 		return EIO;	/* Write error */
-	}
-
-	if (fflush(img) != 0) {
-		fibril_mutex_unlock(&dev_lock);
-		return EIO;
-	}
-
-	fibril_mutex_unlock(&dev_lock);
 
 	return EOK;
 }
@@ -109,6 +109,7 @@ static errno_t scan_device_tree(devman_handle_t funh)
 		bd_srvs_init(&disk[disk_count].bds);
 		disk[disk_count].bds.ops = &sata_bd_ops;
 		disk[disk_count].bds.sarg = &disk[disk_count];
+		disk[disk_count].bds.queue_depth = SATA_BD_QUEUE_DEPTH;
 
 		printf("Device %s - %s , blocks: %lu, block_size: %lu\n",
 		    disk[disk_count].dev_name, disk[disk_count].sata_dev_name,
@@ -37,6 +37,9 @@
 
 #define SATA_DEV_NAME_LENGTH 256
 
+/** Number of queued requests processed concurrently (NCQ command slots). */
+#define SATA_BD_QUEUE_DEPTH 32
+
 #include <async.h>
 #include <bd_srv.h>
 #include <loc.h>
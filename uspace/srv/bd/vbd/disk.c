@@ -50,6 +50,12 @@
 #include "disk.h"
 #include "types/vbd.h"
 
+/**
+ * Number of queued requests processed concurrently per partition. Requests
+ * are passed on to the disk, which has its own request queue.
+ */
+#define VBDS_QUEUE_DEPTH 16
+
 static fibril_mutex_t vbds_disks_lock;
 static list_t vbds_disks; /* of vbds_disk_t */
 static fibril_mutex_t vbds_parts_lock;
@@ -331,6 +337,7 @@ static errno_t vbds_part_add(vbds_disk_t *disk, label_part_t *lpart,
 	bd_srvs_init(&part->bds);
 	part->bds.ops = &vbds_bd_ops;
 	part->bds.sarg = part;
+	part->bds.queue_depth = VBDS_QUEUE_DEPTH;
 
 	if (lpinfo.pkind != lpk_extended) {
 		rc = vbds_part_svc_register(part);
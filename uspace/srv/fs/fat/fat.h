@@ -221,6 +221,16 @@ typedef struct {
 	struct fat_node	*nodep;
 } fat_idx_t;
 
+/** Run of contiguous clusters belonging to a node. */
+typedef struct {
+	/** Position of the first cluster of the run within the node */
+	uint32_t	fcn;
+	/** First cluster of the run */
+	fat_cluster_t	pcn;
+	/** Number of clusters in the run */
+	uint32_t	len;
+} fat_extent_t;
+
 /** FAT in-core node. */
 typedef struct fat_node {
 	/** Back pointer to the FS node. */
@@ -243,20 +253,67 @@ typedef struct fat_node {
 	bool			dirty;
 
 	/*
-	 * Cache of the node's last and "current" cluster to avoid some
-	 * unnecessary FAT walks.
+	 * Cache of the node's last cluster to avoid some unnecessary FAT
+	 * walks.
 	 */
 	/* Node's last cluster in FAT. */
 	bool		lastc_cached_valid;
 	fat_cluster_t	lastc_cached_value;
-	/* Node's "current" cluster, i.e. where the last I/O took place. */
-	bool		currc_cached_valid;
-	aoff64_t	currc_cached_bn;
-	fat_cluster_t	currc_cached_value;
+
+	/*
+	 * Map of the node's cluster chain, populated lazily as the chain
+	 * is walked. It covers a prefix of the chain as an array of runs
+	 * of contiguous clusters sorted by their position in the node.
+	 */
+	/*
+	 * Protects the map. Readers and writers of the node do not hold
+	 * the node lock, yet extending the map blocks on reading the FAT.
+	 */
+	fibril_mutex_t	extents_lock;
+	fat_extent_t	*extents;
+	/* Number of runs in the map. */
+	size_t		extents_cnt;
+	/* Number of runs the extents array has room for. */
+	size_t		extents_max;
+	/* The map covers the whole cluster chain. */
+	bool		extents_complete;
 } fat_node_t;
 
+/** Free-cluster count or next free cluster not known */
+#define FAT32_FSINFO_UNKNOWN	0xffffffff
+
+/** Per-instance cluster allocator state. */
+typedef struct fat_alloc {
+	/** Protects the allocator state and FAT1 during (de)allocation */
+	fibril_mutex_t		lock;
+	/** Signalled when the bitmap scan fibril terminates */
+	fibril_condvar_t	cv;
+	service_id_t		service_id;
+	/** Free-cluster bitmap, bit is set if the cluster is free */
+	uint32_t		*map;
+	/** Number of clusters covered by the bitmap */
+	uint32_t		nclsts;
+	/** Number of bits set in the bitmap */
+	uint32_t		map_free;
+	/** The bitmap has been built and can be used for allocation */
+	bool			ready;
+	/** The bitmap scan fibril is running */
+	bool			scanning;
+	/** The bitmap scan fibril should terminate */
+	bool			stop;
+	/**
+	 * Number of free clusters taken from the FAT32 FS info sector and
+	 * maintained until the bitmap is ready. Valid if free_valid is true.
+	 */
+	uint32_t		free_count;
+	bool			free_valid;
+	/** Cluster where the search for free clusters starts next time */
+	fat_cluster_t		next_free;
+} fat_alloc_t;
+
 typedef struct {
 	bool lfn_enabled;
+	fat_alloc_t alloc;
 } fat_instance_t;
 
 extern vfs_out_ops_t fat_ops;
@@ -46,18 +46,16 @@
 #include <byteorder.h>
 #include <align.h>
 #include <assert.h>
+#include <fibril.h>
 #include <fibril_synch.h>
+#include <macros.h>
 #include <mem.h>
 #include <stdlib.h>
 
 #define IS_ODD(number)	(number & 0x1)
 
-/**
- * The fat_alloc_lock mutex protects all copies of the File Allocation Table
- * during allocation of clusters. The lock does not have to be held durring
- * deallocation of clusters.
- */
-static FIBRIL_MUTEX_INITIALIZE(fat_alloc_lock);
+/** Number of FAT entries examined by the bitmap scan fibril at once */
+#define FAT_SCAN_CHUNK	1024
 
 /** Walk the cluster chain.
  *
@@ -112,6 +110,146 @@ fat_cluster_walk(fat_bs_t *bs, service_id_t service_id, fat_cluster_t firstc,
 	return EOK;
 }
 
+/** Add a cluster at the end of the node's extent map.
+ *
+ * @param nodep		FAT node.
+ * @param clst		Cluster following the clusters already mapped.
+ *
+ * @return		EOK on success or an error code.
+ */
+static errno_t fat_extent_append(fat_node_t *nodep, fat_cluster_t clst)
+{
+	fat_extent_t *last = NULL;
+	fat_extent_t *extents;
+	size_t max;
+
+	if (nodep->extents_cnt > 0) {
+		last = &nodep->extents[nodep->extents_cnt - 1];
+		if (last->pcn + last->len == clst) {
+			/* The cluster extends the last run. */
+			last->len++;
+			return EOK;
+		}
+	}
+
+	if (nodep->extents_cnt == nodep->extents_max) {
+		max = nodep->extents_max ? 2 * nodep->extents_max : 4;
+		extents = realloc(nodep->extents, max * sizeof(fat_extent_t));
+		if (extents == NULL)
+			return ENOMEM;
+
+		nodep->extents = extents;
+		nodep->extents_max = max;
+		if (last != NULL)
+			last = &extents[nodep->extents_cnt - 1];
+	}
+
+	extents = &nodep->extents[nodep->extents_cnt++];
+	extents->fcn = last ? last->fcn + last->len : 0;
+	extents->pcn = clst;
+	extents->len = 1;
+
+	return EOK;
+}
+
+/** Translate position of a cluster within a node to the cluster number.
+ *
+ * The node's extent map is extended by walking the cluster chain as far as
+ * needed, afterwards the cluster is found by binary search over the map.
+ *
+ * @param bs		Buffer holding the boot sector of the file system.
+ * @param nodep		FAT node.
+ * @param fcn		Position of the cluster within the node.
+ * @param clst		Place to store the cluster number.
+ *
+ * @return		EOK on success, ELIMIT if the cluster chain is shorter,
+ *			or an error code.
+ */
+errno_t fat_extent_get(fat_bs_t *bs, fat_node_t *nodep, uint32_t fcn,
+    fat_cluster_t *clst)
+{
+	fat_extent_t *last;
+	fat_cluster_t next;
+	size_t lo, hi, mid;
+	errno_t rc;
+
+	if (nodep->firstc == FAT_CLST_RES0)
+		return ELIMIT;
+
+	/*
+	 * The map is extended and searched with the lock held, so that
+	 * fibrils blocked in fat_get_cluster() do not append the same
+	 * cluster twice.
+	 */
+	fibril_mutex_lock(&nodep->extents_lock);
+
+	if (nodep->extents_cnt == 0) {
+		rc = fat_extent_append(nodep, nodep->firstc);
+		if (rc != EOK)
+			goto out;
+	}
+
+	while (true) {
+		last = &nodep->extents[nodep->extents_cnt - 1];
+		if (fcn < last->fcn + last->len)
+			break;
+
+		if (nodep->extents_complete) {
+			rc = ELIMIT;
+			goto out;
+		}
+
+		/* Map the next cluster in the chain. */
+		rc = fat_get_cluster(bs, nodep->idx->service_id, FAT1,
+		    last->pcn + last->len - 1, &next);
+		if (rc != EOK)
+			goto out;
+
+		if (next >= FAT_CLST_LAST1(bs)) {
+			nodep->extents_complete = true;
+			continue;
+		}
+
+		assert(next >= FAT_CLST_FIRST && next != FAT_CLST_BAD(bs));
+
+		rc = fat_extent_append(nodep, next);
+		if (rc != EOK)
+			goto out;
+	}
+
+	/* Find the last run starting at or before fcn. */
+	lo = 0;
+	hi = nodep->extents_cnt;
+	while (hi - lo > 1) {
+		mid = (lo + hi) / 2;
+		if (nodep->extents[mid].fcn <= fcn)
+			lo = mid;
+		else
+			hi = mid;
+	}
+
+	*clst = nodep->extents[lo].pcn + (fcn - nodep->extents[lo].fcn);
+	rc = EOK;
+out:
+	fibril_mutex_unlock(&nodep->extents_lock);
+	return rc;
+}
+
+/** Drop the node's extent map.
+ *
+ * @param nodep		FAT node.
+ */
+void fat_extents_fini(fat_node_t *nodep)
+{
+	fibril_mutex_lock(&nodep->extents_lock);
+	free(nodep->extents);
+	nodep->extents = NULL;
+	nodep->extents_cnt = 0;
+	nodep->extents_max = 0;
+	nodep->extents_complete = false;
+	fibril_mutex_unlock(&nodep->extents_lock);
+}
+
 /** Read block from file located on a FAT file system.
  *
  * @param block		Pointer to a block pointer for storing result.
@@ -126,16 +264,16 @@ errno_t
 fat_block_get(block_t **block, struct fat_bs *bs, fat_node_t *nodep,
     aoff64_t bn, int flags)
 {
-	fat_cluster_t firstc = nodep->firstc;
-	fat_cluster_t currc = 0;
-	aoff64_t relbn = bn;
+	fat_cluster_t clst;
 	errno_t rc;
 
 	if (!nodep->size)
 		return ELIMIT;
 
-	if (!FAT_IS_FAT32(bs) && nodep->firstc == FAT_CLST_ROOT)
-		goto fall_through;
+	if (!FAT_IS_FAT32(bs) && nodep->firstc == FAT_CLST_ROOT) {
+		return _fat_block_get(block, bs, nodep->idx->service_id,
+		    nodep->firstc, NULL, bn, flags);
+	}
 
 	if (((((nodep->size - 1) / BPS(bs)) / SPC(bs)) == bn / SPC(bs)) &&
 	    nodep->lastc_cached_valid) {
@@ -147,29 +285,12 @@ fat_block_get(block_t **block, struct fat_bs *bs, fat_node_t *nodep,
 		    CLBN2PBN(bs, nodep->lastc_cached_value, bn), flags);
 	}
 
-	if (nodep->currc_cached_valid && bn >= nodep->currc_cached_bn) {
-		/*
-		 * We can start with the cluster cached by the previous call to
-		 * fat_block_get().
-		 */
-		firstc = nodep->currc_cached_value;
-		relbn -= (nodep->currc_cached_bn / SPC(bs)) * SPC(bs);
-	}
-
-fall_through:
-	rc = _fat_block_get(block, bs, nodep->idx->service_id, firstc,
-	    &currc, relbn, flags);
+	rc = fat_extent_get(bs, nodep, bn / SPC(bs), &clst);
 	if (rc != EOK)
 		return rc;
 
-	/*
-	 * Update the "current" cluster cache.
-	 */
-	nodep->currc_cached_valid = true;
-	nodep->currc_cached_bn = bn;
-	nodep->currc_cached_value = currc;
-
-	return rc;
+	return block_get(block, nodep->idx->service_id,
+	    CLBN2PBN(bs, clst, bn), flags);
 }
 
 /** Read block from file located on a FAT file system.
@@ -654,6 +775,359 @@ errno_t fat_alloc_shadow_clusters(fat_bs_t *bs, service_id_t service_id,
 	return EOK;
 }
 
+/** Get allocator state of a mounted file system instance.
+ *
+ * @param service_id	Service ID of the file system.
+ * @param ralloc	Place to store pointer to the allocator state.
+ *
+ * @return		EOK on success or an error code.
+ */
+static errno_t fat_alloc_get(service_id_t service_id, fat_alloc_t **ralloc)
+{
+	fat_instance_t *instance;
+	void *data;
+	errno_t rc;
+
+	rc = fs_instance_get(service_id, &data);
+	if (rc != EOK)
+		return rc;
+
+	instance = (fat_instance_t *) data;
+	*ralloc = &instance->alloc;
+	return EOK;
+}
+
+/** Test whether a cluster is marked free in the free-cluster bitmap. */
+static bool fat_map_test(fat_alloc_t *alloc, fat_cluster_t clst)
+{
+	uint32_t i = clst - FAT_CLST_FIRST;
+
+	return (alloc->map[i / 32] & (UINT32_C(1) << (i % 32))) != 0;
+}
+
+/** Mark a cluster free in the free-cluster bitmap. */
+static void fat_map_set(fat_alloc_t *alloc, fat_cluster_t clst)
+{
+	uint32_t i = clst - FAT_CLST_FIRST;
+
+	if (i >= alloc->nclsts || fat_map_test(alloc, clst))
+		return;
+
+	alloc->map[i / 32] |= UINT32_C(1) << (i % 32);
+	alloc->map_free++;
+}
+
+/** Mark a cluster used in the free-cluster bitmap. */
+static void fat_map_clear(fat_alloc_t *alloc, fat_cluster_t clst)
+{
+	uint32_t i = clst - FAT_CLST_FIRST;
+
+	if (i >= alloc->nclsts || !fat_map_test(alloc, clst))
+		return;
+
+	alloc->map[i / 32] &= ~(UINT32_C(1) << (i % 32));
+	alloc->map_free--;
+}
+
+/** Find the next cluster marked free in the bitmap.
+ *
+ * Words of the bitmap with no free cluster are skipped as a whole.
+ *
+ * @param alloc		Allocator state.
+ * @param clst		Cluster to start the search with.
+ * @param end		Cluster where the search stops.
+ *
+ * @return		Free cluster or @a end if there is none.
+ */
+static fat_cluster_t fat_map_next(fat_alloc_t *alloc, fat_cluster_t clst,
+    fat_cluster_t end)
+{
+	while (clst < end) {
+		uint32_t i = clst - FAT_CLST_FIRST;
+
+		if (i % 32 == 0 && alloc->map[i / 32] == 0) {
+			clst += 32;
+			continue;
+		}
+
+		if (fat_map_test(alloc, clst))
+			return clst;
+		clst++;
+	}
+
+	return end;
+}
+
+/** Find a run of contiguous free clusters in the bitmap.
+ *
+ * @param alloc		Allocator state.
+ * @param clst		Cluster to start the search with.
+ * @param end		Cluster where the search stops.
+ * @param nclsts	Length of the run.
+ * @param first		Place to store the first cluster of the run.
+ *
+ * @return		True if a run has been found.
+ */
+static bool fat_map_find_run(fat_alloc_t *alloc, fat_cluster_t clst,
+    fat_cluster_t end, unsigned nclsts, fat_cluster_t *first)
+{
+	unsigned len;
+
+	while ((clst = fat_map_next(alloc, clst, end)) < end) {
+		for (len = 1; len < nclsts && clst + len < end; len++) {
+			if (!fat_map_test(alloc, clst + len))
+				break;
+		}
+
+		if (len == nclsts) {
+			*first = clst;
+			return true;
+		}
+
+		clst += len;
+	}
+
+	return false;
+}
+
+/** Pick free clusters using the free-cluster bitmap.
+ *
+ * A contiguous run of @a nclsts clusters is preferred, so that multi-cluster
+ * appends do not fragment the file. If there is no such run, the first free
+ * clusters following the next-free hint are used.
+ *
+ * @param alloc		Allocator state.
+ * @param nclsts	Number of clusters to pick.
+ * @param clsts		Array for storing the picked clusters in chain order.
+ *
+ * @return		Number of clusters picked.
+ */
+static unsigned fat_alloc_pick_map(fat_alloc_t *alloc, unsigned nclsts,
+    fat_cluster_t *clsts)
+{
+	fat_cluster_t end = alloc->nclsts + FAT_CLST_FIRST;
+	fat_cluster_t clst;
+	unsigned found;
+
+	if (alloc->map_free < nclsts)
+		return 0;
+
+	if (nclsts > 1 &&
+	    (fat_map_find_run(alloc, alloc->next_free, end, nclsts, &clst) ||
+	    fat_map_find_run(alloc, FAT_CLST_FIRST, end, nclsts, &clst))) {
+		for (found = 0; found < nclsts; found++)
+			clsts[found] = clst + found;
+		return found;
+	}
+
+	found = 0;
+	clst = alloc->next_free;
+	while (found < nclsts) {
+		clst = fat_map_next(alloc, clst, end);
+		if (clst == end) {
+			/* Wrap around, map_free guarantees we will succeed. */
+			clst = FAT_CLST_FIRST;
+			continue;
+		}
+
+		clsts[found++] = clst++;
+	}
+
+	return found;
+}
+
+/** Pick free clusters by scanning FAT1.
+ *
+ * This is used until the free-cluster bitmap has been built.
+ *
+ * @param bs		Buffer holding the boot sector of the file system.
+ * @param alloc		Allocator state.
+ * @param nclsts	Number of clusters to pick.
+ * @param clsts		Array for storing the picked clusters in chain order.
+ * @param found		Place to store the number of clusters picked.
+ *
+ * @return		EOK on success or an error code.
+ */
+static errno_t fat_alloc_pick_scan(fat_bs_t *bs, fat_alloc_t *alloc,
+    unsigned nclsts, fat_cluster_t *clsts, unsigned *found)
+{
+	fat_cluster_t end = alloc->nclsts + FAT_CLST_FIRST;
+	fat_cluster_t clst = alloc->next_free;
+	fat_cluster_t value = 0;
+	uint32_t i;
+	errno_t rc;
+
+	*found = 0;
+	for (i = 0; i < alloc->nclsts && *found < nclsts; i++) {
+		rc = fat_get_cluster(bs, alloc->service_id, FAT1, clst, &value);
+		if (rc != EOK)
+			return rc;
+
+		if (value == FAT_CLST_RES0)
+			clsts[(*found)++] = clst;
+
+		if (++clst == end)
+			clst = FAT_CLST_FIRST;
+	}
+
+	return EOK;
+}
+
+/** Build the free-cluster bitmap.
+ *
+ * The scan runs in its own fibril after the file system has been mounted.
+ * FAT1 is examined in chunks with the allocator lock held, so allocations
+ * and deallocations proceed between the chunks and keep the already scanned
+ * part of the bitmap accurate.
+ *
+ * @param arg		Allocator state.
+ *
+ * @return		EOK on success or an error code.
+ */
+static errno_t fat_alloc_scan_fibril(void *arg)
+{
+	fat_alloc_t *alloc = (fat_alloc_t *) arg;
+	fat_bs_t *bs = block_bb_get(alloc->service_id);
+	fat_cluster_t end = alloc->nclsts + FAT_CLST_FIRST;
+	fat_cluster_t clst = FAT_CLST_FIRST;
+	fat_cluster_t cend;
+	fat_cluster_t value = 0;
+	errno_t rc = EOK;
+
+	fibril_mutex_lock(&alloc->lock);
+
+	while (clst < end && !alloc->stop) {
+		cend = min(clst + FAT_SCAN_CHUNK, end);
+		for (; clst < cend; clst++) {
+			rc = fat_get_cluster(bs, alloc->service_id, FAT1, clst,
+			    &value);
+			if (rc != EOK)
+				break;
+
+			if (value == FAT_CLST_RES0)
+				fat_map_set(alloc, clst);
+		}
+
+		if (rc != EOK)
+			break;
+
+		fibril_mutex_unlock(&alloc->lock);
+		fibril_yield();
+		fibril_mutex_lock(&alloc->lock);
+	}
+
+	if (clst == end)
+		alloc->ready = true;
+
+	alloc->scanning = false;
+	fibril_condvar_broadcast(&alloc->cv);
+	fibril_mutex_unlock(&alloc->lock);
+
+	return rc;
+}
+
+/** Initialize cluster allocator of a file system instance.
+ *
+ * Start building the free-cluster bitmap in the background. Until the
+ * bitmap is ready, clusters are allocated by scanning FAT1.
+ *
+ * @param alloc		Allocator state to initialize.
+ * @param bs		Buffer holding the boot sector of the file system.
+ * @param service_id	Service ID of the file system.
+ * @param free_count	Number of free clusters recorded in the file system or
+ *			FAT32_FSINFO_UNKNOWN.
+ * @param next_free	Cluster to start searching for free clusters with or
+ *			FAT32_FSINFO_UNKNOWN.
+ *
+ * @return		EOK on success or an error code.
+ */
+errno_t fat_alloc_init(fat_alloc_t *alloc, fat_bs_t *bs,
+    service_id_t service_id, uint32_t free_count, fat_cluster_t next_free)
+{
+	fid_t fid;
+
+	fibril_mutex_initialize(&alloc->lock);
+	fibril_condvar_initialize(&alloc->cv);
+	alloc->service_id = service_id;
+	alloc->nclsts = CC(bs);
+	alloc->map_free = 0;
+	alloc->ready = false;
+	alloc->scanning = false;
+	alloc->stop = false;
+
+	alloc->free_valid = free_count <= alloc->nclsts;
+	alloc->free_count = alloc->free_valid ? free_count : 0;
+
+	if (next_free >= FAT_CLST_FIRST &&
+	    next_free < alloc->nclsts + FAT_CLST_FIRST)
+		alloc->next_free = next_free;
+	else
+		alloc->next_free = FAT_CLST_FIRST;
+
+	alloc->map = calloc((alloc->nclsts + 31) / 32, sizeof(uint32_t));
+	if (alloc->map == NULL)
+		return ENOMEM;
+
+	fid = fibril_create(fat_alloc_scan_fibril, alloc);
+	if (fid == 0) {
+		free(alloc->map);
+		return ENOMEM;
+	}
+
+	alloc->scanning = true;
+	fibril_add_ready(fid);
+
+	return EOK;
+}
+
+/** Finalize cluster allocator of a file system instance.
+ *
+ * @param alloc		Allocator state.
+ */
+void fat_alloc_fini(fat_alloc_t *alloc)
+{
+	fibril_mutex_lock(&alloc->lock);
+
+	alloc->stop = true;
+	while (alloc->scanning)
+		fibril_condvar_wait(&alloc->cv, &alloc->lock);
+
+	fibril_mutex_unlock(&alloc->lock);
+
+	free(alloc->map);
+	alloc->map = NULL;
+}
+
+/** Get free space information maintained by the cluster allocator.
+ *
+ * @param alloc		Allocator state.
+ * @param free_count	Place to store the number of free clusters.
+ * @param next_free	If non-NULL, place to store the next-free hint.
+ *
+ * @return		True if the number of free clusters is known.
+ */
+bool fat_alloc_stats(fat_alloc_t *alloc, uint32_t *free_count,
+    fat_cluster_t *next_free)
+{
+	bool known;
+
+	fibril_mutex_lock(&alloc->lock);
+
+	if (alloc->ready) {
+		*free_count = alloc->map_free;
+		known = true;
+	} else {
+		*free_count = alloc->free_count;
+		known = alloc->free_valid;
+	}
+
+	if (next_free != NULL)
+		*next_free = alloc->next_free;
+
+	fibril_mutex_unlock(&alloc->lock);
+	return known;
+}
+
 /** Allocate clusters in all copies of FAT.
  *
  * This function will attempt to allocate the requested number of clusters in
@@ -675,63 +1149,95 @@ errno_t
 fat_alloc_clusters(fat_bs_t *bs, service_id_t service_id, unsigned nclsts,
     fat_cluster_t *mcl, fat_cluster_t *lcl)
 {
-	fat_cluster_t *lifo;    /* stack for storing free cluster numbers */
-	unsigned found = 0;     /* top of the free cluster number stack */
-	fat_cluster_t clst;
-	fat_cluster_t value = 0;
+	fat_alloc_t *alloc;
+	fat_cluster_t *clsts;   /* picked clusters in chain order */
+	fat_cluster_t *lifo;    /* the same clusters in reverse order */
+	unsigned found = 0;
+	unsigned written = 0;
+	unsigned c;
 	fat_cluster_t clst_last1 = FAT_CLST_LAST1(bs);
-	errno_t rc = EOK;
+	errno_t rc;
+
+	rc = fat_alloc_get(service_id, &alloc);
+	if (rc != EOK)
+		return rc;
 
-	lifo = (fat_cluster_t *) malloc(nclsts * sizeof(fat_cluster_t));
-	if (!lifo)
+	clsts = (fat_cluster_t *) malloc(2 * nclsts * sizeof(fat_cluster_t));
+	if (!clsts)
 		return ENOMEM;
+	lifo = clsts + nclsts;
+
+	fibril_mutex_lock(&alloc->lock);
 
 	/*
-	 * Search FAT1 for unused clusters.
+	 * The free cluster count recorded in FSInfo is only a hint, so it is
+	 * never used to refuse the allocation. Until the bitmap is ready,
+	 * FAT1 is scanned, which finds all free clusters there are.
 	 */
-	fibril_mutex_lock(&fat_alloc_lock);
-	for (clst = FAT_CLST_FIRST; clst < CC(bs) + 2 && found < nclsts;
-	    clst++) {
-		rc = fat_get_cluster(bs, service_id, FAT1, clst, &value);
+	if (alloc->ready) {
+		found = fat_alloc_pick_map(alloc, nclsts, clsts);
+	} else {
+		rc = fat_alloc_pick_scan(bs, alloc, nclsts, clsts, &found);
 		if (rc != EOK)
-			break;
-
-		if (value == FAT_CLST_RES0) {
-			/*
-			 * The cluster is free. Put it into our stack
-			 * of found clusters and mark it as non-free.
-			 */
-			lifo[found] = clst;
-			rc = fat_set_cluster(bs, service_id, FAT1, clst,
-			    (found == 0) ?  clst_last1 : lifo[found - 1]);
-			if (rc != EOK)
-				break;
+			goto error;
+	}
 
-			found++;
+	if (found < nclsts) {
+		if (!alloc->ready) {
+			/* The scan has just counted all free clusters */
+			alloc->free_count = found;
+			alloc->free_valid = true;
 		}
+
+		rc = ENOSPC;
+		goto error;
 	}
 
-	if (rc == EOK && found == nclsts) {
-		rc = fat_alloc_shadow_clusters(bs, service_id, lifo, nclsts);
-		if (rc == EOK) {
-			*mcl = lifo[found - 1];
-			*lcl = lifo[0];
-			free(lifo);
-			fibril_mutex_unlock(&fat_alloc_lock);
-			return EOK;
-		}
+	/* Link the clusters into a chain in FAT1. */
+	for (written = 0; written < nclsts; written++) {
+		rc = fat_set_cluster(bs, service_id, FAT1, clsts[written],
+		    (written == nclsts - 1) ? clst_last1 : clsts[written + 1]);
+		if (rc != EOK)
+			goto error;
 	}
 
+	for (c = 0; c < nclsts; c++)
+		lifo[c] = clsts[nclsts - 1 - c];
+
+	rc = fat_alloc_shadow_clusters(bs, service_id, lifo, nclsts);
+	if (rc != EOK)
+		goto error;
+
+	for (c = 0; c < nclsts; c++)
+		fat_map_clear(alloc, clsts[c]);
+
+	if (alloc->free_valid && alloc->free_count >= nclsts)
+		alloc->free_count -= nclsts;
+	else
+		alloc->free_valid = false;
+
+	alloc->next_free = clsts[nclsts - 1] + 1;
+	if (alloc->next_free >= alloc->nclsts + FAT_CLST_FIRST)
+		alloc->next_free = FAT_CLST_FIRST;
+
+	fibril_mutex_unlock(&alloc->lock);
+
+	*mcl = clsts[0];
+	*lcl = clsts[nclsts - 1];
+	free(clsts);
+	return EOK;
+
+error:
 	/* If something wrong - free the clusters */
-	while (found--) {
-		(void) fat_set_cluster(bs, service_id, FAT1, lifo[found],
+	while (written--) {
+		(void) fat_set_cluster(bs, service_id, FAT1, clsts[written],
 		    FAT_CLST_RES0);
 	}
 
-	free(lifo);
-	fibril_mutex_unlock(&fat_alloc_lock);
+	fibril_mutex_unlock(&alloc->lock);
+	free(clsts);
 
-	return ENOSPC;
+	return rc;
 }
 
 /** Free clusters forming a cluster chain in all copies of FAT.
@@ -745,30 +1251,44 @@ fat_alloc_clusters(fat_bs_t *bs, service_id_t service_id, unsigned nclsts,
 errno_t
 fat_free_clusters(fat_bs_t *bs, service_id_t service_id, fat_cluster_t firstc)
 {
+	fat_alloc_t *alloc;
 	unsigned fatno;
 	fat_cluster_t nextc = 0;
 	fat_cluster_t clst_bad = FAT_CLST_BAD(bs);
 	errno_t rc;
 
+	rc = fat_alloc_get(service_id, &alloc);
+	if (rc != EOK)
+		return rc;
+
+	fibril_mutex_lock(&alloc->lock);
+
 	/* Mark all clusters in the chain as free in all copies of FAT. */
 	while (firstc < FAT_CLST_LAST1(bs)) {
 		assert(firstc >= FAT_CLST_FIRST && firstc < clst_bad);
 
 		rc = fat_get_cluster(bs, service_id, FAT1, firstc, &nextc);
 		if (rc != EOK)
-			return rc;
+			goto out;
 
 		for (fatno = FAT1; fatno < FATCNT(bs); fatno++) {
 			rc = fat_set_cluster(bs, service_id, fatno, firstc,
 			    FAT_CLST_RES0);
 			if (rc != EOK)
-				return rc;
+				goto out;
 		}
 
+		fat_map_set(alloc, firstc);
+		if (alloc->free_valid)
+			alloc->free_count++;
+
 		firstc = nextc;
 	}
 
-	return EOK;
+	rc = EOK;
+out:
+	fibril_mutex_unlock(&alloc->lock);
+	return rc;
 }
 
 /** Append a cluster chain to the last file cluster in all FATs.
@@ -793,10 +1313,18 @@ errno_t fat_append_clusters(fat_bs_t *bs, fat_node_t *nodep, fat_cluster_t mcl,
 		nodep->firstc = mcl;
 		nodep->dirty = true;	/* need to sync node */
 	} else {
+		fibril_mutex_lock(&nodep->extents_lock);
 		if (nodep->lastc_cached_valid) {
 			lastc = nodep->lastc_cached_value;
 			nodep->lastc_cached_valid = false;
-		} else {
+		} else if (nodep->extents_complete) {
+			fat_extent_t *last =
+			    &nodep->extents[nodep->extents_cnt - 1];
+			lastc = last->pcn + last->len - 1;
+		}
+		fibril_mutex_unlock(&nodep->extents_lock);
+
+		if (lastc == 0) {
 			rc = fat_cluster_walk(bs, service_id, nodep->firstc,
 			    &lastc, NULL, (uint32_t) -1);
 			if (rc != EOK)
@@ -811,6 +1339,11 @@ errno_t fat_append_clusters(fat_bs_t *bs, fat_node_t *nodep, fat_cluster_t mcl,
 		}
 	}
 
+	/* The chain continues past the end of the extent map now. */
+	fibril_mutex_lock(&nodep->extents_lock);
+	nodep->extents_complete = false;
+	fibril_mutex_unlock(&nodep->extents_lock);
+
 	nodep->lastc_cached_valid = true;
 	nodep->lastc_cached_value = lcl;
 
@@ -837,8 +1370,7 @@ errno_t fat_chop_clusters(fat_bs_t *bs, fat_node_t *nodep, fat_cluster_t lcl)
 	 * Invalidate cached cluster numbers.
 	 */
 	nodep->lastc_cached_valid = false;
-	if (nodep->currc_cached_value != lcl)
-		nodep->currc_cached_valid = false;
+	fat_extents_fini(nodep);
 
 	if (lcl == FAT_CLST_RES0) {
 		/* The node will have zero size and no clusters allocated. */
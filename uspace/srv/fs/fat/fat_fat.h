@@ -35,6 +35,7 @@
 #define FAT_FAT_FAT_H_
 
 #include "../../vfs/vfs.h"
+#include <stdbool.h>
 #include <stdint.h>
 #include <block.h>
 
@@ -102,6 +103,7 @@
 struct block;
 struct fat_node;
 struct fat_bs;
+struct fat_alloc;
 
 typedef uint32_t fat_cluster_t;
 
@@ -110,6 +112,9 @@ typedef uint32_t fat_cluster_t;
 extern errno_t fat_cluster_walk(struct fat_bs *, service_id_t, fat_cluster_t,
     fat_cluster_t *, uint32_t *, uint32_t);
 
+extern errno_t fat_extent_get(struct fat_bs *, struct fat_node *, uint32_t,
+    fat_cluster_t *);
+extern void fat_extents_fini(struct fat_node *);
 extern errno_t fat_block_get(block_t **, struct fat_bs *, struct fat_node *,
     aoff64_t, int);
 extern errno_t _fat_block_get(block_t **, struct fat_bs *, service_id_t,
@@ -130,6 +135,10 @@ extern errno_t fat_set_cluster(struct fat_bs *, service_id_t, unsigned,
     fat_cluster_t, fat_cluster_t);
 extern errno_t fat_fill_gap(struct fat_bs *, struct fat_node *, fat_cluster_t,
     aoff64_t);
+extern errno_t fat_alloc_init(struct fat_alloc *, struct fat_bs *,
+    service_id_t, uint32_t, fat_cluster_t);
+extern void fat_alloc_fini(struct fat_alloc *);
+extern bool fat_alloc_stats(struct fat_alloc *, uint32_t *, fat_cluster_t *);
 extern errno_t fat_zero_cluster(struct fat_bs *, service_id_t, fat_cluster_t);
 extern errno_t fat_sanity_check(struct fat_bs *, service_id_t);
 
@@ -108,9 +108,11 @@ static void fat_node_initialize(fat_node_t *node)
 	node->dirty = false;
 	node->lastc_cached_valid = false;
 	node->lastc_cached_value = 0;
-	node->currc_cached_valid = false;
-	node->currc_cached_bn = 0;
-	node->currc_cached_value = 0;
+	fibril_mutex_initialize(&node->extents_lock);
+	node->extents = NULL;
+	node->extents_cnt = 0;
+	node->extents_max = 0;
+	node->extents_complete = false;
 }
 
 static errno_t fat_node_sync(fat_node_t *node)
@@ -192,6 +194,7 @@ restart:
 				return rc;
 		}
 		nodep->idx->nodep = NULL;
+		fat_extents_fini(nodep);
 		free(nodep->bp);
 		free(nodep);
 
@@ -230,12 +233,14 @@ static errno_t fat_node_get_new(fat_node_t **nodepp)
 				idxp_tmp->nodep = NULL;
 				fibril_mutex_unlock(&nodep->lock);
 				fibril_mutex_unlock(&idxp_tmp->lock);
+				fat_extents_fini(nodep);
 				free(nodep->bp);
 				free(nodep);
 				return rc;
 			}
 		}
 		idxp_tmp->nodep = NULL;
+		fat_extents_fini(nodep);
 		fibril_mutex_unlock(&nodep->lock);
 		fibril_mutex_unlock(&idxp_tmp->lock);
 		fn = FS_NODE(nodep);
@@ -476,6 +481,7 @@ errno_t fat_node_put(fs_node_t *fn)
 	}
 	fibril_mutex_unlock(&nodep->lock);
 	if (destroy) {
+		fat_extents_fini(nodep);
 		free(nodep->bp);
 		free(nodep);
 	}
@@ -569,6 +575,7 @@ errno_t fat_destroy_node(fs_node_t *fn)
 	}
 
 	fat_idx_destroy(nodep->idx);
+	fat_extents_fini(nodep);
 	free(nodep->bp);
 	free(nodep);
 	return rc;
@@ -868,6 +875,16 @@ errno_t fat_free_block_count(service_id_t service_id, uint64_t *count)
 	uint64_t block_count;
 	errno_t rc;
 	uint32_t cluster_no, clusters;
+	uint32_t free_count;
+	void *data;
+
+	/* Use the count maintained by the allocator if it is known. */
+	if (fs_instance_get(service_id, &data) == EOK &&
+	    fat_alloc_stats(&((fat_instance_t *) data)->alloc, &free_count,
+	    NULL)) {
+		*count = free_count;
+		return EOK;
+	}
 
 	block_count = 0;
 	bs = block_bb_get(service_id);
@@ -1024,6 +1041,7 @@ static errno_t fat_fs_open(service_id_t service_id, enum cache_mode cmode,
 
 static void fat_fs_close(service_id_t service_id, fs_node_t *rfn)
 {
+	fat_extents_fini(FAT_NODE(rfn));
 	free(rfn->data);
 	free(rfn);
 	(void) block_cache_fini(service_id);
@@ -1074,6 +1092,85 @@ static errno_t fat_fsprobe(service_id_t service_id, vfs_fs_probe_info_t *info)
 	return EOK;
 }
 
+/** Read the FAT32 FS info sector.
+ *
+ * @param service_id	Service ID of the file system.
+ * @param free_count	Place to store the number of free clusters.
+ * @param next_free	Place to store the next free cluster hint.
+ *
+ * @return		EOK on success or an error code.
+ */
+static errno_t fat_read_fat32_fsinfo(service_id_t service_id,
+    uint32_t *free_count, fat_cluster_t *next_free)
+{
+	fat_bs_t *bs;
+	fat32_fsinfo_t *info;
+	block_t *b;
+	errno_t rc;
+
+	bs = block_bb_get(service_id);
+	assert(FAT_IS_FAT32(bs));
+
+	rc = block_get(&b, service_id, uint16_t_le2host(bs->fat32.fsinfo_sec),
+	    BLOCK_FLAGS_NONE);
+	if (rc != EOK)
+		return rc;
+
+	info = (fat32_fsinfo_t *) b->data;
+
+	if (memcmp(info->sig1, FAT32_FSINFO_SIG1, sizeof(info->sig1)) != 0 ||
+	    memcmp(info->sig2, FAT32_FSINFO_SIG2, sizeof(info->sig2)) != 0 ||
+	    memcmp(info->sig3, FAT32_FSINFO_SIG3, sizeof(info->sig3)) != 0) {
+		(void) block_put(b);
+		return EINVAL;
+	}
+
+	*free_count = uint32_t_le2host(info->free_clusters);
+	*next_free = uint32_t_le2host(info->last_allocated_cluster);
+
+	return block_put(b);
+}
+
+/** Update the FAT32 FS info sector.
+ *
+ * @param service_id	Service ID of the file system.
+ * @param free_count	Number of free clusters or FAT32_FSINFO_UNKNOWN.
+ * @param next_free	Next free cluster hint or FAT32_FSINFO_UNKNOWN.
+ *
+ * @return		EOK on success or an error code.
+ */
+static errno_t fat_update_fat32_fsinfo(service_id_t service_id,
+    uint32_t free_count, fat_cluster_t next_free)
+{
+	fat_bs_t *bs;
+	fat32_fsinfo_t *info;
+	block_t *b;
+	errno_t rc;
+
+	bs = block_bb_get(service_id);
+	assert(FAT_IS_FAT32(bs));
+
+	rc = block_get(&b, service_id, uint16_t_le2host(bs->fat32.fsinfo_sec),
+	    BLOCK_FLAGS_NONE);
+	if (rc != EOK)
+		return rc;
+
+	info = (fat32_fsinfo_t *) b->data;
+
+	if (memcmp(info->sig1, FAT32_FSINFO_SIG1, sizeof(info->sig1)) != 0 ||
+	    memcmp(info->sig2, FAT32_FSINFO_SIG2, sizeof(info->sig2)) != 0 ||
+	    memcmp(info->sig3, FAT32_FSINFO_SIG3, sizeof(info->sig3)) != 0) {
+		(void) block_put(b);
+		return EINVAL;
+	}
+
+	info->free_clusters = host2uint32_t_le(free_count);
+	info->last_allocated_cluster = host2uint32_t_le(next_free);
+
+	b->dirty = true;
+	return block_put(b);
+}
+
 static errno_t
 fat_mounted(service_id_t service_id, const char *opts, fs_index_t *index,
     aoff64_t *size)
@@ -1082,6 +1179,9 @@ fat_mounted(service_id_t service_id, const char *opts, fs_index_t *index,
 	fat_instance_t *instance;
 	fat_idx_t *ridxp;
 	fs_node_t *rfn;
+	fat_bs_t *bs;
+	uint32_t free_count;
+	fat_cluster_t next_free;
 	errno_t rc;
 
 	instance = malloc(sizeof(fat_instance_t));
@@ -1105,11 +1205,27 @@ fat_mounted(service_id_t service_id, const char *opts, fs_index_t *index,
 		return rc;
 	}
 
+	bs = block_bb_get(service_id);
+	if (!FAT_IS_FAT32(bs) ||
+	    fat_read_fat32_fsinfo(service_id, &free_count, &next_free) != EOK) {
+		free_count = FAT32_FSINFO_UNKNOWN;
+		next_free = FAT32_FSINFO_UNKNOWN;
+	}
+
+	rc = fat_alloc_init(&instance->alloc, bs, service_id, free_count,
+	    next_free);
+	if (rc != EOK) {
+		fat_fs_close(service_id, rfn);
+		free(instance);
+		return rc;
+	}
+
 	fibril_mutex_lock(&ridxp->lock);
 
 	rc = fs_instance_create(service_id, instance);
 	if (rc != EOK) {
 		fibril_mutex_unlock(&ridxp->lock);
+		fat_alloc_fini(&instance->alloc);
 		fat_fs_close(service_id, rfn);
 		free(instance);
 		return rc;
@@ -1123,42 +1239,15 @@ fat_mounted(service_id_t service_id, const char *opts, fs_index_t *index,
 	return EOK;
 }
 
-static errno_t fat_update_fat32_fsinfo(service_id_t service_id)
-{
-	fat_bs_t *bs;
-	fat32_fsinfo_t *info;
-	block_t *b;
-	errno_t rc;
-
-	bs = block_bb_get(service_id);
-	assert(FAT_IS_FAT32(bs));
-
-	rc = block_get(&b, service_id, uint16_t_le2host(bs->fat32.fsinfo_sec),
-	    BLOCK_FLAGS_NONE);
-	if (rc != EOK)
-		return rc;
-
-	info = (fat32_fsinfo_t *) b->data;
-
-	if (memcmp(info->sig1, FAT32_FSINFO_SIG1, sizeof(info->sig1)) != 0 ||
-	    memcmp(info->sig2, FAT32_FSINFO_SIG2, sizeof(info->sig2)) != 0 ||
-	    memcmp(info->sig3, FAT32_FSINFO_SIG3, sizeof(info->sig3)) != 0) {
-		(void) block_put(b);
-		return EINVAL;
-	}
-
-	/* For now, invalidate the counter. */
-	info->free_clusters = host2uint16_t_le(-1);
-
-	b->dirty = true;
-	return block_put(b);
-}
-
 static errno_t fat_unmounted(service_id_t service_id)
 {
+	fat_instance_t *instance;
 	fs_node_t *fn;
 	fat_node_t *nodep;
 	fat_bs_t *bs;
+	uint32_t free_count;
+	fat_cluster_t next_free;
+	void *data;
 	errno_t rc;
 
 	bs = block_bb_get(service_id);
@@ -1177,11 +1266,27 @@ static errno_t fat_unmounted(service_id_t service_id)
 		return EBUSY;
 	}
 
+	rc = fs_instance_get(service_id, &data);
+	if (rc != EOK) {
+		(void) fat_node_put(fn);
+		return rc;
+	}
+	instance = (fat_instance_t *) data;
+
+	/*
+	 * Stop the allocator and record its free space information in
+	 * the FAT32 FS info.
+	 */
+	if (!fat_alloc_stats(&instance->alloc, &free_count, &next_free))
+		free_count = FAT32_FSINFO_UNKNOWN;
+	fat_alloc_fini(&instance->alloc);
+
 	if (FAT_IS_FAT32(bs)) {
 		/*
 		 * Attempt to update the FAT32 FS info.
 		 */
-		(void) fat_update_fat32_fsinfo(service_id);
+		(void) fat_update_fat32_fsinfo(service_id, free_count,
+		    next_free);
 	}
 
 	/*
@@ -1197,11 +1302,8 @@ static errno_t fat_unmounted(service_id_t service_id)
 	(void) fat_node_fini_by_service_id(service_id);
 	fat_fs_close(service_id, fn);
 
-	void *data;
-	if (fs_instance_get(service_id, &data) == EOK) {
-		fs_instance_destroy(service_id);
-		free(data);
-	}
+	fs_instance_destroy(service_id);
+	free(instance);
 
 	return EOK;
 }
@@ -1495,8 +1597,8 @@ fat_truncate(service_id_t service_id, fs_index_t index, aoff64_t size)
 				goto out;
 		} else {
 			fat_cluster_t lastc;
-			rc = fat_cluster_walk(bs, service_id, nodep->firstc,
-			    &lastc, NULL, (size - 1) / BPC(bs));
+			rc = fat_extent_get(bs, nodep, (size - 1) / BPC(bs),
+			    &lastc);
 			if (rc != EOK)
 				goto out;
 			rc = fat_chop_clusters(bs, nodep, lastc);
@@ -37,10 +37,21 @@
 #include <stddef.h>
 #include <stdbool.h>
 #include <adt/hash_table.h>
+#include <as.h>
 
 #define TMPFS_NODE(node)	((node) ? (tmpfs_node_t *)(node)->data : NULL)
 #define FS_NODE(node)		((node) ? (node)->bp : NULL)
 
+/** Size of the chunks in which file contents are stored. */
+#define TMPFS_PAGE_SIZE		PAGE_SIZE
+
+#define TMPFS_RADIX_BITS	6
+#define TMPFS_RADIX_SLOTS	(1 << TMPFS_RADIX_BITS)
+#define TMPFS_RADIX_MASK	(TMPFS_RADIX_SLOTS - 1)
+
+/** Number of readdir cursors remembered per directory. */
+#define TMPFS_DIR_CURSORS	4
+
 typedef enum {
 	TMPFS_NONE,
 	TMPFS_FILE,
@@ -50,10 +61,21 @@ typedef enum {
 /* forward declaration */
 struct tmpfs_node;
 
+/** Sparse file contents, a radix tree of pages. */
+typedef struct {
+	void *root;		/**< Page or inner node of the tree. */
+	unsigned height;	/**< Number of inner node levels. */
+	uint64_t hint_index;	/**< Index of the last page looked up. */
+	void *hint_page;	/**< Last page looked up. */
+} tmpfs_pages_t;
+
 typedef struct tmpfs_dentry {
 	link_t link;		/**< Linkage for the list of siblings. */
+	ht_link_t dh_link;	/**< Dentries hash table link. */
+	struct tmpfs_node *parent;/**< Containing directory. */
 	struct tmpfs_node *node;/**< Back pointer to TMPFS node. */
 	char *name;		/**< Name of dentry. */
+	aoff64_t pos;		/**< Directory position, stable until unlinked. */
 } tmpfs_dentry_t;
 
 typedef struct tmpfs_node {
@@ -63,9 +85,13 @@ typedef struct tmpfs_node {
 	ht_link_t nh_link;		/**< Nodes hash table link. */
 	tmpfs_dentry_type_t type;
 	unsigned lnkcnt;	/**< Link count. */
-	size_t size;		/**< File size if type is TMPFS_FILE. */
-	void *data;		/**< File content's if type is TMPFS_FILE. */
+	aoff64_t size;		/**< File size if type is TMPFS_FILE. */
+	tmpfs_pages_t pages;	/**< File content's if type is TMPFS_FILE. */
 	list_t cs_list;		/**< Child's siblings list. */
+	aoff64_t next_pos;	/**< Directory position of the next child. */
+	/** Recently read children, starting points for readdir. */
+	tmpfs_dentry_t *cursor[TMPFS_DIR_CURSORS];
+	unsigned cursor_next;	/**< Cursor to be replaced next. */
 } tmpfs_node_t;
 
 extern vfs_out_ops_t tmpfs_ops;
@@ -73,6 +99,11 @@ extern libfs_ops_t tmpfs_libfs_ops;
 
 extern bool tmpfs_init(void);
 
+extern void tmpfs_pages_initialize(tmpfs_pages_t *);
+extern const void *tmpfs_pages_read(tmpfs_pages_t *, uint64_t);
+extern void *tmpfs_pages_write(tmpfs_pages_t *, uint64_t);
+extern void tmpfs_pages_truncate(tmpfs_pages_t *, aoff64_t);
+
 #endif
 
 /**
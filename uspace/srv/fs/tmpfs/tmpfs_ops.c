@@ -55,6 +55,9 @@
 /** All root nodes have index 0. */
 #define TMPFS_SOME_ROOT  0
 
+/** Maximum number of bytes copied through a bounce buffer in one request. */
+#define TMPFS_XFER_MAX  (256 * TMPFS_PAGE_SIZE)
+
 /** Global counter for assigning node indices. Shared by all instances. */
 fs_index_t tmpfs_next_index = 1;
 
@@ -71,6 +74,7 @@ static errno_t tmpfs_create_node(fs_node_t **, service_id_t, int);
 static errno_t tmpfs_destroy_node(fs_node_t *);
 static errno_t tmpfs_link_node(fs_node_t *, fs_node_t *, const char *);
 static errno_t tmpfs_unlink_node(fs_node_t *, fs_node_t *, const char *);
+static void tmpfs_dentry_remove(tmpfs_dentry_t *);
 
 /* Implementation of helper functions. */
 static errno_t tmpfs_root_get(fs_node_t **rfn, service_id_t service_id)
@@ -175,14 +179,11 @@ static void nodes_remove_callback(ht_link_t *item)
 		    list_first(&nodep->cs_list), tmpfs_dentry_t, link);
 
 		assert(nodep->type == TMPFS_DIRECTORY);
-		list_remove(&dentryp->link);
-		free(dentryp);
+		tmpfs_dentry_remove(dentryp);
 	}
 
-	if (nodep->data) {
-		assert(nodep->type == TMPFS_FILE);
-		free(nodep->data);
-	}
+	if (nodep->type == TMPFS_FILE)
+		tmpfs_pages_truncate(&nodep->pages, 0);
 	free(nodep->bp);
 	free(nodep);
 }
@@ -196,6 +197,101 @@ hash_table_ops_t nodes_ops = {
 	.remove_callback = nodes_remove_callback
 };
 
+/** Hash table of all TMPFS directory entries. */
+hash_table_t dentries;
+
+/*
+ * Implementation of hash table interface for the dentries hash table.
+ */
+
+typedef struct {
+	tmpfs_node_t *parent;
+	const char *name;
+} dentry_key_t;
+
+static size_t dentries_name_hash(const char *name)
+{
+	size_t hash = 0;
+
+	while (*name != '\0')
+		hash = hash_combine(hash, (uint8_t) *name++);
+
+	return hash;
+}
+
+static size_t dentries_key_hash(void *k)
+{
+	dentry_key_t *key = (dentry_key_t *)k;
+	return hash_combine((uintptr_t) key->parent,
+	    dentries_name_hash(key->name));
+}
+
+static size_t dentries_hash(const ht_link_t *item)
+{
+	tmpfs_dentry_t *dentryp = hash_table_get_inst(item, tmpfs_dentry_t,
+	    dh_link);
+	return hash_combine((uintptr_t) dentryp->parent,
+	    dentries_name_hash(dentryp->name));
+}
+
+static bool dentries_key_equal(void *key_arg, const ht_link_t *item)
+{
+	tmpfs_dentry_t *dentryp = hash_table_get_inst(item, tmpfs_dentry_t,
+	    dh_link);
+	dentry_key_t *key = (dentry_key_t *)key_arg;
+
+	return key->parent == dentryp->parent &&
+	    !str_cmp(key->name, dentryp->name);
+}
+
+/** TMPFS dentries hash table operations. */
+hash_table_ops_t dentries_ops = {
+	.hash = dentries_hash,
+	.key_hash = dentries_key_hash,
+	.key_equal = dentries_key_equal,
+	.equal = NULL,
+	.remove_callback = NULL
+};
+
+static tmpfs_dentry_t *tmpfs_dentry_find(tmpfs_node_t *parentp,
+    const char *name)
+{
+	dentry_key_t key = {
+		.parent = parentp,
+		.name = name
+	};
+
+	ht_link_t *lnk = hash_table_find(&dentries, &key);
+	if (!lnk)
+		return NULL;
+
+	return hash_table_get_inst(lnk, tmpfs_dentry_t, dh_link);
+}
+
+/** Unlink a dentry from its directory and free it. */
+static void tmpfs_dentry_remove(tmpfs_dentry_t *dentryp)
+{
+	tmpfs_node_t *parentp = dentryp->parent;
+
+	/*
+	 * Cursors pointing at the dentry fall back to its predecessor,
+	 * which is still a valid starting point for the same positions.
+	 */
+	link_t *prev = list_prev(&dentryp->link, &parentp->cs_list);
+	for (unsigned i = 0; i < TMPFS_DIR_CURSORS; i++) {
+		if (parentp->cursor[i] != dentryp)
+			continue;
+
+		parentp->cursor[i] = prev ?
+		    list_get_instance(prev, tmpfs_dentry_t, link) : NULL;
+	}
+
+	hash_table_remove_item(&dentries, &dentryp->dh_link);
+	list_remove(&dentryp->link);
+	free(dentryp->name);
+	free(dentryp);
+}
+
 static void tmpfs_node_initialize(tmpfs_node_t *nodep)
 {
 	nodep->bp = NULL;
@@ -204,15 +300,21 @@ static void tmpfs_node_initialize(tmpfs_node_t *nodep)
 	nodep->type = TMPFS_NONE;
 	nodep->lnkcnt = 0;
 	nodep->size = 0;
-	nodep->data = NULL;
+	tmpfs_pages_initialize(&nodep->pages);
 	list_initialize(&nodep->cs_list);
+	nodep->next_pos = 0;
+	for (unsigned i = 0; i < TMPFS_DIR_CURSORS; i++)
+		nodep->cursor[i] = NULL;
+	nodep->cursor_next = 0;
 }
 
 static void tmpfs_dentry_initialize(tmpfs_dentry_t *dentryp)
 {
 	link_initialize(&dentryp->link);
+	dentryp->parent = NULL;
 	dentryp->name = NULL;
 	dentryp->node = NULL;
+	dentryp->pos = 0;
 }
 
 bool tmpfs_init(void)
@@ -220,6 +322,11 @@ bool tmpfs_init(void)
 	if (!hash_table_create(&nodes, 0, 0, &nodes_ops))
 		return false;
 
+	if (!hash_table_create(&dentries, 0, 0, &dentries_ops)) {
+		hash_table_destroy(&nodes);
+		return false;
+	}
+
 	return true;
 }
 
@@ -253,16 +360,9 @@ static void tmpfs_instance_done(service_id_t service_id)
 
 errno_t tmpfs_match(fs_node_t **rfn, fs_node_t *pfn, const char *component)
 {
-	tmpfs_node_t *parentp = TMPFS_NODE(pfn);
-
-	list_foreach(parentp->cs_list, link, tmpfs_dentry_t, dentryp) {
-		if (!str_cmp(dentryp->name, component)) {
-			*rfn = FS_NODE(dentryp->node);
-			return EOK;
-		}
-	}
+	tmpfs_dentry_t *dentryp = tmpfs_dentry_find(TMPFS_NODE(pfn), component);
 
-	*rfn = NULL;
+	*rfn = dentryp ? FS_NODE(dentryp->node) : NULL;
 	return EOK;
 }
 
@@ -362,10 +462,8 @@ errno_t tmpfs_link_node(fs_node_t *pfn, fs_node_t *cfn, const char *nm)
 	assert(parentp->type == TMPFS_DIRECTORY);
 
 	/* Check for duplicit entries. */
-	list_foreach(parentp->cs_list, link, tmpfs_dentry_t, dp) {
-		if (!str_cmp(dp->name, nm))
-			return EEXIST;
-	}
+	if (tmpfs_dentry_find(parentp, nm))
+		return EEXIST;
 
 	/* Allocate and initialize the dentry. */
 	dentryp = malloc(sizeof(tmpfs_dentry_t));
@@ -381,9 +479,12 @@ errno_t tmpfs_link_node(fs_node_t *pfn, fs_node_t *cfn, const char *nm)
 		return ENOMEM;
 	}
 	str_cpy(dentryp->name, size + 1, nm);
+	dentryp->parent = parentp;
 	dentryp->node = childp;
+	dentryp->pos = parentp->next_pos++;
 	childp->lnkcnt++;
 	list_append(&dentryp->link, &parentp->cs_list);
+	hash_table_insert(&dentries, &dentryp->dh_link);
 
 	return EOK;
 }
@@ -391,29 +492,21 @@ errno_t tmpfs_link_node(fs_node_t *pfn, fs_node_t *cfn, const char *nm)
 errno_t tmpfs_unlink_node(fs_node_t *pfn, fs_node_t *cfn, const char *nm)
 {
 	tmpfs_node_t *parentp = TMPFS_NODE(pfn);
-	tmpfs_node_t *childp = NULL;
-	tmpfs_dentry_t *dentryp;
 
 	if (!parentp)
 		return EBUSY;
 
-	list_foreach(parentp->cs_list, link, tmpfs_dentry_t, dp) {
-		if (!str_cmp(dp->name, nm)) {
-			dentryp = dp;
-			childp = dentryp->node;
-			assert(FS_NODE(childp) == cfn);
-			break;
-		}
-	}
-
-	if (!childp)
+	tmpfs_dentry_t *dentryp = tmpfs_dentry_find(parentp, nm);
+	if (!dentryp)
 		return ENOENT;
 
+	tmpfs_node_t *childp = dentryp->node;
+	assert(FS_NODE(childp) == cfn);
+
 	if ((childp->lnkcnt == 1) && !list_empty(&childp->cs_list))
 		return ENOTEMPTY;
 
-	list_remove(&dentryp->link);
-	free(dentryp);
+	tmpfs_dentry_remove(dentryp);
 	childp->lnkcnt--;
 
 	return EOK;
@@ -462,6 +555,54 @@ static errno_t tmpfs_unmounted(service_id_t service_id)
 	return EOK;
 }
 
+/** Find the first child of a directory at or after a position.
+ *
+ * Children are kept in the order of their positions. The search starts
+ * from the closest remembered cursor, so a sequential scan of the
+ * directory advances by a single child per read.
+ *
+ * @param nodep Directory node.
+ * @param pos   Directory position.
+ *
+ * @return Directory entry or NULL if there are no more entries.
+ */
+static tmpfs_dentry_t *tmpfs_dir_seek(tmpfs_node_t *nodep, aoff64_t pos)
+{
+	tmpfs_dentry_t *start = NULL;
+
+	for (unsigned i = 0; i < TMPFS_DIR_CURSORS; i++) {
+		tmpfs_dentry_t *cursor = nodep->cursor[i];
+		if ((cursor != NULL) && (cursor->pos <= pos) &&
+		    ((start == NULL) || (cursor->pos > start->pos)))
+			start = cursor;
+	}
+
+	link_t *lnk = start ? &start->link : list_first(&nodep->cs_list);
+	while (lnk != NULL) {
+		tmpfs_dentry_t *dentryp = list_get_instance(lnk,
+		    tmpfs_dentry_t, link);
+		if (dentryp->pos < pos) {
+			lnk = list_next(lnk, &nodep->cs_list);
+			continue;
+		}
+
+		/* Remember the entry for the next read. */
+		for (unsigned i = 0; i < TMPFS_DIR_CURSORS; i++) {
+			if (nodep->cursor[i] == start) {
+				nodep->cursor[i] = dentryp;
+				return dentryp;
+			}
+		}
+
+		nodep->cursor[nodep->cursor_next] = dentryp;
+		nodep->cursor_next = (nodep->cursor_next + 1) %
+		    TMPFS_DIR_CURSORS;
+		return dentryp;
+	}
+
+	return NULL;
+}
+
 static errno_t tmpfs_read(service_id_t service_id, fs_index_t index, aoff64_t pos,
     size_t *rbytes)
 {
@@ -491,32 +632,59 @@ static errno_t tmpfs_read(service_id_t service_id, fs_index_t index, aoff64_t po
 
 	size_t bytes;
 	if (nodep->type == TMPFS_FILE) {
-		bytes = min(nodep->size - pos, size);
-		(void) async_data_read_finalize(&call, nodep->data + pos,
-		    bytes);
-	} else {
-		tmpfs_dentry_t *dentryp;
-		link_t *lnk;
+		size_t offset = pos % TMPFS_PAGE_SIZE;
+		bytes = min(size, TMPFS_XFER_MAX);
+		if (pos >= nodep->size)
+			bytes = 0;
+		else if (nodep->size - pos < bytes)
+			bytes = nodep->size - pos;
+
+		/* Gather reads spanning several pages in a bounce buffer. */
+		uint8_t *buf = NULL;
+		if (offset + bytes > TMPFS_PAGE_SIZE) {
+			buf = malloc(bytes);
+			if (buf == NULL)
+				bytes = TMPFS_PAGE_SIZE - offset;
+		}
 
+		if (buf != NULL) {
+			size_t done = 0;
+			while (done < bytes) {
+				size_t poff = (pos + done) % TMPFS_PAGE_SIZE;
+				size_t n = min(bytes - done,
+				    TMPFS_PAGE_SIZE - poff);
+				const uint8_t *page = tmpfs_pages_read(
+				    &nodep->pages, (pos + done) / TMPFS_PAGE_SIZE);
+				memcpy(buf + done, page + poff, n);
+				done += n;
+			}
+
+			(void) async_data_read_finalize(&call, buf, bytes);
+			free(buf);
+		} else {
+			/* Serve the data straight from the page. */
+			const uint8_t *page = tmpfs_pages_read(&nodep->pages,
+			    pos / TMPFS_PAGE_SIZE);
+			(void) async_data_read_finalize(&call, page + offset,
+			    bytes);
+		}
+	} else {
 		assert(nodep->type == TMPFS_DIRECTORY);
 
-		/*
-		 * Yes, we really use O(n) algorithm here.
-		 * If it bothers someone, it could be fixed by introducing a
-		 * hash table.
-		 */
-		lnk = list_nth(&nodep->cs_list, pos);
-
-		if (lnk == NULL) {
+		tmpfs_dentry_t *dentryp = tmpfs_dir_seek(nodep, pos);
+		if (dentryp == NULL) {
 			async_answer_0(&call, ENOENT);
 			return ENOENT;
 		}
 
-		dentryp = list_get_instance(lnk, tmpfs_dentry_t, link);
-
 		(void) async_data_read_finalize(&call, dentryp->name,
 		    str_size(dentryp->name) + 1);
-		bytes = 1;
+
+		/*
+		 * Advance the position just past the returned entry so that
+		 * positions of removed entries are skipped in one step.
+		 */
+		bytes = dentryp->pos + 1 - pos;
 	}
 
 	*rbytes = bytes;
@@ -553,33 +721,68 @@ tmpfs_write(service_id_t service_id, fs_index_t index, aoff64_t pos,
 	}
 
 	/*
-	 * Check whether the file needs to grow.
-	 */
-	if (pos + size <= nodep->size) {
-		/* The file size is not changing. */
-		(void) async_data_write_finalize(&call, nodep->data + pos,
-		    size);
-		goto out;
-	}
-	size_t delta = (pos + size) - nodep->size;
-	/*
-	 * At this point, we are deliberately extremely straightforward and
-	 * simply realloc the contents of the file on every write that grows the
-	 * file. In the end, the situation might not be as bad as it may look:
-	 * our heap allocator can save us and just grow the block whenever
-	 * possible.
+	 * Allocate the pages to be written first, so that running out of
+	 * memory only shortens the write. Holes before the position are
+	 * left unallocated and read as zeros.
 	 */
-	void *newdata = realloc(nodep->data, nodep->size + delta);
-	if (!newdata) {
+	size_t offset = pos % TMPFS_PAGE_SIZE;
+	size = min(size, TMPFS_XFER_MAX);
+
+	uint8_t *page = NULL;
+	size_t avail = 0;
+	do {
+		size_t poff = (pos + avail) % TMPFS_PAGE_SIZE;
+		uint8_t *p = tmpfs_pages_write(&nodep->pages,
+		    (pos + avail) / TMPFS_PAGE_SIZE);
+		if (p == NULL)
+			break;
+
+		if (page == NULL)
+			page = p;
+		avail += min(size - avail, TMPFS_PAGE_SIZE - poff);
+	} while (avail < size);
+
+	if (page == NULL) {
 		async_answer_0(&call, ENOMEM);
 		size = 0;
 		goto out;
 	}
-	/* Clear any newly allocated memory in order to emulate gaps. */
-	memset(newdata + nodep->size, 0, delta);
-	nodep->size += delta;
-	nodep->data = newdata;
-	(void) async_data_write_finalize(&call, nodep->data + pos, size);
+
+	size = avail;
+
+	/* Scatter writes spanning several pages from a bounce buffer. */
+	uint8_t *buf = NULL;
+	if (offset + size > TMPFS_PAGE_SIZE) {
+		buf = malloc(size);
+		if (buf == NULL)
+			size = TMPFS_PAGE_SIZE - offset;
+	}
+
+	if (buf != NULL) {
+		errno_t rc = async_data_write_finalize(&call, buf, size);
+		if (rc != EOK) {
+			free(buf);
+			size = 0;
+			goto out;
+		}
+
+		size_t done = 0;
+		while (done < size) {
+			size_t poff = (pos + done) % TMPFS_PAGE_SIZE;
+			size_t n = min(size - done, TMPFS_PAGE_SIZE - poff);
+			uint8_t *p = tmpfs_pages_write(&nodep->pages,
+			    (pos + done) / TMPFS_PAGE_SIZE);
+			memcpy(p + poff, buf + done, n);
+			done += n;
+		}
+
+		free(buf);
+	} else {
+		(void) async_data_write_finalize(&call, page + offset, size);
+	}
+
+	if (pos + size > nodep->size)
+		nodep->size = pos + size;
 
 out:
 	*wbytes = size;
@@ -606,20 +809,11 @@ static errno_t tmpfs_truncate(service_id_t service_id, fs_index_t index,
 	if (size == nodep->size)
 		return EOK;
 
-	if (size > SIZE_MAX)
-		return ENOMEM;
-
-	void *newdata = realloc(nodep->data, size);
-	if (!newdata && size)
-		return ENOMEM;
-
-	if (size > nodep->size) {
-		size_t delta = size - nodep->size;
-		memset(newdata + nodep->size, 0, delta);
-	}
+	/* Growing the file just adds a hole at its end. */
+	if (size < nodep->size)
+		tmpfs_pages_truncate(&nodep->pages, size);
 
 	nodep->size = size;
-	nodep->data = newdata;
 	return EOK;
 }
 
@@ -0,0 +1,243 @@
+/*
+ * Copyright (c) 2026 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup tmpfs
+ * @{
+ */
+
+/**
+ * @file	tmpfs_pages.c
+ * @brief	Paged storage of TMPFS file contents.
+ *
+ * File contents are kept in page-sized chunks indexed by a radix tree.
+ * Missing pages are holes which read as zeros. The tree only grows as
+ * high as needed to cover the highest page of the file, so small files
+ * cost a single page and no inner nodes.
+ */
+
+#include "tmpfs.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <mem.h>
+
+/** Contents of holes. */
+static const uint8_t tmpfs_zero_page[TMPFS_PAGE_SIZE];
+
+/** Check whether a tree of the given height can hold a page index. */
+static bool tmpfs_pages_covers(unsigned int height, uint64_t index)
+{
+	if (height * TMPFS_RADIX_BITS >= 64)
+		return true;
+
+	return (index >> (height * TMPFS_RADIX_BITS)) == 0;
+}
+
+/** Look up a page.
+ *
+ * @param pages Paged storage.
+ * @param index Page index.
+ *
+ * @return The page or NULL if the page is a hole.
+ */
+static void *tmpfs_pages_find(tmpfs_pages_t *pages, uint64_t index)
+{
+	if ((pages->hint_page != NULL) && (pages->hint_index == index))
+		return pages->hint_page;
+
+	if (!tmpfs_pages_covers(pages->height, index))
+		return NULL;
+
+	void *node = pages->root;
+	for (unsigned int level = pages->height; level > 0; level--) {
+		if (node == NULL)
+			return NULL;
+
+		unsigned int shift = (level - 1) * TMPFS_RADIX_BITS;
+		node = ((void **) node)[(index >> shift) & TMPFS_RADIX_MASK];
+	}
+
+	if (node != NULL) {
+		pages->hint_index = index;
+		pages->hint_page = node;
+	}
+
+	return node;
+}
+
+void tmpfs_pages_initialize(tmpfs_pages_t *pages)
+{
+	pages->root = NULL;
+	pages->height = 0;
+	pages->hint_index = 0;
+	pages->hint_page = NULL;
+}
+
+/** Get a page for reading.
+ *
+ * @param pages Paged storage.
+ * @param index Page index.
+ *
+ * @return The page, or a page of zeros if the page is a hole.
+ */
+const void *tmpfs_pages_read(tmpfs_pages_t *pages, uint64_t index)
+{
+	void *page = tmpfs_pages_find(pages, index);
+	return (page != NULL) ? page : tmpfs_zero_page;
+}
+
+/** Get a page for writing, allocating it if it is a hole.
+ *
+ * Newly allocated pages are zero-filled.
+ *
+ * @param pages Paged storage.
+ * @param index Page index.
+ *
+ * @return The page or NULL if there is not enough memory.
+ */
+void *tmpfs_pages_write(tmpfs_pages_t *pages, uint64_t index)
+{
+	void *page = tmpfs_pages_find(pages, index);
+	if (page != NULL)
+		return page;
+
+	/* Add levels on top of the tree until it covers the index. */
+	while (!tmpfs_pages_covers(pages->height, index)) {
+		if (pages->root != NULL) {
+			void **node = calloc(TMPFS_RADIX_SLOTS, sizeof(void *));
+			if (node == NULL)
+				return NULL;
+
+			node[0] = pages->root;
+			pages->root = node;
+		}
+
+		pages->height++;
+	}
+
+	void **slot = &pages->root;
+	for (unsigned int level = pages->height; level > 0; level--) {
+		if (*slot == NULL) {
+			*slot = calloc(TMPFS_RADIX_SLOTS, sizeof(void *));
+			if (*slot == NULL)
+				return NULL;
+		}
+
+		unsigned int shift = (level - 1) * TMPFS_RADIX_BITS;
+		slot = &((void **) *slot)[(index >> shift) & TMPFS_RADIX_MASK];
+	}
+
+	*slot = calloc(1, TMPFS_PAGE_SIZE);
+	if (*slot == NULL)
+		return NULL;
+
+	pages->hint_index = index;
+	pages->hint_page = *slot;
+	return *slot;
+}
+
+/** Free all pages of a subtree starting at a given page index.
+ *
+ * @param slot  Slot holding the subtree.
+ * @param level Level of the subtree, 0 for a page.
+ * @param base  Index of the first page covered by the subtree.
+ * @param first Index of the first page to free.
+ *
+ * @return True if the whole subtree was freed.
+ */
+static bool tmpfs_pages_trim(void **slot, unsigned int level, uint64_t base,
+    uint64_t first)
+{
+	if (*slot == NULL)
+		return true;
+
+	if (level == 0) {
+		if (base < first)
+			return false;
+
+		free(*slot);
+		*slot = NULL;
+		return true;
+	}
+
+	void **node = *slot;
+	unsigned int shift = (level - 1) * TMPFS_RADIX_BITS;
+	bool empty = true;
+
+	for (unsigned int i = 0; i < TMPFS_RADIX_SLOTS; i++) {
+		if (node[i] == NULL)
+			continue;
+
+		uint64_t child = base + ((uint64_t) i << shift);
+		uint64_t span = (uint64_t) 1 << shift;
+
+		/* Keep subtrees which lie entirely below the first page. */
+		if (child + span <= first) {
+			empty = false;
+			continue;
+		}
+
+		if (!tmpfs_pages_trim(&node[i], level - 1, child, first))
+			empty = false;
+	}
+
+	if (empty) {
+		free(node);
+		*slot = NULL;
+	}
+
+	return empty;
+}
+
+/** Shrink paged storage.
+ *
+ * Frees all pages past the new size and clears the tail of the last
+ * page so that the file reads as zeros if it grows again.
+ *
+ * @param pages Paged storage.
+ * @param size  New size of the file in bytes.
+ */
+void tmpfs_pages_truncate(tmpfs_pages_t *pages, aoff64_t size)
+{
+	uint64_t first = (size + TMPFS_PAGE_SIZE - 1) / TMPFS_PAGE_SIZE;
+
+	pages->hint_page = NULL;
+	(void) tmpfs_pages_trim(&pages->root, pages->height, 0, first);
+	if (pages->root == NULL)
+		pages->height = 0;
+
+	size_t offset = size % TMPFS_PAGE_SIZE;
+	if (offset != 0) {
+		void *page = tmpfs_pages_find(pages, size / TMPFS_PAGE_SIZE);
+		if (page != NULL)
+			memset(page + offset, 0, TMPFS_PAGE_SIZE - offset);
+	}
+}
+
+/**
+ * @}
+ */
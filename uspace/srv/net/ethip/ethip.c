@@ -225,7 +225,27 @@ static errno_t ethip_send6(iplink_srv_t *srv, iplink_sdu6_t *sdu)
 	return rc;
 }
 
-errno_t ethip_received(iplink_srv_t *srv, void *data, size_t size)
+/** Pass received SDU to the IP link client, possibly as part of a batch */
+static errno_t ethip_deliver(ethip_nic_t *nic, iplink_srv_batch_t *batch,
+    iplink_recv_sdu_t *sdu, ip_ver_t ver)
+{
+	if (batch != NULL)
+		return iplink_srv_batch_add(batch, sdu, ver);
+
+	return iplink_ev_recv(&nic->iplink, sdu, ver);
+}
+
+/** Process received Ethernet frame.
+ *
+ * @param srv	IP link service
+ * @param data	Frame data
+ * @param size	Frame size in bytes
+ * @param batch	Batch to collect IP SDUs into or @c NULL to deliver
+ *		them immediately
+ * @return	EOK on success or an error code
+ */
+errno_t ethip_received(iplink_srv_t *srv, void *data, size_t size,
+    iplink_srv_batch_t *batch)
 {
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "ethip_received(): srv=%p", srv);
 	ethip_nic_t *nic = (ethip_nic_t *) srv->arg;
@@ -250,14 +270,14 @@ errno_t ethip_received(iplink_srv_t *srv, void *data, size_t size)
 		sdu.data = frame.data;
 		sdu.size = frame.size;
 		log_msg(LOG_DEFAULT, LVL_DEBUG, " - call iplink_ev_recv");
-		rc = iplink_ev_recv(&nic->iplink, &sdu, ip_v4);
+		rc = ethip_deliver(nic, batch, &sdu, ip_v4);
 		break;
 	case ETYPE_IPV6:
 		log_msg(LOG_DEFAULT, LVL_DEBUG, " - construct SDU IPv6");
 		sdu.data = frame.data;
 		sdu.size = frame.size;
 		log_msg(LOG_DEFAULT, LVL_DEBUG, " - call iplink_ev_recv");
-		rc = iplink_ev_recv(&nic->iplink, &sdu, ip_v6);
+		rc = ethip_deliver(nic, batch, &sdu, ip_v6);
 		break;
 	default:
 		log_msg(LOG_DEFAULT, LVL_DEBUG, "Unknown ethertype 0x%" PRIx16,
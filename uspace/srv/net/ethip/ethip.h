@@ -116,7 +116,8 @@ typedef struct {
 } ethip_atrans_t;
 
 extern errno_t ethip_iplink_init(ethip_nic_t *);
-extern errno_t ethip_received(iplink_srv_t *, void *, size_t);
+extern errno_t ethip_received(iplink_srv_t *, void *, size_t,
+    iplink_srv_batch_t *);
 
 #endif
 
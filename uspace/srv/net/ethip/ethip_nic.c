@@ -35,6 +35,7 @@
  */
 
 #include <adt/list.h>
+#include <align.h>
 #include <async.h>
 #include <stdbool.h>
 #include <errno.h>
@@ -43,6 +44,7 @@
 #include <inet/iplink_srv.h>
 #include <io/log.h>
 #include <loc.h>
+#include <macros.h>
 #include <nic_iface.h>
 #include <stdlib.h>
 #include <mem.h>
@@ -274,7 +276,7 @@ static void ethip_nic_received(ethip_nic_t *nic, ipc_call_t *call)
 	    size);
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "call ethip_received");
-	rc = ethip_received(&nic->iplink, data, size);
+	rc = ethip_received(&nic->iplink, data, size, NULL);
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "free data");
 	free(data);
 
@@ -282,6 +284,61 @@ static void ethip_nic_received(ethip_nic_t *nic, ipc_call_t *call)
 	async_answer_0(call, rc);
 }
 
+static void ethip_nic_received_batch(ethip_nic_t *nic, ipc_call_t *call)
+{
+	iplink_srv_batch_t batch;
+	nic_batch_hdr_t *hdr;
+	uint8_t *data;
+	size_t size;
+	size_t offs;
+	size_t count;
+	size_t i;
+	errno_t rc;
+
+	count = IPC_GET_ARG1(*call);
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "ethip_nic_received_batch() nic=%p "
+	    "count=%zu", nic, count);
+
+	rc = async_data_write_accept((void **) &data, false, 0,
+	    NIC_BATCH_MAX_SIZE, 0, &size);
+	if (rc != EOK) {
+		log_msg(LOG_DEFAULT, LVL_DEBUG, "data_write_accept() failed");
+		async_answer_0(call, rc);
+		return;
+	}
+
+	/* IP packets from the whole batch go to inetsrv in one IPC */
+	iplink_srv_batch_init(&batch, &nic->iplink);
+
+	offs = 0;
+	for (i = 0; i < count; i++) {
+		if (size - offs < sizeof(*hdr)) {
+			rc = EINVAL;
+			break;
+		}
+
+		hdr = (nic_batch_hdr_t *) (data + offs);
+		if (size - offs - sizeof(*hdr) < hdr->size) {
+			rc = EINVAL;
+			break;
+		}
+
+		(void) ethip_received(&nic->iplink, &hdr[1], hdr->size,
+		    &batch);
+
+		offs += sizeof(*hdr) + hdr->size;
+		offs = min(ALIGN_UP(offs, sizeof(*hdr)), size);
+	}
+
+	(void) iplink_srv_batch_flush(&batch);
+	iplink_srv_batch_fini(&batch);
+	free(data);
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "ethip_nic_received_batch() done, "
+	    "rc=%s", str_error_name(rc));
+	async_answer_0(call, rc);
+}
+
 static void ethip_nic_device_state(ethip_nic_t *nic, ipc_call_t *call)
 {
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "ethip_nic_device_state()");
@@ -313,6 +370,9 @@ static void ethip_nic_cb_conn(ipc_call_t *icall, void *arg)
 		case NIC_EV_DEVICE_STATE:
 			ethip_nic_device_state(nic, &call);
 			break;
+		case NIC_EV_RECEIVED_BATCH:
+			ethip_nic_received_batch(nic, &call);
+			break;
 		default:
 			log_msg(LOG_DEFAULT, LVL_DEBUG, "unknown IPC method: %" PRIun, IPC_GET_IMETHOD(call));
 			async_answer_0(&call, ENOTSUP);
@@ -32,53 +32,143 @@
 /**
  * @file
  * @brief Datagram reassembly.
+ *
+ * Datagrams being reassembled are found by a hash table. Each keeps the
+ * data received so far as a list of non-overlapping fragments sorted by
+ * offset, duplicate data is dropped on arrival. Memory held by incomplete
+ * datagrams is limited, the oldest datagrams are evicted to make room for
+ * new data. Datagrams that are not completed in time are discarded.
  */
 
+#include <adt/hash.h>
+#include <adt/hash_table.h>
 #include <errno.h>
 #include <fibril_synch.h>
 #include <io/log.h>
 #include <macros.h>
 #include <mem.h>
 #include <stdlib.h>
+#include <time.h>
 
 #include "inetsrv.h"
 #include "inet_std.h"
 #include "reass.h"
 
-/** Datagram being reassembled.
+/** Memory limit for datagrams being reassembled, in bytes */
+#define REASS_MEM_LIMIT (1024 * 1024)
+
+/** Reassembly timeout, RFC 791 suggests 15 seconds */
+#define REASS_TIMEOUT_SEC 15
+
+/** Datagram identification.
  *
- * Uniquely identified by (source address, destination address, protocol,
- * identification) per RFC 791 sec. 2.3 / Fragmentation.
+ * Uniquely identifies datagram per RFC 791 sec. 2.3 / Fragmentation.
  */
 typedef struct {
-	link_t map_link;
-	/** List of fragments, @c reass_frag_t */
+	/** Source address */
+	inet_addr_t src;
+	/** Destination address */
+	inet_addr_t dest;
+	/** Protocol */
+	uint8_t proto;
+	/** Identification */
+	uint32_t ident;
+} reass_key_t;
+
+/** Datagram being reassembled. */
+typedef struct {
+	/** Link to @c reass_dgram_map */
+	ht_link_t map_link;
+	/** Link to @c reass_dgram_age */
+	link_t age_link;
+	/** Identification */
+	reass_key_t key;
+	/** Packet header (of the first fragment, if received), without data */
+	inet_packet_t hdr;
+	/** Time when reassembly is abandoned */
+	struct timespec deadline;
+	/** Received data, @c reass_frag_t sorted by offset, not overlapping */
 	list_t frags;
+	/** Number of data bytes received */
+	size_t covered;
+	/** Last fragment has been received */
+	bool have_last;
+	/** Datagram size (if @c have_last) */
+	size_t size;
+	/** Memory held by the datagram */
+	size_t mem;
 } reass_dgram_t;
 
-/** One datagram fragment */
+/** Contiguous piece of received datagram data */
 typedef struct {
 	link_t dgram_link;
-	inet_packet_t packet;
+	/** Offset of data in datagram */
+	size_t offs;
+	/** Data size */
+	size_t size;
+	/** Data, allocated together with the structure */
+	uint8_t *data;
 } reass_frag_t;
 
-/** Datagram map, list of reass_dgram_t */
-static LIST_INITIALIZE(reass_dgram_map);
-/** Protects access to @c reass_dgram_map */
+static size_t reass_dgram_hash(const ht_link_t *);
+static size_t reass_dgram_key_hash(void *);
+static bool reass_dgram_equal(const ht_link_t *, const ht_link_t *);
+static bool reass_dgram_key_equal(void *, const ht_link_t *);
+
+static hash_table_ops_t reass_dgram_ops = {
+	.hash = reass_dgram_hash,
+	.key_hash = reass_dgram_key_hash,
+	.equal = reass_dgram_equal,
+	.key_equal = reass_dgram_key_equal,
+	.remove_callback = NULL
+};
+
+/** Datagram map, reass_dgram_t by reass_key_t */
+static hash_table_t reass_dgram_map;
+/** Datagrams being reassembled, oldest first */
+static LIST_INITIALIZE(reass_dgram_age);
+/** Memory held by datagrams being reassembled */
+static size_t reass_mem;
+/** Discards datagrams that were not reassembled in time */
+static fibril_timer_t *reass_timer;
+/** @c reass_timer is set */
+static bool reass_timer_active;
+/** Protects access to @c reass_dgram_map and other reassembly state */
 static FIBRIL_MUTEX_INITIALIZE(reass_dgram_map_lock);
 
-static reass_dgram_t *reass_dgram_new(void);
 static reass_dgram_t *reass_dgram_get(inet_packet_t *);
 static errno_t reass_dgram_insert_frag(reass_dgram_t *, inet_packet_t *);
 static bool reass_dgram_complete(reass_dgram_t *);
 static void reass_dgram_remove(reass_dgram_t *);
 static errno_t reass_dgram_deliver(reass_dgram_t *);
 static void reass_dgram_destroy(reass_dgram_t *);
+static void reass_evict(reass_dgram_t *);
+static void reass_timer_set(void);
+static void reass_timeout(void *);
+
+/** Initialize datagram reassembly.
+ *
+ * @return EOK on success or ENOMEM.
+ */
+errno_t inet_reass_init(void)
+{
+	if (!hash_table_create(&reass_dgram_map, 0, 0, &reass_dgram_ops))
+		return ENOMEM;
+
+	reass_timer = fibril_timer_create(&reass_dgram_map_lock);
+	if (reass_timer == NULL) {
+		hash_table_destroy(&reass_dgram_map);
+		return ENOMEM;
+	}
+
+	return EOK;
+}
 
 /** Queue packet for datagram reassembly.
  *
  * @param packet	Packet
- * @return		EOK on success or ENOMEM.
+ * @return		EOK on success, ENOMEM if out of memory,
+ *			ELIMIT if datagram would be too large
  */
 errno_t inet_reass_queue_packet(inet_packet_t *packet)
 {
@@ -100,8 +190,16 @@ errno_t inet_reass_queue_packet(inet_packet_t *packet)
 
 	/* Insert fragment into the datagram */
 	rc = reass_dgram_insert_frag(rdg, packet);
-	if (rc != EOK)
-		return ENOMEM;
+	if (rc != EOK) {
+		if (list_empty(&rdg->frags)) {
+			reass_dgram_remove(rdg);
+			reass_dgram_destroy(rdg);
+		}
+
+		fibril_mutex_unlock(&reass_dgram_map_lock);
+		log_msg(LOG_DEFAULT, LVL_DEBUG, "Fragment dropped.");
+		return rc;
+	}
 
 	/* Check if datagram is complete */
 	if (reass_dgram_complete(rdg)) {
@@ -115,6 +213,9 @@ errno_t inet_reass_queue_packet(inet_packet_t *packet)
 		return rc;
 	}
 
+	/* Make room by evicting the oldest datagrams */
+	reass_evict(rdg);
+
 	fibril_mutex_unlock(&reass_dgram_map_lock);
 	return EOK;
 }
@@ -123,111 +224,195 @@ errno_t inet_reass_queue_packet(inet_packet_t *packet)
  *
  * @param packet	Packet
  * @return		Datagram reassembly structure matching @a packet
+ *			or @c NULL if out of memory
  */
 static reass_dgram_t *reass_dgram_get(inet_packet_t *packet)
 {
-	assert(fibril_mutex_is_locked(&reass_dgram_map_lock));
+	reass_dgram_t *rdg;
+	reass_key_t key;
+	ht_link_t *link;
 
-	list_foreach(reass_dgram_map, map_link, reass_dgram_t, rdg) {
-		link_t *f1_link = list_first(&rdg->frags);
-		assert(f1_link != NULL);
+	assert(fibril_mutex_is_locked(&reass_dgram_map_lock));
 
-		reass_frag_t *f1 = list_get_instance(f1_link, reass_frag_t,
-		    dgram_link);
+	key.src = packet->src;
+	key.dest = packet->dest;
+	key.proto = packet->proto;
+	key.ident = packet->ident;
 
-		if ((inet_addr_compare(&f1->packet.src, &packet->src)) &&
-		    (inet_addr_compare(&f1->packet.dest, &packet->dest)) &&
-		    (f1->packet.proto == packet->proto) &&
-		    (f1->packet.ident == packet->ident)) {
-			/* Match */
-			return rdg;
-		}
-	}
+	link = hash_table_find(&reass_dgram_map, &key);
+	if (link != NULL)
+		return hash_table_get_inst(link, reass_dgram_t, map_link);
 
 	/* No existing reassembly structure. Create a new one. */
-	return reass_dgram_new();
-}
-
-/** Create new datagram reassembly structure.
- *
- * @return New datagram reassembly structure.
- */
-static reass_dgram_t *reass_dgram_new(void)
-{
-	reass_dgram_t *rdg;
-
 	rdg = calloc(1, sizeof(reass_dgram_t));
 	if (rdg == NULL)
 		return NULL;
 
-	list_append(&rdg->map_link, &reass_dgram_map);
+	rdg->key = key;
+	rdg->hdr = *packet;
+	rdg->hdr.data = NULL;
+	rdg->hdr.size = 0;
 	list_initialize(&rdg->frags);
+	rdg->mem = sizeof(reass_dgram_t);
+
+	getuptime(&rdg->deadline);
+	rdg->deadline.tv_sec += REASS_TIMEOUT_SEC;
+
+	hash_table_insert(&reass_dgram_map, &rdg->map_link);
+	list_append(&rdg->age_link, &reass_dgram_age);
+	reass_mem += rdg->mem;
+
+	if (!reass_timer_active)
+		reass_timer_set();
 
 	return rdg;
 }
 
-static reass_frag_t *reass_frag_new(void)
+/** Create new piece of datagram data.
+ *
+ * @param offs		Offset of the data in datagram
+ * @param data		Data
+ * @param size		Data size
+ * @return		New fragment or @c NULL if out of memory
+ */
+static reass_frag_t *reass_frag_new(size_t offs, const void *data,
+    size_t size)
 {
 	reass_frag_t *frag;
 
-	frag = calloc(1, sizeof(reass_frag_t));
+	frag = malloc(sizeof(reass_frag_t) + size);
 	if (frag == NULL)
 		return NULL;
 
 	link_initialize(&frag->dgram_link);
+	frag->offs = offs;
+	frag->size = size;
+	frag->data = (uint8_t *) (frag + 1);
+	memcpy(frag->data, data, size);
 
 	return frag;
 }
 
-static errno_t reass_dgram_insert_frag(reass_dgram_t *rdg, inet_packet_t *packet)
+/** Store data of a datagram piece not received before.
+ *
+ * @param rdg		Datagram reassembly structure
+ * @param before	Fragment before which to insert or @c NULL to append
+ * @param packet	Packet containing the piece
+ * @param b		Start offset of the piece in datagram
+ * @param e		End offset of the piece in datagram
+ * @return		EOK on success or ENOMEM
+ */
+static errno_t reass_dgram_add_piece(reass_dgram_t *rdg, reass_frag_t *before,
+    inet_packet_t *packet, size_t b, size_t e)
 {
 	reass_frag_t *frag;
-	void *data_copy;
-	link_t *link;
-
-	assert(fibril_mutex_is_locked(&reass_dgram_map_lock));
 
-	frag = reass_frag_new();
+	frag = reass_frag_new(b, (uint8_t *) packet->data + (b - packet->offs),
+	    e - b);
+	if (frag == NULL)
+		return ENOMEM;
 
-	/* Clone the packet */
+	if (before != NULL)
+		list_insert_before(&frag->dgram_link, &before->dgram_link);
+	else
+		list_append(&frag->dgram_link, &rdg->frags);
 
-	data_copy = malloc(packet->size);
-	if (data_copy == NULL) {
-		free(frag);
-		return ENOMEM;
-	}
+	rdg->covered += e - b;
+	rdg->mem += sizeof(reass_frag_t) + (e - b);
+	reass_mem += sizeof(reass_frag_t) + (e - b);
+	return EOK;
+}
 
-	memcpy(data_copy, packet->data, packet->size);
+/** Insert fragment into datagram.
+ *
+ * Only data not received before is stored.
+ *
+ * @param rdg		Datagram reassembly structure
+ * @param packet	Fragment
+ * @return		EOK on success, ENOMEM if out of memory,
+ *			ELIMIT if datagram would be too large
+ */
+static errno_t reass_dgram_insert_frag(reass_dgram_t *rdg, inet_packet_t *packet)
+{
+	size_t fragoff_limit;
+	reass_frag_t *last = NULL;
+	size_t b, e;
+	link_t *link;
+	errno_t rc;
 
-	frag->packet = *packet;
-	frag->packet.data = data_copy;
+	assert(fibril_mutex_is_locked(&reass_dgram_map_lock));
 
-	/*
-	 * XXX Make resource-consuming attacks harder, eliminate any duplicate
-	 * data immediately. Possibly eliminate redundant packet headers.
-	 */
+	b = packet->offs;
+	e = packet->offs + packet->size;
 
-	/*
-	 * Insert into the list, which is sorted by offs member ascending.
-	 */
+	/* Upper bound for fragment offset field */
+	fragoff_limit = 1 << (FF_FRAGOFF_h - FF_FRAGOFF_l + 1);
 
-	link = list_first(&rdg->frags);
-	while (link != NULL) {
-		reass_frag_t *qf = list_get_instance(link, reass_frag_t,
-		    dgram_link);
+	/* Verify that total size of datagram is within reasonable bounds */
+	if (e > FRAG_OFFS_UNIT * fragoff_limit)
+		return ELIMIT;
 
-		if (qf->packet.offs >= packet->offs)
-			break;
+	if (!packet->mf) {
+		if (rdg->have_last) {
+			/* Another last fragment, the first one stays valid */
+			e = min(e, rdg->size);
+		} else {
+			/* Data received so far must fit */
+			link = list_last(&rdg->frags);
+			if (link != NULL) {
+				last = list_get_instance(link, reass_frag_t,
+				    dgram_link);
+				if (last->offs + last->size > e)
+					return EOK;
+			}
+
+			rdg->have_last = true;
+			rdg->size = e;
+		}
+	} else if (rdg->have_last) {
+		e = min(e, rdg->size);
+	}
 
-		link = list_next(link, &rdg->frags);
+	/* The first fragment carries the header of the datagram */
+	if (packet->offs == 0) {
+		rdg->hdr = *packet;
+		rdg->hdr.data = NULL;
+		rdg->hdr.size = 0;
 	}
 
+	if (b >= e)
+		return EOK;
+
+	/* Fast path for fragments received in order */
+	link = list_last(&rdg->frags);
 	if (link != NULL)
-		list_insert_after(&frag->dgram_link, link);
-	else
-		list_append(&frag->dgram_link, &rdg->frags);
+		last = list_get_instance(link, reass_frag_t, dgram_link);
+	if (link == NULL || last->offs + last->size <= b)
+		return reass_dgram_add_piece(rdg, NULL, packet, b, e);
+
+	list_foreach(rdg->frags, dgram_link, reass_frag_t, frag) {
+		/* Fragment is entirely before the piece */
+		if (frag->offs + frag->size <= b)
+			continue;
+
+		/* Piece is entirely before the fragment */
+		if (frag->offs >= e)
+			return reass_dgram_add_piece(rdg, frag, packet, b, e);
+
+		/* Store the part preceding the fragment, skip the overlap */
+		if (b < frag->offs) {
+			rc = reass_dgram_add_piece(rdg, frag, packet, b,
+			    frag->offs);
+			if (rc != EOK)
+				return rc;
+		}
 
-	return EOK;
+		b = frag->offs + frag->size;
+		if (b >= e)
+			return EOK;
+	}
+
+	return reass_dgram_add_piece(rdg, NULL, packet, b, e);
 }
 
 /** Check if datagram is complete.
@@ -237,52 +422,113 @@ static errno_t reass_dgram_insert_frag(reass_dgram_t *rdg, inet_packet_t *packet
  */
 static bool reass_dgram_complete(reass_dgram_t *rdg)
 {
-	reass_frag_t *frag, *prev;
-	link_t *link;
+	assert(fibril_mutex_is_locked(&reass_dgram_map_lock));
+
+	/* Fragments do not overlap, so all data is there if enough is */
+	return rdg->have_last && rdg->covered == rdg->size;
+}
 
+/** Remove datagram from reassembly map.
+ *
+ * @param rdg		Datagram reassembly structure
+ */
+static void reass_dgram_remove(reass_dgram_t *rdg)
+{
 	assert(fibril_mutex_is_locked(&reass_dgram_map_lock));
-	assert(!list_empty(&rdg->frags));
 
-	link = list_first(&rdg->frags);
-	assert(link != NULL);
+	hash_table_remove_item(&reass_dgram_map, &rdg->map_link);
+	list_remove(&rdg->age_link);
+	reass_mem -= rdg->mem;
+}
 
-	frag = list_get_instance(link, reass_frag_t,
-	    dgram_link);
+/** Evict oldest datagrams until memory limit is met.
+ *
+ * @param cur		Datagram just updated, evicted last
+ */
+static void reass_evict(reass_dgram_t *cur)
+{
+	link_t *link;
+	reass_dgram_t *rdg;
 
-	/* First fragment must be at offset zero */
-	if (frag->packet.offs != 0)
-		return false;
+	assert(fibril_mutex_is_locked(&reass_dgram_map_lock));
 
-	prev = frag;
+	while (reass_mem > REASS_MEM_LIMIT) {
+		link = list_first(&reass_dgram_age);
+		rdg = list_get_instance(link, reass_dgram_t, age_link);
 
-	while (true) {
-		link = list_next(link, &rdg->frags);
-		if (link == NULL)
-			break;
+		if (rdg == cur) {
+			link = list_next(link, &reass_dgram_age);
+			if (link != NULL)
+				rdg = list_get_instance(link, reass_dgram_t, age_link);
+		}
 
-		/* Each next fragment must follow immediately or overlap */
-		frag = list_get_instance(link, reass_frag_t, dgram_link);
-		if (frag->packet.offs > prev->packet.offs + prev->packet.size)
-			return false;
+		log_msg(LOG_DEFAULT, LVL_DEBUG, "Reassembly memory exhausted, "
+		    "dropping datagram %" PRIu32 ".", rdg->key.ident);
+		reass_dgram_remove(rdg);
+		reass_dgram_destroy(rdg);
+	}
+}
 
-		/* No more fragments - datagram is complete */
-		if (!frag->packet.mf)
-			return true;
+/** Set reassembly timer to expire with the oldest datagram. */
+static void reass_timer_set(void)
+{
+	struct timespec now;
+	reass_dgram_t *rdg;
+	nsec_t delay;
+
+	assert(fibril_mutex_is_locked(&reass_dgram_map_lock));
 
-		prev = frag;
+	if (list_empty(&reass_dgram_age)) {
+		reass_timer_active = false;
+		return;
 	}
 
-	return false;
+	rdg = list_get_instance(list_first(&reass_dgram_age), reass_dgram_t,
+	    age_link);
+
+	getuptime(&now);
+	delay = ts_gt(&rdg->deadline, &now) ?
+	    ts_sub_diff(&rdg->deadline, &now) : 0;
+
+	/*
+	 * A zero timeout means no timeout at all, so the timer would never
+	 * fire. Expire an overdue datagram after the shortest delay instead.
+	 */
+	fibril_timer_set_locked(reass_timer, max(NSEC2USEC(delay), 1),
+	    reass_timeout, NULL);
+	reass_timer_active = true;
 }
 
-/** Remove datagram from reassembly map.
+/** Reassembly timer handler.
  *
- * @param rdg		Datagram reassembly structure
+ * Discard datagrams that were not reassembled in time.
+ *
+ * @param arg		Not used
  */
-static void reass_dgram_remove(reass_dgram_t *rdg)
+static void reass_timeout(void *arg)
 {
-	assert(fibril_mutex_is_locked(&reass_dgram_map_lock));
-	list_remove(&rdg->map_link);
+	struct timespec now;
+	reass_dgram_t *rdg;
+
+	(void) arg;
+
+	fibril_mutex_lock(&reass_dgram_map_lock);
+
+	getuptime(&now);
+	while (!list_empty(&reass_dgram_age)) {
+		rdg = list_get_instance(list_first(&reass_dgram_age),
+		    reass_dgram_t, age_link);
+		if (ts_gt(&rdg->deadline, &now))
+			break;
+
+		log_msg(LOG_DEFAULT, LVL_DEBUG, "Reassembly timed out, "
+		    "dropping datagram %" PRIu32 ".", rdg->key.ident);
+		reass_dgram_remove(rdg);
+		reass_dgram_destroy(rdg);
+	}
+
+	reass_timer_set();
+	fibril_mutex_unlock(&reass_dgram_map_lock);
 }
 
 /** Deliver complete datagram.
@@ -291,70 +537,27 @@ static void reass_dgram_remove(reass_dgram_t *rdg)
  */
 static errno_t reass_dgram_deliver(reass_dgram_t *rdg)
 {
-	size_t dgram_size;
-	size_t fragoff_limit;
 	inet_dgram_t dgram;
-	uint8_t proto;
-	reass_frag_t *frag;
 	errno_t rc;
 
-	/*
-	 * Potentially there could be something beyond the first packet
-	 * that has !MF. Make sure we ignore that.
-	 */
-	frag = NULL;
-	list_foreach(rdg->frags, dgram_link, reass_frag_t, cfrag) {
-		if (!cfrag->packet.mf) {
-			frag = cfrag;
-			break;
-		}
-	}
-
-	assert(frag != NULL);
-	assert(!frag->packet.mf);
-
-	dgram_size = frag->packet.offs + frag->packet.size;
-
-	/* Upper bound for fragment offset field */
-	fragoff_limit = 1 << (FF_FRAGOFF_h - FF_FRAGOFF_l + 1);
-
-	/* Verify that total size of datagram is within reasonable bounds */
-	if (dgram_size > FRAG_OFFS_UNIT * fragoff_limit)
-		return ELIMIT;
-
-	dgram.data = calloc(dgram_size, 1);
+	dgram.data = malloc(rdg->size);
 	if (dgram.data == NULL)
 		return ENOMEM;
 
 	/* XXX What if different fragments came from different link? */
-	dgram.iplink = frag->packet.link_id;
-	dgram.size = dgram_size;
-	dgram.src = frag->packet.src;
-	dgram.dest = frag->packet.dest;
-	dgram.tos = frag->packet.tos;
-	proto = frag->packet.proto;
+	dgram.iplink = rdg->hdr.link_id;
+	dgram.size = rdg->size;
+	dgram.src = rdg->hdr.src;
+	dgram.dest = rdg->hdr.dest;
+	dgram.tos = rdg->hdr.tos;
 
 	/* Pull together data from individual fragments */
-
-	size_t doffs = 0;
-
-	list_foreach(rdg->frags, dgram_link, reass_frag_t, cfrag) {
-		size_t cb, ce;
-
-		cb = max(doffs, cfrag->packet.offs);
-		ce = min(dgram_size, cfrag->packet.offs + cfrag->packet.size);
-
-		if (ce > cb) {
-			memcpy(dgram.data + cb,
-			    cfrag->packet.data + cb - cfrag->packet.offs,
-			    ce - cb);
-		}
-
-		if (!cfrag->packet.mf)
-			break;
+	list_foreach(rdg->frags, dgram_link, reass_frag_t, frag) {
+		memcpy((uint8_t *) dgram.data + frag->offs, frag->data,
+		    frag->size);
 	}
 
-	rc = inet_recv_dgram_local(&dgram, proto);
+	rc = inet_recv_dgram_local(&dgram, rdg->key.proto);
 	free(dgram.data);
 	return rc;
 }
@@ -371,12 +574,83 @@ static void reass_dgram_destroy(reass_dgram_t *rdg)
 		    dgram_link);
 
 		list_remove(&frag->dgram_link);
-		free(frag->packet.data);
 		free(frag);
 	}
 
 	free(rdg);
 }
 
+/** Compute hash of an internet address.
+ *
+ * @param addr Address
+ * @return Hash value consistent with inet_addr_compare()
+ */
+static size_t reass_addr_hash(inet_addr_t *addr)
+{
+	size_t hash;
+	size_t i;
+
+	hash = hash_mix(addr->version);
+
+	switch (addr->version) {
+	case ip_v4:
+		hash = hash_combine(hash, hash_mix(addr->addr));
+		break;
+	case ip_v6:
+		for (i = 0; i < sizeof(addr128_t); i += 4) {
+			hash = hash_combine(hash, hash_mix(
+			    ((uint32_t) addr->addr6[i] << 24) |
+			    ((uint32_t) addr->addr6[i + 1] << 16) |
+			    ((uint32_t) addr->addr6[i + 2] << 8) |
+			    addr->addr6[i + 3]));
+		}
+		break;
+	default:
+		break;
+	}
+
+	return hash;
+}
+
+/** Return hash of datagram. */
+static size_t reass_dgram_hash(const ht_link_t *item)
+{
+	reass_dgram_t *rdg = hash_table_get_inst(item, reass_dgram_t, map_link);
+
+	return reass_dgram_key_hash(&rdg->key);
+}
+
+/** Return hash of datagram key. */
+static size_t reass_dgram_key_hash(void *arg)
+{
+	reass_key_t *key = (reass_key_t *) arg;
+	size_t hash;
+
+	hash = reass_addr_hash(&key->src);
+	hash = hash_combine(hash, reass_addr_hash(&key->dest));
+	hash = hash_combine(hash, hash_mix(key->proto));
+	return hash_combine(hash, hash_mix(key->ident));
+}
+
+/** Determine if datagrams have the same key. */
+static bool reass_dgram_equal(const ht_link_t *item1, const ht_link_t *item2)
+{
+	reass_dgram_t *rdg = hash_table_get_inst(item1, reass_dgram_t, map_link);
+
+	return reass_dgram_key_equal(&rdg->key, item2);
+}
+
+/** Determine if datagram matches key. */
+static bool reass_dgram_key_equal(void *arg, const ht_link_t *item)
+{
+	reass_key_t *key = (reass_key_t *) arg;
+	reass_dgram_t *rdg = hash_table_get_inst(item, reass_dgram_t, map_link);
+
+	return rdg->key.ident == key->ident &&
+	    rdg->key.proto == key->proto &&
+	    inet_addr_compare(&rdg->key.src, &key->src) &&
+	    inet_addr_compare(&rdg->key.dest, &key->dest);
+}
+
 /** @}
  */
@@ -34,21 +34,92 @@
  * @brief
  */
 
+#include <adt/hash.h>
+#include <assert.h>
 #include <bitops.h>
 #include <errno.h>
 #include <fibril_synch.h>
+#include <inet/lpm.h>
 #include <io/log.h>
 #include <ipc/loc.h>
+#include <stdbool.h>
 #include <stdlib.h>
 #include <str.h>
 #include "sroute.h"
 #include "inetsrv.h"
 #include "inet_link.h"
 
+/** Number of next-hop cache entries, must be a power of two */
+#define SROUTE_CACHE_SIZE 64
+
+/** Next-hop cache entry */
+typedef struct {
+	/** Entry is valid */
+	bool valid;
+	/** Destination address */
+	inet_addr_t addr;
+	/** Route to the destination or @c NULL if there is none */
+	inet_sroute_t *sroute;
+} inet_sroute_cache_t;
+
 static FIBRIL_MUTEX_INITIALIZE(sroute_list_lock);
 static LIST_INITIALIZE(sroute_list);
 static sysarg_t sroute_id = 0;
 
+/**
+ * Static routes by destination network. If more routes have the same
+ * destination, the one added first is used. Zero-initialized table is
+ * empty.
+ */
+static inet_lpm_t sroute_lpm;
+
+/** Recently looked up destinations, direct-mapped */
+static inet_sroute_cache_t sroute_cache[SROUTE_CACHE_SIZE];
+
+/** Invalidate next-hop cache.
+ *
+ * Must be called with sroute_list_lock held whenever routes change.
+ */
+static void inet_sroute_cache_flush(void)
+{
+	size_t i;
+
+	for (i = 0; i < SROUTE_CACHE_SIZE; i++)
+		sroute_cache[i].valid = false;
+}
+
+/** Get next-hop cache entry for a destination.
+ *
+ * @param addr	Destination address
+ * @return	Cache entry where the destination belongs
+ */
+static inet_sroute_cache_t *inet_sroute_cache_entry(inet_addr_t *addr)
+{
+	addr32_t addr4 = 0;
+	addr128_t addr6;
+	size_t hash;
+	size_t i;
+
+	switch (inet_addr_get(addr, &addr4, &addr6)) {
+	case ip_v4:
+		hash = addr4;
+		break;
+	case ip_v6:
+		hash = 0;
+		for (i = 0; i < 16; i += 4) {
+			hash = hash_combine(hash, ((size_t) addr6[i] << 24) |
+			    ((size_t) addr6[i + 1] << 16) |
+			    ((size_t) addr6[i + 2] << 8) | addr6[i + 3]);
+		}
+		break;
+	default:
+		hash = 0;
+		break;
+	}
+
+	return &sroute_cache[hash_mix(hash) & (SROUTE_CACHE_SIZE - 1)];
+}
+
 inet_sroute_t *inet_sroute_new(void)
 {
 	inet_sroute_t *sroute = calloc(1, sizeof(inet_sroute_t));
@@ -74,17 +145,57 @@ void inet_sroute_delete(inet_sroute_t *sroute)
 	free(sroute);
 }
 
-void inet_sroute_add(inet_sroute_t *sroute)
+errno_t inet_sroute_add(inet_sroute_t *sroute)
 {
+	errno_t rc;
+
 	fibril_mutex_lock(&sroute_list_lock);
+
+	rc = inet_lpm_insert(&sroute_lpm, &sroute->dest, sroute);
+	if (rc == EEXIST) {
+		/* Route with the same destination takes precedence */
+		rc = EOK;
+	} else if (rc != EOK) {
+		fibril_mutex_unlock(&sroute_list_lock);
+		return rc;
+	}
+
 	list_append(&sroute->sroute_list, &sroute_list);
+	inet_sroute_cache_flush();
 	fibril_mutex_unlock(&sroute_list_lock);
+
+	return EOK;
 }
 
 void inet_sroute_remove(inet_sroute_t *sroute)
 {
+	inet_sroute_t *next = NULL;
+	inet_addr_t dest;
+	errno_t rc;
+
 	fibril_mutex_lock(&sroute_list_lock);
 	list_remove(&sroute->sroute_list);
+
+	if (inet_lpm_get(&sroute_lpm, &sroute->dest) == sroute) {
+		/* Fall back to the next route with the same destination */
+		inet_naddr_addr(&sroute->dest, &dest);
+		list_foreach(sroute_list, sroute_list, inet_sroute_t, sr) {
+			if (sr->dest.prefix == sroute->dest.prefix &&
+			    inet_naddr_compare_mask(&sr->dest, &dest)) {
+				next = sr;
+				break;
+			}
+		}
+
+		if (next != NULL)
+			rc = inet_lpm_update(&sroute_lpm, &sroute->dest, next);
+		else
+			rc = inet_lpm_remove(&sroute_lpm, &sroute->dest);
+		assert(rc == EOK);
+		(void) rc;
+	}
+
+	inet_sroute_cache_flush();
 	fibril_mutex_unlock(&sroute_list_lock);
 }
 
@@ -94,37 +205,30 @@ void inet_sroute_remove(inet_sroute_t *sroute)
  */
 inet_sroute_t *inet_sroute_find(inet_addr_t *addr)
 {
-	ip_ver_t addr_ver = inet_addr_get(addr, NULL, NULL);
-
-	inet_sroute_t *best = NULL;
-	uint8_t best_bits = 0;
+	inet_sroute_cache_t *entry;
+	inet_sroute_t *best;
 
 	fibril_mutex_lock(&sroute_list_lock);
 
-	list_foreach(sroute_list, sroute_list, inet_sroute_t, sroute) {
-		uint8_t dest_bits;
-		ip_ver_t dest_ver = inet_naddr_get(&sroute->dest, NULL, NULL,
-		    &dest_bits);
-
-		/* Skip comparison with different address family */
-		if (addr_ver != dest_ver)
-			continue;
-
-		/* Look for the most specific route */
-		if ((best != NULL) && (best_bits >= dest_bits))
-			continue;
-
-		if (inet_naddr_compare_mask(&sroute->dest, addr)) {
-			log_msg(LOG_DEFAULT, LVL_DEBUG, "inet_sroute_find: found candidate %p",
-			    sroute);
-
-			best = sroute;
-			best_bits = dest_bits;
-		}
+	entry = inet_sroute_cache_entry(addr);
+	if (entry->valid && inet_addr_compare(&entry->addr, addr)) {
+		best = entry->sroute;
+		fibril_mutex_unlock(&sroute_list_lock);
+		return best;
 	}
 
-	if (best == NULL)
+	/* Look for the most specific route */
+	best = inet_lpm_lookup(&sroute_lpm, addr);
+	if (best != NULL) {
+		log_msg(LOG_DEFAULT, LVL_DEBUG, "inet_sroute_find: found %p",
+		    best);
+	} else {
 		log_msg(LOG_DEFAULT, LVL_DEBUG, "inet_sroute_find: Not found");
+	}
+
+	entry->valid = true;
+	entry->addr = *addr;
+	entry->sroute = best;
 
 	fibril_mutex_unlock(&sroute_list_lock);
 
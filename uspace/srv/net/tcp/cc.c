@@ -0,0 +1,251 @@
+/*
+ * Copyright (c) 2026 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup tcp
+ * @{
+ */
+
+/**
+ * @file Congestion control
+ *
+ * Slow start, fast retransmit and fast recovery (RFC 5681, RFC 6582)
+ * are common to all algorithms. Congestion control algorithms only
+ * decide how the congestion window grows in congestion avoidance and
+ * how far it is reduced when loss is detected.
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <io/log.h>
+#include <macros.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <str.h>
+#include "cc.h"
+#include "tcp_type.h"
+
+/** Sender maximum segment size */
+#define TCP_SMSS 1460
+
+/** Available congestion control algorithms */
+static tcp_cc_ops_t *tcp_cc_algs[] = {
+	&tcp_cc_cubic,
+	&tcp_cc_newreno
+};
+
+/** Algorithm used for new connections */
+static tcp_cc_ops_t *tcp_cc_default = &tcp_cc_cubic;
+
+/** Select congestion control algorithm for new connections.
+ *
+ * @param name	Algorithm name
+ * @return	EOK on success, ENOENT if there is no such algorithm
+ */
+errno_t tcp_cc_set_default(const char *name)
+{
+	size_t i;
+
+	for (i = 0; i < sizeof(tcp_cc_algs) / sizeof(tcp_cc_algs[0]); i++) {
+		if (str_cmp(tcp_cc_algs[i]->name, name) == 0) {
+			tcp_cc_default = tcp_cc_algs[i];
+			return EOK;
+		}
+	}
+
+	return ENOENT;
+}
+
+/** Initialize congestion control for a new connection.
+ *
+ * @param conn		Connection
+ * @return		EOK on success, ENOMEM if out of memory
+ */
+errno_t tcp_cc_init(tcp_conn_t *conn)
+{
+	conn->smss = TCP_SMSS;
+	conn->cc = tcp_cc_default;
+	conn->cc_arg = NULL;
+	conn->ca_state = ca_open;
+
+	/* Initial window (RFC 6928) */
+	conn->cwnd = min(10 * conn->smss, max(2 * conn->smss, 14600));
+	conn->ssthresh = UINT32_MAX;
+	conn->cwnd_cnt = 0;
+	conn->dupacks = 0;
+	conn->recover = 0;
+
+	if (conn->cc->init != NULL)
+		return conn->cc->init(conn);
+
+	return EOK;
+}
+
+/** Finalize congestion control of a connection.
+ *
+ * @param conn		Connection
+ */
+void tcp_cc_fini(tcp_conn_t *conn)
+{
+	if (conn->cc != NULL && conn->cc->fini != NULL)
+		conn->cc->fini(conn);
+}
+
+/** Return number of bytes sent but not yet acknowledged.
+ *
+ * @param conn		Connection
+ * @return		Flight size
+ */
+uint32_t tcp_cc_flight_size(tcp_conn_t *conn)
+{
+	return conn->snd_nxt - conn->snd_una;
+}
+
+/** New data has been acknowledged.
+ *
+ * @param conn		Connection (SND.UNA already updated)
+ * @param acked		Number of newly acknowledged bytes
+ * @return		@c true if the first unacknowledged segment should
+ *			be retransmitted (partial ACK during recovery)
+ */
+bool tcp_cc_ack(tcp_conn_t *conn, uint32_t acked)
+{
+	bool full;
+	bool retransmit;
+
+	conn->dupacks = 0;
+	retransmit = false;
+
+	/* ACK covers all data outstanding when recovery started */
+	full = (int32_t)(conn->snd_una - conn->recover) >= 0;
+
+	switch (conn->ca_state) {
+	case ca_recovery:
+		if (full) {
+			/* Deflate window (RFC 6582, 3.2 step 3) */
+			conn->cwnd = min(conn->ssthresh,
+			    max(tcp_cc_flight_size(conn), conn->smss) +
+			    conn->smss);
+			conn->ca_state = ca_open;
+			log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: recovery finished, "
+			    "cwnd=%" PRIu32, conn->name, conn->cwnd);
+			return false;
+		}
+
+		/*
+		 * Partial ACK. With SACK the pipe estimate accounts for
+		 * data that left the network, otherwise deflate by amount
+		 * acked and add back one SMSS.
+		 */
+		if (!conn->sack) {
+			conn->cwnd -= min(acked, conn->cwnd - conn->smss);
+			if (acked >= conn->smss)
+				conn->cwnd += conn->smss;
+		}
+		return true;
+	case ca_loss:
+		if (full)
+			conn->ca_state = ca_open;
+		else
+			retransmit = true;
+		break;
+	case ca_open:
+		break;
+	}
+
+	if (conn->cwnd < conn->ssthresh) {
+		/* Slow start, increase by at most one SMSS per ACK */
+		conn->cwnd += min(acked, conn->smss);
+	} else {
+		conn->cc->cong_avoid(conn, acked);
+	}
+
+	return retransmit;
+}
+
+/** Duplicate ACK has been received.
+ *
+ * @param conn		Connection
+ * @return		@c true if fast retransmit should be performed
+ */
+bool tcp_cc_dupack(tcp_conn_t *conn)
+{
+	switch (conn->ca_state) {
+	case ca_recovery:
+		/* Another segment has left the network, inflate window */
+		if (!conn->sack)
+			conn->cwnd += conn->smss;
+		return false;
+	case ca_loss:
+		return false;
+	case ca_open:
+		break;
+	}
+
+	if (++conn->dupacks < TCP_DUPACK_THRESH)
+		return false;
+
+	conn->ssthresh = conn->cc->ssthresh(conn);
+	if (conn->sack) {
+		/* Sending is governed by the pipe estimate (RFC 6675) */
+		conn->cwnd = conn->ssthresh;
+	} else {
+		conn->cwnd = conn->ssthresh + TCP_DUPACK_THRESH * conn->smss;
+	}
+	conn->cwnd_cnt = 0;
+	conn->recover = conn->snd_nxt;
+	conn->ca_state = ca_recovery;
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: fast retransmit, ssthresh=%" PRIu32,
+	    conn->name, conn->ssthresh);
+	return true;
+}
+
+/** Retransmission timer has expired.
+ *
+ * @param conn		Connection
+ */
+void tcp_cc_timeout(tcp_conn_t *conn)
+{
+	/* Do not reduce ssthresh again if the retransmission is lost, too */
+	if (conn->ca_state != ca_loss)
+		conn->ssthresh = conn->cc->ssthresh(conn);
+
+	/* Loss window */
+	conn->cwnd = conn->smss;
+	conn->cwnd_cnt = 0;
+	conn->dupacks = 0;
+	conn->recover = conn->snd_nxt;
+	conn->ca_state = ca_loss;
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: retransmission timeout, "
+	    "ssthresh=%" PRIu32, conn->name, conn->ssthresh);
+}
+
+/**
+ * @}
+ */
@@ -0,0 +1,226 @@
+/*
+ * Copyright (c) 2026 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup tcp
+ * @{
+ */
+
+/**
+ * @file CUBIC congestion control
+ *
+ * The congestion window follows W(t) = C (t - K)^3 + W_max where t is
+ * the time since the last window reduction (RFC 9438). The window never
+ * grows slower than the Reno-friendly estimate.
+ *
+ * Windows are computed in milli-SMSS and times in milliseconds so that
+ * all arithmetic can be done in integers.
+ */
+
+#include <errno.h>
+#include <macros.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+#include "cc.h"
+#include "tcp_type.h"
+
+/** Multiplicative decrease factor beta in thousandths */
+#define CUBIC_BETA	700
+/** Reno-friendly additive increase alpha = 3 (1 - beta) / (1 + beta) */
+#define CUBIC_ALPHA	529
+/** Cubic function time is capped to avoid overflow (ms) */
+#define CUBIC_T_MAX	100000
+
+/** CUBIC state */
+typedef struct {
+	/** Window just before last reduction (bytes) */
+	uint32_t w_max;
+	/** Time it takes to reach @c origin from start of epoch (ms) */
+	int64_t k;
+	/** Window where the cubic function is centered (bytes) */
+	uint32_t origin;
+	/** Reno-friendly window estimate (thousandths of a byte) */
+	uint64_t w_est;
+	/** Start of current congestion avoidance epoch */
+	struct timespec epoch;
+	/** @c epoch is valid */
+	bool in_epoch;
+} tcp_cubic_t;
+
+static errno_t tcp_cubic_init(tcp_conn_t *);
+static void tcp_cubic_fini(tcp_conn_t *);
+static void tcp_cubic_cong_avoid(tcp_conn_t *, uint32_t);
+static uint32_t tcp_cubic_ssthresh(tcp_conn_t *);
+
+tcp_cc_ops_t tcp_cc_cubic = {
+	.name = "cubic",
+	.init = tcp_cubic_init,
+	.fini = tcp_cubic_fini,
+	.cong_avoid = tcp_cubic_cong_avoid,
+	.ssthresh = tcp_cubic_ssthresh
+};
+
+/** Integer cube root.
+ *
+ * @param x	Argument
+ * @return	Largest y such that y^3 <= x
+ */
+static uint64_t tcp_cubic_cbrt(uint64_t x)
+{
+	uint64_t y;
+	uint64_t b;
+	int s;
+
+	y = 0;
+	for (s = 63; s >= 0; s -= 3) {
+		y = 2 * y;
+		b = 3 * y * (y + 1) + 1;
+		if ((x >> s) >= b) {
+			x -= b << s;
+			y++;
+		}
+	}
+
+	return y;
+}
+
+static errno_t tcp_cubic_init(tcp_conn_t *conn)
+{
+	tcp_cubic_t *cubic;
+
+	cubic = calloc(1, sizeof(tcp_cubic_t));
+	if (cubic == NULL)
+		return ENOMEM;
+
+	conn->cc_arg = cubic;
+	return EOK;
+}
+
+static void tcp_cubic_fini(tcp_conn_t *conn)
+{
+	free(conn->cc_arg);
+	conn->cc_arg = NULL;
+}
+
+/** Start new congestion avoidance epoch.
+ *
+ * @param conn		Connection
+ * @param cubic		CUBIC state
+ */
+static void tcp_cubic_epoch_start(tcp_conn_t *conn, tcp_cubic_t *cubic)
+{
+	uint64_t diff;
+
+	getuptime(&cubic->epoch);
+	cubic->in_epoch = true;
+
+	if (conn->cwnd < cubic->w_max) {
+		/* K = cbrt((W_max - cwnd) / C), C = 0.4 */
+		diff = (uint64_t)(cubic->w_max - conn->cwnd) * 1000 /
+		    conn->smss;
+		cubic->k = tcp_cubic_cbrt(diff * 2500000);
+		cubic->origin = cubic->w_max;
+	} else {
+		cubic->k = 0;
+		cubic->origin = conn->cwnd;
+	}
+
+	cubic->w_est = (uint64_t)conn->cwnd * 1000;
+}
+
+/** Grow congestion window in congestion avoidance.
+ *
+ * @param conn		Connection
+ * @param acked		Number of newly acknowledged bytes
+ */
+static void tcp_cubic_cong_avoid(tcp_conn_t *conn, uint32_t acked)
+{
+	tcp_cubic_t *cubic = (tcp_cubic_t *)conn->cc_arg;
+	struct timespec now;
+	int64_t t, d, offs;
+	int64_t target;
+	uint64_t est;
+
+	if (!cubic->in_epoch)
+		tcp_cubic_epoch_start(conn, cubic);
+
+	/* Aim for where the window should be one RTT from now */
+	getuptime(&now);
+	t = NSEC2MSEC(ts_sub_diff(&now, &cubic->epoch)) +
+	    USEC2MSEC(conn->rtt.srtt);
+	t = min(t, CUBIC_T_MAX);
+
+	/* C (t - K)^3 in milli-SMSS, C = 0.4 and t in ms */
+	d = t - cubic->k;
+	offs = 4 * d * d * d / 10000000;
+	target = (int64_t)cubic->origin + offs * conn->smss / 1000;
+
+	/* Do not grow faster than by half the window per round trip */
+	target = max(target, (int64_t)conn->cwnd);
+	target = min(target, (int64_t)conn->cwnd * 3 / 2);
+
+	if (target > conn->cwnd) {
+		conn->cwnd += (uint64_t)(target - conn->cwnd) * acked /
+		    conn->cwnd;
+	}
+
+	/* Reno-friendly region */
+	cubic->w_est += (uint64_t)acked * conn->smss * CUBIC_ALPHA /
+	    conn->cwnd;
+	est = cubic->w_est / 1000;
+	if (est > conn->cwnd)
+		conn->cwnd = est;
+}
+
+/** Compute slow start threshold after loss.
+ *
+ * @param conn		Connection
+ * @return		New slow start threshold
+ */
+static uint32_t tcp_cubic_ssthresh(tcp_conn_t *conn)
+{
+	tcp_cubic_t *cubic = (tcp_cubic_t *)conn->cc_arg;
+
+	cubic->in_epoch = false;
+
+	if (conn->cwnd < cubic->w_max) {
+		/* Fast convergence, release bandwidth to new flows */
+		cubic->w_max = (uint64_t)conn->cwnd * (1000 + CUBIC_BETA) /
+		    2000;
+	} else {
+		cubic->w_max = conn->cwnd;
+	}
+
+	return max((uint64_t)conn->cwnd * CUBIC_BETA / 1000,
+	    2 * (uint64_t)conn->smss);
+}
+
+/**
+ * @}
+ */
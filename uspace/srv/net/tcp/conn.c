@@ -39,22 +39,36 @@
 #include <inet/endpoint.h>
 #include <io/log.h>
 #include <macros.h>
+#include <mem.h>
 #include <nettl/amap.h>
 #include <stdbool.h>
 #include <stdlib.h>
+#include <time.h>
+#include "cc.h"
 #include "conn.h"
 #include "inet.h"
 #include "iqueue.h"
+#include "ncsim.h"
 #include "pdu.h"
 #include "rqueue.h"
+#include "rtt.h"
 #include "segment.h"
 #include "seq_no.h"
+#include "std.h"
 #include "tcp_type.h"
 #include "tqueue.h"
 #include "ucall.h"
 
-#define RCV_BUF_SIZE 4096/*2*/
-#define SND_BUF_SIZE 4096
+/** Initial receive buffer size */
+#define RCV_BUF_SIZE 16384
+/** Initial send buffer size */
+#define SND_BUF_SIZE 16384
+/** Autotuning does not grow the receive buffer beyond this size */
+#define RCV_BUF_MAX (1024 * 1024)
+/** Autotuning does not grow the send buffer beyond this size */
+#define SND_BUF_MAX (1024 * 1024)
+/** Receive tuning epochs longer than this do not indicate a window limit */
+#define RCV_TUNE_EPOCH_MAX (1000 * 1000)
 
 #define MAX_SEGMENT_LIFETIME	(15*1000*1000) //(2*60*1000*1000)
 #define TIME_WAIT_TIMEOUT	(2*MAX_SEGMENT_LIFETIME)
@@ -152,6 +166,21 @@ tcp_conn_t *tcp_conn_new(inet_ep2_t *epp)
 	/* Set up receive window. */
 	conn->rcv_wnd = conn->rcv_buf_size;
 
+	/* Offer the smallest window scale that can advertise RCV_BUF_MAX */
+	conn->wscale = true;
+	conn->snd_wscale = 0;
+	conn->rcv_wscale = 0;
+	while ((RCV_BUF_MAX >> conn->rcv_wscale) > TCP_WND_MAX)
+		++conn->rcv_wscale;
+
+	/* Offer selective acknowledgements */
+	conn->sack = true;
+
+	/* Set up retransmission timeout and congestion control */
+	tcp_rtt_init(&conn->rtt);
+	if (tcp_cc_init(conn) != EOK)
+		goto error;
+
 	/* Initialize incoming segment queue */
 	tcp_iqueue_init(&conn->incoming, conn);
 
@@ -185,6 +214,8 @@ tcp_conn_t *tcp_conn_new(inet_ep2_t *epp)
 error:
 	if (tqueue_inited)
 		tcp_tqueue_fini(&conn->retransmit);
+	if (conn != NULL)
+		tcp_cc_fini(conn);
 	if (conn != NULL && conn->rcv_buf != NULL)
 		free(conn->rcv_buf);
 	if (conn != NULL && conn->snd_buf != NULL)
@@ -216,11 +247,13 @@ static void tcp_conn_free(tcp_conn_t *conn)
 
 	assert(conn->mapped == false);
 	tcp_tqueue_fini(&conn->retransmit);
+	tcp_iqueue_fini(&conn->incoming);
 
 	fibril_mutex_lock(&conn_list_lock);
 	list_remove(&conn->link);
 	fibril_mutex_unlock(&conn_list_lock);
 
+	tcp_cc_fini(conn);
 	if (conn->rcv_buf != NULL)
 		free(conn->rcv_buf);
 	if (conn->snd_buf != NULL)
@@ -230,6 +263,215 @@ static void tcp_conn_free(tcp_conn_t *conn)
 	free(conn);
 }
 
+/** Copy data into a ring buffer.
+ *
+ * @param buf		Ring buffer
+ * @param bsize		Ring buffer size
+ * @param off		Offset in @a buf where to start writing
+ * @param data		Source data
+ * @param size		Number of bytes to copy
+ */
+static void tcp_ring_copy_in(uint8_t *buf, size_t bsize, size_t off,
+    const void *data, size_t size)
+{
+	size_t first;
+
+	first = min(size, bsize - off);
+	memcpy(buf + off, data, first);
+	memcpy(buf, (const uint8_t *)data + first, size - first);
+}
+
+/** Copy data out of a ring buffer.
+ *
+ * @param buf		Ring buffer
+ * @param bsize		Ring buffer size
+ * @param off		Offset in @a buf where to start reading
+ * @param data		Destination buffer
+ * @param size		Number of bytes to copy
+ */
+static void tcp_ring_copy_out(uint8_t *buf, size_t bsize, size_t off,
+    void *data, size_t size)
+{
+	size_t first;
+
+	first = min(size, bsize - off);
+	memcpy(data, buf + off, first);
+	memcpy((uint8_t *)data + first, buf, size - first);
+}
+
+/** Resize ring buffer.
+ *
+ * The contents are moved to the beginning of the new buffer.
+ *
+ * @param buf		Ring buffer, updated on success
+ * @param bsize		Ring buffer size, updated on success
+ * @param head		Offset of first used byte, updated on success
+ * @param used		Number of bytes used
+ * @param nsize		New size, at least @a used
+ * @return		EOK on success, ENOMEM if out of memory
+ */
+static errno_t tcp_ring_resize(uint8_t **buf, size_t *bsize, size_t *head,
+    size_t used, size_t nsize)
+{
+	uint8_t *nbuf;
+
+	assert(used <= nsize);
+
+	nbuf = malloc(nsize);
+	if (nbuf == NULL)
+		return ENOMEM;
+
+	tcp_ring_copy_out(*buf, *bsize, *head, nbuf, used);
+	free(*buf);
+
+	*buf = nbuf;
+	*bsize = nsize;
+	*head = 0;
+	return EOK;
+}
+
+/** Append data to send buffer.
+ *
+ * @param conn		Connection
+ * @param data		Data
+ * @param size		Number of bytes, must fit in free space of send buffer
+ */
+void tcp_conn_snd_buf_append(tcp_conn_t *conn, const void *data, size_t size)
+{
+	assert(fibril_mutex_is_locked(&conn->lock));
+	assert(size <= conn->snd_buf_size - conn->snd_buf_used);
+
+	tcp_ring_copy_in(conn->snd_buf, conn->snd_buf_size,
+	    (conn->snd_buf_head + conn->snd_buf_used) % conn->snd_buf_size,
+	    data, size);
+	conn->snd_buf_used += size;
+}
+
+/** Remove data from the beginning of send buffer.
+ *
+ * @param conn		Connection
+ * @param size		Number of bytes to remove
+ */
+void tcp_conn_snd_buf_consume(tcp_conn_t *conn, size_t size)
+{
+	assert(fibril_mutex_is_locked(&conn->lock));
+	assert(size <= conn->snd_buf_used);
+
+	conn->snd_buf_head = (conn->snd_buf_head + size) % conn->snd_buf_size;
+	conn->snd_buf_used -= size;
+}
+
+/** Grow send buffer to match the peer's window.
+ *
+ * Called when the user is about to block on a full send buffer. Data
+ * in flight is held by the retransmission queue, the send buffer only
+ * needs to hold enough data to fill the window once it opens. The peer
+ * sizes its window by the bandwidth-delay product, so we follow it.
+ *
+ * @param conn		Connection
+ */
+void tcp_conn_snd_buf_tune(tcp_conn_t *conn)
+{
+	size_t nsize;
+	errno_t rc;
+
+	assert(fibril_mutex_is_locked(&conn->lock));
+
+	if (conn->snd_buf_size >= conn->snd_wnd ||
+	    conn->snd_buf_size >= SND_BUF_MAX)
+		return;
+
+	nsize = conn->snd_buf_size;
+	while (nsize < conn->snd_wnd && nsize < SND_BUF_MAX)
+		nsize *= 2;
+	nsize = min(nsize, SND_BUF_MAX);
+
+	rc = tcp_ring_resize(&conn->snd_buf, &conn->snd_buf_size,
+	    &conn->snd_buf_head, conn->snd_buf_used, nsize);
+	if (rc != EOK)
+		return;
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: send buffer size %zu",
+	    conn->name, conn->snd_buf_size);
+}
+
+/** Copy data from receive buffer and remove it.
+ *
+ * @param conn		Connection
+ * @param buf		Destination buffer
+ * @param size		Number of bytes, at most the number of bytes used
+ */
+void tcp_conn_rcv_buf_get(tcp_conn_t *conn, void *buf, size_t size)
+{
+	assert(fibril_mutex_is_locked(&conn->lock));
+	assert(size <= conn->rcv_buf_used);
+
+	tcp_ring_copy_out(conn->rcv_buf, conn->rcv_buf_size,
+	    conn->rcv_buf_head, buf, size);
+	conn->rcv_buf_head = (conn->rcv_buf_head + size) % conn->rcv_buf_size;
+	conn->rcv_buf_used -= size;
+	conn->rcv_tune_copied += size;
+}
+
+/** Start receive buffer tuning epoch.
+ *
+ * The epoch ends when the peer has sent all data fitting in the window
+ * we are currently advertising. If the peer is limited by our window,
+ * this takes about one round-trip time.
+ *
+ * @param conn		Connection
+ */
+static void tcp_conn_rcv_tune_start(tcp_conn_t *conn)
+{
+	getuptime(&conn->rcv_tune_ts);
+	conn->rcv_tune_seq = conn->rcv_nxt + conn->rcv_wnd;
+	conn->rcv_tune_copied = 0;
+}
+
+/** Grow receive buffer if the receive window limits throughput.
+ *
+ * If the peer filled the whole window within a tuning epoch and the user
+ * kept up with receiving the data, the window is smaller than the
+ * bandwidth-delay product. Double the buffer (and thus the window).
+ *
+ * @param conn		Connection
+ */
+static void tcp_conn_rcv_buf_tune(tcp_conn_t *conn)
+{
+	struct timespec now;
+	nsec_t elapsed;
+	size_t max_size;
+	size_t osize;
+	size_t nsize;
+	errno_t rc;
+
+	if ((int32_t)(conn->rcv_nxt - conn->rcv_tune_seq) < 0)
+		return;
+
+	getuptime(&now);
+	elapsed = ts_sub_diff(&now, &conn->rcv_tune_ts);
+
+	/* Without window scaling we cannot advertise more than TCP_WND_MAX */
+	max_size = conn->wscale ? RCV_BUF_MAX : TCP_WND_MAX;
+
+	if (NSEC2USEC(elapsed) <= RCV_TUNE_EPOCH_MAX &&
+	    conn->rcv_tune_copied >= conn->rcv_buf_size / 2 &&
+	    conn->rcv_buf_size < max_size) {
+		osize = conn->rcv_buf_size;
+		nsize = min(2 * osize, max_size);
+		rc = tcp_ring_resize(&conn->rcv_buf, &conn->rcv_buf_size,
+		    &conn->rcv_buf_head, conn->rcv_buf_used, nsize);
+		if (rc == EOK) {
+			/* Open the window by the added space */
+			conn->rcv_wnd += nsize - osize;
+			log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: receive buffer "
+			    "size %zu", conn->name, nsize);
+		}
+	}
+
+	tcp_conn_rcv_tune_start(conn);
+}
+
 /** Add reference to connection.
  *
  * Increase connection reference count by one.
@@ -511,6 +753,75 @@ bool tcp_conn_got_syn(tcp_conn_t *conn)
 	assert(false);
 }
 
+/** Process window scale option in received SYN segment.
+ *
+ * Window scaling is only used if both sides offer it in their SYN.
+ *
+ * @param conn		Connection
+ * @param seg		SYN segment
+ */
+static void tcp_conn_wscale_negotiate(tcp_conn_t *conn, tcp_segment_t *seg)
+{
+	if (conn->wscale && seg->has_wscale) {
+		conn->snd_wscale = min(seg->wscale, TCP_WSCALE_MAX);
+	} else {
+		conn->wscale = false;
+		conn->snd_wscale = 0;
+		conn->rcv_wscale = 0;
+	}
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: window scale snd=%u rcv=%u",
+	    conn->name, conn->snd_wscale, conn->rcv_wscale);
+}
+
+/** Process SACK-permitted option in received SYN segment.
+ *
+ * Selective acknowledgements are only used if both sides offer them.
+ *
+ * @param conn		Connection
+ * @param seg		SYN segment
+ */
+static void tcp_conn_sack_negotiate(tcp_conn_t *conn, tcp_segment_t *seg)
+{
+	conn->sack = conn->sack && seg->sack_perm;
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: SACK %s", conn->name,
+	    conn->sack ? "enabled" : "disabled");
+}
+
+/** Return window advertised by segment in bytes.
+ *
+ * @param conn		Connection
+ * @param seg		Segment
+ * @return		SEG.WND adjusted by the send window scale
+ */
+static uint32_t tcp_conn_seg_wnd(tcp_conn_t *conn, tcp_segment_t *seg)
+{
+	/* Window field of a SYN segment is never scaled */
+	if ((seg->ctrl & CTL_SYN) != 0)
+		return seg->wnd;
+
+	return seg->wnd << conn->snd_wscale;
+}
+
+/** Determine if segment is a duplicate ACK.
+ *
+ * As defined in RFC 5681, a duplicate ACK acknowledges SND.UNA while
+ * there is outstanding data, carries no data, SYN or FIN and does not
+ * change the window.
+ *
+ * @param conn		Connection
+ * @param seg		Segment
+ * @return		@c true if @a seg is a duplicate ACK
+ */
+static bool tcp_conn_seg_dupack(tcp_conn_t *conn, tcp_segment_t *seg)
+{
+	return seg->ack == conn->snd_una &&
+	    conn->snd_nxt != conn->snd_una &&
+	    seg->len == 0 &&
+	    tcp_conn_seg_wnd(conn, seg) == conn->snd_wnd;
+}
+
 /** Segment arrived in Listen state.
  *
  * @param conn		Connection
@@ -546,6 +857,10 @@ static void tcp_conn_sa_listen(tcp_conn_t *conn, tcp_segment_t *seg)
 	if (seg->len > 1)
 		log_msg(LOG_DEFAULT, LVL_WARN, "SYN combined with data, ignoring data.");
 
+	tcp_conn_wscale_negotiate(conn, seg);
+	tcp_conn_sack_negotiate(conn, seg);
+	tcp_conn_rcv_tune_start(conn);
+
 	/* XXX select ISS */
 	conn->iss = 1;
 	conn->snd_nxt = conn->iss;
@@ -556,7 +871,7 @@ static void tcp_conn_sa_listen(tcp_conn_t *conn, tcp_segment_t *seg)
 	 * Set SND.WND = SEG.WND and set SND.WL1 so that next segment
 	 * will always be accepted as new window setting.
 	 */
-	conn->snd_wnd = seg->wnd;
+	conn->snd_wnd = tcp_conn_seg_wnd(conn, seg);
 	conn->snd_wl1 = seg->seq;
 	conn->snd_wl2 = seg->seq;
 
@@ -615,6 +930,10 @@ static void tcp_conn_sa_syn_sent(tcp_conn_t *conn, tcp_segment_t *seg)
 	conn->rcv_nxt = seg->seq + 1;
 	conn->irs = seg->seq;
 
+	tcp_conn_wscale_negotiate(conn, seg);
+	tcp_conn_sack_negotiate(conn, seg);
+	tcp_conn_rcv_tune_start(conn);
+
 	if ((seg->ctrl & CTL_ACK) != 0) {
 		conn->snd_una = seg->ack;
 
@@ -634,7 +953,7 @@ static void tcp_conn_sa_syn_sent(tcp_conn_t *conn, tcp_segment_t *seg)
 	 */
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "SND.WND := %" PRIu32 ", SND.WL1 := %" PRIu32 ", "
 	    "SND.WL2 = %" PRIu32, seg->wnd, seg->seq, seg->seq);
-	conn->snd_wnd = seg->wnd;
+	conn->snd_wnd = tcp_conn_seg_wnd(conn, seg);
 	conn->snd_wl1 = seg->seq;
 	conn->snd_wl2 = seg->seq;
 
@@ -662,6 +981,7 @@ static void tcp_conn_sa_syn_sent(tcp_conn_t *conn, tcp_segment_t *seg)
 static void tcp_conn_sa_queue(tcp_conn_t *conn, tcp_segment_t *seg)
 {
 	tcp_segment_t *pseg;
+	bool ooo;
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "tcp_conn_sa_seq(%p, %p)", conn, seg);
 
@@ -673,6 +993,21 @@ static void tcp_conn_sa_queue(tcp_conn_t *conn, tcp_segment_t *seg)
 		return;
 	}
 
+	/* Discard retransmissions of out-of-order data we already hold */
+	if (tcp_iqueue_seg_covered(&conn->incoming, seg)) {
+		log_msg(LOG_DEFAULT, LVL_DEBUG, "Replying ACK to duplicate segment.");
+		tcp_tqueue_ctrl_seg(conn, CTL_ACK);
+		tcp_segment_delete(seg);
+		return;
+	}
+
+	/*
+	 * Out-of-order data should be acknowledged immediately
+	 * (RFC 5681, section 4.2) so that the sender learns about the
+	 * hole (through duplicate ACKs and SACK blocks).
+	 */
+	ooo = seg->len > 0 && !seq_no_segment_ready(conn, seg);
+
 	/* Queue for processing */
 	tcp_iqueue_insert_seg(&conn->incoming, seg);
 
@@ -684,6 +1019,9 @@ static void tcp_conn_sa_queue(tcp_conn_t *conn, tcp_segment_t *seg)
 	 */
 	while (tcp_iqueue_get_ready_seg(&conn->incoming, &pseg) == EOK)
 		tcp_conn_seg_process(conn, pseg);
+
+	if (ooo && conn->cstate != st_closed)
+		tcp_tqueue_ctrl_seg(conn, CTL_ACK);
 }
 
 /** Process segment RST field.
@@ -817,6 +1155,11 @@ static cproc_t tcp_conn_seg_proc_ack_est(tcp_conn_t *conn, tcp_segment_t *seg)
 	    (unsigned)seg->ack, (unsigned)conn->snd_una,
 	    (unsigned)conn->snd_nxt);
 
+	/* Update SACK scoreboard before acting on the ACK itself */
+	if (seq_no_ack_acceptable(conn, seg->ack) ||
+	    seq_no_ack_duplicate(conn, seg->ack))
+		tcp_tqueue_sack_received(conn, seg);
+
 	if (!seq_no_ack_acceptable(conn, seg->ack)) {
 		log_msg(LOG_DEFAULT, LVL_DEBUG, "ACK not acceptable.");
 		if (!seq_no_ack_duplicate(conn, seg->ack)) {
@@ -826,8 +1169,11 @@ static cproc_t tcp_conn_seg_proc_ack_est(tcp_conn_t *conn, tcp_segment_t *seg)
 			tcp_tqueue_ctrl_seg(conn, CTL_ACK);
 			tcp_segment_delete(seg);
 			return cp_done;
+		} else if (tcp_conn_seg_dupack(conn, seg)) {
+			log_msg(LOG_DEFAULT, LVL_DEBUG, "Duplicate ACK.");
+			tcp_tqueue_dupack(conn);
 		} else {
-			log_msg(LOG_DEFAULT, LVL_DEBUG, "Ignoring duplicate ACK.");
+			log_msg(LOG_DEFAULT, LVL_DEBUG, "Ignoring old ACK.");
 		}
 	} else {
 		/* Update SND.UNA */
@@ -835,7 +1181,7 @@ static cproc_t tcp_conn_seg_proc_ack_est(tcp_conn_t *conn, tcp_segment_t *seg)
 	}
 
 	if (seq_no_new_wnd_update(conn, seg)) {
-		conn->snd_wnd = seg->wnd;
+		conn->snd_wnd = tcp_conn_seg_wnd(conn, seg);
 		conn->snd_wl1 = seg->seq;
 		conn->snd_wl2 = seg->ack;
 
@@ -1060,8 +1406,9 @@ static cproc_t tcp_conn_seg_proc_text(tcp_conn_t *conn, tcp_segment_t *seg)
 	xfer_size = min(text_size, conn->rcv_buf_size - conn->rcv_buf_used);
 
 	/* Copy data to receive buffer */
-	tcp_segment_text_copy(seg, conn->rcv_buf + conn->rcv_buf_used,
-	    xfer_size);
+	tcp_ring_copy_in(conn->rcv_buf, conn->rcv_buf_size,
+	    (conn->rcv_buf_head + conn->rcv_buf_used) % conn->rcv_buf_size,
+	    seg->data, xfer_size);
 	conn->rcv_buf_used += xfer_size;
 
 	/* Signal to the receive function that new data has arrived */
@@ -1079,6 +1426,9 @@ static cproc_t tcp_conn_seg_proc_text(tcp_conn_t *conn, tcp_segment_t *seg)
 	/* Update receive window. XXX Not an efficient strategy. */
 	conn->rcv_wnd -= xfer_size;
 
+	/* Grow receive buffer if the window is holding the peer back */
+	tcp_conn_rcv_buf_tune(conn);
+
 	/* Send ACK */
 	if (xfer_size > 0)
 		tcp_tqueue_ctrl_seg(conn, CTL_ACK);
@@ -1410,17 +1760,14 @@ static void tcp_transmit_segment(inet_ep2_t *epp, tcp_segment_t *seg)
 	tcp_segment_dump(seg);
 
 	if (tcp_conn_lb == tcp_lb_segment) {
-		/* Loop back segment */
-#if 0
-		tcp_ncsim_bounce_seg(sp, seg);
-#endif
-
-		/* Reverse the identification */
-		tcp_ep2_flipped(epp, &rident);
-
-		/* Insert segment back into rqueue */
+		/* Loop back segment through network condition simulator */
 		dseg = tcp_segment_dup(seg);
-		tcp_rqueue_insert_seg(&rident, dseg);
+		if (dseg == NULL) {
+			log_msg(LOG_DEFAULT, LVL_WARN, "Not enough memory. Segment dropped.");
+			return;
+		}
+
+		tcp_ncsim_bounce_seg(epp, dseg);
 		return;
 	}
 
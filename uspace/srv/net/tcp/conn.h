@@ -53,6 +53,10 @@ extern void tcp_conn_delref(tcp_conn_t *);
 extern void tcp_conn_lock(tcp_conn_t *);
 extern void tcp_conn_unlock(tcp_conn_t *);
 extern bool tcp_conn_got_syn(tcp_conn_t *);
+extern void tcp_conn_snd_buf_append(tcp_conn_t *, const void *, size_t);
+extern void tcp_conn_snd_buf_consume(tcp_conn_t *, size_t);
+extern void tcp_conn_snd_buf_tune(tcp_conn_t *);
+extern void tcp_conn_rcv_buf_get(tcp_conn_t *, void *, size_t);
 extern void tcp_conn_segment_arrived(tcp_conn_t *, inet_ep2_t *,
     tcp_segment_t *);
 extern void tcp_unexpected_segment(inet_ep2_t *, tcp_segment_t *);
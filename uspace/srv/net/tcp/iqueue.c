@@ -33,10 +33,14 @@
 /**
  * @file Connection incoming segments queue
  *
- * Segments are sorted in order of their sequence number.
+ * Segments are sorted in order of their sequence number. Besides the
+ * segments themselves we keep track of the sequence space they cover as
+ * an ordered set of disjoint ranges. This allows us to detect duplicate
+ * segments and to report out-of-order data to the peer in SACK blocks
+ * (RFC 2018).
  */
 
-#include <adt/list.h>
+#include <adt/odict.h>
 #include <errno.h>
 #include <io/log.h>
 #include <stdlib.h>
@@ -45,6 +49,26 @@
 #include "seq_no.h"
 #include "tcp_type.h"
 
+static void *tcp_iqueue_seg_getkey(odlink_t *);
+static void *tcp_iqueue_range_getkey(odlink_t *);
+static int tcp_iqueue_seq_cmp(void *, void *);
+static void tcp_iqueue_range_add(tcp_iqueue_t *, uint32_t, uint32_t);
+static void tcp_iqueue_range_drop(tcp_iqueue_t *, tcp_segment_t *);
+static void tcp_iqueue_ranges_prune(tcp_iqueue_t *);
+static tcp_iqueue_range_t *tcp_iqueue_range_find(tcp_iqueue_t *, uint32_t);
+
+/** Return @c true if sequence number @a a comes before @a b. */
+static bool tcp_iqueue_seq_lt(uint32_t a, uint32_t b)
+{
+	return (int32_t)(a - b) < 0;
+}
+
+/** Return @c true if sequence number @a a comes before or equals @a b. */
+static bool tcp_iqueue_seq_le(uint32_t a, uint32_t b)
+{
+	return (int32_t)(a - b) <= 0;
+}
+
 /** Initialize incoming segments queue.
  *
  * @param iqueue	Incoming queue
@@ -52,10 +76,43 @@
  */
 void tcp_iqueue_init(tcp_iqueue_t *iqueue, tcp_conn_t *conn)
 {
-	list_initialize(&iqueue->list);
+	odict_initialize(&iqueue->segs, tcp_iqueue_seg_getkey,
+	    tcp_iqueue_seq_cmp);
+	odict_initialize(&iqueue->ranges, tcp_iqueue_range_getkey,
+	    tcp_iqueue_seq_cmp);
+	iqueue->nrecent = 0;
 	iqueue->conn = conn;
 }
 
+/** Finalize incoming segments queue.
+ *
+ * Any segments still in the queue are deleted.
+ *
+ * @param iqueue	Incoming queue
+ */
+void tcp_iqueue_fini(tcp_iqueue_t *iqueue)
+{
+	odlink_t *odlink;
+	tcp_iqueue_entry_t *iqe;
+	tcp_iqueue_range_t *range;
+
+	while ((odlink = odict_first(&iqueue->segs)) != NULL) {
+		iqe = odict_get_instance(odlink, tcp_iqueue_entry_t, lsegs);
+		odict_remove(odlink);
+		tcp_segment_delete(iqe->seg);
+		free(iqe);
+	}
+
+	while ((odlink = odict_first(&iqueue->ranges)) != NULL) {
+		range = odict_get_instance(odlink, tcp_iqueue_range_t,
+		    lranges);
+		odict_remove(odlink);
+		free(range);
+	}
+
+	iqueue->nrecent = 0;
+}
+
 /** Insert segment into incoming queue.
  *
  * @param iqueue	Incoming queue
@@ -64,8 +121,9 @@ void tcp_iqueue_init(tcp_iqueue_t *iqueue, tcp_conn_t *conn)
 void tcp_iqueue_insert_seg(tcp_iqueue_t *iqueue, tcp_segment_t *seg)
 {
 	tcp_iqueue_entry_t *iqe;
-	tcp_iqueue_entry_t *qe;
-	link_t *link;
+	tcp_iqueue_range_t *range;
+	size_t i, j;
+
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "tcp_iqueue_insert_seg()");
 
 	iqe = calloc(1, sizeof(tcp_iqueue_entry_t));
@@ -74,25 +132,33 @@ void tcp_iqueue_insert_seg(tcp_iqueue_t *iqueue, tcp_segment_t *seg)
 		return;
 	}
 
+	iqe->seq = seg->seq;
 	iqe->seg = seg;
 
-	/* Sort by sequence number */
+	/* Sort by sequence number, equal keys in order of arrival */
+	odict_insert(&iqe->lsegs, &iqueue->segs, NULL);
 
-	link = list_first(&iqueue->list);
-	while (link != NULL) {
-		qe = list_get_instance(link,
-		    tcp_iqueue_entry_t, link);
+	if (seg->len == 0)
+		return;
 
-		if (seq_no_seg_cmp(iqueue->conn, iqe->seg, qe->seg) < 0)
-			break;
+	tcp_iqueue_range_add(iqueue, seg->seq, seg->seq + seg->len);
 
-		link = list_next(link, &iqueue->list);
+	/*
+	 * Remember which range received data most recently. Drop older
+	 * entries that now refer to the same (merged) range.
+	 */
+	range = tcp_iqueue_range_find(iqueue, seg->seq);
+	j = 0;
+	for (i = 0; i < iqueue->nrecent; i++) {
+		if (range != NULL &&
+		    tcp_iqueue_range_find(iqueue, iqueue->recent[i]) == range)
+			continue;
+		if (j + 1 < TCP_SACK_BLOCKS_MAX)
+			iqueue->recent[1 + j++] = iqueue->recent[i];
 	}
 
-	if (link != NULL)
-		list_insert_before(&iqe->link, &qe->link);
-	else
-		list_append(&iqe->link, &iqueue->list);
+	iqueue->recent[0] = seg->seq;
+	iqueue->nrecent = 1 + j;
 }
 
 /** Remove segment from incoming queue.
@@ -103,24 +169,23 @@ void tcp_iqueue_insert_seg(tcp_iqueue_t *iqueue, tcp_segment_t *seg)
 void tcp_iqueue_remove_seg(tcp_iqueue_t *iqueue, tcp_segment_t *seg)
 {
 	tcp_iqueue_entry_t *qe;
-	link_t *link;
+	odlink_t *odlink;
 
 	log_msg(LOG_DEFAULT, LVL_NOTE, "tcp_iqueue_remove_seg()");
 
-	link = list_first(&iqueue->list);
-	while (link != NULL) {
+	odlink = odict_first(&iqueue->segs);
+	while (odlink != NULL) {
 		log_msg(LOG_DEFAULT, LVL_NOTE, "tcp_iqueue_remove_seg() - next");
-		qe = list_get_instance(link,
-		    tcp_iqueue_entry_t, link);
+		qe = odict_get_instance(odlink, tcp_iqueue_entry_t, lsegs);
 
 		if (qe->seg == seg) {
 			log_msg(LOG_DEFAULT, LVL_NOTE, "tcp_iqueue_remove_seg() - found, DONE");
-			list_remove(&qe->link);
+			odict_remove(&qe->lsegs);
 			free(qe);
 			return;
 		}
 
-		link = list_next(link, &iqueue->list);
+		odlink = odict_next(odlink, &iqueue->segs);
 	}
 
 	log_msg(LOG_DEFAULT, LVL_NOTE, "tcp_iqueue_remove_seg() - not found");
@@ -139,17 +204,17 @@ void tcp_iqueue_remove_seg(tcp_iqueue_t *iqueue, tcp_segment_t *seg)
 errno_t tcp_iqueue_get_ready_seg(tcp_iqueue_t *iqueue, tcp_segment_t **seg)
 {
 	tcp_iqueue_entry_t *iqe;
-	link_t *link;
+	odlink_t *odlink;
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "tcp_get_ready_seg()");
 
-	link = list_first(&iqueue->list);
-	if (link == NULL) {
+	odlink = odict_first(&iqueue->segs);
+	if (odlink == NULL) {
 		log_msg(LOG_DEFAULT, LVL_DEBUG, "iqueue is empty");
 		return ENOENT;
 	}
 
-	iqe = list_get_instance(link, tcp_iqueue_entry_t, link);
+	iqe = odict_get_instance(odlink, tcp_iqueue_entry_t, lsegs);
 
 	while (!seq_no_segment_acceptable(iqueue->conn, iqe->seg)) {
 		log_msg(LOG_DEFAULT, LVL_DEBUG, "Skipping unacceptable segment (RCV.NXT=%"
@@ -158,16 +223,20 @@ errno_t tcp_iqueue_get_ready_seg(tcp_iqueue_t *iqueue, tcp_segment_t **seg)
 		    iqueue->conn->rcv_nxt + iqueue->conn->rcv_wnd,
 		    iqe->seg->seq, iqe->seg->len);
 
-		list_remove(&iqe->link);
+		/* We no longer hold this data, do not report it in SACK */
+		tcp_iqueue_range_drop(iqueue, iqe->seg);
+
+		odict_remove(&iqe->lsegs);
 		tcp_segment_delete(iqe->seg);
+		free(iqe);
 
-		link = list_first(&iqueue->list);
-		if (link == NULL) {
+		odlink = odict_first(&iqueue->segs);
+		if (odlink == NULL) {
 			log_msg(LOG_DEFAULT, LVL_DEBUG, "iqueue is empty");
 			return ENOENT;
 		}
 
-		iqe = list_get_instance(link, tcp_iqueue_entry_t, link);
+		iqe = odict_get_instance(odlink, tcp_iqueue_entry_t, lsegs);
 	}
 
 	/* Do not return segments that are not ready for processing */
@@ -179,13 +248,269 @@ errno_t tcp_iqueue_get_ready_seg(tcp_iqueue_t *iqueue, tcp_segment_t **seg)
 	}
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "Returning ready segment %p", iqe->seg);
-	list_remove(&iqe->link);
+	odict_remove(&iqe->lsegs);
 	*seg = iqe->seg;
 	free(iqe);
 
 	return EOK;
 }
 
+/** Determine if segment only carries data already in the queue.
+ *
+ * @param iqueue	Incoming queue
+ * @param seg		Segment
+ * @return		@c true if @a seg has non-zero length and all of it
+ *			is covered by queued segments
+ */
+bool tcp_iqueue_seg_covered(tcp_iqueue_t *iqueue, tcp_segment_t *seg)
+{
+	tcp_iqueue_range_t *range;
+
+	if (seg->len == 0)
+		return false;
+
+	tcp_iqueue_ranges_prune(iqueue);
+
+	range = tcp_iqueue_range_find(iqueue, seg->seq);
+	if (range == NULL)
+		return false;
+
+	return tcp_iqueue_seq_le(seg->seq + seg->len, range->end);
+}
+
+/** Get SACK blocks describing queued out-of-order data.
+ *
+ * As required by RFC 2018 the first block contains the most recently
+ * received segment, followed by other recently reported blocks. Any
+ * remaining space is filled with the remaining blocks in sequence order.
+ *
+ * @param iqueue	Incoming queue
+ * @param blocks	Array to fill in
+ * @param max		Maximum number of blocks to return
+ * @return		Number of blocks stored in @a blocks
+ */
+size_t tcp_iqueue_sack_blocks(tcp_iqueue_t *iqueue, tcp_sack_block_t *blocks,
+    size_t max)
+{
+	tcp_iqueue_range_t *reported[TCP_SACK_BLOCKS_MAX];
+	tcp_iqueue_range_t *range;
+	odlink_t *odlink;
+	size_t cnt;
+	size_t i, j;
+
+	assert(max <= TCP_SACK_BLOCKS_MAX);
+
+	tcp_iqueue_ranges_prune(iqueue);
+
+	cnt = 0;
+	for (i = 0; i < iqueue->nrecent && cnt < max; i++) {
+		range = tcp_iqueue_range_find(iqueue, iqueue->recent[i]);
+		if (range == NULL)
+			continue;
+
+		for (j = 0; j < cnt; j++) {
+			if (reported[j] == range)
+				break;
+		}
+
+		if (j == cnt)
+			reported[cnt++] = range;
+	}
+
+	odlink = odict_first(&iqueue->ranges);
+	while (odlink != NULL && cnt < max) {
+		range = odict_get_instance(odlink, tcp_iqueue_range_t,
+		    lranges);
+
+		for (j = 0; j < cnt; j++) {
+			if (reported[j] == range)
+				break;
+		}
+
+		if (j == cnt)
+			reported[cnt++] = range;
+
+		odlink = odict_next(odlink, &iqueue->ranges);
+	}
+
+	for (i = 0; i < cnt; i++) {
+		blocks[i].start = reported[i]->start;
+		blocks[i].end = reported[i]->end;
+	}
+
+	return cnt;
+}
+
+/** Add sequence space to the set of queued ranges.
+ *
+ * @param iqueue	Incoming queue
+ * @param start		First sequence number
+ * @param end		Sequence number immediately following the range
+ */
+static void tcp_iqueue_range_add(tcp_iqueue_t *iqueue, uint32_t start,
+    uint32_t end)
+{
+	tcp_iqueue_range_t *range;
+	tcp_iqueue_range_t *next;
+	odlink_t *odlink;
+
+	tcp_iqueue_ranges_prune(iqueue);
+
+	/* Extend preceding range if it reaches up to @a start */
+	odlink = odict_find_leq(&iqueue->ranges, &start, NULL);
+	if (odlink != NULL) {
+		range = odict_get_instance(odlink, tcp_iqueue_range_t,
+		    lranges);
+		if (!tcp_iqueue_seq_le(start, range->end))
+			range = NULL;
+	} else {
+		range = NULL;
+	}
+
+	if (range != NULL) {
+		if (tcp_iqueue_seq_lt(range->end, end))
+			range->end = end;
+	} else {
+		range = calloc(1, sizeof(tcp_iqueue_range_t));
+		if (range == NULL) {
+			/* Only results in less precise SACK information */
+			log_msg(LOG_DEFAULT, LVL_ERROR, "Failed allocating "
+			    "range.");
+			return;
+		}
+
+		range->start = start;
+		range->end = end;
+		odict_insert(&range->lranges, &iqueue->ranges, NULL);
+	}
+
+	/* Absorb any following ranges that now overlap or abut */
+	odlink = odict_next(&range->lranges, &iqueue->ranges);
+	while (odlink != NULL) {
+		next = odict_get_instance(odlink, tcp_iqueue_range_t, lranges);
+		if (!tcp_iqueue_seq_le(next->start, range->end))
+			break;
+
+		if (tcp_iqueue_seq_lt(range->end, next->end))
+			range->end = next->end;
+
+		odlink = odict_next(odlink, &iqueue->ranges);
+		odict_remove(&next->lranges);
+		free(next);
+	}
+}
+
+/** Remove any ranges overlapping segment.
+ *
+ * Used when a queued segment is discarded. We may under-report, but
+ * must never report data we do not hold.
+ *
+ * @param iqueue	Incoming queue
+ * @param seg		Segment being discarded
+ */
+static void tcp_iqueue_range_drop(tcp_iqueue_t *iqueue, tcp_segment_t *seg)
+{
+	tcp_iqueue_range_t *range;
+	odlink_t *odlink;
+	odlink_t *next;
+
+	if (seg->len == 0)
+		return;
+
+	odlink = odict_first(&iqueue->ranges);
+	while (odlink != NULL) {
+		range = odict_get_instance(odlink, tcp_iqueue_range_t,
+		    lranges);
+		next = odict_next(odlink, &iqueue->ranges);
+
+		if (tcp_iqueue_seq_lt(range->start, seg->seq + seg->len) &&
+		    tcp_iqueue_seq_lt(seg->seq, range->end)) {
+			odict_remove(odlink);
+			free(range);
+		}
+
+		odlink = next;
+	}
+}
+
+/** Discard ranges that have already been received in sequence.
+ *
+ * @param iqueue	Incoming queue
+ */
+static void tcp_iqueue_ranges_prune(tcp_iqueue_t *iqueue)
+{
+	tcp_iqueue_range_t *range;
+	odlink_t *odlink;
+	uint32_t rcv_nxt = iqueue->conn->rcv_nxt;
+
+	while ((odlink = odict_first(&iqueue->ranges)) != NULL) {
+		range = odict_get_instance(odlink, tcp_iqueue_range_t,
+		    lranges);
+
+		if (tcp_iqueue_seq_lt(rcv_nxt, range->end)) {
+			/* Lowest range, clipping it does not change order */
+			if (tcp_iqueue_seq_lt(range->start, rcv_nxt))
+				range->start = rcv_nxt;
+			break;
+		}
+
+		odict_remove(odlink);
+		free(range);
+	}
+}
+
+/** Find range containing sequence number.
+ *
+ * @param iqueue	Incoming queue
+ * @param seq		Sequence number
+ * @return		Range or @c NULL if @a seq is not in any range
+ */
+static tcp_iqueue_range_t *tcp_iqueue_range_find(tcp_iqueue_t *iqueue,
+    uint32_t seq)
+{
+	tcp_iqueue_range_t *range;
+	odlink_t *odlink;
+
+	odlink = odict_find_leq(&iqueue->ranges, &seq, NULL);
+	if (odlink == NULL)
+		return NULL;
+
+	range = odict_get_instance(odlink, tcp_iqueue_range_t, lranges);
+	if (!tcp_iqueue_seq_lt(seq, range->end))
+		return NULL;
+
+	return range;
+}
+
+/** Get key of incoming queue entry. */
+static void *tcp_iqueue_seg_getkey(odlink_t *odlink)
+{
+	return &odict_get_instance(odlink, tcp_iqueue_entry_t, lsegs)->seq;
+}
+
+/** Get key of incoming queue range. */
+static void *tcp_iqueue_range_getkey(odlink_t *odlink)
+{
+	return &odict_get_instance(odlink, tcp_iqueue_range_t,
+	    lranges)->start;
+}
+
+/** Compare two sequence numbers.
+ *
+ * All keys lie within the receive window, i.e. within 2^31 of each
+ * other, so modular comparison gives a consistent total order.
+ */
+static int tcp_iqueue_seq_cmp(void *a, void *b)
+{
+	uint32_t sa = *(uint32_t *)a;
+	uint32_t sb = *(uint32_t *)b;
+
+	if (sa == sb)
+		return 0;
+
+	return tcp_iqueue_seq_lt(sa, sb) ? -1 : +1;
+}
+
 /**
  * @}
  */
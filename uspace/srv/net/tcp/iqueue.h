@@ -38,9 +38,13 @@
 #include "tcp_type.h"
 
 extern void tcp_iqueue_init(tcp_iqueue_t *, tcp_conn_t *);
+extern void tcp_iqueue_fini(tcp_iqueue_t *);
 extern void tcp_iqueue_insert_seg(tcp_iqueue_t *, tcp_segment_t *);
 extern void tcp_iqueue_remove_seg(tcp_iqueue_t *, tcp_segment_t *);
 extern errno_t tcp_iqueue_get_ready_seg(tcp_iqueue_t *, tcp_segment_t **);
+extern bool tcp_iqueue_seg_covered(tcp_iqueue_t *, tcp_segment_t *);
+extern size_t tcp_iqueue_sack_blocks(tcp_iqueue_t *, tcp_sack_block_t *,
+    size_t);
 
 #endif
 
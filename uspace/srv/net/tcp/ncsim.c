@@ -36,6 +36,9 @@
  * Simulate network conditions for testing the reliability implementation:
  *    - variable latency
  *    - frame drop
+ *
+ * Conditions are described by a profile set with tcp_ncsim_set_profile().
+ * Without a profile segments are looped back immediately.
  */
 
 #include <adt/list.h>
@@ -43,79 +46,188 @@
 #include <errno.h>
 #include <inet/endpoint.h>
 #include <io/log.h>
+#include <macros.h>
 #include <stdlib.h>
 #include <fibril.h>
+#include <fibril_synch.h>
+#include <time.h>
 #include "conn.h"
 #include "ncsim.h"
 #include "rqueue.h"
 #include "segment.h"
 #include "tcp_type.h"
 
-static list_t sim_queue;
-static fibril_mutex_t sim_queue_lock;
-static fibril_condvar_t sim_queue_cv;
+static LIST_INITIALIZE(sim_queue);
+static FIBRIL_MUTEX_INITIALIZE(sim_queue_lock);
+static FIBRIL_CONDVAR_INITIALIZE(sim_queue_cv);
+static bool sim_active;
+static bool sim_quit;
+/** Current profile, protected by @c sim_queue_lock */
+static tcp_ncsim_profile_t sim_profile;
+static bool sim_profile_set;
+
+/** Sequence number following the new data seen so far */
+static uint32_t sim_data_nxt;
+/** @c sim_data_nxt is valid */
+static bool sim_data_seen;
+/** Number of segments with new data seen */
+static unsigned sim_data_cnt;
+/** Number of segments dropped due to @c drop_nth */
+static unsigned sim_data_drops;
 
-/** Initialize segment receive queue. */
+/** Initialize network condition simulator. */
 void tcp_ncsim_init(void)
 {
-	list_initialize(&sim_queue);
-	fibril_mutex_initialize(&sim_queue_lock);
-	fibril_condvar_initialize(&sim_queue_cv);
+	fibril_mutex_lock(&sim_queue_lock);
+	assert(list_empty(&sim_queue));
+	sim_active = false;
+	sim_quit = false;
+	sim_profile_set = false;
+	fibril_mutex_unlock(&sim_queue_lock);
+}
+
+/** Stop simulator and drop segments still in flight. */
+void tcp_ncsim_fini(void)
+{
+	link_t *link;
+	tcp_squeue_entry_t *sqe;
+
+	fibril_mutex_lock(&sim_queue_lock);
+	sim_quit = true;
+	sim_profile_set = false;
+	fibril_condvar_broadcast(&sim_queue_cv);
+
+	while (sim_active)
+		fibril_condvar_wait(&sim_queue_cv, &sim_queue_lock);
+
+	while ((link = list_first(&sim_queue)) != NULL) {
+		sqe = list_get_instance(link, tcp_squeue_entry_t, link);
+		list_remove(link);
+		tcp_segment_delete(sqe->seg);
+		free(sqe);
+	}
+
+	fibril_mutex_unlock(&sim_queue_lock);
+}
+
+/** Set network conditions profile.
+ *
+ * @param profile	Profile or @c NULL to loop segments back directly
+ */
+void tcp_ncsim_set_profile(tcp_ncsim_profile_t *profile)
+{
+	fibril_mutex_lock(&sim_queue_lock);
+
+	if (profile != NULL) {
+		assert(profile->delay_min <= profile->delay_max);
+		sim_profile = *profile;
+		sim_profile_set = true;
+		sim_data_seen = false;
+		sim_data_cnt = 0;
+		sim_data_drops = 0;
+	} else {
+		sim_profile_set = false;
+	}
+
+	fibril_mutex_unlock(&sim_queue_lock);
+}
+
+/** Determine whether segment should be dropped as the n-th one with new data.
+ *
+ * Must be called with sim_queue_lock held.
+ *
+ * @param seg	Segment
+ * @return	@c true if segment should be dropped
+ */
+static bool tcp_ncsim_drop_nth(tcp_segment_t *seg)
+{
+	size_t text_size;
+
+	text_size = tcp_segment_text_size(seg);
+	if (sim_profile.drop_nth == 0 || text_size == 0)
+		return false;
+
+	/* Retransmissions carry no new data */
+	if (sim_data_seen && (int32_t)(seg->seq - sim_data_nxt) < 0)
+		return false;
+
+	sim_data_nxt = seg->seq + text_size;
+	sim_data_seen = true;
+
+	if (++sim_data_cnt % sim_profile.drop_nth != 0 ||
+	    sim_data_drops >= sim_profile.drop_max)
+		return false;
+
+	sim_data_drops++;
+	return true;
 }
 
 /** Bounce segment through simulator into receive queue.
  *
  * @param epp	Endpoint pair, oriented for transmission
- * @param seg	Segment
+ * @param seg	Segment (ownership transferred to simulator)
  */
 void tcp_ncsim_bounce_seg(inet_ep2_t *epp, tcp_segment_t *seg)
 {
 	tcp_squeue_entry_t *sqe;
 	tcp_squeue_entry_t *old_qe;
 	inet_ep2_t rident;
+	usec_t delay;
 	link_t *link;
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "tcp_ncsim_bounce_seg()");
-	tcp_ep2_flipped(epp, &rident);
-	tcp_rqueue_insert_seg(&rident, seg);
-	return;
 
-	if (0 /*rand() % 4 == 3*/) {
+	fibril_mutex_lock(&sim_queue_lock);
+
+	if (!sim_profile_set) {
+		fibril_mutex_unlock(&sim_queue_lock);
+		tcp_ep2_flipped(epp, &rident);
+		tcp_rqueue_insert_seg(&rident, seg);
+		return;
+	}
+
+	if (tcp_ncsim_drop_nth(seg) || (sim_profile.drop_pct > 0 &&
+	    (unsigned) rand() % 100 < sim_profile.drop_pct)) {
+		fibril_mutex_unlock(&sim_queue_lock);
 		/* Drop segment */
-		log_msg(LOG_DEFAULT, LVL_ERROR, "NCSim dropping segment");
+		log_msg(LOG_DEFAULT, LVL_DEBUG, "NCSim dropping segment");
 		tcp_segment_delete(seg);
 		return;
 	}
 
 	sqe = calloc(1, sizeof(tcp_squeue_entry_t));
 	if (sqe == NULL) {
+		fibril_mutex_unlock(&sim_queue_lock);
 		log_msg(LOG_DEFAULT, LVL_ERROR, "Failed allocating SQE.");
+		tcp_segment_delete(seg);
 		return;
 	}
 
-	sqe->delay = rand() % (1000 * 1000);
+	delay = sim_profile.delay_min;
+	if (sim_profile.delay_max > sim_profile.delay_min) {
+		delay += rand() % (sim_profile.delay_max -
+		    sim_profile.delay_min + 1);
+	}
+
+	getuptime(&sqe->due);
+	ts_add_diff(&sqe->due, USEC2NSEC(delay));
 	sqe->epp = *epp;
 	sqe->seg = seg;
 
-	fibril_mutex_lock(&sim_queue_lock);
-
-	link = list_first(&sim_queue);
-	while (link != NULL && sqe->delay > 0) {
+	/* Keep queue sorted by delivery time */
+	link = list_last(&sim_queue);
+	while (link != NULL) {
 		old_qe = list_get_instance(link, tcp_squeue_entry_t, link);
-		if (sqe->delay < old_qe->delay)
+		if (ts_gteq(&sqe->due, &old_qe->due))
 			break;
 
-		sqe->delay -= old_qe->delay;
-
-		link = link->next;
-		if (link == &sim_queue.head)
-			link = NULL;
+		link = list_prev(link, &sim_queue);
 	}
 
 	if (link != NULL)
 		list_insert_after(&sqe->link, link);
 	else
-		list_append(&sqe->link, &sim_queue);
+		list_prepend(&sqe->link, &sim_queue);
 
 	fibril_condvar_broadcast(&sim_queue_cv);
 	fibril_mutex_unlock(&sim_queue_lock);
@@ -127,35 +239,47 @@ static errno_t tcp_ncsim_fibril(void *arg)
 	link_t *link;
 	tcp_squeue_entry_t *sqe;
 	inet_ep2_t rident;
-	errno_t rc;
+	struct timespec now;
+	nsec_t remain;
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "tcp_ncsim_fibril()");
 
-	while (true) {
-		fibril_mutex_lock(&sim_queue_lock);
+	fibril_mutex_lock(&sim_queue_lock);
 
-		while (list_empty(&sim_queue))
+	while (!sim_quit) {
+		link = list_first(&sim_queue);
+		if (link == NULL) {
 			fibril_condvar_wait(&sim_queue_cv, &sim_queue_lock);
+			continue;
+		}
 
-		do {
-			link = list_first(&sim_queue);
-			sqe = list_get_instance(link, tcp_squeue_entry_t, link);
+		sqe = list_get_instance(link, tcp_squeue_entry_t, link);
 
+		getuptime(&now);
+		remain = ts_sub_diff(&sqe->due, &now);
+		if (remain > 0) {
+			/* New segment or quit request may wake us up early */
 			log_msg(LOG_DEFAULT, LVL_DEBUG, "NCSim - Sleep");
-			rc = fibril_condvar_wait_timeout(&sim_queue_cv,
-			    &sim_queue_lock, sqe->delay);
-		} while (rc != ETIMEOUT);
+			(void) fibril_condvar_wait_timeout(&sim_queue_cv,
+			    &sim_queue_lock, max(NSEC2USEC(remain), 1));
+			continue;
+		}
 
 		list_remove(link);
 		fibril_mutex_unlock(&sim_queue_lock);
 
-		log_msg(LOG_DEFAULT, LVL_DEBUG, "NCSim - End Sleep");
+		log_msg(LOG_DEFAULT, LVL_DEBUG, "NCSim - Deliver");
 		tcp_ep2_flipped(&sqe->epp, &rident);
 		tcp_rqueue_insert_seg(&rident, sqe->seg);
 		free(sqe);
+
+		fibril_mutex_lock(&sim_queue_lock);
 	}
 
-	/* Not reached */
+	sim_active = false;
+	fibril_condvar_broadcast(&sim_queue_cv);
+	fibril_mutex_unlock(&sim_queue_lock);
+
 	return 0;
 }
 
@@ -172,6 +296,7 @@ void tcp_ncsim_fibril_start(void)
 		return;
 	}
 
+	sim_active = true;
 	fibril_add_ready(fid);
 }
 
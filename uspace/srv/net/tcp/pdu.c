@@ -37,6 +37,7 @@
 #include <bitops.h>
 #include <byteorder.h>
 #include <errno.h>
+#include <inet/checksum.h>
 #include <inet/endpoint.h>
 #include <mem.h>
 #include <stdlib.h>
@@ -46,44 +47,6 @@
 #include "std.h"
 #include "tcp_type.h"
 
-#define TCP_CHECKSUM_INIT 0xffff
-
-/** One's complement addition.
- *
- * Result is a + b + carry.
- */
-static uint16_t tcp_ocadd16(uint16_t a, uint16_t b)
-{
-	uint32_t s;
-
-	s = (uint32_t)a + (uint32_t)b;
-	return (s & 0xffff) + (s >> 16);
-}
-
-static uint16_t tcp_checksum_calc(uint16_t ivalue, void *data, size_t size)
-{
-	uint16_t sum;
-	uint16_t w;
-	size_t words, i;
-	uint8_t *bdata;
-
-	sum = ~ivalue;
-	words = size / 2;
-	bdata = (uint8_t *)data;
-
-	for (i = 0; i < words; i++) {
-		w = ((uint16_t)bdata[2 * i] << 8) | bdata[2 * i + 1];
-		sum = tcp_ocadd16(sum, w);
-	}
-
-	if (size % 2 != 0) {
-		w = ((uint16_t)bdata[2 * words] << 8);
-		sum = tcp_ocadd16(sum, w);
-	}
-
-	return ~sum;
-}
-
 static void tcp_header_decode_flags(uint16_t doff_flags, tcp_control_t *rctl)
 {
 	tcp_control_t ctl;
@@ -125,7 +88,8 @@ static void tcp_header_encode_flags(tcp_control_t ctl, uint16_t doff_flags0,
 	*rdoff_flags = doff_flags;
 }
 
-static void tcp_header_setup(inet_ep2_t *epp, tcp_segment_t *seg, tcp_header_t *hdr)
+static void tcp_header_setup(inet_ep2_t *epp, tcp_segment_t *seg,
+    tcp_header_t *hdr, size_t hdr_size)
 {
 	uint16_t doff_flags;
 	uint16_t doff;
@@ -135,7 +99,7 @@ static void tcp_header_setup(inet_ep2_t *epp, tcp_segment_t *seg, tcp_header_t *
 	hdr->seq = host2uint32_t_be(seg->seq);
 	hdr->ack = host2uint32_t_be(seg->ack);
 
-	doff = (sizeof(tcp_header_t) / sizeof(uint32_t)) << DF_DATA_OFFSET_l;
+	doff = (hdr_size / sizeof(uint32_t)) << DF_DATA_OFFSET_l;
 	tcp_header_encode_flags(seg->ctrl, doff, &doff_flags);
 
 	hdr->doff_flags = host2uint16_t_be(doff_flags);
@@ -190,18 +154,164 @@ static void tcp_header_decode(tcp_header_t *hdr, tcp_segment_t *seg)
 	seg->up = uint16_t_be2host(hdr->urg_ptr);
 }
 
+/** Read 32-bit big-endian value from option data. */
+static uint32_t tcp_opt_get32(uint8_t *p)
+{
+	return ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) |
+	    ((uint32_t) p[2] << 8) | p[3];
+}
+
+/** Write 32-bit big-endian value to option data. */
+static void tcp_opt_put32(uint8_t *p, uint32_t val)
+{
+	p[0] = val >> 24;
+	p[1] = (val >> 16) & 0xff;
+	p[2] = (val >> 8) & 0xff;
+	p[3] = val & 0xff;
+}
+
+/** Decode TCP options.
+ *
+ * Unknown options are skipped. A malformed option terminates processing,
+ * options decoded up to that point are kept.
+ *
+ * @param opt		Options
+ * @param size		Size of options in bytes
+ * @param seg		Segment to store decoded options into
+ */
+static void tcp_options_decode(uint8_t *opt, size_t size, tcp_segment_t *seg)
+{
+	size_t i, j;
+	size_t nblk;
+	uint8_t *blk;
+	uint8_t kind;
+	uint8_t len;
+
+	i = 0;
+	while (i < size) {
+		kind = opt[i];
+		if (kind == OPT_END_LIST)
+			break;
+
+		if (kind == OPT_NOP) {
+			++i;
+			continue;
+		}
+
+		if (i + 1 >= size)
+			break;
+
+		len = opt[i + 1];
+		if (len < 2 || i + len > size)
+			break;
+
+		switch (kind) {
+		case OPT_WINDOW_SCALE:
+			if (len != OPT_WINDOW_SCALE_LEN)
+				break;
+			seg->has_wscale = true;
+			seg->wscale = opt[i + 2];
+			break;
+		case OPT_SACK_PERMITTED:
+			if (len != OPT_SACK_PERMITTED_LEN)
+				break;
+			seg->sack_perm = true;
+			break;
+		case OPT_SACK:
+			if ((len - OPT_SACK_HDR_LEN) % OPT_SACK_BLOCK_LEN != 0)
+				break;
+			nblk = (len - OPT_SACK_HDR_LEN) / OPT_SACK_BLOCK_LEN;
+			seg->nsack = 0;
+			for (j = 0; j < nblk && j < TCP_SACK_BLOCKS_MAX; j++) {
+				blk = &opt[i + OPT_SACK_HDR_LEN +
+				    j * OPT_SACK_BLOCK_LEN];
+				seg->sack[j].start = tcp_opt_get32(blk);
+				seg->sack[j].end = tcp_opt_get32(blk + 4);
+				seg->nsack++;
+			}
+			break;
+		default:
+			break;
+		}
+
+		i += len;
+	}
+}
+
+/** Return size of encoded TCP options, padded to a multiple of 4 bytes. */
+static size_t tcp_options_size(tcp_segment_t *seg)
+{
+	size_t size = 0;
+
+	/* Each option is preceded by NOPs to keep alignment */
+	if (seg->has_wscale)
+		size += 1 + OPT_WINDOW_SCALE_LEN;
+	if (seg->sack_perm)
+		size += 2 + OPT_SACK_PERMITTED_LEN;
+	if (seg->nsack > 0) {
+		size += 2 + OPT_SACK_HDR_LEN + seg->nsack *
+		    OPT_SACK_BLOCK_LEN;
+	}
+
+	return size;
+}
+
+/** Encode TCP options.
+ *
+ * @param seg		Segment
+ * @param opt		Buffer of tcp_options_size() bytes
+ */
+static void tcp_options_encode(tcp_segment_t *seg, uint8_t *opt)
+{
+	size_t i;
+
+	if (seg->has_wscale) {
+		opt[0] = OPT_NOP;
+		opt[1] = OPT_WINDOW_SCALE;
+		opt[2] = OPT_WINDOW_SCALE_LEN;
+		opt[3] = seg->wscale;
+		opt += 1 + OPT_WINDOW_SCALE_LEN;
+	}
+
+	if (seg->sack_perm) {
+		opt[0] = OPT_NOP;
+		opt[1] = OPT_NOP;
+		opt[2] = OPT_SACK_PERMITTED;
+		opt[3] = OPT_SACK_PERMITTED_LEN;
+		opt += 2 + OPT_SACK_PERMITTED_LEN;
+	}
+
+	if (seg->nsack > 0) {
+		opt[0] = OPT_NOP;
+		opt[1] = OPT_NOP;
+		opt[2] = OPT_SACK;
+		opt[3] = OPT_SACK_HDR_LEN + seg->nsack * OPT_SACK_BLOCK_LEN;
+		opt += 2 + OPT_SACK_HDR_LEN;
+
+		for (i = 0; i < seg->nsack; i++) {
+			tcp_opt_put32(opt, seg->sack[i].start);
+			tcp_opt_put32(opt + 4, seg->sack[i].end);
+			opt += OPT_SACK_BLOCK_LEN;
+		}
+	}
+}
+
 static errno_t tcp_header_encode(inet_ep2_t *epp, tcp_segment_t *seg,
     void **header, size_t *size)
 {
 	tcp_header_t *hdr;
+	size_t hdr_size;
+
+	hdr_size = sizeof(tcp_header_t) + tcp_options_size(seg);
 
-	hdr = calloc(1, sizeof(tcp_header_t));
+	hdr = calloc(1, hdr_size);
 	if (hdr == NULL)
 		return ENOMEM;
 
-	tcp_header_setup(epp, seg, hdr);
+	tcp_header_setup(epp, seg, hdr, hdr_size);
+	tcp_options_encode(seg, (uint8_t *)(hdr + 1));
 	*header = hdr;
-	*size = sizeof(tcp_header_t);
+	*size = hdr_size;
 
 	return EOK;
 }
@@ -270,19 +380,19 @@ static uint16_t tcp_pdu_checksum_calc(tcp_pdu_t *pdu)
 	ip_ver_t ver = tcp_phdr_setup(pdu, &phdr, &phdr6);
 	switch (ver) {
 	case ip_v4:
-		cs_phdr = tcp_checksum_calc(TCP_CHECKSUM_INIT, (void *) &phdr,
+		cs_phdr = inet_checksum_calc(INET_CHECKSUM_INIT, (void *) &phdr,
 		    sizeof(tcp_phdr_t));
 		break;
 	case ip_v6:
-		cs_phdr = tcp_checksum_calc(TCP_CHECKSUM_INIT, (void *) &phdr6,
+		cs_phdr = inet_checksum_calc(INET_CHECKSUM_INIT, (void *) &phdr6,
 		    sizeof(tcp_phdr6_t));
 		break;
 	default:
 		assert(false);
 	}
 
-	cs_headers = tcp_checksum_calc(cs_phdr, pdu->header, pdu->header_size);
-	return tcp_checksum_calc(cs_headers, pdu->text, pdu->text_size);
+	cs_headers = inet_checksum_calc(cs_phdr, pdu->header, pdu->header_size);
+	return inet_checksum_calc(cs_headers, pdu->text, pdu->text_size);
 }
 
 static void tcp_pdu_set_checksum(tcp_pdu_t *pdu, uint16_t checksum)
@@ -307,6 +417,8 @@ errno_t tcp_pdu_decode(tcp_pdu_t *pdu, inet_ep2_t *epp, tcp_segment_t **seg)
 	nseg->len += seq_no_control_len(nseg->ctrl);
 
 	hdr = (tcp_header_t *)pdu->header;
+	tcp_options_decode((uint8_t *)(hdr + 1),
+	    pdu->header_size - sizeof(tcp_header_t), nseg);
 
 	epp->local.port = uint16_t_be2host(hdr->dest_port);
 	epp->local.addr = pdu->dest;
@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2026 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup tcp
+ * @{
+ */
+
+/**
+ * @file Round-trip time estimation
+ *
+ * Retransmission timeout computation as per RFC 6298. Only one segment
+ * is timed at a time and retransmitted segments are never timed (Karn's
+ * algorithm).
+ */
+
+#include <macros.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+#include "rtt.h"
+#include "tcp_type.h"
+
+/** Initial retransmission timeout */
+#define RTO_INITIAL	(1000 * 1000)
+/** Lower bound on retransmission timeout (RFC 6298 suggests 1 s) */
+#define RTO_MIN		(200 * 1000)
+/** Upper bound on retransmission timeout */
+#define RTO_MAX		(60 * 1000 * 1000)
+/** Clock granularity */
+#define RTT_G		1000
+
+/** Initialize round-trip time estimator.
+ *
+ * @param rtt	RTT estimator
+ */
+void tcp_rtt_init(tcp_rtt_t *rtt)
+{
+	rtt->srtt = 0;
+	rtt->rttvar = 0;
+	rtt->rto = RTO_INITIAL;
+	rtt->timing = false;
+}
+
+/** Update estimator with a round-trip time measurement.
+ *
+ * @param rtt	RTT estimator
+ * @param r	Measured round-trip time
+ */
+void tcp_rtt_sample(tcp_rtt_t *rtt, usec_t r)
+{
+	usec_t delta;
+
+	if (rtt->srtt == 0) {
+		/* First measurement */
+		rtt->srtt = max(r, 1);
+		rtt->rttvar = r / 2;
+	} else {
+		delta = rtt->srtt > r ? rtt->srtt - r : r - rtt->srtt;
+		/* RTTVAR = 3/4 RTTVAR + 1/4 |SRTT - R| */
+		rtt->rttvar = (3 * rtt->rttvar + delta) / 4;
+		/* SRTT = 7/8 SRTT + 1/8 R */
+		rtt->srtt = (7 * rtt->srtt + r) / 8;
+	}
+
+	rtt->rto = rtt->srtt + max(RTT_G, 4 * rtt->rttvar);
+	rtt->rto = max(rtt->rto, RTO_MIN);
+	rtt->rto = min(rtt->rto, RTO_MAX);
+}
+
+/** Back off retransmission timer after it expired.
+ *
+ * Also stops timing the current segment since it is going to be
+ * retransmitted.
+ *
+ * @param rtt	RTT estimator
+ */
+void tcp_rtt_backoff(tcp_rtt_t *rtt)
+{
+	rtt->rto = min(2 * rtt->rto, RTO_MAX);
+	rtt->timing = false;
+}
+
+/** Start timing a segment, unless one is being timed already.
+ *
+ * @param rtt	RTT estimator
+ * @param seq	Sequence number following the segment
+ */
+void tcp_rtt_start(tcp_rtt_t *rtt, uint32_t seq)
+{
+	if (rtt->timing)
+		return;
+
+	getuptime(&rtt->ts);
+	rtt->seq = seq;
+	rtt->timing = true;
+}
+
+/** Take measurement if the timed segment has been acknowledged.
+ *
+ * @param rtt	RTT estimator
+ * @param una	SND.UNA
+ */
+void tcp_rtt_ack(tcp_rtt_t *rtt, uint32_t una)
+{
+	struct timespec now;
+
+	if (!rtt->timing || (int32_t)(una - rtt->seq) < 0)
+		return;
+
+	getuptime(&now);
+	tcp_rtt_sample(rtt, NSEC2USEC(ts_sub_diff(&now, &rtt->ts)));
+	rtt->timing = false;
+}
+
+/**
+ * @}
+ */
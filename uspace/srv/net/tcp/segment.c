@@ -35,6 +35,7 @@
  */
 
 #include <io/log.h>
+#include <macros.h>
 #include <mem.h>
 #include <stdlib.h>
 #include "segment.h"
@@ -74,6 +75,11 @@ tcp_segment_t *tcp_segment_dup(tcp_segment_t *seg)
 	scopy->len = seg->len;
 	scopy->wnd = seg->wnd;
 	scopy->up = seg->up;
+	scopy->has_wscale = seg->has_wscale;
+	scopy->wscale = seg->wscale;
+	scopy->sack_perm = seg->sack_perm;
+	scopy->nsack = seg->nsack;
+	memcpy(scopy->sack, seg->sack, sizeof(seg->sack));
 
 	tsize = tcp_segment_text_size(seg);
 	scopy->data = calloc(tsize, 1);
@@ -158,6 +164,44 @@ tcp_segment_t *tcp_segment_make_data(tcp_control_t ctrl, void *data,
 	return seg;
 }
 
+/** Create a data segment with text taken from a ring buffer.
+ *
+ * @param ctrl	Control flags
+ * @param buf	Ring buffer
+ * @param bsize	Size of ring buffer
+ * @param off	Offset of first byte of text in @a buf
+ * @param size	Text size, may wrap around the end of @a buf
+ * @return	Segment or @c NULL if out of memory
+ */
+tcp_segment_t *tcp_segment_make_data_ring(tcp_control_t ctrl, uint8_t *buf,
+    size_t bsize, size_t off, size_t size)
+{
+	tcp_segment_t *seg;
+	size_t first;
+
+	assert(off < bsize || (off == bsize && size == 0));
+	assert(size <= bsize);
+
+	seg = tcp_segment_new();
+	if (seg == NULL)
+		return NULL;
+
+	seg->ctrl = ctrl;
+	seg->len = seq_no_control_len(ctrl) + size;
+
+	seg->dfptr = seg->data = malloc(size);
+	if (seg->dfptr == NULL) {
+		free(seg);
+		return NULL;
+	}
+
+	first = min(size, bsize - off);
+	memcpy(seg->data, buf + off, first);
+	memcpy((uint8_t *)seg->data + first, buf, size - first);
+
+	return seg;
+}
+
 /** Trim segment from left and right by the specified amount.
  *
  * Trim any text or control to remove the specified amount of sequence
@@ -247,6 +291,8 @@ size_t tcp_segment_text_size(tcp_segment_t *seg)
  */
 void tcp_segment_dump(tcp_segment_t *seg)
 {
+	size_t i;
+
 	log_msg(LOG_DEFAULT, LVL_DEBUG2, "Segment dump:");
 	log_msg(LOG_DEFAULT, LVL_DEBUG2, " - ctrl = %u", (unsigned)seg->ctrl);
 	log_msg(LOG_DEFAULT, LVL_DEBUG2, " - seq = %" PRIu32, seg->seq);
@@ -254,6 +300,14 @@ void tcp_segment_dump(tcp_segment_t *seg)
 	log_msg(LOG_DEFAULT, LVL_DEBUG2, " - len = %" PRIu32, seg->len);
 	log_msg(LOG_DEFAULT, LVL_DEBUG2, " - wnd = %" PRIu32, seg->wnd);
 	log_msg(LOG_DEFAULT, LVL_DEBUG2, " - up = %" PRIu32, seg->up);
+	if (seg->has_wscale)
+		log_msg(LOG_DEFAULT, LVL_DEBUG2, " - wscale = %u", seg->wscale);
+	if (seg->sack_perm)
+		log_msg(LOG_DEFAULT, LVL_DEBUG2, " - sack permitted");
+	for (i = 0; i < seg->nsack; i++) {
+		log_msg(LOG_DEFAULT, LVL_DEBUG2, " - sack = %" PRIu32 "-%" PRIu32,
+		    seg->sack[i].start, seg->sack[i].end);
+	}
 }
 
 /**
@@ -42,6 +42,11 @@
 
 #define IP_PROTO_TCP  6
 
+/** Largest value of the (unscaled) window field */
+#define TCP_WND_MAX  0xffff
+/** Largest window scale shift count allowed by RFC 7323 */
+#define TCP_WSCALE_MAX  14
+
 /** TCP Header (fixed part) */
 typedef struct {
 	/** Source port */
@@ -109,9 +114,24 @@ enum opt_kind {
 	/** No-operation */
 	OPT_NOP			= 1,
 	/** Maximum segment size */
-	OPT_MAX_SEG_SIZE	= 2
+	OPT_MAX_SEG_SIZE	= 2,
+	/** Window scale (RFC 7323) */
+	OPT_WINDOW_SCALE	= 3,
+	/** SACK permitted (RFC 2018) */
+	OPT_SACK_PERMITTED	= 4,
+	/** SACK (RFC 2018) */
+	OPT_SACK		= 5
 };
 
+/** Length of window scale option */
+#define OPT_WINDOW_SCALE_LEN  3
+/** Length of SACK permitted option */
+#define OPT_SACK_PERMITTED_LEN  2
+/** Length of SACK option header (kind and length) */
+#define OPT_SACK_HDR_LEN  2
+/** Length of one SACK block */
+#define OPT_SACK_BLOCK_LEN  8
+
 #endif
 
 /** @}
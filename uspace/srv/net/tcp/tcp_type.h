@@ -36,13 +36,16 @@
 #define TCP_TYPE_H
 
 #include <adt/list.h>
+#include <adt/odict.h>
 #include <async.h>
+#include <errno.h>
 #include <stdbool.h>
 #include <fibril.h>
 #include <fibril_synch.h>
 #include <refcount.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <time.h>
 #include <inet/addr.h>
 #include <inet/endpoint.h>
 
@@ -120,10 +123,28 @@ typedef enum {
 	CTL_ACK		= 0x8
 } tcp_control_t;
 
+/** Maximum number of SACK blocks carried by a segment */
+#define TCP_SACK_BLOCKS_MAX  4
+
+/** Block of contiguous sequence space (SACK block) */
+typedef struct {
+	/** First sequence number in block */
+	uint32_t start;
+	/** Sequence number immediately following the block */
+	uint32_t end;
+} tcp_sack_block_t;
+
 /** Connection incoming segments queue */
 typedef struct {
 	struct tcp_conn *conn;
-	list_t list;
+	/** Segments ordered by sequence number (tcp_iqueue_entry_t) */
+	odict_t segs;
+	/** Disjoint ranges of queued sequence space (tcp_iqueue_range_t) */
+	odict_t ranges;
+	/** Sequence numbers of most recently received ranges, newest first */
+	uint32_t recent[TCP_SACK_BLOCKS_MAX];
+	/** Number of valid entries in @c recent */
+	size_t nrecent;
 } tcp_iqueue_t;
 
 /** Active or passive connection */
@@ -168,6 +189,16 @@ typedef struct {
 	uint32_t wnd;
 	/** Segment urgent pointer */
 	uint32_t up;
+	/** Segment carries window scale option */
+	bool has_wscale;
+	/** Window scale shift count (if @c has_wscale is true) */
+	uint8_t wscale;
+	/** Segment carries SACK-permitted option */
+	bool sack_perm;
+	/** Number of SACK blocks */
+	size_t nsack;
+	/** SACK blocks */
+	tcp_sack_block_t sack[TCP_SACK_BLOCKS_MAX];
 
 	/** Segment data, may be moved when trimming segment */
 	void *data;
@@ -191,22 +222,55 @@ typedef struct {
 /** NCSim queue entry */
 typedef struct {
 	link_t link;
-	usec_t delay;
+	/** Time when segment should be delivered */
+	struct timespec due;
 	inet_ep2_t epp;
 	tcp_segment_t *seg;
 } tcp_squeue_entry_t;
 
+/** NCSim network conditions profile */
+typedef struct {
+	/** Percentage of segments dropped */
+	unsigned drop_pct;
+	/** Minimum one-way delay */
+	usec_t delay_min;
+	/** Maximum one-way delay */
+	usec_t delay_max;
+	/**
+	 * Drop every n-th segment carrying new data, 0 for none. Segments
+	 * carrying only data seen before are never dropped this way.
+	 */
+	unsigned drop_nth;
+	/** Maximum number of segments dropped due to @c drop_nth */
+	unsigned drop_max;
+} tcp_ncsim_profile_t;
+
 /** Incoming queue entry */
 typedef struct {
-	link_t link;
+	odlink_t lsegs;
+	/** Sequence number of @c seg at the time it was inserted */
+	uint32_t seq;
 	tcp_segment_t *seg;
 } tcp_iqueue_entry_t;
 
+/** Incoming queue range of contiguous sequence space */
+typedef struct {
+	odlink_t lranges;
+	/** First sequence number in range */
+	uint32_t start;
+	/** Sequence number immediately following the range */
+	uint32_t end;
+} tcp_iqueue_range_t;
+
 /** Retransmission queue entry */
 typedef struct {
 	link_t link;
 	tcp_conn_t *conn;
 	tcp_segment_t *seg;
+	/** Segment has been selectively acknowledged by peer */
+	bool sacked;
+	/** Segment has been retransmitted during current loss recovery */
+	bool rexmit;
 } tcp_tqueue_entry_t;
 
 /** Retransmission queue callbacks */
@@ -227,6 +291,46 @@ typedef struct {
 	tcp_tqueue_cb_t *cb;
 } tcp_tqueue_t;
 
+/** Round-trip time estimator (RFC 6298) */
+typedef struct {
+	/** Smoothed round-trip time */
+	usec_t srtt;
+	/** Round-trip time variation */
+	usec_t rttvar;
+	/** Retransmission timeout */
+	usec_t rto;
+	/** A segment is being timed */
+	bool timing;
+	/** Timed segment is acknowledged when SND.UNA reaches this */
+	uint32_t seq;
+	/** Time when timed segment was sent */
+	struct timespec ts;
+} tcp_rtt_t;
+
+/** Congestion avoidance state */
+typedef enum {
+	/** Normal operation */
+	ca_open,
+	/** Fast recovery after fast retransmit */
+	ca_recovery,
+	/** Recovery after retransmission timeout */
+	ca_loss
+} tcp_ca_state_t;
+
+/** Congestion control algorithm */
+typedef struct {
+	/** Algorithm name */
+	const char *name;
+	/** Set up algorithm state for new connection */
+	errno_t (*init)(struct tcp_conn *);
+	/** Free algorithm state */
+	void (*fini)(struct tcp_conn *);
+	/** Grow congestion window in congestion avoidance */
+	void (*cong_avoid)(struct tcp_conn *, uint32_t);
+	/** Loss detected, return new slow start threshold */
+	uint32_t (*ssthresh)(struct tcp_conn *);
+} tcp_cc_ops_t;
+
 /** Connection */
 struct tcp_conn {
 	char *name;
@@ -275,6 +379,8 @@ struct tcp_conn {
 	uint8_t *rcv_buf;
 	/** Receive buffer size */
 	size_t rcv_buf_size;
+	/** Receive buffer index of first used byte */
+	size_t rcv_buf_head;
 	/** Receive buffer number of bytes used */
 	size_t rcv_buf_used;
 	/** Receive buffer contains FIN */
@@ -286,6 +392,8 @@ struct tcp_conn {
 	uint8_t *snd_buf;
 	/** Send buffer size */
 	size_t snd_buf_size;
+	/** Send buffer index of first used byte */
+	size_t snd_buf_head;
 	/** Send buffer number of bytes used */
 	size_t snd_buf_used;
 	/** Send buffer contains FIN */
@@ -316,6 +424,54 @@ struct tcp_conn {
 	uint32_t rcv_up;
 	/** Initial receive sequence number */
 	uint32_t irs;
+
+	/** Window scaling is offered (before SYN exchange) or in use */
+	bool wscale;
+	/** Shift count applied to window we receive from peer */
+	uint8_t snd_wscale;
+	/** Shift count applied to window we advertise to peer */
+	uint8_t rcv_wscale;
+
+	/** Selective acknowledgements are offered (before SYN exchange) or in use */
+	bool sack;
+
+	/** Start of current receive buffer tuning epoch */
+	struct timespec rcv_tune_ts;
+	/** Tuning epoch ends when RCV.NXT reaches this sequence number */
+	uint32_t rcv_tune_seq;
+	/** Number of bytes received by user during current tuning epoch */
+	size_t rcv_tune_copied;
+
+	/** Round-trip time estimator */
+	tcp_rtt_t rtt;
+
+	/** Sender maximum segment size */
+	uint32_t smss;
+	/** Congestion control algorithm */
+	tcp_cc_ops_t *cc;
+	/** Congestion control algorithm state */
+	void *cc_arg;
+	/** Congestion avoidance state */
+	tcp_ca_state_t ca_state;
+	/** Congestion window */
+	uint32_t cwnd;
+	/** Slow start threshold */
+	uint32_t ssthresh;
+	/** Bytes acknowledged towards next congestion window increase */
+	uint32_t cwnd_cnt;
+	/** Number of consecutive duplicate ACKs */
+	unsigned dupacks;
+	/** SND.NXT at the time loss recovery started */
+	uint32_t recover;
+	/** Estimate of bytes in flight during SACK-based loss recovery */
+	uint32_t pipe;
+
+	/** Number of loss recovery episodes started by fast retransmit */
+	unsigned fast_rexmits;
+	/** Number of segments retransmitted during SACK-based recovery */
+	unsigned sack_rexmits;
+	/** Number of retransmission timer expirations */
+	unsigned rto_expiries;
 };
 
 /** Continuation of processing.
@@ -0,0 +1,267 @@
+/*
+ * Copyright (c) 2026 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <errno.h>
+#include <io/log.h>
+#include <pcut/pcut.h>
+#include <stdlib.h>
+
+#include "../cc.h"
+#include "../tcp_type.h"
+
+PCUT_INIT;
+
+PCUT_TEST_SUITE(cc);
+
+static tcp_conn_t *test_cc_conn_create(const char *);
+static void test_cc_conn_destroy(tcp_conn_t *);
+
+PCUT_TEST_BEFORE
+{
+	errno_t rc;
+
+	/* We will be calling functions that perform logging */
+	rc = log_init("test-tcp");
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+}
+
+PCUT_TEST_AFTER
+{
+	(void) tcp_cc_set_default("cubic");
+}
+
+/** Test selecting unknown algorithm */
+PCUT_TEST(set_default_unknown)
+{
+	PCUT_ASSERT_ERRNO_VAL(ENOENT, tcp_cc_set_default("foo"));
+	PCUT_ASSERT_ERRNO_VAL(EOK, tcp_cc_set_default("newreno"));
+}
+
+/** Test slow start and congestion avoidance with NewReno */
+PCUT_TEST(newreno_grow)
+{
+	tcp_conn_t *conn;
+	uint32_t cwnd;
+
+	conn = test_cc_conn_create("newreno");
+	PCUT_ASSERT_NOT_NULL(conn);
+
+	/* Slow start grows by one SMSS per ACK */
+	cwnd = conn->cwnd;
+	PCUT_ASSERT_FALSE(tcp_cc_ack(conn, conn->smss));
+	PCUT_ASSERT_INT_EQUALS(cwnd + conn->smss, conn->cwnd);
+
+	/* Congestion avoidance grows by one SMSS per window */
+	conn->ssthresh = conn->cwnd;
+	cwnd = conn->cwnd;
+	PCUT_ASSERT_FALSE(tcp_cc_ack(conn, cwnd - 1));
+	PCUT_ASSERT_INT_EQUALS(cwnd, conn->cwnd);
+	PCUT_ASSERT_FALSE(tcp_cc_ack(conn, 1));
+	PCUT_ASSERT_INT_EQUALS(cwnd + conn->smss, conn->cwnd);
+
+	test_cc_conn_destroy(conn);
+}
+
+/** Test fast retransmit and fast recovery with NewReno */
+PCUT_TEST(newreno_fast_recovery)
+{
+	tcp_conn_t *conn;
+	uint32_t smss;
+
+	conn = test_cc_conn_create("newreno");
+	PCUT_ASSERT_NOT_NULL(conn);
+	smss = conn->smss;
+
+	conn->snd_una = 1000;
+	conn->snd_nxt = 1000 + 10 * smss;
+	conn->cwnd = 10 * smss;
+
+	/* Third duplicate ACK triggers fast retransmit */
+	PCUT_ASSERT_FALSE(tcp_cc_dupack(conn));
+	PCUT_ASSERT_FALSE(tcp_cc_dupack(conn));
+	PCUT_ASSERT_TRUE(tcp_cc_dupack(conn));
+	PCUT_ASSERT_INT_EQUALS(ca_recovery, conn->ca_state);
+	PCUT_ASSERT_INT_EQUALS(5 * smss, conn->ssthresh);
+	PCUT_ASSERT_INT_EQUALS(8 * smss, conn->cwnd);
+
+	/* Further duplicate ACKs inflate the window */
+	PCUT_ASSERT_FALSE(tcp_cc_dupack(conn));
+	PCUT_ASSERT_INT_EQUALS(9 * smss, conn->cwnd);
+
+	/* Partial ACK asks for retransmission of next segment */
+	conn->snd_una += smss;
+	PCUT_ASSERT_TRUE(tcp_cc_ack(conn, smss));
+	PCUT_ASSERT_INT_EQUALS(ca_recovery, conn->ca_state);
+
+	/* Full ACK ends recovery with deflated window */
+	conn->snd_una = conn->snd_nxt;
+	PCUT_ASSERT_FALSE(tcp_cc_ack(conn, 9 * smss));
+	PCUT_ASSERT_INT_EQUALS(ca_open, conn->ca_state);
+	PCUT_ASSERT_TRUE(conn->cwnd <= conn->ssthresh);
+
+	test_cc_conn_destroy(conn);
+}
+
+/** Test fast recovery with SACK, governed by the pipe estimate */
+PCUT_TEST(sack_fast_recovery)
+{
+	tcp_conn_t *conn;
+	uint32_t smss;
+
+	conn = test_cc_conn_create("newreno");
+	PCUT_ASSERT_NOT_NULL(conn);
+	smss = conn->smss;
+	conn->sack = true;
+
+	conn->snd_una = 1000;
+	conn->snd_nxt = 1000 + 10 * smss;
+	conn->cwnd = 10 * smss;
+
+	PCUT_ASSERT_FALSE(tcp_cc_dupack(conn));
+	PCUT_ASSERT_FALSE(tcp_cc_dupack(conn));
+	PCUT_ASSERT_TRUE(tcp_cc_dupack(conn));
+	PCUT_ASSERT_INT_EQUALS(ca_recovery, conn->ca_state);
+	PCUT_ASSERT_INT_EQUALS(5 * smss, conn->cwnd);
+
+	/* Window is not inflated by duplicate ACKs */
+	PCUT_ASSERT_FALSE(tcp_cc_dupack(conn));
+	PCUT_ASSERT_INT_EQUALS(5 * smss, conn->cwnd);
+
+	/* Nor deflated by partial ACK */
+	conn->snd_una += smss;
+	PCUT_ASSERT_TRUE(tcp_cc_ack(conn, smss));
+	PCUT_ASSERT_INT_EQUALS(5 * smss, conn->cwnd);
+
+	conn->snd_una = conn->snd_nxt;
+	PCUT_ASSERT_FALSE(tcp_cc_ack(conn, 9 * smss));
+	PCUT_ASSERT_INT_EQUALS(ca_open, conn->ca_state);
+
+	test_cc_conn_destroy(conn);
+}
+
+/** Test retransmission timeout */
+PCUT_TEST(timeout)
+{
+	tcp_conn_t *conn;
+	uint32_t ssthresh;
+
+	conn = test_cc_conn_create("newreno");
+	PCUT_ASSERT_NOT_NULL(conn);
+
+	conn->snd_una = 1000;
+	conn->snd_nxt = 1000 + 10 * conn->smss;
+
+	tcp_cc_timeout(conn);
+	PCUT_ASSERT_INT_EQUALS(ca_loss, conn->ca_state);
+	PCUT_ASSERT_INT_EQUALS(conn->smss, conn->cwnd);
+	ssthresh = conn->ssthresh;
+
+	/* Repeated timeout does not reduce ssthresh further */
+	tcp_cc_timeout(conn);
+	PCUT_ASSERT_INT_EQUALS(ssthresh, conn->ssthresh);
+
+	/* Duplicate ACKs are ignored while recovering from timeout */
+	PCUT_ASSERT_FALSE(tcp_cc_dupack(conn));
+	PCUT_ASSERT_FALSE(tcp_cc_dupack(conn));
+	PCUT_ASSERT_FALSE(tcp_cc_dupack(conn));
+
+	conn->snd_una = conn->snd_nxt;
+	PCUT_ASSERT_FALSE(tcp_cc_ack(conn, conn->smss));
+	PCUT_ASSERT_INT_EQUALS(ca_open, conn->ca_state);
+
+	test_cc_conn_destroy(conn);
+}
+
+/** Test CUBIC window reduction and growth */
+PCUT_TEST(cubic_loss_grow)
+{
+	tcp_conn_t *conn;
+	uint32_t cwnd;
+	int i;
+
+	conn = test_cc_conn_create("cubic");
+	PCUT_ASSERT_NOT_NULL(conn);
+
+	conn->snd_una = 1000;
+	conn->snd_nxt = 1000 + 100 * conn->smss;
+	conn->cwnd = 100 * conn->smss;
+
+	/* Multiplicative decrease by beta = 0.7 */
+	PCUT_ASSERT_FALSE(tcp_cc_dupack(conn));
+	PCUT_ASSERT_FALSE(tcp_cc_dupack(conn));
+	PCUT_ASSERT_TRUE(tcp_cc_dupack(conn));
+	PCUT_ASSERT_INT_EQUALS(70 * conn->smss, conn->ssthresh);
+
+	conn->snd_una = conn->snd_nxt;
+	PCUT_ASSERT_FALSE(tcp_cc_ack(conn, conn->smss));
+	PCUT_ASSERT_INT_EQUALS(ca_open, conn->ca_state);
+
+	/* Skip slow start back to ssthresh */
+	conn->cwnd = conn->ssthresh;
+
+	/* Window grows slowly in congestion avoidance */
+	cwnd = conn->cwnd;
+	for (i = 0; i < 100; i++)
+		(void) tcp_cc_ack(conn, conn->smss);
+
+	PCUT_ASSERT_TRUE(conn->cwnd > cwnd);
+	PCUT_ASSERT_TRUE(conn->cwnd <= 2 * cwnd);
+
+	test_cc_conn_destroy(conn);
+}
+
+static tcp_conn_t *test_cc_conn_create(const char *alg)
+{
+	tcp_conn_t *conn;
+	errno_t rc;
+
+	rc = tcp_cc_set_default(alg);
+	if (rc != EOK)
+		return NULL;
+
+	conn = calloc(1, sizeof(tcp_conn_t));
+	if (conn == NULL)
+		return NULL;
+
+	conn->name = (char *) "test";
+	rc = tcp_cc_init(conn);
+	if (rc != EOK) {
+		free(conn);
+		return NULL;
+	}
+
+	return conn;
+}
+
+static void test_cc_conn_destroy(tcp_conn_t *conn)
+{
+	tcp_cc_fini(conn);
+	free(conn);
+}
+
+PCUT_EXPORT(cc);
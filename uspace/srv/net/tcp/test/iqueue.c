@@ -57,6 +57,7 @@ PCUT_TEST(empty_queue)
 	rc = tcp_iqueue_get_ready_seg(&iqueue, &rseg);
 	PCUT_ASSERT_ERRNO_VAL(ENOENT, rc);
 
+	tcp_iqueue_fini(&iqueue);
 	tcp_conn_delete(conn);
 }
 
@@ -100,6 +101,7 @@ PCUT_TEST(one_segment)
 	rc = tcp_iqueue_get_ready_seg(&iqueue, &rseg);
 	PCUT_ASSERT_ERRNO_VAL(ENOENT, rc);
 	tcp_iqueue_remove_seg(&iqueue, seg);
+	tcp_iqueue_fini(&iqueue);
 
 	tcp_segment_delete(seg);
 	free(data);
@@ -168,6 +170,7 @@ PCUT_TEST(two_segments)
 
 	rc = tcp_iqueue_get_ready_seg(&iqueue, &rseg);
 	PCUT_ASSERT_ERRNO_VAL(ENOENT, rc);
+	tcp_iqueue_fini(&iqueue);
 
 	tcp_segment_delete(seg1);
 	tcp_segment_delete(seg2);
@@ -175,4 +178,121 @@ PCUT_TEST(two_segments)
 	tcp_conn_delete(conn);
 }
 
+/** Create data segment for testing */
+static tcp_segment_t *test_iqueue_seg(uint32_t seq, size_t size)
+{
+	tcp_segment_t *seg;
+	void *data;
+
+	data = calloc(size, 1);
+	if (data == NULL)
+		return NULL;
+
+	seg = tcp_segment_make_data(0, data, size);
+	free(data);
+	if (seg == NULL)
+		return NULL;
+
+	seg->seq = seq;
+	return seg;
+}
+
+/** Test generating SACK blocks from out-of-order segments */
+PCUT_TEST(sack_blocks)
+{
+	tcp_conn_t *conn;
+	tcp_iqueue_t iqueue;
+	inet_ep2_t epp;
+	tcp_sack_block_t blocks[TCP_SACK_BLOCKS_MAX];
+	tcp_segment_t *seg, *rseg;
+	size_t nblocks;
+	errno_t rc;
+
+	inet_ep2_init(&epp);
+	conn = tcp_conn_new(&epp);
+	PCUT_ASSERT_NOT_NULL(conn);
+
+	conn->rcv_nxt = 1000;
+	conn->rcv_wnd = 10000;
+
+	tcp_iqueue_init(&iqueue, conn);
+	nblocks = tcp_iqueue_sack_blocks(&iqueue, blocks, TCP_SACK_BLOCKS_MAX);
+	PCUT_ASSERT_INT_EQUALS(0, nblocks);
+
+	seg = test_iqueue_seg(2000, 100);
+	PCUT_ASSERT_NOT_NULL(seg);
+	tcp_iqueue_insert_seg(&iqueue, seg);
+
+	seg = test_iqueue_seg(3000, 100);
+	PCUT_ASSERT_NOT_NULL(seg);
+	tcp_iqueue_insert_seg(&iqueue, seg);
+
+	/* Adjacent segment is merged, its block is reported first */
+	seg = test_iqueue_seg(2100, 100);
+	PCUT_ASSERT_NOT_NULL(seg);
+	tcp_iqueue_insert_seg(&iqueue, seg);
+
+	nblocks = tcp_iqueue_sack_blocks(&iqueue, blocks, TCP_SACK_BLOCKS_MAX);
+	PCUT_ASSERT_INT_EQUALS(2, nblocks);
+	PCUT_ASSERT_INT_EQUALS(2000, blocks[0].start);
+	PCUT_ASSERT_INT_EQUALS(2200, blocks[0].end);
+	PCUT_ASSERT_INT_EQUALS(3000, blocks[1].start);
+	PCUT_ASSERT_INT_EQUALS(3100, blocks[1].end);
+
+	/* In-sequence data is not reported once it has been processed */
+	seg = test_iqueue_seg(1000, 100);
+	PCUT_ASSERT_NOT_NULL(seg);
+	tcp_iqueue_insert_seg(&iqueue, seg);
+
+	rc = tcp_iqueue_get_ready_seg(&iqueue, &rseg);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_EQUALS(seg, rseg);
+	tcp_segment_delete(rseg);
+	conn->rcv_nxt = 1100;
+
+	nblocks = tcp_iqueue_sack_blocks(&iqueue, blocks, 1);
+	PCUT_ASSERT_INT_EQUALS(1, nblocks);
+	PCUT_ASSERT_INT_EQUALS(2000, blocks[0].start);
+	PCUT_ASSERT_INT_EQUALS(2200, blocks[0].end);
+
+	tcp_iqueue_fini(&iqueue);
+	tcp_conn_delete(conn);
+}
+
+/** Test detecting segments that carry only data already queued */
+PCUT_TEST(seg_covered)
+{
+	tcp_conn_t *conn;
+	tcp_iqueue_t iqueue;
+	inet_ep2_t epp;
+	tcp_segment_t *seg, *dseg;
+
+	inet_ep2_init(&epp);
+	conn = tcp_conn_new(&epp);
+	PCUT_ASSERT_NOT_NULL(conn);
+
+	conn->rcv_nxt = 1000;
+	conn->rcv_wnd = 10000;
+
+	tcp_iqueue_init(&iqueue, conn);
+
+	seg = test_iqueue_seg(2000, 200);
+	PCUT_ASSERT_NOT_NULL(seg);
+	tcp_iqueue_insert_seg(&iqueue, seg);
+
+	dseg = test_iqueue_seg(2050, 100);
+	PCUT_ASSERT_NOT_NULL(dseg);
+	PCUT_ASSERT_TRUE(tcp_iqueue_seg_covered(&iqueue, dseg));
+
+	dseg->seq = 2150;
+	PCUT_ASSERT_FALSE(tcp_iqueue_seg_covered(&iqueue, dseg));
+
+	dseg->seq = 1950;
+	PCUT_ASSERT_FALSE(tcp_iqueue_seg_covered(&iqueue, dseg));
+
+	tcp_segment_delete(dseg);
+	tcp_iqueue_fini(&iqueue);
+	tcp_conn_delete(conn);
+}
+
 PCUT_EXPORT(iqueue);
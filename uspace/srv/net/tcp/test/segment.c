@@ -66,6 +66,29 @@ PCUT_TEST(data_seg_mkdel)
 	free(data);
 }
 
+/** Test creating data segment from a ring buffer */
+PCUT_TEST(data_seg_ring)
+{
+	tcp_segment_t *seg;
+	uint8_t buf[8];
+	uint8_t text[5];
+	size_t i;
+
+	for (i = 0; i < sizeof(buf); i++)
+		buf[i] = (uint8_t) i;
+
+	/* Text wraps around the end of the buffer */
+	seg = tcp_segment_make_data_ring(0, buf, sizeof(buf), 6, 5);
+	PCUT_ASSERT_NOT_NULL(seg);
+
+	PCUT_ASSERT_INT_EQUALS(5, tcp_segment_text_size(seg));
+	tcp_segment_text_copy(seg, text, sizeof(text));
+	for (i = 0; i < sizeof(text); i++)
+		PCUT_ASSERT_INT_EQUALS((6 + i) % sizeof(buf), text[i]);
+
+	tcp_segment_delete(seg);
+}
+
 /** Test create/duplicate/destroy control segment */
 PCUT_TEST(ctrl_seg_dup)
 {
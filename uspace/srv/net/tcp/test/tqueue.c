@@ -31,6 +31,7 @@
 #include <pcut/pcut.h>
 
 #include "../conn.h"
+#include "../segment.h"
 #include "../tqueue.h"
 
 PCUT_INIT;
@@ -43,6 +44,7 @@ enum {
 
 static int seg_cnt;
 static tcp_segment_t *trans_seg[test_seg_max];
+static uint32_t trans_seq[test_seg_max];
 
 static void tqueue_test_transmit_seg(inet_ep2_t *, tcp_segment_t *);
 
@@ -190,8 +192,10 @@ PCUT_TEST(new_data_small_win)
 	PCUT_ASSERT_EQUALS(15, conn->snd_nxt);
 	PCUT_ASSERT_EQUALS(25, conn->snd_buf_used);
 	PCUT_ASSERT_FALSE(conn->snd_buf_fin);
-	for (i = 0; i < 25; i++)
-		PCUT_ASSERT_INT_EQUALS(5 + i, conn->snd_buf[i]);
+	for (i = 0; i < 25; i++) {
+		PCUT_ASSERT_INT_EQUALS(5 + i, conn->snd_buf[(conn->snd_buf_head +
+		    i) % conn->snd_buf_size]);
+	}
 
 	tcp_conn_delete(conn);
 	PCUT_ASSERT_EQUALS(1, seg_cnt);
@@ -253,8 +257,87 @@ PCUT_TEST(ack_received)
 	tcp_conn_delete(conn);
 }
 
+/** Test selective retransmission driven by SACK information */
+PCUT_TEST(sack_retransmit)
+{
+	tcp_conn_t *conn;
+	tcp_segment_t *aseg;
+	tcp_tqueue_entry_t *tqe;
+	inet_ep2_t epp;
+	link_t *link;
+	uint32_t smss;
+	int i;
+
+	/* XXX tqueue can only be created via tcp_conn_new */
+	inet_ep2_init(&epp);
+	conn = tcp_conn_new(&epp);
+	PCUT_ASSERT_NOT_NULL(conn);
+	PCUT_ASSERT_TRUE(conn->sack);
+	smss = conn->smss;
+
+	conn->cstate = st_established;
+	conn->snd_una = 1000;
+	conn->snd_nxt = 1000;
+	conn->snd_wnd = 65535;
+
+	/* Redirect segment transmission */
+	conn->retransmit.cb = &tqueue_test_cb;
+	seg_cnt = 0;
+
+	tcp_conn_lock(conn);
+
+	/* Send five full-sized segments */
+	conn->snd_buf_used = 5 * smss;
+	conn->snd_buf_fin = false;
+	tcp_tqueue_new_data(conn);
+	PCUT_ASSERT_INT_EQUALS(5, seg_cnt);
+	PCUT_ASSERT_INT_EQUALS(1000 + 5 * smss, conn->snd_nxt);
+
+	/* Peer received all but the first segment */
+	aseg = tcp_segment_make_ctrl(CTL_ACK);
+	PCUT_ASSERT_NOT_NULL(aseg);
+	aseg->ack = 1000;
+	aseg->nsack = 1;
+	aseg->sack[0].start = 1000 + smss;
+	aseg->sack[0].end = 1000 + 5 * smss;
+	tcp_tqueue_sack_received(conn, aseg);
+	tcp_segment_delete(aseg);
+
+	i = 0;
+	link = list_first(&conn->retransmit.list);
+	while (link != NULL) {
+		tqe = list_get_instance(link, tcp_tqueue_entry_t, link);
+		PCUT_ASSERT_EQUALS(i > 0, tqe->sacked);
+		link = list_next(link, &conn->retransmit.list);
+		++i;
+	}
+
+	/* Only the missing segment is retransmitted */
+	for (i = 0; i < 3; i++)
+		tcp_tqueue_dupack(conn);
+
+	PCUT_ASSERT_INT_EQUALS(ca_recovery, conn->ca_state);
+	PCUT_ASSERT_INT_EQUALS(6, seg_cnt);
+	PCUT_ASSERT_INT_EQUALS(1000, trans_seq[5]);
+
+	/* Further duplicate ACKs do not cause more retransmissions */
+	tcp_tqueue_dupack(conn);
+	PCUT_ASSERT_INT_EQUALS(6, seg_cnt);
+
+	/* Cumulative ACK ends recovery */
+	conn->snd_una = conn->snd_nxt;
+	tcp_tqueue_ack_received(conn);
+	PCUT_ASSERT_INT_EQUALS(ca_open, conn->ca_state);
+	PCUT_ASSERT_TRUE(list_empty(&conn->retransmit.list));
+
+	tcp_conn_reset(conn);
+	tcp_conn_unlock(conn);
+	tcp_conn_delete(conn);
+}
+
 static void tqueue_test_transmit_seg(inet_ep2_t *epp, tcp_segment_t *seg)
 {
+	trans_seq[seg_cnt] = seg->seq;
 	trans_seg[seg_cnt++] = seg;
 }
 
@@ -27,11 +27,17 @@
  */
 
 #include <errno.h>
+#include <fibril.h>
+#include <fibril_synch.h>
 #include <inet/endpoint.h>
 #include <io/log.h>
+#include <macros.h>
+#include <mem.h>
 #include <pcut/pcut.h>
+#include <stdlib.h>
 
 #include "../conn.h"
+#include "../ncsim.h"
 #include "../rqueue.h"
 #include "../ucall.h"
 
@@ -42,6 +48,20 @@ PCUT_TEST_SUITE(ucall);
 static void test_cstate_change(tcp_conn_t *, void *, tcp_cstate_t);
 static void test_conns_establish(tcp_conn_t **, tcp_conn_t **);
 static void test_conns_tear_down(tcp_conn_t *, tcp_conn_t *);
+static void test_transfer(tcp_conn_t *, tcp_conn_t *, size_t);
+static void test_transfer_window(tcp_conn_t *, tcp_conn_t *, size_t);
+static errno_t test_receiver_fibril(void *);
+
+/** Receiving side of a transfer running in its own fibril */
+typedef struct {
+	tcp_conn_t *conn;
+	uint8_t *buf;
+	size_t size;
+	size_t rcvd;
+	bool done;
+	fibril_mutex_t lock;
+	fibril_condvar_t cv;
+} test_receiver_t;
 
 static tcp_rqueue_cb_t test_rqueue_cb = {
 	.seg_received = tcp_as_segment_arrived
@@ -235,6 +255,70 @@ PCUT_TEST(conn_est_close_simult)
 	test_conns_tear_down(cconn, sconn);
 }
 
+/** Test transferring data over a link with delay and random loss. */
+PCUT_TEST(transfer_lossy)
+{
+	tcp_conn_t *cconn, *sconn;
+	tcp_ncsim_profile_t profile;
+
+	/* 5 % loss, 1-5 ms one-way delay */
+	memset(&profile, 0, sizeof(profile));
+	profile.drop_pct = 5;
+	profile.delay_min = 1000;
+	profile.delay_max = 5000;
+
+	tcp_ncsim_init();
+	tcp_ncsim_fibril_start();
+	tcp_ncsim_set_profile(&profile);
+
+	test_conns_establish(&cconn, &sconn);
+	test_transfer(cconn, sconn, 64 * 1024);
+
+	tcp_ncsim_set_profile(NULL);
+	test_conns_tear_down(cconn, sconn);
+	tcp_ncsim_fini();
+}
+
+/** Test recovering from losses with selective acknowledgements.
+ *
+ * The sender keeps a full window in flight and every 20th new data segment
+ * is lost. Each loss must be detected by duplicate ACKs and repaired by
+ * retransmitting the missing segments while the rest of the window keeps
+ * flowing, without waiting for the retransmission timer.
+ */
+PCUT_TEST(sack_recovery)
+{
+	tcp_conn_t *cconn, *sconn;
+	tcp_ncsim_profile_t profile;
+
+	/* Fixed 2 ms one-way delay keeps segments in order */
+	memset(&profile, 0, sizeof(profile));
+	profile.delay_min = 2000;
+	profile.delay_max = 2000;
+	profile.drop_nth = 20;
+	profile.drop_max = 4;
+
+	tcp_ncsim_init();
+	tcp_ncsim_fibril_start();
+	tcp_ncsim_set_profile(&profile);
+
+	test_conns_establish(&cconn, &sconn);
+	PCUT_ASSERT_TRUE(cconn->sack);
+	PCUT_ASSERT_TRUE(sconn->sack);
+
+	test_transfer_window(cconn, sconn, 256 * 1024);
+
+	tcp_conn_lock(cconn);
+	PCUT_ASSERT_TRUE(cconn->fast_rexmits >= 1);
+	PCUT_ASSERT_TRUE(cconn->sack_rexmits >= 4);
+	PCUT_ASSERT_INT_EQUALS(0, cconn->rto_expiries);
+	tcp_conn_unlock(cconn);
+
+	tcp_ncsim_set_profile(NULL);
+	test_conns_tear_down(cconn, sconn);
+	tcp_ncsim_fini();
+}
+
 static void test_cstate_change(tcp_conn_t *conn, void *arg,
     tcp_cstate_t old_state)
 {
@@ -304,6 +388,146 @@ static void test_conns_establish(tcp_conn_t **rcconn, tcp_conn_t **rsconn)
 	*rsconn = sconn;
 }
 
+/** Transfer data from client to server and verify it arrived intact.
+ *
+ * @param cconn		Client connection (sender)
+ * @param sconn		Server connection (receiver)
+ * @param size		Number of bytes to transfer
+ */
+static void test_transfer(tcp_conn_t *cconn, tcp_conn_t *sconn, size_t size)
+{
+	uint8_t *sbuf, *rbuf;
+	size_t chunk;
+	size_t sent, rcvd, n;
+	xflags_t xflags;
+	tcp_error_t trc;
+	size_t i;
+
+	chunk = 4096;
+
+	sbuf = malloc(size);
+	PCUT_ASSERT_NOT_NULL(sbuf);
+	rbuf = malloc(size);
+	PCUT_ASSERT_NOT_NULL(rbuf);
+
+	for (i = 0; i < size; i++)
+		sbuf[i] = (uint8_t) (i * 7);
+
+	sent = 0;
+	rcvd = 0;
+	while (sent < size) {
+		trc = tcp_uc_send(cconn, sbuf + sent, min(chunk, size - sent),
+		    0);
+		PCUT_ASSERT_INT_EQUALS(TCP_EOK, trc);
+		sent += min(chunk, size - sent);
+
+		/* Lost segments are recovered by retransmission */
+		while (rcvd < sent) {
+			trc = tcp_uc_receive(sconn, rbuf + rcvd, size - rcvd,
+			    &n, &xflags);
+			if (trc == TCP_EAGAIN) {
+				fibril_usleep(1000);
+				continue;
+			}
+
+			PCUT_ASSERT_INT_EQUALS(TCP_EOK, trc);
+			rcvd += n;
+		}
+	}
+
+	PCUT_ASSERT_INT_EQUALS(size, rcvd);
+	PCUT_ASSERT_INT_EQUALS(0, memcmp(sbuf, rbuf, size));
+
+	free(sbuf);
+	free(rbuf);
+}
+
+/** Transfer data from client to server with a full window in flight.
+ *
+ * The server receives in a separate fibril, so the client can hand
+ * over all data at once and the transfer is limited by the windows only.
+ *
+ * @param cconn		Client connection (sender)
+ * @param sconn		Server connection (receiver)
+ * @param size		Number of bytes to transfer
+ */
+static void test_transfer_window(tcp_conn_t *cconn, tcp_conn_t *sconn,
+    size_t size)
+{
+	test_receiver_t rcv;
+	uint8_t *sbuf;
+	tcp_error_t trc;
+	fid_t fid;
+	size_t i;
+
+	sbuf = malloc(size);
+	PCUT_ASSERT_NOT_NULL(sbuf);
+
+	for (i = 0; i < size; i++)
+		sbuf[i] = (uint8_t) (i * 7);
+
+	rcv.conn = sconn;
+	rcv.buf = malloc(size);
+	PCUT_ASSERT_NOT_NULL(rcv.buf);
+	rcv.size = size;
+	rcv.rcvd = 0;
+	rcv.done = false;
+	fibril_mutex_initialize(&rcv.lock);
+	fibril_condvar_initialize(&rcv.cv);
+
+	fid = fibril_create(test_receiver_fibril, &rcv);
+	PCUT_ASSERT_TRUE(fid != 0);
+	fibril_add_ready(fid);
+
+	trc = tcp_uc_send(cconn, sbuf, size, 0);
+	PCUT_ASSERT_INT_EQUALS(TCP_EOK, trc);
+
+	fibril_mutex_lock(&rcv.lock);
+	while (!rcv.done)
+		fibril_condvar_wait(&rcv.cv, &rcv.lock);
+	fibril_mutex_unlock(&rcv.lock);
+
+	PCUT_ASSERT_INT_EQUALS(size, rcv.rcvd);
+	PCUT_ASSERT_INT_EQUALS(0, memcmp(sbuf, rcv.buf, size));
+
+	free(sbuf);
+	free(rcv.buf);
+}
+
+/** Receive all data of a transfer.
+ *
+ * @param arg	Receiver (test_receiver_t *)
+ * @return	EOK
+ */
+static errno_t test_receiver_fibril(void *arg)
+{
+	test_receiver_t *rcv = (test_receiver_t *) arg;
+	xflags_t xflags;
+	tcp_error_t trc;
+	size_t n;
+
+	while (rcv->rcvd < rcv->size) {
+		trc = tcp_uc_receive(rcv->conn, rcv->buf + rcv->rcvd,
+		    rcv->size - rcv->rcvd, &n, &xflags);
+		if (trc == TCP_EAGAIN) {
+			fibril_usleep(1000);
+			continue;
+		}
+
+		if (trc != TCP_EOK)
+			break;
+
+		rcv->rcvd += n;
+	}
+
+	fibril_mutex_lock(&rcv->lock);
+	rcv->done = true;
+	fibril_mutex_unlock(&rcv->lock);
+	fibril_condvar_broadcast(&rcv->cv);
+
+	return EOK;
+}
+
 /* Tear down client-server connection. */
 static void test_conns_tear_down(tcp_conn_t *cconn, tcp_conn_t *sconn)
 {
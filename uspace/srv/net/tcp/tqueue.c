@@ -43,24 +43,31 @@
 #include <mem.h>
 #include <stdlib.h>
 
+#include "cc.h"
 #include "conn.h"
 #include "inet.h"
+#include "iqueue.h"
 #include "ncsim.h"
 #include "rqueue.h"
+#include "rtt.h"
 #include "segment.h"
 #include "seq_no.h"
+#include "std.h"
 #include "tqueue.h"
 #include "tcp_type.h"
 
-#define RETRANSMIT_TIMEOUT	(2*1000*1000)
-
 static void retransmit_timeout_func(void *);
 static void tcp_tqueue_timer_set(tcp_conn_t *);
+static void tcp_tqueue_timer_start(tcp_conn_t *);
 static void tcp_tqueue_timer_clear(tcp_conn_t *);
 static void tcp_tqueue_seg(tcp_conn_t *, tcp_segment_t *);
 static void tcp_conn_transmit_segment(tcp_conn_t *, tcp_segment_t *);
 static void tcp_prepare_transmit_segment(tcp_conn_t *, tcp_segment_t *);
 static void tcp_tqueue_send_immed(tcp_conn_t *, tcp_segment_t *);
+static void tcp_tqueue_retransmit_first(tcp_conn_t *);
+static void tcp_tqueue_retransmit_entry(tcp_conn_t *, tcp_tqueue_entry_t *);
+static void tcp_tqueue_sack_retransmit(tcp_conn_t *, bool);
+static bool tcp_tqueue_new_seg(tcp_conn_t *);
 
 errno_t tcp_tqueue_init(tcp_tqueue_t *tqueue, tcp_conn_t *conn,
     tcp_tqueue_cb_t *cb)
@@ -148,9 +155,13 @@ static void tcp_tqueue_seg(tcp_conn_t *conn, tcp_segment_t *seg)
 		rt_seg->seq = conn->snd_nxt;
 
 		list_append(&tqe->link, &conn->retransmit.list);
+		conn->pipe += seg->len;
 
-		/* Set retransmission timer */
-		tcp_tqueue_timer_set(conn);
+		/* Measure round-trip time if no other segment is being timed */
+		tcp_rtt_start(&conn->rtt, conn->snd_nxt + seg->len);
+
+		/* Start retransmission timer unless it is running already */
+		tcp_tqueue_timer_start(conn);
 	}
 
 	tcp_prepare_transmit_segment(conn, seg);
@@ -173,24 +184,49 @@ static void tcp_prepare_transmit_segment(tcp_conn_t *conn, tcp_segment_t *seg)
 }
 
 /** Transmit data from the send buffer.
+ *
+ * Data is sent in segments of at most SMSS bytes, as long as both
+ * the send window and the congestion window allow.
  *
  * @param conn	Connection
  */
 void tcp_tqueue_new_data(tcp_conn_t *conn)
+{
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: tcp_tqueue_new_data()", conn->name);
+
+	while (tcp_tqueue_new_seg(conn))
+		;
+}
+
+/** Transmit one segment of data from the send buffer.
+ *
+ * @param conn	Connection
+ * @return	@c true if a segment was sent
+ */
+static bool tcp_tqueue_new_seg(tcp_conn_t *conn)
 {
 	size_t avail_wnd;
 	size_t xfer_seqlen;
 	size_t snd_buf_seqlen;
 	size_t data_size;
+	uint32_t flight;
+	uint32_t wnd;
 	tcp_control_t ctrl;
 	bool send_fin;
 
 	tcp_segment_t *seg;
 
-	log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: tcp_tqueue_new_data()", conn->name);
-
-	/* Number of free sequence numbers in send window */
-	avail_wnd = (conn->snd_una + conn->snd_wnd) - conn->snd_nxt;
+	/*
+	 * Number of free sequence numbers in send and congestion window.
+	 * During SACK-based recovery use the pipe estimate (RFC 6675)
+	 * instead of the flight size.
+	 */
+	if (conn->sack && conn->ca_state == ca_recovery)
+		flight = conn->pipe;
+	else
+		flight = tcp_cc_flight_size(conn);
+	wnd = min(conn->snd_wnd, conn->cwnd);
+	avail_wnd = wnd > flight ? wnd - flight : 0;
 	snd_buf_seqlen = conn->snd_buf_used + (conn->snd_buf_fin ? 1 : 0);
 
 	xfer_seqlen = min(snd_buf_seqlen, avail_wnd);
@@ -199,13 +235,18 @@ void tcp_tqueue_new_data(tcp_conn_t *conn)
 	    xfer_seqlen);
 
 	if (xfer_seqlen == 0)
-		return;
+		return false;
 
 	/* XXX Do not always send immediately */
 
 	send_fin = conn->snd_buf_fin && xfer_seqlen == snd_buf_seqlen;
 	data_size = xfer_seqlen - (send_fin ? 1 : 0);
 
+	if (data_size > conn->smss) {
+		data_size = conn->smss;
+		send_fin = false;
+	}
+
 	if (send_fin) {
 		log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: Sending out FIN.", conn->name);
 		/* We are sending out FIN */
@@ -214,16 +255,15 @@ void tcp_tqueue_new_data(tcp_conn_t *conn)
 		ctrl = 0;
 	}
 
-	seg = tcp_segment_make_data(ctrl, conn->snd_buf, data_size);
+	seg = tcp_segment_make_data_ring(ctrl, conn->snd_buf,
+	    conn->snd_buf_size, conn->snd_buf_head, data_size);
 	if (seg == NULL) {
 		log_msg(LOG_DEFAULT, LVL_ERROR, "Memory allocation failure.");
-		return;
+		return false;
 	}
 
 	/* Remove data from send buffer */
-	memmove(conn->snd_buf, conn->snd_buf + data_size,
-	    conn->snd_buf_used - data_size);
-	conn->snd_buf_used -= data_size;
+	tcp_conn_snd_buf_consume(conn, data_size);
 
 	if (send_fin)
 		conn->snd_buf_fin = false;
@@ -235,6 +275,7 @@ void tcp_tqueue_new_data(tcp_conn_t *conn)
 
 	tcp_tqueue_seg(conn, seg);
 	tcp_segment_delete(seg);
+	return true;
 }
 
 /** Remove ACKed segments from retransmission queue and possibly transmit
@@ -245,10 +286,13 @@ void tcp_tqueue_new_data(tcp_conn_t *conn)
 void tcp_tqueue_ack_received(tcp_conn_t *conn)
 {
 	link_t *cur, *next;
+	uint32_t acked;
+	bool rexmit;
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: tcp_tqueue_ack_received(%p)", conn->name,
 	    conn);
 
+	acked = 0;
 	cur = conn->retransmit.list.head.next;
 
 	while (cur != &conn->retransmit.list.head) {
@@ -270,6 +314,7 @@ void tcp_tqueue_ack_received(tcp_conn_t *conn)
 				conn->fin_is_acked = true;
 			}
 
+			acked += tqe->seg->len;
 			tcp_segment_delete(tqe->seg);
 			free(tqe);
 
@@ -284,22 +329,278 @@ void tcp_tqueue_ack_received(tcp_conn_t *conn)
 	if (list_empty(&conn->retransmit.list))
 		tcp_tqueue_timer_clear(conn);
 
+	if (acked > 0) {
+		tcp_rtt_ack(&conn->rtt, conn->snd_una);
+
+		/* Partial ACK during recovery, next segment was lost, too */
+		rexmit = tcp_cc_ack(conn, acked);
+		if (conn->sack && conn->ca_state == ca_recovery)
+			tcp_tqueue_sack_retransmit(conn, false);
+		else if (rexmit)
+			tcp_tqueue_retransmit_first(conn);
+	}
+
 	/* Possibly transmit more data */
 	tcp_tqueue_new_data(conn);
 }
 
+/** Handle duplicate ACK.
+ *
+ * Perform fast retransmit once enough duplicate ACKs have arrived.
+ * The congestion window is inflated by further duplicate ACKs during
+ * fast recovery, which may allow sending new data.
+ *
+ * @param conn	Connection
+ */
+void tcp_tqueue_dupack(tcp_conn_t *conn)
+{
+	link_t *link;
+	tcp_tqueue_entry_t *tqe;
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: tcp_tqueue_dupack()", conn->name);
+
+	if (tcp_cc_dupack(conn)) {
+		conn->fast_rexmits++;
+
+		if (conn->sack) {
+			/* New recovery episode */
+			link = list_first(&conn->retransmit.list);
+			while (link != NULL) {
+				tqe = list_get_instance(link,
+				    tcp_tqueue_entry_t, link);
+				tqe->rexmit = false;
+				link = list_next(link, &conn->retransmit.list);
+			}
+
+			tcp_tqueue_sack_retransmit(conn, true);
+		} else {
+			tcp_tqueue_retransmit_first(conn);
+		}
+	} else if (conn->sack && conn->ca_state == ca_recovery) {
+		tcp_tqueue_sack_retransmit(conn, false);
+	}
+
+	tcp_tqueue_new_data(conn);
+}
+
+/** Process SACK blocks carried by an incoming acknowledgement.
+ *
+ * Mark segments in the retransmission queue that the peer has
+ * selectively acknowledged. These will be skipped when retransmitting.
+ *
+ * @param conn	Connection
+ * @param seg	Received segment
+ */
+void tcp_tqueue_sack_received(tcp_conn_t *conn, tcp_segment_t *seg)
+{
+	tcp_sack_block_t *blk;
+	tcp_tqueue_entry_t *tqe;
+	link_t *link;
+	uint32_t end;
+	size_t i;
+
+	if (!conn->sack)
+		return;
+
+	for (i = 0; i < seg->nsack; i++) {
+		blk = &seg->sack[i];
+
+		/* Ignore blocks outside of SND.UNA..SND.NXT */
+		if ((int32_t)(blk->start - conn->snd_una) < 0 ||
+		    (int32_t)(blk->end - conn->snd_nxt) > 0 ||
+		    (int32_t)(blk->end - blk->start) <= 0) {
+			log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: ignoring invalid "
+			    "SACK block %" PRIu32 "-%" PRIu32, conn->name,
+			    blk->start, blk->end);
+			continue;
+		}
+
+		link = list_first(&conn->retransmit.list);
+		while (link != NULL) {
+			tqe = list_get_instance(link, tcp_tqueue_entry_t, link);
+			end = tqe->seg->seq + tqe->seg->len;
+
+			/* Queue is sorted, nothing further can be covered */
+			if ((int32_t)(end - blk->end) > 0)
+				break;
+
+			if ((int32_t)(tqe->seg->seq - blk->start) >= 0)
+				tqe->sacked = true;
+
+			link = list_next(link, &conn->retransmit.list);
+		}
+	}
+}
+
+/** Compute SACK scoreboard.
+ *
+ * A segment is deemed lost if more than (DupThresh - 1) * SMSS bytes
+ * above it have been selectively acknowledged. Also recompute the pipe
+ * estimate (RFC 6675, section 4).
+ *
+ * @param conn	Connection
+ * @return	Sequence number below which unacknowledged segments are lost
+ */
+static uint32_t tcp_tqueue_scoreboard(tcp_conn_t *conn)
+{
+	tcp_tqueue_entry_t *tqe;
+	link_t *link;
+	uint32_t sacked;
+	uint32_t lost_end;
+	bool lost_found;
+
+	sacked = 0;
+	lost_end = conn->snd_una;
+	lost_found = false;
+	conn->pipe = 0;
+
+	link = list_last(&conn->retransmit.list);
+	while (link != NULL) {
+		tqe = list_get_instance(link, tcp_tqueue_entry_t, link);
+
+		if (tqe->sacked) {
+			sacked += tqe->seg->len;
+			if (!lost_found && sacked > (TCP_DUPACK_THRESH - 1) *
+			    conn->smss) {
+				lost_end = tqe->seg->seq;
+				lost_found = true;
+			}
+		} else {
+			if (!lost_found)
+				conn->pipe += tqe->seg->len;
+			if (tqe->rexmit)
+				conn->pipe += tqe->seg->len;
+		}
+
+		link = list_prev(link, &conn->retransmit.list);
+	}
+
+	return lost_end;
+}
+
+/** Retransmit lost segments during SACK-based loss recovery.
+ *
+ * Retransmit segments deemed lost which have not been retransmitted
+ * yet during the current recovery, as long as the congestion window
+ * allows (RFC 6675, section 5).
+ *
+ * @param conn	Connection
+ * @param fast	Fast retransmit, always retransmit the first unacknowledged
+ *		segment regardless of the congestion window
+ */
+static void tcp_tqueue_sack_retransmit(tcp_conn_t *conn, bool fast)
+{
+	tcp_tqueue_entry_t *tqe;
+	link_t *link;
+	uint32_t lost_end;
+
+	lost_end = tcp_tqueue_scoreboard(conn);
+
+	link = list_first(&conn->retransmit.list);
+	while (link != NULL) {
+		tqe = list_get_instance(link, tcp_tqueue_entry_t, link);
+		link = list_next(link, &conn->retransmit.list);
+
+		if (tqe->sacked || tqe->rexmit)
+			continue;
+
+		if (!fast) {
+			/* Lost segments are followed only by not lost ones */
+			if ((int32_t)(tqe->seg->seq + tqe->seg->len -
+			    lost_end) > 0)
+				break;
+
+			if (conn->cwnd < conn->pipe + conn->smss)
+				break;
+		}
+
+		tcp_tqueue_retransmit_entry(conn, tqe);
+		conn->sack_rexmits++;
+		fast = false;
+	}
+}
+
+/** Retransmit first segment in retransmission queue.
+ *
+ * Segments which have been selectively acknowledged are skipped.
+ *
+ * @param conn	Connection
+ */
+static void tcp_tqueue_retransmit_first(tcp_conn_t *conn)
+{
+	tcp_tqueue_entry_t *tqe;
+	link_t *link;
+
+	link = list_first(&conn->retransmit.list);
+	while (link != NULL) {
+		tqe = list_get_instance(link, tcp_tqueue_entry_t, link);
+		if (!tqe->sacked) {
+			tcp_tqueue_retransmit_entry(conn, tqe);
+			return;
+		}
+
+		link = list_next(link, &conn->retransmit.list);
+	}
+}
+
+/** Retransmit segment from retransmission queue.
+ *
+ * @param conn	Connection
+ * @param tqe	Retransmission queue entry
+ */
+static void tcp_tqueue_retransmit_entry(tcp_conn_t *conn,
+    tcp_tqueue_entry_t *tqe)
+{
+	tcp_segment_t *rt_seg;
+
+	rt_seg = tcp_segment_dup(tqe->seg);
+	if (rt_seg == NULL) {
+		log_msg(LOG_DEFAULT, LVL_ERROR, "Memory allocation failed.");
+		/* XXX Handle properly */
+		return;
+	}
+
+	/* Karn's algorithm, do not time retransmitted segments */
+	conn->rtt.timing = false;
+
+	tqe->rexmit = true;
+	conn->pipe += tqe->seg->len;
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: retransmitting segment, "
+	    "SEG.SEQ=%" PRIu32, conn->name, rt_seg->seq);
+	tcp_conn_transmit_segment(conn, rt_seg);
+	tcp_segment_delete(rt_seg);
+}
+
 static void tcp_conn_transmit_segment(tcp_conn_t *conn, tcp_segment_t *seg)
 {
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: tcp_conn_transmit_segment(%p, %p)",
 	    conn->name, conn, seg);
 
-	seg->wnd = conn->rcv_wnd;
+	if ((seg->ctrl & CTL_SYN) != 0) {
+		/* Window in SYN is never scaled, offer our scale instead */
+		seg->wnd = min(conn->rcv_wnd, TCP_WND_MAX);
+		seg->has_wscale = conn->wscale;
+		seg->wscale = conn->rcv_wscale;
+		seg->sack_perm = conn->sack;
+	} else {
+		seg->wnd = min(conn->rcv_wnd >> conn->rcv_wscale, TCP_WND_MAX);
+		seg->sack_perm = false;
+	}
 
 	if ((seg->ctrl & CTL_ACK) != 0)
 		seg->ack = conn->rcv_nxt;
 	else
 		seg->ack = 0;
 
+	/* Report out-of-order data we are holding */
+	if (conn->sack && (seg->ctrl & (CTL_ACK | CTL_SYN)) == CTL_ACK) {
+		seg->nsack = tcp_iqueue_sack_blocks(&conn->incoming,
+		    seg->sack, TCP_SACK_BLOCKS_MAX);
+	} else {
+		seg->nsack = 0;
+	}
+
 	tcp_tqueue_send_immed(conn, seg);
 }
 
@@ -321,7 +622,6 @@ static void retransmit_timeout_func(void *arg)
 {
 	tcp_conn_t *conn = (tcp_conn_t *) arg;
 	tcp_tqueue_entry_t *tqe;
-	tcp_segment_t *rt_seg;
 	link_t *link;
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "### %s: retransmit_timeout_func(%p)", conn->name, conn);
@@ -343,22 +643,29 @@ static void retransmit_timeout_func(void *arg)
 		return;
 	}
 
-	tqe = list_get_instance(link, tcp_tqueue_entry_t, link);
+	conn->rto_expiries++;
 
-	rt_seg = tcp_segment_dup(tqe->seg);
-	if (rt_seg == NULL) {
-		log_msg(LOG_DEFAULT, LVL_ERROR, "Memory allocation failed.");
-		tcp_conn_unlock(conn);
-		tcp_conn_delref(conn);
-		/* XXX Handle properly */
-		return;
+	/* Back off timer and shrink congestion window to loss window */
+	tcp_rtt_backoff(&conn->rtt);
+	tcp_cc_timeout(conn);
+
+	/*
+	 * The peer may have discarded data it selectively acknowledged,
+	 * do not rely on SACK information after timeout (RFC 2018).
+	 */
+	while (link != NULL) {
+		tqe = list_get_instance(link, tcp_tqueue_entry_t, link);
+		tqe->sacked = false;
+		tqe->rexmit = false;
+		link = list_next(link, &conn->retransmit.list);
 	}
 
-	log_msg(LOG_DEFAULT, LVL_DEBUG, "### %s: retransmitting segment", conn->name);
-	tcp_conn_transmit_segment(tqe->conn, rt_seg);
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "### %s: RTO=%lld", conn->name,
+	    (long long) conn->rtt.rto);
+	tcp_tqueue_retransmit_first(conn);
 
 	/* Reset retransmission timer */
-	fibril_timer_set_locked(conn->retransmit.timer, RETRANSMIT_TIMEOUT,
+	fibril_timer_set_locked(conn->retransmit.timer, conn->rtt.rto,
 	    retransmit_timeout_func, (void *) conn);
 
 	tcp_conn_unlock(conn);
@@ -377,12 +684,26 @@ static void tcp_tqueue_timer_set(tcp_conn_t *conn)
 	tcp_tqueue_timer_clear(conn);
 
 	tcp_conn_addref(conn);
-	fibril_timer_set_locked(conn->retransmit.timer, RETRANSMIT_TIMEOUT,
+	fibril_timer_set_locked(conn->retransmit.timer, conn->rtt.rto,
 	    retransmit_timeout_func, (void *) conn);
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "### %s: tcp_tqueue_timer_set() end", conn->name);
 }
 
+/** Start retransmission timer if it is not running.
+ *
+ * Sending new data must not postpone the timeout of the oldest
+ * outstanding segment (RFC 6298, 5.1). Only an acknowledgement of new
+ * data restarts a running timer.
+ */
+static void tcp_tqueue_timer_start(tcp_conn_t *conn)
+{
+	assert(fibril_mutex_is_locked(&conn->lock));
+
+	if (conn->retransmit.timer->state != fts_active)
+		tcp_tqueue_timer_set(conn);
+}
+
 /** Clear retransmission timer */
 static void tcp_tqueue_timer_clear(tcp_conn_t *conn)
 {
@@ -147,6 +147,11 @@ tcp_error_t tcp_uc_send(tcp_conn_t *conn, void *data, size_t size,
 
 	while (size > 0) {
 		buf_free = conn->snd_buf_size - conn->snd_buf_used;
+		if (buf_free == 0) {
+			tcp_conn_snd_buf_tune(conn);
+			buf_free = conn->snd_buf_size - conn->snd_buf_used;
+		}
+
 		while (buf_free == 0 && !conn->reset) {
 			log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: buf_free == 0, waiting.",
 			    conn->name);
@@ -162,9 +167,8 @@ tcp_error_t tcp_uc_send(tcp_conn_t *conn, void *data, size_t size,
 		xfer_size = min(size, buf_free);
 
 		/* Copy data to buffer */
-		memcpy(conn->snd_buf + conn->snd_buf_used, data, xfer_size);
+		tcp_conn_snd_buf_append(conn, data, xfer_size);
 		data += xfer_size;
-		conn->snd_buf_used += xfer_size;
 		size -= xfer_size;
 
 		tcp_tqueue_new_data(conn);
@@ -217,13 +221,10 @@ tcp_error_t tcp_uc_receive(tcp_conn_t *conn, void *buf, size_t size,
 
 	/* Copy data from receive buffer to user buffer */
 	xfer_size = min(size, conn->rcv_buf_used);
-	memcpy(buf, conn->rcv_buf, xfer_size);
+	tcp_conn_rcv_buf_get(conn, buf, xfer_size);
 	*rcvd = xfer_size;
 
-	/* Remove data from receive buffer */
-	memmove(conn->rcv_buf, conn->rcv_buf + xfer_size, conn->rcv_buf_used -
-	    xfer_size);
-	conn->rcv_buf_used -= xfer_size;
+	/* Reopen receive window */
 	conn->rcv_wnd += xfer_size;
 
 	/* TODO */
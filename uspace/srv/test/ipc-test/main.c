@@ -39,6 +39,7 @@
 
 #include <as.h>
 #include <async.h>
+#include <async_ring.h>
 #include <errno.h>
 #include <str_error.h>
 #include <io/log.h>
@@ -181,6 +182,31 @@ static void ipc_test_share_in_rw_srv(ipc_call_t *icall)
 	async_answer_0(icall, EOK);
 }
 
+static void ipc_test_ring_msg(async_ring_msg_t *msg, void *arg)
+{
+	switch (msg->imethod) {
+	case IPC_TEST_PING:
+		msg->retval = EOK;
+		break;
+	default:
+		msg->retval = ENOTSUP;
+		break;
+	}
+}
+
+static void ipc_test_ring_srv(ipc_call_t *icall)
+{
+	errno_t rc;
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "ipc_test_ring_srv");
+
+	rc = async_ring_serve(icall, ipc_test_ring_msg, NULL);
+	if (rc != EOK) {
+		log_msg(LOG_DEFAULT, LVL_ERROR, "async_ring_serve failed (%s)",
+		    str_error(rc));
+	}
+}
+
 static void ipc_test_connection(ipc_call_t *icall, void *arg)
 {
 	/* Accept connection */
@@ -211,6 +237,10 @@ static void ipc_test_connection(ipc_call_t *icall, void *arg)
 		case IPC_TEST_SHARE_IN_RW:
 			ipc_test_share_in_rw_srv(&call);
 			break;
+		case IPC_TEST_RING:
+			/* The connection serves the ring until hangup */
+			ipc_test_ring_srv(&call);
+			return;
 		default:
 			async_answer_0(&call, ENOTSUP);
 			break;